@@ -0,0 +1,165 @@
+/**
+ * @file deferred.c
+ * @brief 延迟回复实现
+ *
+ * 所有函数只在事件循环线程调用 (HTTP 事件与 GDBus 异步回调共用
+ * 默认 GMainContext), 因此挂起列表不需要加锁. 句柄由异步回调通过
+ * deferred_end 释放; 连接先关闭时只断开与连接的关联并取消调用,
+ * 句柄仍等回调来释放, 保证回调拿到的指针始终有效.
+ *
+ * 挂起期间客户端流水线发来的后续请求留在 c->recv 中. 事件源空闲时不会
+ * 再唤醒 (见 http_server.c), 因此回复后安排一次空闲回调重新解析; 不能在
+ * deferred_end 中直接解析, 它可能正处于该连接的 HTTP 解析循环之内.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "mongoose.h"
+#include "deferred.h"
+
+struct DeferredReply {
+    struct mg_connection *conn;     /* NULL 表示客户端已断开 */
+    unsigned long conn_id;
+    GCancellable *cancellable;
+    guint timer_id;
+    int timed_out;
+    DeferredReply *next;
+};
+
+static DeferredReply *g_pending = NULL;
+static int g_pending_count = 0;
+
+/* ==================== 内部函数 ==================== */
+
+static void pending_remove(DeferredReply *d) {
+    DeferredReply **pp;
+
+    for (pp = &g_pending; *pp; pp = &(*pp)->next) {
+        if (*pp == d) {
+            *pp = d->next;
+            d->next = NULL;
+            g_pending_count--;
+            return;
+        }
+    }
+}
+
+static DeferredReply *pending_find(struct mg_connection *c) {
+    DeferredReply *d;
+
+    for (d = g_pending; d; d = d->next) {
+        if (d->conn == c) return d;
+    }
+    return NULL;
+}
+
+/* 恢复解析的目标连接, 按 id 查找, 期间连接可能已关闭 */
+typedef struct {
+    struct mg_mgr *mgr;
+    unsigned long conn_id;
+} ResumeTarget;
+
+static gboolean on_resume(gpointer user_data) {
+    ResumeTarget *t = (ResumeTarget *)user_data;
+    struct mg_connection *c;
+
+    for (c = t->mgr->conns; c; c = c->next) {
+        if (c->id != t->conn_id) continue;
+        if (!c->is_resp && !c->is_closing && !c->is_draining && c->recv.len > 0) {
+            long n = 0;
+            mg_call(c, MG_EV_READ, &n);
+        }
+        break;
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/* 期限到达: 取消异步调用, 由其回调回复 504 */
+static gboolean on_deadline(gpointer user_data) {
+    DeferredReply *d = (DeferredReply *)user_data;
+
+    d->timer_id = 0;
+    d->timed_out = 1;
+    printf("[DEFERRED] 连接 %lu 超过期限, 取消调用\n", d->conn_id);
+    g_cancellable_cancel(d->cancellable);
+    return G_SOURCE_REMOVE;
+}
+
+/* ==================== 公共接口 ==================== */
+
+DeferredReply *deferred_begin(struct mg_connection *c, int timeout_ms) {
+    DeferredReply *d = g_new0(DeferredReply, 1);
+
+    d->conn = c;
+    d->conn_id = c->id;
+    d->cancellable = g_cancellable_new();
+    if (timeout_ms > 0) {
+        d->timer_id = g_timeout_add((guint)timeout_ms, on_deadline, d);
+    }
+
+    d->next = g_pending;
+    g_pending = d;
+    g_pending_count++;
+
+    /* 处理函数返回后不回复, 保持挂起直到 deferred_end */
+    c->is_resp = 1;
+    return d;
+}
+
+GCancellable *deferred_cancellable(DeferredReply *d) {
+    return d->cancellable;
+}
+
+struct mg_connection *deferred_conn(DeferredReply *d) {
+    return d->conn;
+}
+
+int deferred_timed_out(DeferredReply *d) {
+    return d->timed_out;
+}
+
+void deferred_end(DeferredReply *d) {
+    if (!d) return;
+
+    if (d->timer_id) g_source_remove(d->timer_id);
+    if (d->conn) {
+        d->conn->is_resp = 0;
+        pending_remove(d);
+        if (d->conn->recv.len > 0) {
+            ResumeTarget *t = g_new(ResumeTarget, 1);
+
+            t->mgr = d->conn->mgr;
+            t->conn_id = d->conn_id;
+            g_idle_add_full(G_PRIORITY_DEFAULT, on_resume, t, g_free);
+        }
+    }
+    g_object_unref(d->cancellable);
+    g_free(d);
+}
+
+int deferred_handle_event(struct mg_connection *c, int ev, void *ev_data) {
+    DeferredReply *d;
+
+    (void)ev_data;
+    if (ev != MG_EV_CLOSE) return 0;
+
+    d = pending_find(c);
+    if (!d) return 0;
+
+    /* 连接即将释放: 断开关联, 取消调用, 句柄留给回调释放 */
+    pending_remove(d);
+    d->conn = NULL;
+    if (d->timer_id) {
+        g_source_remove(d->timer_id);
+        d->timer_id = 0;
+    }
+    printf("[DEFERRED] 连接 %lu 已断开, 取消进行中的调用\n", d->conn_id);
+    g_cancellable_cancel(d->cancellable);
+    return 1;
+}
+
+int deferred_pending_count(void) {
+    return g_pending_count;
+}
@@ -20,63 +20,57 @@
 #include "ofono.h"
 #include "automation.h"
 #include "http_utils.h"
+#include "router.h"
+#include "json_writer.h"
+#include "deferred.h"
+#include "spengmd.h"
 
 /* GET /api/info - 获取系统信息 */
 void handle_info(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_GET(c, hm);
 
     SystemInfo info;
-    char json[4096];
+    JsonWriter w;
 
     get_system_info(&info);
 
-    snprintf(json, sizeof(json),
-        "{"
-        "\"hostname\":\"%s\","
-        "\"sysname\":\"%s\","
-        "\"release\":\"%s\","
-        "\"version\":\"%s\","
-        "\"machine\":\"%s\","
-        "\"total_ram\":%lu,"
-        "\"free_ram\":%lu,"
-        "\"cached_ram\":%lu,"
-        "\"cpu_usage\":%.2f,"
-        "\"uptime\":%.2f,"
-        "\"bridge_status\":\"%s\","
-        "\"sim_slot\":\"%s\","
-        "\"signal_strength\":\"%s\","
-        "\"thermal_temp\":%.2f,"
-        "\"power_status\":\"%s\","
-        "\"battery_health\":\"%s\","
-        "\"battery_capacity\":%u,"
-        "\"ssid\":\"%s\","
-        "\"passwd\":\"%s\","
-        "\"select_network_mode\":\"%s\","
-        "\"is_activated\":%d,"
-        "\"serial\":\"%s\","
-        "\"network_mode\":\"%s\","
-        "\"airplane_mode\":%s,"
-        "\"imei\":\"%s\","
-        "\"iccid\":\"%s\","
-        "\"imsi\":\"%s\","
-        "\"carrier\":\"%s\","
-        "\"network_type\":\"%s\","
-        "\"network_band\":\"%s\","
-        "\"qci\":%d,"
-        "\"downlink_rate\":%d,"
-        "\"uplink_rate\":%d"
-        "}",
-        info.hostname, info.sysname, info.release, info.version, info.machine,
-        info.total_ram, info.free_ram, info.cached_ram, info.cpu_usage, info.uptime,
-        info.bridge_status, info.sim_slot, info.signal_strength, info.thermal_temp,
-        info.power_status, info.battery_health, info.battery_capacity,
-        info.ssid, info.passwd, info.select_network_mode, info.is_activated,
-        info.serial, info.network_mode, info.airplane_mode ? "true" : "false",
-        info.imei, info.iccid, info.imsi, info.carrier,
-        info.network_type, info.network_band, info.qci, info.downlink_rate, info.uplink_rate
-    );
-
-    HTTP_OK(c, json);
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_str(&w, "hostname", info.hostname);
+    json_kv_str(&w, "sysname", info.sysname);
+    json_kv_str(&w, "release", info.release);
+    json_kv_str(&w, "version", info.version);
+    json_kv_str(&w, "machine", info.machine);
+    json_kv_uint(&w, "total_ram", info.total_ram);
+    json_kv_uint(&w, "free_ram", info.free_ram);
+    json_kv_uint(&w, "cached_ram", info.cached_ram);
+    json_kv_double(&w, "cpu_usage", info.cpu_usage, 2);
+    json_kv_double(&w, "uptime", info.uptime, 2);
+    json_kv_str(&w, "bridge_status", info.bridge_status);
+    json_kv_str(&w, "sim_slot", info.sim_slot);
+    json_kv_str(&w, "signal_strength", info.signal_strength);
+    json_kv_double(&w, "thermal_temp", info.thermal_temp, 2);
+    json_kv_str(&w, "power_status", info.power_status);
+    json_kv_str(&w, "battery_health", info.battery_health);
+    json_kv_uint(&w, "battery_capacity", info.battery_capacity);
+    json_kv_str(&w, "ssid", info.ssid);
+    json_kv_str(&w, "passwd", info.passwd);
+    json_kv_str(&w, "select_network_mode", info.select_network_mode);
+    json_kv_int(&w, "is_activated", info.is_activated);
+    json_kv_str(&w, "serial", info.serial);
+    json_kv_str(&w, "network_mode", info.network_mode);
+    json_kv_bool(&w, "airplane_mode", info.airplane_mode);
+    json_kv_str(&w, "imei", info.imei);
+    json_kv_str(&w, "iccid", info.iccid);
+    json_kv_str(&w, "imsi", info.imsi);
+    json_kv_str(&w, "carrier", info.carrier);
+    json_kv_str(&w, "network_type", info.network_type);
+    json_kv_str(&w, "network_band", info.network_band);
+    json_kv_int(&w, "qci", info.qci);
+    json_kv_int(&w, "downlink_rate", info.downlink_rate);
+    json_kv_int(&w, "uplink_rate", info.uplink_rate);
+    json_obj_end(&w);
+    json_end(&w);
 }
 
 
@@ -92,19 +86,20 @@ void handle_neighbor_cells(struct mg_connection *c, struct mg_http_message *hm)
         return;
     }
 
-    char json[4096];
-    int offset = 0;
-    offset += snprintf(json + offset, sizeof(json) - offset, "[");
-    
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_arr_begin(&w);
     for (int i = 0; i < count; i++) {
-        offset += snprintf(json + offset, sizeof(json) - offset,
-            "%s{\"tech\":\"%s\",\"cell_id\":%d,\"rsrp\":%d,\"rsrq\":%d,\"earfcn\":%d}",
-            i > 0 ? "," : "",
-            cells[i].tech, cells[i].cell_id, cells[i].rsrp, cells[i].rsrq, cells[i].earfcn);
-    }
-    
-    offset += snprintf(json + offset, sizeof(json) - offset, "]");
-    HTTP_OK(c, json);
+        json_obj_begin(&w);
+        json_kv_str(&w, "tech", cells[i].tech);
+        json_kv_int(&w, "cell_id", cells[i].cell_id);
+        json_kv_int(&w, "rsrp", cells[i].rsrp);
+        json_kv_int(&w, "rsrq", cells[i].rsrq);
+        json_kv_int(&w, "earfcn", cells[i].earfcn);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_end(&w);
 }
 
 /* GET /api/automation/rules - 获取自动化规则 */
@@ -114,19 +109,22 @@ void handle_get_automation_rules(struct mg_connection *c, struct mg_http_message
     AutomationRule rules[MAX_RULES];
     int count = automation_get_rules(rules, MAX_RULES);
 
-    char json[4096];
-    int offset = 0;
-    offset += snprintf(json + offset, sizeof(json) - offset, "[");
-    
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_arr_begin(&w);
     for (int i = 0; i < count; i++) {
-        offset += snprintf(json + offset, sizeof(json) - offset,
-            "%s{\"id\":%d,\"name\":\"%s\",\"trigger\":\"%s\",\"operator\":\"%s\",\"value\":%.2f,\"action\":\"%s\",\"enabled\":%d}",
-            i > 0 ? "," : "",
-            rules[i].id, rules[i].name, rules[i].trigger, rules[i].operator, rules[i].value, rules[i].action, rules[i].enabled);
-    }
-    
-    offset += snprintf(json + offset, sizeof(json) - offset, "]");
-    HTTP_OK(c, json);
+        json_obj_begin(&w);
+        json_kv_int(&w, "id", rules[i].id);
+        json_kv_str(&w, "name", rules[i].name);
+        json_kv_str(&w, "trigger", rules[i].trigger);
+        json_kv_str(&w, "operator", rules[i].operator);
+        json_kv_double(&w, "value", rules[i].value, 2);
+        json_kv_str(&w, "action", rules[i].action);
+        json_kv_int(&w, "enabled", rules[i].enabled);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_end(&w);
 }
 
 /* POST /api/automation/save - 保存/更新规则 */
@@ -190,13 +188,47 @@ static void json_escape_string(const char *src, char *dst, size_t dst_size) {
     dst[j] = '\0';
 }
 
+/* 异步 AT 命令完成, 写回挂起的连接 */
+static void on_execute_at_done(int rc, const char *result, const char *error, void *user_data) {
+    DeferredReply *d = (DeferredReply *)user_data;
+    struct mg_connection *c = deferred_conn(d);
+
+    if (!c) {
+        /* 客户端已断开 */
+        deferred_end(d);
+        return;
+    }
+
+    if (rc == -2 && deferred_timed_out(d)) {
+        HTTP_ERROR(c, 504, "AT 命令响应超时");
+        deferred_end(d);
+        return;
+    }
+
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    if (rc == 0) {
+        printf("AT 命令执行成功: %s\n", result);
+        json_kv_int(&w, "Code", 0);
+        json_kv_str(&w, "Error", "");
+        json_kv_str(&w, "Data", result);
+    } else {
+        printf("AT 命令执行失败: %s\n", error);
+        json_kv_int(&w, "Code", 1);
+        json_kv_str(&w, "Error", error);
+        json_kv_null(&w, "Data");
+    }
+    json_obj_end(&w);
+    json_end(&w);
+    deferred_end(d);
+}
+
 /* POST /api/at - 执行 AT 命令 */
 void handle_execute_at(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_POST(c, hm);
 
     char cmd[256] = {0};
-    char *result = NULL;
-    char response[4096];
 
     /* 使用mongoose内置JSON解析 */
     char *cmd_str = mg_json_get_str(hm->body, "$.command");
@@ -219,23 +251,20 @@ void handle_execute_at(struct mg_connection *c, struct mg_http_message *hm) {
 
     printf("执行 AT 命令: %s\n", cmd);
 
-    /* 执行 AT 命令 */
-    if (execute_at(cmd, &result) == 0) {
-        printf("AT 命令执行成功: %s\n", result);
-        char escaped[2048];
-        json_escape_string(result ? result : "", escaped, sizeof(escaped));
-        snprintf(response, sizeof(response),
-            "{\"Code\":0,\"Error\":\"\",\"Data\":\"%s\"}", escaped);
-        g_free(result);
-    } else {
+    /* 异步执行, 响应在回调中写入 */
+    DeferredReply *d = deferred_begin(c, DEFERRED_DEFAULT_TIMEOUT_MS);
+    if (execute_at_async(cmd, deferred_cancellable(d), on_execute_at_done, d) != 0) {
+        deferred_end(d);
         printf("AT 命令执行失败: %s\n", dbus_get_last_error());
-        char escaped_err[512];
-        json_escape_string(dbus_get_last_error(), escaped_err, sizeof(escaped_err));
-        snprintf(response, sizeof(response),
-            "{\"Code\":1,\"Error\":\"%s\",\"Data\":null}", escaped_err);
+        JsonWriter w;
+        json_begin(&w, c, 200);
+        json_obj_begin(&w);
+        json_kv_int(&w, "Code", 1);
+        json_kv_str(&w, "Error", dbus_get_last_error());
+        json_kv_null(&w, "Data");
+        json_obj_end(&w);
+        json_end(&w);
     }
-
-    HTTP_OK(c, response);
 }
 
 
@@ -270,6 +299,7 @@ void handle_set_network(struct mg_connection *c, struct mg_http_message *hm) {
     }
 
     if (set_network_mode_for_slot(mode, strlen(slot) > 0 ? slot : NULL) == 0) {
+        sysinfo_invalidate(SYSINFO_GROUP_BIT(SYSINFO_GROUP_RADIO));
         HTTP_SUCCESS(c, "Network mode updated successfully");
     } else {
         HTTP_OK(c, "{\"status\":\"error\",\"message\":\"Failed to update network mode\"}");
@@ -296,6 +326,9 @@ void handle_switch(struct mg_connection *c, struct mg_http_message *hm) {
 
     char response[128];
     if (switch_slot(slot) == 0) {
+        /* 换卡后 ICCID/IMSI/运营商也会变化 */
+        sysinfo_invalidate(SYSINFO_GROUP_BIT(SYSINFO_GROUP_RADIO) |
+                           SYSINFO_GROUP_BIT(SYSINFO_GROUP_IDENTITY));
         snprintf(response, sizeof(response), 
             "{\"status\":\"success\",\"message\":\"Slot switched to %s successfully\"}", slot);
     } else {
@@ -321,6 +354,7 @@ void handle_airplane_mode(struct mg_connection *c, struct mg_http_message *hm) {
     }
 
     if (set_airplane_mode(enabled) == 0) {
+        sysinfo_invalidate(SYSINFO_GROUP_BIT(SYSINFO_GROUP_RADIO));
         HTTP_SUCCESS(c, "Airplane mode updated successfully");
     } else {
         HTTP_ERROR(c, 500, "Failed to set airplane mode: AT command failed");
@@ -363,120 +397,22 @@ void handle_clear_cache(struct mg_connection *c, struct mg_http_message *hm) {
 }
 
 
-/* 解析 AT 命令返回的小区数据 (Go: parseCellToVec) */
-/* 返回解析后的行数，data 是二维数组 [行][列] */
-int parse_cell_to_vec(const char *input, char data[64][16][32]) {
-    char cleaned[4096];
-    strncpy(cleaned, input, sizeof(cleaned) - 1);
-    cleaned[sizeof(cleaned) - 1] = '\0';
-
-    /* 去除 OK 和换行符 */
-    char *ok_pos = strstr(cleaned, "OK");
-    if (ok_pos) *ok_pos = '\0';
-    
-    /* 替换 \r\n 为空 */
-    char *p = cleaned;
-    char *dst = cleaned;
-    while (*p) {
-        if (*p != '\r' && *p != '\n') {
-            *dst++ = *p;
-        }
-        p++;
-    }
-    *dst = '\0';
-
-    int row = 0;
-    int col = 0;
-    char current_part[4096] = {0};
-    int part_len = 0;
-    char prev_char = 0;
-
-    p = cleaned;
-    while (*p && row < 64) {
-        char c = *p;
-        
-        if (c == '-') {
-            if (prev_char == ',') {
-                /* 规则2: ,- 作为负数处理 */
-                current_part[part_len++] = c;
-            } else if (*(p + 1) == '-') {
-                /* 规则3: -- 分割换行并保留第二个 - */
-                if (part_len > 0) {
-                    current_part[part_len] = '\0';
-                    /* 按逗号分割 */
-                    col = 0;
-                    char *token = strtok(current_part, ",");
-                    while (token && col < 16) {
-                        while (*token == ' ') token++;
-                        strncpy(data[row][col], token, 31);
-                        data[row][col][31] = '\0';
-                        col++;
-                        token = strtok(NULL, ",");
-                    }
-                    row++;
-                    part_len = 0;
-                }
-                current_part[part_len++] = '-';
-                p++; /* 跳过下一个 - */
-            } else {
-                /* 规则1: 单独 - 换行 */
-                if (part_len > 0) {
-                    current_part[part_len] = '\0';
-                    col = 0;
-                    char *token = strtok(current_part, ",");
-                    while (token && col < 16) {
-                        while (*token == ' ') token++;
-                        strncpy(data[row][col], token, 31);
-                        data[row][col][31] = '\0';
-                        col++;
-                        token = strtok(NULL, ",");
-                    }
-                    row++;
-                    part_len = 0;
-                }
-            }
-        } else {
-            current_part[part_len++] = c;
-        }
-        prev_char = c;
-        p++;
-    }
-
-    /* 处理最后剩余部分 */
-    if (part_len > 0 && row < 64) {
-        current_part[part_len] = '\0';
-        col = 0;
-        char *token = strtok(current_part, ",");
-        while (token && col < 16) {
-            while (*token == ' ') token++;
-            strncpy(data[row][col], token, 31);
-            data[row][col][31] = '\0';
-            col++;
-            token = strtok(NULL, ",");
-        }
-        row++;
-    }
-
-    return row;
-}
-
 /**
  * 判断当前网络是否为 5G
  * 通过 D-Bus 查询 oFono NetworkMonitor 获取网络类型
  * @return 1=5G, 0=4G/其他
  */
 static int is_5g_network(void) {
-    char output[2048];
+    char tech[32] = {0};
     
-    /* 使用 dbus-send 获取网络信息 (与 Go 版本一致) */
-    if (run_command(output, sizeof(output), "dbus-send", "--system", "--dest=org.ofono", 
-                    "--print-reply", "/ril_0", "org.ofono.NetworkMonitor.GetServingCellInformation", NULL) != 0) {
+    /* 经共享 D-Bus 连接查询, 不再 fork dbus-send */
+    if (ofono_get_serving_cell_tech(tech, sizeof(tech)) != 0) {
         printf("D-Bus 查询网络类型失败，默认使用 4G\n");
         return 0;
     }
 
-    /* 判断网络类型 - 检查是否包含 "nr" */
-    if (strstr(output, "\"nr\"")) {
+    /* 判断网络类型 - 检查是否为 "nr" */
+    if (strcmp(tech, "nr") == 0) {
         return 1; /* 5G */
     }
     
@@ -497,69 +433,27 @@ void handle_get_current_band(struct mg_connection *c, struct mg_http_message *hm
     int is_5g = is_5g_network();
     char *result = NULL;
 
-    if (is_5g) {
-        /* 5G 网络: AT+SPENGMD=0,14,1 */
-        if (execute_at("AT+SPENGMD=0,14,1", &result) == 0 && result && strlen(result) > 100) {
-            char data[64][16][32] = {{{0}}};
-            int rows = parse_cell_to_vec(result, data);
-            
-            if (rows > 15) {
-                strcpy(net_type, "5G NR");
-                if (strlen(data[0][0]) > 0) {
-                    snprintf(band, sizeof(band), "N%s", data[0][0]);
-                }
-                if (strlen(data[1][0]) > 0) {
-                    arfcn = atoi(data[1][0]);
-                }
-                if (strlen(data[2][0]) > 0) {
-                    pci = atoi(data[2][0]);
-                }
-                if (strlen(data[3][0]) > 0) {
-                    rsrp = atof(data[3][0]) / 100.0;
-                }
-                if (strlen(data[4][0]) > 0) {
-                    rsrq = atof(data[4][0]) / 100.0;
-                }
-                if (strlen(data[15][0]) > 0) {
-                    sinr = atof(data[15][0]) / 100.0;
-                }
-                printf("当前连接5G频段: Band=%s, ARFCN=%d, PCI=%d, RSRP=%.2f, RSRQ=%.2f, SINR=%.2f\n",
-                       band, arfcn, pci, rsrp, rsrq, sinr);
-            }
-        }
-        if (result) { g_free(result); result = NULL; }
-    } else {
-        /* 4G 网络: AT+SPENGMD=0,6,0 */
-        if (execute_at("AT+SPENGMD=0,6,0", &result) == 0 && result && strlen(result) > 100) {
-            char data[64][16][32] = {{{0}}};
-            int rows = parse_cell_to_vec(result, data);
-            
-            if (rows > 33) {
-                strcpy(net_type, "4G LTE");
-                if (strlen(data[0][0]) > 0) {
-                    snprintf(band, sizeof(band), "B%s", data[0][0]);
-                }
-                if (strlen(data[1][0]) > 0) {
-                    arfcn = atoi(data[1][0]);
-                }
-                if (strlen(data[2][0]) > 0) {
-                    pci = atoi(data[2][0]);
-                }
-                if (strlen(data[3][0]) > 0) {
-                    rsrp = atof(data[3][0]) / 100.0;
-                }
-                if (strlen(data[4][0]) > 0) {
-                    rsrq = atof(data[4][0]) / 100.0;
-                }
-                if (strlen(data[33][0]) > 0) {
-                    sinr = atof(data[33][0]) / 100.0;
-                }
-                printf("当前连接4G频段: Band=%s, ARFCN=%d, PCI=%d, RSRP=%.2f, RSRQ=%.2f, SINR=%.2f\n",
-                       band, arfcn, pci, rsrp, rsrq, sinr);
+    /* 5G: AT+SPENGMD=0,14,1, 4G: AT+SPENGMD=0,6,0 */
+    SpengmdRat rat = is_5g ? SPENGMD_NR : SPENGMD_LTE;
+    if (execute_at(is_5g ? "AT+SPENGMD=0,14,1" : "AT+SPENGMD=0,6,0", &result) == 0 &&
+        result && strlen(result) > 100) {
+        SpengmdCell cell;
+
+        if (spengmd_parse_serving(result, rat, &cell) == 0) {
+            strcpy(net_type, is_5g ? "5G NR" : "4G LTE");
+            if (cell.band > 0) {
+                snprintf(band, sizeof(band), "%c%d", is_5g ? 'N' : 'B', cell.band);
             }
+            arfcn = cell.arfcn;
+            pci = cell.pci;
+            rsrp = cell.rsrp;
+            rsrq = cell.rsrq;
+            sinr = cell.sinr;
+            printf("当前连接%s频段: Band=%s, ARFCN=%d, PCI=%d, RSRP=%.2f, RSRQ=%.2f, SINR=%.2f\n",
+                   is_5g ? "5G" : "4G", band, arfcn, pci, rsrp, rsrq, sinr);
         }
-        if (result) { g_free(result); result = NULL; }
     }
+    if (result) { g_free(result); result = NULL; }
 
     snprintf(response, sizeof(response),
         "{\"Code\":0,\"Error\":\"\",\"Data\":{"
@@ -580,40 +474,119 @@ void handle_get_current_band(struct mg_connection *c, struct mg_http_message *hm
 /* ==================== 短信 API ==================== */
 #include "sms.h"
 
-/* GET /api/sms - 获取短信列表 */
+static int query_int(struct mg_http_message *hm, const char *name, int def) {
+    char buf[16];
+    if (mg_http_get_var(&hm->query, name, buf, sizeof(buf)) <= 0) return def;
+    return atoi(buf);
+}
+
+static void write_sms_message(const SmsMessage *msg, void *user_data) {
+    JsonWriter *w = (JsonWriter *)user_data;
+    char time_str[32];
+    struct tm tm_info;
+
+    localtime_r(&msg->timestamp, &tm_info);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", &tm_info);
+
+    json_obj_begin(w);
+    json_kv_int(w, "id", msg->id);
+    json_kv_str(w, "sender", msg->sender);
+    json_kv_str(w, "content", msg->content);
+    json_kv_str(w, "timestamp", time_str);
+    json_kv_bool(w, "read", msg->is_read);
+    json_obj_end(w);
+}
+
+/*
+ * GET /api/sms - 获取短信列表
+ * ?before_id=&after_id=&limit=&sender=&q=
+ * 按 id 降序, 下一页以本页最后一条的 id 作为 before_id; after_id 用于只取新短信
+ */
 void handle_sms_list(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_GET(c, hm);
 
-    SmsMessage messages[100];
-    int count = sms_get_list(messages, 100);
-    
-    if (count < 0) {
-        HTTP_ERROR(c, 500, "获取短信列表失败");
+    char sender[64] = {0};
+    char keyword[256] = {0};
+    SmsQuery query = {0};
+    JsonWriter w;
+
+    query.before_id = query_int(hm, "before_id", 0);
+    query.after_id = query_int(hm, "after_id", 0);
+    query.limit = query_int(hm, "limit", SMS_PAGE_DEFAULT);
+    if (mg_http_get_var(&hm->query, "sender", sender, sizeof(sender)) > 0) query.sender = sender;
+    if (mg_http_get_var(&hm->query, "q", keyword, sizeof(keyword)) > 0) query.keyword = keyword;
+
+    /* 逐行写入发送缓冲区, 不经过中间数组 */
+    json_begin(&w, c, 200);
+    json_arr_begin(&w);
+    sms_query(&query, write_sms_message, &w);
+    json_arr_end(&w);
+    json_end(&w);
+}
+
+static void write_sms_conversation(const SmsConversation *conv, void *user_data) {
+    JsonWriter *w = (JsonWriter *)user_data;
+
+    json_obj_begin(w);
+    json_kv_str(w, "sender", conv->sender);
+    json_kv_int(w, "count", conv->count);
+    json_kv_int(w, "unread", conv->unread);
+    json_kv_int(w, "last_id", conv->last_id);
+    json_kv_int(w, "last_timestamp", (long long)conv->last_timestamp);
+    json_kv_str(w, "last_content", conv->last_content);
+    json_obj_end(w);
+}
+
+/* GET /api/sms/conversations?limit= - 按号码汇总的会话列表 */
+void handle_sms_conversations(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    int limit = query_int(hm, "limit", SMS_PAGE_DEFAULT);
+    JsonWriter w;
+
+    if (limit <= 0 || limit > SMS_PAGE_MAX) limit = SMS_PAGE_DEFAULT;
+
+    json_begin(&w, c, 200);
+    json_arr_begin(&w);
+    sms_get_conversations(limit, write_sms_conversation, &w);
+    json_arr_end(&w);
+    json_end(&w);
+}
+
+/* GET /api/sms/unread - 未读数、总数与最新短信ID (供前端轮询) */
+void handle_sms_unread(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    int unread = 0, total = 0, latest_id = 0;
+    char json[128];
+
+    if (sms_get_unread_stats(&unread, &total, &latest_id) != 0) {
+        HTTP_ERROR(c, 500, "获取未读数失败");
         return;
     }
 
-    /* 构建JSON数组 */
-    char json[65536];
-    int offset = 0;
-    offset += snprintf(json + offset, sizeof(json) - offset, "[");
-    
-    for (int i = 0; i < count; i++) {
-        char escaped_content[2048];
-        json_escape_string(messages[i].content, escaped_content, sizeof(escaped_content));
-        
-        char time_str[32];
-        struct tm *tm_info = localtime(&messages[i].timestamp);
-        strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", tm_info);
-        
-        offset += snprintf(json + offset, sizeof(json) - offset,
-            "%s{\"id\":%d,\"sender\":\"%s\",\"content\":\"%s\",\"timestamp\":\"%s\",\"read\":%s}",
-            i > 0 ? "," : "",
-            messages[i].id, messages[i].sender, escaped_content, time_str,
-            messages[i].is_read ? "true" : "false");
+    snprintf(json, sizeof(json), "{\"unread\":%d,\"total\":%d,\"latest_id\":%d}", unread, total, latest_id);
+    HTTP_OK(c, json);
+}
+
+/* POST /api/sms/read - 标记已读 {"id":1} / {"sender":"10086"} / {} 全部 */
+void handle_sms_mark_read(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    int id = (int)mg_json_get_long(hm->body, "$.id", 0);
+    char *sender = mg_json_get_str(hm->body, "$.sender");
+    int changed = sms_mark_read(id, sender);
+    int unread = 0;
+    char json[128];
+
+    free(sender);
+    if (changed < 0) {
+        HTTP_ERROR(c, 500, "标记已读失败");
+        return;
     }
-    
-    offset += snprintf(json + offset, sizeof(json) - offset, "]");
 
+    sms_get_unread_stats(&unread, NULL, NULL);
+    snprintf(json, sizeof(json), "{\"status\":\"success\",\"changed\":%d,\"unread\":%d}", changed, unread);
     HTTP_OK(c, json);
 }
 
@@ -650,13 +623,9 @@ void handle_sms_send(struct mg_connection *c, struct mg_http_message *hm) {
 void handle_sms_delete(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_DELETE(c, hm);
 
-    int id = 0;
-    const char *uri = hm->uri.buf;
-    const char *id_start = strstr(uri, "/api/sms/");
-    if (id_start) {
-        id_start += 9;
-        id = atoi(id_start);
-    }
+    /* 路由通配段即短信ID */
+    char id_str[32];
+    int id = router_param(0, id_str, sizeof(id_str)) > 0 ? atoi(id_str) : 0;
 
     if (id <= 0) {
         HTTP_ERROR(c, 400, "无效的短信ID");
@@ -687,8 +656,10 @@ void handle_sms_webhook_get(struct mg_connection *c, struct mg_http_message *hm)
 
     char json[8192];
     snprintf(json, sizeof(json),
-        "{\"enabled\":%s,\"platform\":\"%s\",\"url\":\"%s\",\"body\":\"%s\",\"headers\":\"%s\"}",
-        config.enabled ? "true" : "false", config.platform, config.url, escaped_body, escaped_headers);
+        "{\"enabled\":%s,\"platform\":\"%s\",\"url\":\"%s\",\"body\":\"%s\",\"headers\":\"%s\","
+        "\"tlsInsecure\":%s}",
+        config.enabled ? "true" : "false", config.platform, config.url, escaped_body, escaped_headers,
+        config.tls_insecure ? "true" : "false");
 
     HTTP_OK(c, json);
 }
@@ -753,6 +724,9 @@ void handle_sms_webhook_save(struct mg_connection *c, struct mg_http_message *hm
     if (strstr(json_buf, "\"enabled\":true") || strstr(json_buf, "\"enabled\": true")) {
         config.enabled = 1;
     }
+    if (strstr(json_buf, "\"tlsInsecure\":true") || strstr(json_buf, "\"tlsInsecure\": true")) {
+        config.tls_insecure = 1;
+    }
     
     /* 使用智能解析函数解析字符串字段 */
     parse_json_string_field(json_buf, "platform", config.platform, sizeof(config.platform));
@@ -772,7 +746,7 @@ void handle_sms_webhook_test(struct mg_connection *c, struct mg_http_message *hm
     HTTP_CHECK_POST(c, hm);
 
     if (sms_test_webhook() == 0) {
-        HTTP_SUCCESS(c, "测试通知已发送");
+        HTTP_SUCCESS(c, "测试通知已加入发送队列");
     } else {
         HTTP_ERROR(c, 500, "Webhook未启用或URL为空");
     }
@@ -790,37 +764,20 @@ void handle_sms_sent_list(struct mg_connection *c, struct mg_http_message *hm) {
         return;
     }
 
-    char json[65536];
-    int offset = snprintf(json, sizeof(json), "[");
-    
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_arr_begin(&w);
     for (int i = 0; i < count; i++) {
-        char escaped_content[2048];
-        size_t j = 0;
-        for (size_t k = 0; messages[i].content[k] && j < sizeof(escaped_content) - 2; k++) {
-            char ch = messages[i].content[k];
-            if (ch == '"' || ch == '\\') {
-                escaped_content[j++] = '\\';
-            } else if (ch == '\n') {
-                escaped_content[j++] = '\\';
-                ch = 'n';
-            } else if (ch == '\r') {
-                escaped_content[j++] = '\\';
-                ch = 'r';
-            }
-            escaped_content[j++] = ch;
-        }
-        escaped_content[j] = '\0';
-        
-        offset += snprintf(json + offset, sizeof(json) - offset,
-            "%s{\"id\":%d,\"recipient\":\"%s\",\"content\":\"%s\",\"timestamp\":%ld,\"status\":\"%s\"}",
-            i > 0 ? "," : "",
-            messages[i].id, messages[i].recipient, escaped_content,
-            (long)messages[i].timestamp, messages[i].status);
-    }
-    
-    snprintf(json + offset, sizeof(json) - offset, "]");
-    
-    HTTP_OK(c, json);
+        json_obj_begin(&w);
+        json_kv_int(&w, "id", messages[i].id);
+        json_kv_str(&w, "recipient", messages[i].recipient);
+        json_kv_str(&w, "content", messages[i].content);
+        json_kv_int(&w, "timestamp", (long long)messages[i].timestamp);
+        json_kv_str(&w, "status", messages[i].status);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_end(&w);
 }
 
 /* GET /api/sms/config - 获取短信配置 */
@@ -871,13 +828,8 @@ void handle_sms_config_save(struct mg_connection *c, struct mg_http_message *hm)
 void handle_sms_sent_delete(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_DELETE(c, hm);
 
-    int id = 0;
-    const char *uri = hm->uri.buf;
-    const char *id_start = strstr(uri, "/api/sms/sent/");
-    if (id_start) {
-        id_start += 14;
-        id = atoi(id_start);
-    }
+    char id_str[32];
+    int id = router_param(0, id_str, sizeof(id_str)) > 0 ? atoi(id_str) : 0;
 
     if (id <= 0) {
         HTTP_ERROR(c, 400, "无效的ID");
@@ -1132,6 +1084,85 @@ void handle_set_system_time(struct mg_connection *c, struct mg_http_message *hm)
 /* ==================== 数据连接和漫游 API ==================== */
 #include "ofono.h"
 
+/*
+ * POST 开关请求通过异步 D-Bus 调用完成, 连接在回调前保持挂起,
+ * GET 仍由工作线程执行 (镜像未就绪时需要同步查询).
+ */
+typedef struct {
+    DeferredReply *d;
+    int value;                  /* 请求设置的值 */
+} SwitchReply;
+
+static SwitchReply *switch_reply_new(struct mg_connection *c, int value) {
+    SwitchReply *r = g_new0(SwitchReply, 1);
+    r->d = deferred_begin(c, DEFERRED_DEFAULT_TIMEOUT_MS);
+    r->value = value;
+    return r;
+}
+
+static void switch_reply_end(SwitchReply *r) {
+    deferred_end(r->d);
+    g_free(r);
+}
+
+/* 回复失败结果, 超过期限时返回 504; 返回1表示已处理 (含客户端已断开) */
+static int switch_reply_failed(SwitchReply *r, int rc, const char *json) {
+    struct mg_connection *c = deferred_conn(r->d);
+
+    if (rc == 0 && c) return 0;
+    if (c) {
+        if (rc == -2 && deferred_timed_out(r->d)) {
+            HTTP_ERROR(c, 504, "oFono 响应超时");
+        } else {
+            HTTP_OK(c, json);
+        }
+    }
+    switch_reply_end(r);
+    return 1;
+}
+
+static void on_data_set_done(int rc, GVariant *reply, const char *error, void *user_data) {
+    SwitchReply *r = (SwitchReply *)user_data;
+    char response[256];
+
+    (void)reply;
+    if (rc != 0) printf("设置数据连接失败: %s\n", error);
+    if (switch_reply_failed(r, rc, "{\"status\":\"error\",\"message\":\"Failed to set data connection\"}")) {
+        return;
+    }
+
+    snprintf(response, sizeof(response),
+        "{\"status\":\"ok\",\"message\":\"Data connection %s successfully\",\"data\":{\"active\":%s}}",
+        r->value ? "enabled" : "disabled",
+        r->value ? "true" : "false");
+    HTTP_OK(deferred_conn(r->d), response);
+    switch_reply_end(r);
+}
+
+static void on_roaming_set_done(int rc, GVariant *reply, const char *error, void *user_data) {
+    SwitchReply *r = (SwitchReply *)user_data;
+    char response[256];
+    int roaming_allowed = r->value;
+    int is_roaming = 0;
+
+    (void)reply;
+    if (rc != 0) printf("设置漫游失败: %s\n", error);
+    if (switch_reply_failed(r, rc, "{\"status\":\"error\",\"message\":\"Failed to set roaming\"}")) {
+        return;
+    }
+
+    /* 读取当前状态确认 (镜像已在调用成功时更新) */
+    ofono_get_roaming_cached(&roaming_allowed, &is_roaming);
+
+    snprintf(response, sizeof(response),
+        "{\"status\":\"ok\",\"message\":\"Roaming %s successfully\",\"data\":{\"roaming_allowed\":%s,\"is_roaming\":%s}}",
+        r->value ? "enabled" : "disabled",
+        roaming_allowed ? "true" : "false",
+        is_roaming ? "true" : "false");
+    HTTP_OK(deferred_conn(r->d), response);
+    switch_reply_end(r);
+}
+
 /* GET/POST /api/data - 数据连接开关 */
 void handle_data_status(struct mg_connection *c, struct mg_http_message *hm) {
     char response[256];
@@ -1158,13 +1189,9 @@ void handle_data_status(struct mg_connection *c, struct mg_http_message *hm) {
             return;
         }
 
-        if (ofono_set_data_status(active) == 0) {
-            snprintf(response, sizeof(response),
-                "{\"status\":\"ok\",\"message\":\"Data connection %s successfully\",\"data\":{\"active\":%s}}",
-                active ? "enabled" : "disabled",
-                active ? "true" : "false");
-            HTTP_OK(c, response);
-        } else {
+        SwitchReply *r = switch_reply_new(c, active);
+        if (ofono_set_data_status_async(active, deferred_cancellable(r->d), on_data_set_done, r) != 0) {
+            switch_reply_end(r);
             HTTP_OK(c, "{\"status\":\"error\",\"message\":\"Failed to set data connection\"}");
         }
     } else {
@@ -1200,19 +1227,9 @@ void handle_roaming_status(struct mg_connection *c, struct mg_http_message *hm)
             return;
         }
 
-        if (ofono_set_roaming_allowed(allowed) == 0) {
-            /* 读取当前状态确认 */
-            int roaming_allowed = 0;
-            int is_roaming = 0;
-            ofono_get_roaming_status(&roaming_allowed, &is_roaming);
-            
-            snprintf(response, sizeof(response),
-                "{\"status\":\"ok\",\"message\":\"Roaming %s successfully\",\"data\":{\"roaming_allowed\":%s,\"is_roaming\":%s}}",
-                allowed ? "enabled" : "disabled",
-                roaming_allowed ? "true" : "false",
-                is_roaming ? "true" : "false");
-            HTTP_OK(c, response);
-        } else {
+        SwitchReply *r = switch_reply_new(c, allowed);
+        if (ofono_set_roaming_allowed_async(allowed, deferred_cancellable(r->d), on_roaming_set_done, r) != 0) {
+            switch_reply_end(r);
             HTTP_OK(c, "{\"status\":\"error\",\"message\":\"Failed to set roaming\"}");
         }
     } else {
@@ -1350,6 +1367,10 @@ void handle_apn_set(struct mg_connection *c, struct mg_http_message *hm) {
 
 /* ==================== 插件管理 API ==================== */
 #include "plugin.h"
+#include "storage_io.h"
+
+/* Shell 命令输出上限 */
+#define SHELL_OUTPUT_MAX (64 * 1024)
 
 /* POST /api/shell - 执行Shell命令 */
 void handle_shell_execute(struct mg_connection *c, struct mg_http_message *hm) {
@@ -1367,61 +1388,57 @@ void handle_shell_execute(struct mg_connection *c, struct mg_http_message *hm) {
         return;
     }
 
-    char output[8192] = {0};
-    char response[16384];
-
-    if (execute_shell(cmd, output, sizeof(output)) == 0) {
-        /* 转义输出 */
-        char escaped[8192];
-        size_t j = 0;
-        for (size_t i = 0; output[i] && j < sizeof(escaped) - 2; i++) {
-            char ch = output[i];
-            if (ch == '"' || ch == '\\') {
-                escaped[j++] = '\\';
-            } else if (ch == '\n') {
-                escaped[j++] = '\\';
-                ch = 'n';
-            } else if (ch == '\r') {
-                escaped[j++] = '\\';
-                ch = 'r';
-            } else if (ch == '\t') {
-                escaped[j++] = '\\';
-                ch = 't';
-            }
-            if ((unsigned char)ch >= 0x20 || ch == 'n' || ch == 'r' || ch == 't') {
-                escaped[j++] = ch;
-            }
-        }
-        escaped[j] = '\0';
-
-        snprintf(response, sizeof(response),
-            "{\"Code\":0,\"Error\":\"\",\"Data\":\"%s\"}", escaped);
-    } else {
-        snprintf(response, sizeof(response),
-            "{\"Code\":1,\"Error\":\"命令执行失败\",\"Data\":\"%s\"}", output);
+    char *output = calloc(1, SHELL_OUTPUT_MAX);
+    if (!output) {
+        HTTP_ERROR(c, 500, "内存分配失败");
+        return;
     }
 
-    HTTP_OK(c, response);
+    int ret = execute_shell(cmd, output, SHELL_OUTPUT_MAX);
+
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", ret == 0 ? 0 : 1);
+    json_kv_str(&w, "Error", ret == 0 ? "" : "命令执行失败");
+    json_kv_str(&w, "Data", output);
+    json_obj_end(&w);
+    json_end(&w);
+    free(output);
 }
 
 /* GET /api/plugins - 获取插件列表 */
+static void write_plugin_item(const PluginInfo *info, void *ctx) {
+    JsonWriter *w = (JsonWriter *)ctx;
+
+    json_obj_begin(w);
+    json_kv_str(w, "filename", info->filename);
+    json_kv_str(w, "name", info->name);
+    json_kv_str(w, "version", info->version);
+    json_kv_str(w, "author", info->author);
+    json_kv_str(w, "description", info->description);
+    json_kv_str(w, "icon", info->icon);
+    json_kv_str(w, "color", info->color);
+    json_key(w, "content");
+    json_str_n(w, info->content, info->content_len);
+    json_obj_end(w);
+}
+
 void handle_plugin_list(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_GET(c, hm);
 
-    char *json = malloc(512 * 1024);  /* 512KB缓冲区 */
-    if (!json) {
-        HTTP_ERROR(c, 500, "内存分配失败");
-        return;
-    }
-
-    int count = get_plugin_list(json, 512 * 1024);
-    
-    char response[512 * 1024 + 128];
-    snprintf(response, sizeof(response),
-        "{\"Code\":0,\"Error\":\"\",\"Data\":%s,\"Count\":%d}", json, count);
-    
-    HTTP_OK(c, response);
-    free(json);
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_arr_begin(&w);
+    int count = plugin_foreach(write_plugin_item, &w);
+    json_arr_end(&w);
+    json_kv_int(&w, "Count", count);
+    json_obj_end(&w);
+    json_end(&w);
 }
 
 /* POST /api/plugins - 上传插件 */
@@ -1459,33 +1476,13 @@ void handle_plugin_upload(struct mg_connection *c, struct mg_http_message *hm) {
 void handle_plugin_delete(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_DELETE(c, hm);
 
-    /* 从URI中提取插件名 */
-    const char *uri = hm->uri.buf;
-    const char *name_start = strstr(uri, "/api/plugins/");
-    if (!name_start) {
-        HTTP_ERROR(c, 400, "无效的请求路径");
-        return;
-    }
-    name_start += 13;  /* 跳过 "/api/plugins/" */
-
-    /* 提取名称直到URI结束或遇到? */
-    char encoded_name[256] = {0};
-    int i = 0;
-    while (name_start[i] && name_start[i] != '?' && name_start[i] != ' ' && i < 255) {
-        encoded_name[i] = name_start[i];
-        i++;
-    }
-    encoded_name[i] = '\0';
-
-    if (strlen(encoded_name) == 0) {
+    /* 路由通配段即插件名 (已URL解码, 支持中文名称) */
+    char name[256] = {0};
+    if (router_param(0, name, sizeof(name)) <= 0) {
         HTTP_ERROR(c, 400, "插件名称不能为空");
         return;
     }
 
-    /* URL解码支持中文名称 */
-    char name[256] = {0};
-    mg_url_decode(encoded_name, strlen(encoded_name), name, sizeof(name), 0);
-
     if (delete_plugin(name) == 0) {
         HTTP_OK(c, "{\"Code\":0,\"Error\":\"\",\"Data\":\"插件删除成功\"}");
     } else {
@@ -1508,20 +1505,13 @@ void handle_plugin_delete_all(struct mg_connection *c, struct mg_http_message *h
 
 #define SCRIPTS_DIR "/home/root/9898/Plugins/scripts"
 
+/* 列表中返回的单个脚本内容上限 */
+#define SCRIPT_CONTENT_MAX (32 * 1024)
+
 /* GET /api/scripts - 获取脚本列表 */
 void handle_script_list(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_GET(c, hm);
 
-    char *json = malloc(256 * 1024);
-    if (!json) {
-        HTTP_ERROR(c, 500, "内存分配失败");
-        return;
-    }
-
-    json[0] = '[';
-    json[1] = '\0';
-    size_t json_len = 1;
-    int first = 1;
     int count = 0;
 
     /* 确保目录存在 */
@@ -1529,6 +1519,14 @@ void handle_script_list(struct mg_connection *c, struct mg_http_message *hm) {
     char output[256];
     run_command(output, sizeof(output), "mkdir", "-p", SCRIPTS_DIR, NULL);
 
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_arr_begin(&w);
+
     DIR *dir = opendir(SCRIPTS_DIR);
     if (dir) {
         struct dirent *entry;
@@ -1538,61 +1536,37 @@ void handle_script_list(struct mg_connection *c, struct mg_http_message *hm) {
                 snprintf(filepath, sizeof(filepath), "%s/%s", SCRIPTS_DIR, entry->d_name);
                 
                 struct stat st;
-                if (stat(filepath, &st) == 0) {
-                    /* 读取脚本内容 */
-                    FILE *f = fopen(filepath, "r");
-                    char content[32768] = {0};
-                    if (f) {
-                        fread(content, 1, sizeof(content) - 1, f);
-                        fclose(f);
-                    }
-
-                    /* 转义内容 */
-                    char escaped[65536];
-                    size_t j = 0;
-                    for (size_t i = 0; content[i] && j < sizeof(escaped) - 2; i++) {
-                        char ch = content[i];
-                        if (ch == '"' || ch == '\\') { escaped[j++] = '\\'; }
-                        else if (ch == '\n') { escaped[j++] = '\\'; ch = 'n'; }
-                        else if (ch == '\r') { escaped[j++] = '\\'; ch = 'r'; }
-                        else if (ch == '\t') { escaped[j++] = '\\'; ch = 't'; }
-                        if ((unsigned char)ch >= 0x20 || ch == 'n' || ch == 'r' || ch == 't') {
-                            escaped[j++] = ch;
-                        }
-                    }
-                    escaped[j] = '\0';
-
-                    char item[70000];
-                    int item_len = snprintf(item, sizeof(item),
-                        "%s{\"name\":\"%s\",\"size\":%ld,\"mtime\":%ld,\"content\":\"%s\"}",
-                        first ? "" : ",", entry->d_name, st.st_size, st.st_mtime, escaped);
-
-                    /* 安全拼接：检查缓冲区空间 */
-                    if (json_len + item_len < 256 * 1024 - 10) {
-                        memcpy(json + json_len, item, item_len);
-                        json_len += item_len;
-                        json[json_len] = '\0';
-                        first = 0;
-                        count++;
-                    }
+                if (stat(filepath, &st) != 0) continue;
+
+                /* 读取脚本内容 (最多32KB) */
+                size_t cap = st.st_size < SCRIPT_CONTENT_MAX ? (size_t)st.st_size : SCRIPT_CONTENT_MAX;
+                char *content = malloc(cap + 1);
+                size_t len = 0;
+                if (!content) continue;
+                FILE *f = fopen(filepath, "r");
+                if (f) {
+                    len = fread(content, 1, cap, f);
+                    fclose(f);
                 }
+                content[len] = '\0';
+
+                json_obj_begin(&w);
+                json_kv_str(&w, "name", entry->d_name);
+                json_kv_int(&w, "size", (long long)st.st_size);
+                json_kv_int(&w, "mtime", (long long)st.st_mtime);
+                json_kv_str(&w, "content", content);
+                json_obj_end(&w);
+                free(content);
+                count++;
             }
         }
         closedir(dir);
     }
 
-    /* 安全拼接结束符 */
-    if (json_len < 256 * 1024 - 2) {
-        json[json_len++] = ']';
-        json[json_len] = '\0';
-    }
-
-    char response[256 * 1024 + 128];
-    snprintf(response, sizeof(response),
-        "{\"Code\":0,\"Error\":\"\",\"Data\":%s,\"Count\":%d}", json, count);
-    
-    HTTP_OK(c, response);
-    free(json);
+    json_arr_end(&w);
+    json_kv_int(&w, "Count", count);
+    json_obj_end(&w);
+    json_end(&w);
 }
 
 /* POST /api/scripts - 上传脚本 */
@@ -1627,14 +1601,8 @@ void handle_script_upload(struct mg_connection *c, struct mg_http_message *hm) {
     char filepath[512];
     snprintf(filepath, sizeof(filepath), "%s/%s", SCRIPTS_DIR, name);
     
-    FILE *f = fopen(filepath, "w");
-    if (f) {
-        fputs(content_str, f);
-        fclose(f);
-        /* 添加执行权限 */
-        char chmod_cmd[512];
-        snprintf(chmod_cmd, sizeof(chmod_cmd), "chmod +x %s", filepath);
-        system(chmod_cmd);
+    if (storage_write_file(STORAGE_PLUGIN, filepath, content_str, strlen(content_str),
+                           0755, STORAGE_WRITE_SYNC) == 0) {
         HTTP_OK(c, "{\"Code\":0,\"Error\":\"\",\"Data\":\"脚本上传成功\"}");
     } else {
         HTTP_OK(c, "{\"Code\":1,\"Error\":\"脚本保存失败\",\"Data\":null}");
@@ -1647,24 +1615,9 @@ void handle_script_upload(struct mg_connection *c, struct mg_http_message *hm) {
 void handle_script_update(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_PUT(c, hm);
 
-    /* 从URI中提取脚本名 */
-    const char *uri = hm->uri.buf;
-    const char *name_start = strstr(uri, "/api/scripts/");
-    if (!name_start) {
-        HTTP_ERROR(c, 400, "无效的请求路径");
-        return;
-    }
-    name_start += 13;
-
+    /* 路由通配段即脚本名 */
     char name[256] = {0};
-    int i = 0;
-    while (name_start[i] && name_start[i] != '?' && name_start[i] != ' ' && i < 255) {
-        name[i] = name_start[i];
-        i++;
-    }
-    name[i] = '\0';
-
-    if (strlen(name) == 0) {
+    if (router_param(0, name, sizeof(name)) <= 0) {
         HTTP_ERROR(c, 400, "脚本名称不能为空");
         return;
     }
@@ -1678,10 +1631,8 @@ void handle_script_update(struct mg_connection *c, struct mg_http_message *hm) {
     char filepath[512];
     snprintf(filepath, sizeof(filepath), "%s/%s", SCRIPTS_DIR, name);
     
-    FILE *f = fopen(filepath, "w");
-    if (f) {
-        fputs(content_str, f);
-        fclose(f);
+    if (storage_write_file(STORAGE_PLUGIN, filepath, content_str, strlen(content_str),
+                           0755, STORAGE_WRITE_SYNC) == 0) {
         HTTP_OK(c, "{\"Code\":0,\"Error\":\"\",\"Data\":\"脚本更新成功\"}");
     } else {
         HTTP_OK(c, "{\"Code\":1,\"Error\":\"脚本更新失败\",\"Data\":null}");
@@ -1694,31 +1645,13 @@ void handle_script_update(struct mg_connection *c, struct mg_http_message *hm) {
 void handle_script_delete(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_DELETE(c, hm);
 
-    const char *uri = hm->uri.buf;
-    const char *name_start = strstr(uri, "/api/scripts/");
-    if (!name_start) {
-        HTTP_ERROR(c, 400, "无效的请求路径");
-        return;
-    }
-    name_start += 13;
-
-    char encoded_name[256] = {0};
-    int i = 0;
-    while (name_start[i] && name_start[i] != '?' && name_start[i] != ' ' && i < 255) {
-        encoded_name[i] = name_start[i];
-        i++;
-    }
-    encoded_name[i] = '\0';
-
-    if (strlen(encoded_name) == 0) {
+    /* 路由通配段即脚本名 (已URL解码, 支持中文名称) */
+    char name[256] = {0};
+    if (router_param(0, name, sizeof(name)) <= 0) {
         HTTP_ERROR(c, 400, "脚本名称不能为空");
         return;
     }
 
-    /* URL解码支持中文名称 */
-    char name[256] = {0};
-    mg_url_decode(encoded_name, strlen(encoded_name), name, sizeof(name), 0);
-
     char filepath[512];
     snprintf(filepath, sizeof(filepath), "%s/%s", SCRIPTS_DIR, name);
     
@@ -1732,34 +1665,12 @@ void handle_script_delete(struct mg_connection *c, struct mg_http_message *hm) {
 /* ==================== 插件存储 API ==================== */
 #include "plugin_storage.h"
 
-/* 从URL提取插件名 /api/plugins/storage/:name */
-static int extract_plugin_name_from_url(const char *uri, char *name, size_t size) {
-    const char *prefix = "/api/plugins/storage/";
-    const char *start = strstr(uri, prefix);
-    if (!start) return -1;
-    
-    start += strlen(prefix);
-    char encoded[256] = {0};
-    size_t i = 0;
-    while (start[i] && start[i] != '?' && start[i] != ' ' && i < sizeof(encoded) - 1) {
-        encoded[i] = start[i];
-        i++;
-    }
-    encoded[i] = '\0';
-    
-    if (i == 0) return -1;
-    
-    /* URL解码支持中文名称 */
-    mg_url_decode(encoded, strlen(encoded), name, size, 0);
-    return (strlen(name) > 0) ? 0 : -1;
-}
-
 /* GET /api/plugins/storage/:name - 读取插件存储 */
 void handle_plugin_storage_get(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_GET(c, hm);
 
     char plugin_name[256] = {0};
-    if (extract_plugin_name_from_url(hm->uri.buf, plugin_name, sizeof(plugin_name)) != 0) {
+    if (router_param(0, plugin_name, sizeof(plugin_name)) <= 0) {
         HTTP_ERROR(c, 400, "无效的插件名称");
         return;
     }
@@ -1781,7 +1692,7 @@ void handle_plugin_storage_set(struct mg_connection *c, struct mg_http_message *
     HTTP_CHECK_POST(c, hm);
 
     char plugin_name[256] = {0};
-    if (extract_plugin_name_from_url(hm->uri.buf, plugin_name, sizeof(plugin_name)) != 0) {
+    if (router_param(0, plugin_name, sizeof(plugin_name)) <= 0) {
         HTTP_ERROR(c, 400, "无效的插件名称");
         return;
     }
@@ -1804,7 +1715,7 @@ void handle_plugin_storage_delete(struct mg_connection *c, struct mg_http_messag
     HTTP_CHECK_DELETE(c, hm);
 
     char plugin_name[256] = {0};
-    if (extract_plugin_name_from_url(hm->uri.buf, plugin_name, sizeof(plugin_name)) != 0) {
+    if (router_param(0, plugin_name, sizeof(plugin_name)) <= 0) {
         HTTP_ERROR(c, 400, "无效的插件名称");
         return;
     }
@@ -9,6 +9,7 @@
 #include <signal.h>
 #include <stdint.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include "mongoose.h"
 #include "http_server.h"
 #include "dbus_core.h"
@@ -22,28 +23,37 @@
 #include "http_utils.h"
 #include "auth.h"
 #include "automation.h"
-
-/* 嵌入式文件系统声明 (packed_fs.c) */
-extern int serve_packed_file(struct mg_connection *c, struct mg_http_message *hm);
+#include "router.h"
+#include "worker_pool.h"
+#include "deferred.h"
+#include "packed_fs.h"
+#include "telemetry.h"
+#include "sysinfo.h"
+#include "metrics.h"
+#include "history.h"
+#include "at_sched.h"
+#include "cell_log.h"
+#include "webhook.h"
+#include "sms_queue.h"
+#include "db_maint.h"
+#include "storage_io.h"
+
+/* 周期任务间隔 (秒) */
+#define SMS_MAINTENANCE_INTERVAL_S   30
+#define AUTOMATION_CHECK_INTERVAL_S  10
+
+/* 连接建立/DNS 解析期间的轮询间隔 (ms), 超时检查依赖 MG_EV_POLL */
+#define MG_SOURCE_TRANSIENT_MS       500
 
 /* 全局变量 */
 static struct mg_mgr g_mgr;
-static volatile int g_running = 0;
-
-/* 信号处理 */
-static void signal_handler(int sig) {
-    (void)sig;
-    g_running = 0;
-}
+static GMainLoop *g_loop = NULL;
 
-/**
- * 检查API是否在白名单中（无需认证）
- */
-static int is_auth_whitelist(const char *uri) {
-    /* 认证相关API无需认证 */
-    if (strncmp(uri, "/api/auth/login", 15) == 0) return 1;
-    if (strncmp(uri, "/api/auth/status", 16) == 0) return 1;
-    return 0;
+/* 信号处理 (由 GLib 在主循环中回调, 非异步信号上下文) */
+static gboolean on_quit_signal(gpointer user_data) {
+    (void)user_data;
+    if (g_loop) g_main_loop_quit(g_loop);
+    return G_SOURCE_CONTINUE;
 }
 
 /**
@@ -52,7 +62,17 @@ static int is_auth_whitelist(const char *uri) {
  */
 static int verify_request_token(struct mg_http_message *hm) {
     struct mg_str *auth_header = mg_http_get_header(hm, "Authorization");
+    struct mg_str *upgrade = mg_http_get_header(hm, "Upgrade");
     
+    /* 浏览器 WebSocket 无法设置请求头, 升级请求允许通过 ?token= 传递 */
+    if (!auth_header && upgrade && mg_strcasecmp(*upgrade, mg_str("websocket")) == 0) {
+        char token[65] = {0};
+        if (mg_http_get_var(&hm->query, "token", token, sizeof(token)) <= 0) {
+            return -1;
+        }
+        return auth_verify_token(token);
+    }
+
     if (!auth_header || auth_header->len <= 7) {
         return -1;
     }
@@ -74,14 +94,52 @@ static int verify_request_token(struct mg_http_message *hm) {
     return auth_verify_token(token);
 }
 
+/* WebSocket 升级 (Token 已由路由校验), 连接用于遥测推送 */
+static void handle_ws_log(struct mg_connection *c, struct mg_http_message *hm) {
+    mg_ws_upgrade(c, hm, NULL);
+    telemetry_ws_open(c);
+}
+
+/* ==================== API 路由表 ==================== */
+
+/*
+ * 同一路径可按方法注册多个处理函数, "*" 为该路径的默认处理函数.
+ * 路径段 "*" 匹配任意单段, 处理函数内通过 router_param() 读取.
+ * ROUTE_WORKER: 处理函数会阻塞 (AT命令、D-Bus同步调用、外部进程),
+ * 在线程池中执行, 不占用事件循环. 改用异步 D-Bus 调用的处理函数
+ * (/api/at、/api/data 与 /api/roaming 的设置) 直接在事件循环中执行,
+ * 通过 deferred.h 在回调中回复.
+ */
+static const Route g_routes[] = {
+#define ROUTE(method, path, handler, flags) {method, path, handler, flags},
+#include "routes.def"
+#undef ROUTE
+};
+
 
 /* HTTP 事件处理函数 */
 static void http_handler(struct mg_connection *c, int ev, void *ev_data) {
+    /* 遥测推送: 订阅消息、帧投递与订阅连接关闭 */
+    if (telemetry_handle_event(c, ev, ev_data)) {
+        return;
+    }
+
+    /* Webhook 投递队列唤醒 */
+    if (webhook_handle_event(c, ev, ev_data)) {
+        return;
+    }
+
+    /* 线程池任务完成或挂起连接关闭 */
+    if (ev == MG_EV_WAKEUP || ev == MG_EV_CLOSE) {
+        if (!deferred_handle_event(c, ev, ev_data)) {
+            worker_pool_handle_event(c, ev, ev_data);
+        }
+        return;
+    }
+
     if (ev == MG_EV_HTTP_MSG) {
         struct mg_http_message *hm = (struct mg_http_message *)ev_data;
-        char uri[256] = {0};
-        size_t uri_len = hm->uri.len < sizeof(uri) - 1 ? hm->uri.len : sizeof(uri) - 1;
-        memcpy(uri, hm->uri.buf, uri_len);
+        RouteMatch match;
 
         /* 静态文件处理 */
         if (hm->uri.len < 5 || memcmp(hm->uri.buf, "/api/", 5) != 0) {
@@ -90,314 +148,200 @@ static void http_handler(struct mg_connection *c, int ev, void *ev_data) {
             }
         }
 
-        /* WebSocket 升级处理 - 需要验证 Token */
-        if (mg_match(hm->uri, mg_str("/api/ws/log"), NULL)) {
-            if (verify_request_token(hm) != 0) {
-                HTTP_JSON(c, 401, "{\"status\":\"error\",\"message\":\"未授权\"}");
-                return;
-            }
-            mg_ws_upgrade(c, hm, NULL);
-            return;
-        }
-
-        /* 认证 API - 优先处理，无需Token验证 */
-        if (mg_match(hm->uri, mg_str("/api/auth/login"), NULL)) {
-            handle_auth_login(c, hm);
-            return;
-        }
-        else if (mg_match(hm->uri, mg_str("/api/auth/status"), NULL)) {
-            handle_auth_status(c, hm);
-            return;
-        }
-        else if (mg_match(hm->uri, mg_str("/api/auth/logout"), NULL)) {
-            handle_auth_logout(c, hm);
-            return;
-        }
-        else if (mg_match(hm->uri, mg_str("/api/auth/password"), NULL)) {
-            handle_auth_password(c, hm);
-            return;
-        }
+        router_lookup(hm->method, hm->uri, &match);
 
-        /* 认证中间件 - 检查Token */
-        if (!is_auth_whitelist(uri)) {
+        /* 认证中间件 - 未命中的路由同样需要Token, 避免暴露路由表 */
+        if (!match.route || (match.route->flags & ROUTE_AUTH)) {
             if (verify_request_token(hm) != 0) {
                 HTTP_JSON(c, 401, "{\"status\":\"error\",\"message\":\"未授权，请先登录\"}");
                 return;
             }
         }
 
-        /* API 路由 */
-        if (mg_match(hm->uri, mg_str("/api/info"), NULL)) {
-            handle_info(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/at"), NULL)) {
-            handle_execute_at(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/set_network"), NULL)) {
-            handle_set_network(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/switch"), NULL)) {
-            handle_switch(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/airplane_mode"), NULL)) {
-            handle_airplane_mode(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/device_control"), NULL)) {
-            handle_device_control(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/clear_cache"), NULL)) {
-            handle_clear_cache(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/current_band"), NULL)) {
-            handle_get_current_band(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/network/neighbors"), NULL)) {
-            handle_neighbor_cells(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/automation/rules"), NULL)) {
-            handle_get_automation_rules(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/automation/save"), NULL)) {
-            handle_save_automation_rule(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/automation/delete"), NULL)) {
-            handle_delete_automation_rule(c, hm);
-        }
-        /* 高级网络 API */
-        else if (mg_match(hm->uri, mg_str("/api/bands"), NULL)) {
-            handle_get_bands(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/lock_bands"), NULL)) {
-            handle_lock_bands(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/unlock_bands"), NULL)) {
-            handle_unlock_bands(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/cells"), NULL)) {
-            handle_get_cells(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/lock_cell"), NULL)) {
-            handle_lock_cell(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/unlock_cell"), NULL)) {
-            handle_unlock_cell(c, hm);
-        }
-        /* 流量统计 API */
-        else if (mg_match(hm->uri, mg_str("/api/get/Total"), NULL)) {
-            handle_get_traffic_total(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/get/set"), NULL)) {
-            handle_get_traffic_config(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/set/total"), NULL)) {
-            handle_set_traffic_limit(c, hm);
-        }
-        /* 系统时间 API */
-        else if (mg_match(hm->uri, mg_str("/api/get/time"), NULL)) {
-            handle_get_system_time(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/set/time"), NULL)) {
-            handle_set_system_time(c, hm);
-        }
-        /* 定时重启 API */
-        else if (mg_match(hm->uri, mg_str("/api/get/first-reboot"), NULL)) {
-            handle_get_first_reboot(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/set/reboot"), NULL)) {
-            handle_set_reboot(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/claen/cron"), NULL)) {
-            handle_clear_cron(c, hm);
-        }
-        /* 充电控制 API */
-        else if (mg_match(hm->uri, mg_str("/api/charge/config"), NULL)) {
-            handle_charge_config(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/charge/on"), NULL)) {
-            handle_charge_on(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/charge/off"), NULL)) {
-            handle_charge_off(c, hm);
-        }
-        /* 短信 API */
-        else if (mg_match(hm->uri, mg_str("/api/sms"), NULL)) {
-            handle_sms_list(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/send"), NULL)) {
-            handle_sms_send(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/sent"), NULL)) {
-            handle_sms_sent_list(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/sent/*"), NULL)) {
-            handle_sms_sent_delete(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/config"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_sms_config_get(c, hm);
-            } else {
-                handle_sms_config_save(c, hm);
-            }
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/webhook"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_sms_webhook_get(c, hm);
-            } else {
-                handle_sms_webhook_save(c, hm);
-            }
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/webhook/test"), NULL)) {
-            handle_sms_webhook_test(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/fix"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_sms_fix_get(c, hm);
-            } else {
-                handle_sms_fix_set(c, hm);
-            }
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/admin"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_sms_admin_get(c, hm);
-            } else {
-                handle_sms_admin_save(c, hm);
-            }
-        }
-        else if (mg_match(hm->uri, mg_str("/api/sms/*"), NULL)) {
-            handle_sms_delete(c, hm);
-        }
-        /* OTA更新 API */
-        else if (mg_match(hm->uri, mg_str("/api/update/version"), NULL)) {
-            handle_update_version(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/update/upload"), NULL)) {
-            handle_update_upload(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/plugins/market"), NULL)) {
-            handle_plugin_market_list(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/plugins/market/install"), NULL)) {
-            handle_plugin_market_install(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/plugins/market/mirror"), NULL)) {
-            handle_plugin_market_mirror(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/update/download"), NULL)) {
-            handle_update_download(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/update/extract"), NULL)) {
-            handle_update_extract(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/update/install"), NULL)) {
-            handle_update_install(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/update/check"), NULL)) {
-            handle_update_check(c, hm);
-        }
-        /* USB模式切换 API */
-        else if (mg_match(hm->uri, mg_str("/api/usb/mode"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_usb_mode_get(c, hm);
-            } else {
-                handle_usb_mode_set(c, hm);
+        if (match.route && (match.route->flags & ROUTE_WORKER)) {
+            if (worker_pool_submit(&match, c, hm) != 0) {
+                HTTP_ERROR(c, 503, "服务器繁忙，请稍后重试");
             }
-        }
-        else if (mg_match(hm->uri, mg_str("/api/usb-advance"), NULL)) {
-            handle_usb_advance(c, hm);
-        }
-        /* 数据连接和漫游 API */
-        else if (mg_match(hm->uri, mg_str("/api/data"), NULL)) {
-            handle_data_status(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/roaming"), NULL)) {
-            handle_roaming_status(c, hm);
-        }
-        /* APN 管理 API */
-        else if (mg_match(hm->uri, mg_str("/api/apn"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_apn_list(c, hm);
-            } else {
-                handle_apn_set(c, hm);
-            }
-        }
-        /* 插件管理 API */
-        else if (mg_match(hm->uri, mg_str("/api/shell"), NULL)) {
-            handle_shell_execute(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/plugins/all"), NULL)) {
-            handle_plugin_delete_all(c, hm);
-        }
-        else if (mg_match(hm->uri, mg_str("/api/plugins"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_plugin_list(c, hm);
-            } else {
-                handle_plugin_upload(c, hm);
-            }
-        }
-        else if (mg_match(hm->uri, mg_str("/api/plugins/*"), NULL)) {
-            handle_plugin_delete(c, hm);
-        }
-        /* 脚本管理 API */
-        else if (mg_match(hm->uri, mg_str("/api/scripts"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_script_list(c, hm);
-            } else {
-                handle_script_upload(c, hm);
-            }
-        }
-        else if (mg_match(hm->uri, mg_str("/api/scripts/*"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "PUT", 3) == 0) {
-                handle_script_update(c, hm);
-            } else {
-                handle_script_delete(c, hm);
-            }
-        }
-        /* 插件存储 API */
-        else if (mg_match(hm->uri, mg_str("/api/plugins/storage/*"), NULL)) {
-            if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-                handle_plugin_storage_get(c, hm);
-            } else if (hm->method.len == 4 && memcmp(hm->method.buf, "POST", 4) == 0) {
-                handle_plugin_storage_set(c, hm);
-            } else if (hm->method.len == 6 && memcmp(hm->method.buf, "DELETE", 6) == 0) {
-                handle_plugin_storage_delete(c, hm);
-            } else {
-                HTTP_ERROR(c, 405, "Method not allowed");
-            }
-        }
-        /* 未知 API 路由 */
-        else {
+        } else if (match.route) {
+            router_invoke(&match, c, hm);
+        } else if (match.path_found) {
+            HTTP_ERROR(c, 405, "Method not allowed");
+        } else {
+            /* 未知 API 路由 */
             HTTP_ERROR(c, 404, "Endpoint not found");
         }
     }
 }
 
 
+/* ==================== mongoose 事件源 ==================== */
+
+/*
+ * 将 mongoose 的 epoll fd 包装为 GSource, HTTP 连接与 GLib/D-Bus
+ * 共用同一个 GMainContext 等待, 空闲时不再周期性唤醒.
+ */
+typedef struct {
+    GSource source;
+    struct mg_mgr *mgr;
+    gpointer fd_tag;        /* epoll fd 的 poll 句柄 */
+    gint64 due_us;          /* 下一次必须调度的单调时间, -1 表示无 */
+} MgSource;
+
+/* 计算连接/定时器需要的等待时间, 返回 0 表示需要立即调度 */
+static gint mg_source_wait_ms(struct mg_mgr *mgr) {
+    struct mg_connection *c;
+    struct mg_timer *t;
+    uint64_t now = mg_millis();
+    gint wait = -1;
+
+    for (c = mgr->conns; c != NULL; c = c->next) {
+        /* 待关闭或 TLS 缓冲未读完的连接需要立即处理 */
+        if (c->is_closing || c->rtls.len > 0 || mg_tls_pending(c) > 0 ||
+            (c->is_draining && c->send.len == 0)) {
+            return 0;
+        }
+        /* 有待发数据时关注可写事件 (与 mg_iotest 每轮所做一致) */
+        if (!c->is_resolving && (c->is_connecting || (c->send.len > 0 && !c->is_tls_hs))) {
+            MG_EPOLL_MOD(c, 1);
+        }
+        if (c->is_resolving || c->is_connecting) {
+            if (wait < 0 || wait > MG_SOURCE_TRANSIENT_MS) wait = MG_SOURCE_TRANSIENT_MS;
+        }
+    }
+
+    for (t = mgr->timers; t != NULL; t = t->next) {
+        if (t->expire == 0) return 0;
+        gint left = t->expire > now ? (gint)(t->expire - now) : 0;
+        if (wait < 0 || left < wait) wait = left;
+    }
+
+    return wait;
+}
+
+static gboolean mg_source_prepare(GSource *source, gint *timeout) {
+    MgSource *ms = (MgSource *)source;
+    gint wait = mg_source_wait_ms(ms->mgr);
+
+    ms->due_us = wait < 0 ? -1 : g_source_get_time(source) + (gint64)wait * 1000;
+    *timeout = wait;
+    return wait == 0;
+}
+
+static gboolean mg_source_check(GSource *source) {
+    MgSource *ms = (MgSource *)source;
+
+    if (g_source_query_unix_fd(source, ms->fd_tag) & (G_IO_IN | G_IO_HUP | G_IO_ERR)) {
+        return TRUE;
+    }
+    return ms->due_us >= 0 && g_source_get_time(source) >= ms->due_us;
+}
+
+static gboolean mg_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data) {
+    MgSource *ms = (MgSource *)source;
+    (void)callback;
+    (void)user_data;
+
+    /* 就绪事件已由 GLib 等到, 这里只做非阻塞处理 */
+    mg_mgr_poll(ms->mgr, 0);
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs mg_source_funcs = {
+    mg_source_prepare,
+    mg_source_check,
+    mg_source_dispatch,
+    NULL, NULL, NULL
+};
+
+static GSource *mg_source_new(struct mg_mgr *mgr) {
+    GSource *source = g_source_new(&mg_source_funcs, sizeof(MgSource));
+    MgSource *ms = (MgSource *)source;
+
+    ms->mgr = mgr;
+    ms->due_us = -1;
+    ms->fd_tag = g_source_add_unix_fd(source, mgr->epoll_fd, G_IO_IN | G_IO_HUP | G_IO_ERR);
+    g_source_set_name(source, "mongoose");
+    return source;
+}
+
+/* ==================== 周期任务 ==================== */
+
+/* 短信模块维护（检查D-Bus连接） */
+static gboolean on_sms_maintenance(gpointer user_data) {
+    (void)user_data;
+    sms_maintenance();
+    return G_SOURCE_CONTINUE;
+}
+
+/* 自动化规则检查 */
+static gboolean on_automation_check(gpointer user_data) {
+    (void)user_data;
+    automation_check_cycle();
+    return G_SOURCE_CONTINUE;
+}
+
+
 int http_server_start(const char *port) {
     char listen_addr[64];
+    struct mg_connection *listener;
+
+    /* 写入统计从进程启动开始计时 */
+    storage_io_init();
 
     /* 初始化 D-Bus */
     if (init_dbus() != 0) {
         printf("警告: D-Bus 初始化失败 (高级网络功能将不可用)\n");
     }
 
-    /* 初始化流量统计 */
-    init_traffic();
+    /* 系统信息后台分级采样, /api/info 与自动化规则只读快照 */
+    if (sysinfo_sampler_start() != 0) {
+        printf("警告: 系统信息采样线程启动失败\n");
+    }
 
-    /* 初始化充电控制 */
-    init_charge();
+    /* 指标历史 (读取上面的采样快照) */
+    if (history_init() != 0) {
+        printf("警告: 指标历史采样线程启动失败\n");
+    }
 
-    /* 初始化短信模块（必须在auth_init之前，因为auth依赖数据库） */
+    /* 初始化短信模块（打开数据库并载入配置, 须在读取配置的模块之前） */
     if (sms_init("9898.db") != 0) {
         printf("警告: 短信模块初始化失败\n");
     }
 
+    /* 初始化流量统计 */
+    init_traffic();
+
+    /* 初始化充电控制 */
+    init_charge();
+
     /* 初始化认证模块 */
     if (auth_init() != 0) {
         printf("警告: 认证模块初始化失败\n");
     }
 
+    /* 小区测量记录 (配置保存在数据库中) */
+    if (cell_log_init() != 0) {
+        printf("警告: 小区测量记录启动失败\n");
+    }
+
+    /* 群发短信队列 (依赖短信模块的数据库与 D-Bus 连接) */
+    if (sms_queue_init() != 0) {
+        printf("警告: 群发短信队列启动失败\n");
+    }
+
+    /* 数据库维护 (检查点、回收、表容量上限) */
+    if (db_maint_init() != 0) {
+        printf("警告: 数据库维护线程启动失败\n");
+    }
+
     /* 初始化成就系统 */
 
+    /* 编译路由表 */
+    if (router_init(g_routes, (int)(sizeof(g_routes) / sizeof(g_routes[0]))) != 0) {
+        printf("路由表编译失败\n");
+        return -1;
+    }
+
     /* 初始化 mongoose */
     mg_mgr_init(&g_mgr);
 
@@ -405,57 +349,83 @@ int http_server_start(const char *port) {
     snprintf(listen_addr, sizeof(listen_addr), "http://0.0.0.0:%s", port);
 
     /* 创建 HTTP 监听器 */
-    if (mg_http_listen(&g_mgr, listen_addr, http_handler, NULL) == NULL) {
+    listener = mg_http_listen(&g_mgr, listen_addr, http_handler, NULL);
+    if (listener == NULL) {
         printf("无法监听端口 %s\n", port);
         mg_mgr_free(&g_mgr);
+        router_deinit();
         return -1;
     }
 
+    /* 启动阻塞型处理函数线程池 (失败时这些路由返回503) */
+    if (worker_pool_init(&g_mgr, WORKER_POOL_THREADS, WORKER_POOL_QUEUE_MAX) != 0) {
+        printf("警告: 工作线程池启动失败\n");
+    }
+
+    /* 启动遥测采样线程, 帧通过监听连接的唤醒事件投递 */
+    if (telemetry_init(&g_mgr, listener->id) != 0) {
+        printf("警告: 遥测推送启动失败\n");
+    }
+
+    /* Webhook 投递 (继续发送上次未送达的通知) */
+    if (webhook_init(&g_mgr, listener->id) != 0) {
+        printf("警告: Webhook 投递启动失败\n");
+    }
+
     printf("Server starting on :%s\n", port);
-    g_running = 1;
+    g_loop = g_main_loop_new(g_main_context_default(), FALSE);
 
     /* 设置信号处理 */
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    g_unix_signal_add(SIGINT, on_quit_signal, NULL);
+    g_unix_signal_add(SIGTERM, on_quit_signal, NULL);
 
     return 0;
 }
 
 void http_server_stop(void) {
-    g_running = 0;
+    if (g_loop) {
+        g_main_loop_unref(g_loop);
+        g_loop = NULL;
+    }
+    telemetry_deinit();
+    webhook_deinit();
+    worker_pool_deinit();
+    cell_log_deinit();
+    sms_queue_deinit();
+    db_maint_deinit();
+    at_sched_stop();
     mg_mgr_free(&g_mgr);
+    router_deinit();
+    auth_deinit();
     sms_deinit();
+    history_deinit();
+    sysinfo_sampler_stop();
+    metrics_close();
     close_dbus();
     printf("服务器已停止\n");
 }
 
 void http_server_run(void) {
     GMainContext *context = g_main_context_default();
-    static int maintenance_counter = 0;
-    
-    while (g_running) {
-        /* 处理GLib/D-Bus事件 - 优先处理，确保信号不丢失 */
-        while (g_main_context_pending(context)) {
-            g_main_context_iteration(context, FALSE);
-        }
-        
-        /* 处理mongoose事件 - 减少超时时间以更快响应D-Bus信号 */
-        mg_mgr_poll(&g_mgr, 10);  /* 10ms超时 */
-        
-        /* 每30秒执行一次短信模块维护（检查D-Bus连接） */
-        if (++maintenance_counter >= 3000) {  /* 3000 * 10ms = 30秒 */
-            maintenance_counter = 0;
-            sms_maintenance();
-        }
+    GSource *mg_source;
+    guint maintenance_id, auto_id;
 
+    if (!g_loop) return;
 
-        /* 每10秒检查一次自动化规则 */
-        static int auto_counter = 0;
-        if (++auto_counter >= 1000) { /* 1000 * 10ms = 10秒 */
-            auto_counter = 0;
-            automation_check_cycle();
-        }
-    }
+    /* HTTP 与 GLib/D-Bus 在同一个循环中按 fd 就绪调度 */
+    mg_source = mg_source_new(&g_mgr);
+    g_source_attach(mg_source, context);
+
+    /* 周期任务使用单调时钟定时器, 不受处理耗时影响 */
+    maintenance_id = g_timeout_add_seconds(SMS_MAINTENANCE_INTERVAL_S, on_sms_maintenance, NULL);
+    auto_id = g_timeout_add_seconds(AUTOMATION_CHECK_INTERVAL_S, on_automation_check, NULL);
+
+    g_main_loop_run(g_loop);
+
+    g_source_remove(auto_id);
+    g_source_remove(maintenance_id);
+    g_source_destroy(mg_source);
+    g_source_unref(mg_source);
 }
 
 
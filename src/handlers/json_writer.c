@@ -0,0 +1,213 @@
+/**
+ * @file json_writer.c
+ * @brief 流式 JSON 响应实现
+ *
+ * 与 mg_http_reply 相同的做法: 先写入留空的 Content-Length, 响应体写完后
+ * 原地回填. 字符串转义按连续的安全字节整段追加, 不经过临时缓冲区.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "mongoose.h"
+#include "http_utils.h"
+#include "json_writer.h"
+
+/* Content-Length 占位宽度 (与 mg_http_reply 一致) */
+#define JSON_LEN_FIELD 10
+#define JSON_LEN_PAD   "          "
+
+static void put(JsonWriter *w, const char *s, size_t len) {
+    if (len > 0) mg_send(w->c, s, len);
+}
+
+/* 值之前: 按需插入逗号 */
+static void before_value(JsonWriter *w) {
+    if (w->after_key) {
+        w->after_key = 0;
+        return;
+    }
+    if (w->depth > 0 && w->depth <= JSON_MAX_DEPTH) {
+        if (w->has_items[w->depth - 1]) put(w, ",", 1);
+        w->has_items[w->depth - 1] = 1;
+    }
+}
+
+static void put_escaped(JsonWriter *w, const char *s, size_t len) {
+    size_t start = 0;
+
+    put(w, "\"", 1);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)s[i];
+        const char *esc = NULL;
+        char ubuf[8];
+
+        if (ch == '"') esc = "\\\"";
+        else if (ch == '\\') esc = "\\\\";
+        else if (ch == '\n') esc = "\\n";
+        else if (ch == '\r') esc = "\\r";
+        else if (ch == '\t') esc = "\\t";
+        else if (ch < 0x20) {
+            snprintf(ubuf, sizeof(ubuf), "\\u%04x", ch);
+            esc = ubuf;
+        }
+        if (esc) {
+            put(w, s + start, i - start);
+            put(w, esc, strlen(esc));
+            start = i + 1;
+        }
+    }
+    put(w, s + start, len - start);
+    put(w, "\"", 1);
+}
+
+/* 状态行文本 (mongoose 的同名函数为 static) */
+static const char *status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "OK";
+    }
+}
+
+void json_begin(JsonWriter *w, struct mg_connection *c, int status) {
+    memset(w, 0, sizeof(*w));
+    w->c = c;
+    /* mg_printf 不支持 %*s, 占位直接写成字面量 */
+    mg_printf(c, "HTTP/1.1 %d %s\r\n" HTTP_CORS_HEADERS "Content-Length: %s\r\n\r\n",
+              status, status_text(status), JSON_LEN_PAD);
+    w->body_start = c->send.len;
+}
+
+void json_end(JsonWriter *w) {
+    struct mg_connection *c = w->c;
+    char num[JSON_LEN_FIELD + 1];
+    size_t field = w->body_start - 4 - JSON_LEN_FIELD;
+    int n = snprintf(num, sizeof(num), "%lu", (unsigned long)(c->send.len - w->body_start));
+
+    /* 数字左对齐, 其余保持空格 */
+    memcpy(c->send.buf + field, num, (size_t)n);
+    c->is_resp = 0;
+}
+
+void json_obj_begin(JsonWriter *w) {
+    before_value(w);
+    put(w, "{", 1);
+    if (w->depth < JSON_MAX_DEPTH) w->has_items[w->depth] = 0;
+    w->depth++;
+}
+
+void json_obj_end(JsonWriter *w) {
+    if (w->depth > 0) w->depth--;
+    put(w, "}", 1);
+}
+
+void json_arr_begin(JsonWriter *w) {
+    before_value(w);
+    put(w, "[", 1);
+    if (w->depth < JSON_MAX_DEPTH) w->has_items[w->depth] = 0;
+    w->depth++;
+}
+
+void json_arr_end(JsonWriter *w) {
+    if (w->depth > 0) w->depth--;
+    put(w, "]", 1);
+}
+
+void json_key(JsonWriter *w, const char *key) {
+    before_value(w);
+    put_escaped(w, key, strlen(key));
+    put(w, ":", 1);
+    w->after_key = 1;
+}
+
+void json_str(JsonWriter *w, const char *s) {
+    if (!s) {
+        json_null(w);
+        return;
+    }
+    json_str_n(w, s, strlen(s));
+}
+
+void json_str_n(JsonWriter *w, const char *s, size_t len) {
+    before_value(w);
+    put_escaped(w, s, len);
+}
+
+void json_int(JsonWriter *w, long long v) {
+    char buf[24];
+    before_value(w);
+    put(w, buf, (size_t)snprintf(buf, sizeof(buf), "%lld", v));
+}
+
+void json_uint(JsonWriter *w, unsigned long long v) {
+    char buf[24];
+    before_value(w);
+    put(w, buf, (size_t)snprintf(buf, sizeof(buf), "%llu", v));
+}
+
+void json_double(JsonWriter *w, double v, int precision) {
+    char buf[48];
+    int n;
+
+    if (isnan(v) || isinf(v)) {
+        json_null(w);
+        return;
+    }
+    before_value(w);
+    n = snprintf(buf, sizeof(buf), "%.*f", precision, v);
+    if (n < 0 || n >= (int)sizeof(buf)) n = snprintf(buf, sizeof(buf), "%g", v);
+    put(w, buf, (size_t)n);
+}
+
+void json_bool(JsonWriter *w, int v) {
+    before_value(w);
+    if (v) put(w, "true", 4);
+    else put(w, "false", 5);
+}
+
+void json_null(JsonWriter *w) {
+    before_value(w);
+    put(w, "null", 4);
+}
+
+void json_raw(JsonWriter *w, const char *raw) {
+    before_value(w);
+    put(w, raw, strlen(raw));
+}
+
+void json_kv_str(JsonWriter *w, const char *key, const char *s) {
+    json_key(w, key);
+    json_str(w, s);
+}
+
+void json_kv_int(JsonWriter *w, const char *key, long long v) {
+    json_key(w, key);
+    json_int(w, v);
+}
+
+void json_kv_uint(JsonWriter *w, const char *key, unsigned long long v) {
+    json_key(w, key);
+    json_uint(w, v);
+}
+
+void json_kv_double(JsonWriter *w, const char *key, double v, int precision) {
+    json_key(w, key);
+    json_double(w, v, precision);
+}
+
+void json_kv_bool(JsonWriter *w, const char *key, int v) {
+    json_key(w, key);
+    json_bool(w, v);
+}
+
+void json_kv_null(JsonWriter *w, const char *key) {
+    json_key(w, key);
+    json_null(w);
+}
@@ -0,0 +1,256 @@
+/**
+ * @file router.c
+ * @brief API 路由表实现
+ *
+ * 路由在启动时按 '/' 切分为段, 插入前缀树. 每个节点的字面子节点按
+ * (长度, 内容) 排序后二分查找, "*" 段作为独立的参数子节点, 字面匹配
+ * 失败时回退尝试. 单次查找只与路径深度相关, 与路由总数无关.
+ * 树在 router_init 之后只读, 可被工作线程并发查找.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mongoose.h"
+#include "router.h"
+
+/* 同一路径上最多可注册的方法数 */
+#define ROUTER_MAX_METHODS 4
+
+typedef struct RouteNode {
+    char *segment;                          /* 字面段 (参数节点为NULL) */
+    size_t seg_len;
+    struct RouteNode **children;            /* 字面子节点, 已排序 */
+    int child_count;
+    struct RouteNode *param_child;          /* "*" 子节点 */
+    const Route *methods[ROUTER_MAX_METHODS];
+    int method_count;
+} RouteNode;
+
+static RouteNode *g_root = NULL;
+
+/* 当前线程正在执行的处理函数对应的匹配结果 */
+static __thread const RouteMatch *g_current = NULL;
+
+/* ==================== 树构建 ==================== */
+
+static int segment_cmp(const char *a, size_t alen, const char *b, size_t blen) {
+    if (alen != blen) return alen < blen ? -1 : 1;
+    return memcmp(a, b, alen);
+}
+
+/* 二分查找字面子节点, 未找到时 *pos 为插入位置 */
+static RouteNode *find_child(const RouteNode *node, const char *seg, size_t len, int *pos) {
+    int lo = 0, hi = node->child_count - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        RouteNode *child = node->children[mid];
+        int cmp = segment_cmp(seg, len, child->segment, child->seg_len);
+        if (cmp == 0) return child;
+        if (cmp < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    if (pos) *pos = lo;
+    return NULL;
+}
+
+static RouteNode *node_new(const char *seg, size_t len) {
+    RouteNode *node = calloc(1, sizeof(RouteNode));
+    if (!node) return NULL;
+
+    if (seg) {
+        node->segment = malloc(len + 1);
+        if (!node->segment) {
+            free(node);
+            return NULL;
+        }
+        memcpy(node->segment, seg, len);
+        node->segment[len] = '\0';
+        node->seg_len = len;
+    }
+    return node;
+}
+
+static void node_free(RouteNode *node) {
+    if (!node) return;
+    for (int i = 0; i < node->child_count; i++) {
+        node_free(node->children[i]);
+    }
+    node_free(node->param_child);
+    free(node->children);
+    free(node->segment);
+    free(node);
+}
+
+static RouteNode *node_get_child(RouteNode *node, const char *seg, size_t len) {
+    RouteNode *child;
+    RouteNode **children;
+    int pos = 0;
+
+    if (len == 1 && seg[0] == '*') {
+        if (!node->param_child) node->param_child = node_new(NULL, 0);
+        return node->param_child;
+    }
+
+    child = find_child(node, seg, len, &pos);
+    if (child) return child;
+
+    child = node_new(seg, len);
+    if (!child) return NULL;
+
+    children = realloc(node->children, (node->child_count + 1) * sizeof(RouteNode *));
+    if (!children) {
+        node_free(child);
+        return NULL;
+    }
+    node->children = children;
+    memmove(&children[pos + 1], &children[pos], (node->child_count - pos) * sizeof(RouteNode *));
+    children[pos] = child;
+    node->child_count++;
+    return child;
+}
+
+static int router_add(const Route *route) {
+    RouteNode *node = g_root;
+    const char *p = route->path;
+
+    while (*p == '/') {
+        const char *seg = p + 1;
+        const char *next = strchr(seg, '/');
+        size_t len = next ? (size_t)(next - seg) : strlen(seg);
+
+        node = node_get_child(node, seg, len);
+        if (!node) return -1;
+        p = seg + len;
+    }
+
+    if (*p != '\0') {
+        printf("[ROUTER] 非法路由路径: %s\n", route->path);
+        return -1;
+    }
+
+    for (int i = 0; i < node->method_count; i++) {
+        if (strcmp(node->methods[i]->method, route->method) == 0) {
+            printf("[ROUTER] 重复路由: %s %s\n", route->method, route->path);
+            return -1;
+        }
+    }
+    if (node->method_count >= ROUTER_MAX_METHODS) {
+        printf("[ROUTER] 路由方法过多: %s\n", route->path);
+        return -1;
+    }
+    node->methods[node->method_count++] = route;
+    return 0;
+}
+
+int router_init(const Route *routes, int count) {
+    router_deinit();
+
+    g_root = node_new(NULL, 0);
+    if (!g_root) return -1;
+
+    for (int i = 0; i < count; i++) {
+        if (router_add(&routes[i]) != 0) {
+            router_deinit();
+            return -1;
+        }
+    }
+
+    printf("[ROUTER] 已编译 %d 条路由\n", count);
+    return 0;
+}
+
+void router_deinit(void) {
+    node_free(g_root);
+    g_root = NULL;
+}
+
+/* ==================== 查找 ==================== */
+
+static const RouteNode *match_node(const RouteNode *node, const char *p, const char *end,
+                                   RouteMatch *match) {
+    const char *seg, *next;
+    const RouteNode *found;
+    size_t len;
+
+    if (p == end) return node->method_count > 0 ? node : NULL;
+    if (*p != '/') return NULL;
+
+    seg = p + 1;
+    next = memchr(seg, '/', (size_t)(end - seg));
+    if (!next) next = end;
+    len = (size_t)(next - seg);
+
+    /* 字面段优先 */
+    if (node->child_count > 0) {
+        RouteNode *child = find_child(node, seg, len, NULL);
+        if (child && (found = match_node(child, next, end, match)) != NULL) {
+            return found;
+        }
+    }
+
+    /* 回退到通配段 */
+    if (node->param_child && len > 0 && match->param_count < ROUTER_MAX_PARAMS) {
+        int idx = match->param_count++;
+        match->params[idx] = mg_str_n(seg, len);
+        if ((found = match_node(node->param_child, next, end, match)) != NULL) {
+            return found;
+        }
+        match->param_count--;
+    }
+
+    return NULL;
+}
+
+int router_lookup(struct mg_str method, struct mg_str uri, RouteMatch *match) {
+    const RouteNode *node;
+    const Route *any = NULL;
+
+    memset(match, 0, sizeof(*match));
+    if (!g_root || uri.len == 0) return -1;
+
+    node = match_node(g_root, uri.buf, uri.buf + uri.len, match);
+    if (!node) {
+        match->param_count = 0;
+        return -1;
+    }
+
+    for (int i = 0; i < node->method_count; i++) {
+        const Route *r = node->methods[i];
+        if (r->method[0] == '*' && r->method[1] == '\0') {
+            any = r;
+        } else if (strlen(r->method) == method.len &&
+                   memcmp(r->method, method.buf, method.len) == 0) {
+            match->route = r;
+            return 0;
+        }
+    }
+
+    if (any) {
+        match->route = any;
+        return 0;
+    }
+
+    match->path_found = 1;
+    return -1;
+}
+
+void router_invoke(const RouteMatch *match, struct mg_connection *c, struct mg_http_message *hm) {
+    const RouteMatch *prev = g_current;
+
+    g_current = match;
+    match->route->handler(c, hm);
+    g_current = prev;
+}
+
+int router_param(int idx, char *buf, size_t size) {
+    const struct mg_str *s;
+
+    if (!buf || size == 0) return -1;
+    buf[0] = '\0';
+    if (!g_current || idx < 0 || idx >= g_current->param_count) return -1;
+
+    s = &g_current->params[idx];
+    return mg_url_decode(s->buf, s->len, buf, size, 0);
+}
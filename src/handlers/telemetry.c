@@ -0,0 +1,558 @@
+/**
+ * @file telemetry.c
+ * @brief WebSocket 遥测推送实现
+ *
+ * 采样线程按主题周期在伪连接上调用原 GET 处理函数, 输出与轮询接口完全
+ * 一致. 结果与上一次按字段比较 (顶层及信封中的 Data), 只把变化的字段编码为增量帧, 经挂起
+ * 队列交给事件循环, 由事件循环写入所有订阅了该主题的 WebSocket 连接.
+ * 事件循环同时保留每个主题的最新完整数据, 供新订阅者和慢连接补发.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "mongoose.h"
+#include "telemetry.h"
+#include "router.h"
+#include "handlers.h"
+#include "advanced.h"
+#include "traffic.h"
+#include "sms_queue.h"
+#include "at_sched.h"
+
+/* 连接标记, 保存在 c->data 中 */
+#define TELEMETRY_MAGIC 0x544c4d57u     /* "TLMW" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t topics;            /* 已订阅主题位图 */
+    uint32_t stale;             /* 丢过增量的主题, 下一帧改发完整数据 */
+} WsSub;
+
+typedef struct {
+    const char *name;
+    const char *uri;
+    RouteHandler handler;
+    int interval_ms;
+    /* 采样线程私有 */
+    char *last;                 /* 上一次的响应体 */
+    int64_t next_ms;
+    /* 事件循环私有 */
+    char *snapshot;             /* 最新完整数据 */
+    /* g_tm_mutex 保护 */
+    int subscribers;
+    int resync;                 /* 丢弃基准, 下一次采样发完整数据 */
+} TelemetryTopic;
+
+/* 待事件循环发送的帧 */
+typedef struct TelemetryFrame {
+    struct TelemetryFrame *next;
+    int topic;
+    char *snapshot;             /* 完整响应体, 交给事件循环保存 */
+    char *frame;                /* 编码好的帧 (增量或完整) */
+} TelemetryFrame;
+
+static TelemetryTopic g_topics[] = {
+    {"info",    "/api/info",          handle_info,              5000, NULL, 0, NULL, 0, 0},
+    {"band",    "/api/current_band",  handle_get_current_band,  5000, NULL, 0, NULL, 0, 0},
+    {"cells",   "/api/cells",         handle_get_cells,         5000, NULL, 0, NULL, 0, 0},
+    {"traffic", "/api/get/Total",     handle_get_traffic_total, 5000, NULL, 0, NULL, 0, 0},
+    {"time",    "/api/get/time",      handle_get_system_time,   1000, NULL, 0, NULL, 0, 0},
+    {"sms_jobs", "/api/sms/jobs",     handle_sms_jobs,          1000, NULL, 0, NULL, 0, 0},
+};
+#define TOPIC_COUNT ((int)(sizeof(g_topics) / sizeof(g_topics[0])))
+
+static pthread_mutex_t g_tm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_tm_cond;
+static pthread_t g_tm_thread;
+static int g_tm_running = 0;
+static int g_tm_stop = 0;
+static struct mg_mgr *g_tm_mgr = NULL;
+static unsigned long g_tm_wake_id = 0;
+
+static TelemetryFrame *g_pending_head = NULL;
+static TelemetryFrame *g_pending_tail = NULL;
+
+/* ==================== 内部函数 ==================== */
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int topic_find(struct mg_str name) {
+    for (int i = 0; i < TOPIC_COUNT; i++) {
+        if (mg_strcmp(name, mg_str(g_topics[i].name)) == 0) return i;
+    }
+    return -1;
+}
+
+static WsSub *ws_sub(struct mg_connection *c) {
+    WsSub *sub = (WsSub *)c->data;
+    return c->is_websocket && sub->magic == TELEMETRY_MAGIC ? sub : NULL;
+}
+
+/* 在伪连接上执行 GET 处理函数, 返回响应体 (需 free), 非 200 返回 NULL */
+static char *sample_topic(const TelemetryTopic *t) {
+    struct mg_connection fake;
+    struct mg_http_message hm, resp;
+    char req[128];
+    char *body = NULL;
+    int n;
+
+    n = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\n\r\n", t->uri);
+    if (n <= 0 || n >= (int)sizeof(req) || mg_http_parse(req, (size_t)n, &hm) <= 0) {
+        return NULL;
+    }
+
+    memset(&fake, 0, sizeof(fake));
+    fake.is_accepted = 1;
+    fake.is_resp = 1;
+    fake.send.align = MG_IO_SIZE;
+    t->handler(&fake, &hm);
+
+    if (fake.send.len > 0 &&
+        mg_http_parse((char *)fake.send.buf, fake.send.len, &resp) > 0 &&
+        mg_http_status(&resp) == 200) {
+        body = malloc(resp.body.len + 1);
+        if (body) {
+            memcpy(body, resp.body.buf, resp.body.len);
+            body[resp.body.len] = '\0';
+        }
+    }
+    mg_iobuf_free(&fake.send);
+    mg_iobuf_free(&fake.recv);
+    return body;
+}
+
+/* 在 JSON 对象中查找顶层键 (key 含引号) */
+static int json_find_key(struct mg_str obj, struct mg_str key, struct mg_str *val) {
+    struct mg_str k, v;
+    size_t ofs = 0;
+
+    while ((ofs = mg_json_next(obj, ofs, &k, &v)) > 0) {
+        if (mg_strcmp(k, key) == 0) {
+            *val = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void io_puts(struct mg_iobuf *io, const char *s, size_t len) {
+    mg_iobuf_add(io, io->len, s, len);
+}
+
+static char *io_finish(struct mg_iobuf *io) {
+    char *s;
+
+    io_puts(io, "", 1);
+    s = (char *)io->buf;
+    if (!s) return NULL;
+    io->buf = NULL;
+    io->len = io->size = 0;
+    return s;
+}
+
+/* 完整帧 */
+static char *frame_full(const char *topic, const char *body) {
+    struct mg_iobuf io = {NULL, 0, 0, 256};
+
+    io_puts(&io, "{\"topic\":\"", 10);
+    io_puts(&io, topic, strlen(topic));
+    io_puts(&io, "\",\"full\":true,\"data\":", 21);
+    io_puts(&io, body, strlen(body));
+    io_puts(&io, "}", 1);
+    return io_finish(&io);
+}
+
+static int is_json_object(struct mg_str v) {
+    return v.len >= 2 && v.buf[0] == '{';
+}
+
+/*
+ * 把 cur 相对 prev 变化的字段写入 io (不含外层花括号).
+ * 接口响应的 {Code, Error, Data} 信封中, Data 两侧都是对象时再比较一层,
+ * 只写出其中变化的字段. 返回变化的字段数, prev 中有字段被删除时返回 -1.
+ */
+static int diff_object(struct mg_iobuf *io, struct mg_str po, struct mg_str co, int nested) {
+    struct mg_str k, v, pv;
+    size_t ofs = 0;
+    int prev_keys = 0, matched = 0, changed = 0;
+
+    while ((ofs = mg_json_next(po, ofs, NULL, NULL)) > 0) prev_keys++;
+
+    ofs = 0;
+    while ((ofs = mg_json_next(co, ofs, &k, &v)) > 0) {
+        int found = json_find_key(po, k, &pv);
+
+        if (found) {
+            matched++;
+            if (pv.len == v.len && memcmp(pv.buf, v.buf, v.len) == 0) continue;
+        }
+        if (changed > 0) io_puts(io, ",", 1);
+        io_puts(io, k.buf, k.len);
+        io_puts(io, ":", 1);
+
+        if (found && nested && mg_strcmp(k, mg_str("\"Data\"")) == 0 &&
+            is_json_object(pv) && is_json_object(v)) {
+            io_puts(io, "{", 1);
+            if (diff_object(io, pv, v, 0) < 0) return -1;
+            io_puts(io, "}", 1);
+        } else {
+            io_puts(io, v.buf, v.len);
+        }
+        changed++;
+    }
+    return matched == prev_keys ? changed : -1;
+}
+
+/*
+ * 增量帧: 只包含值发生变化的字段 (信封内的 Data 按字段比较).
+ * 上一次为空、不是对象或有字段被删除时退化为完整帧. 无变化返回 NULL.
+ */
+static char *frame_delta(const char *topic, const char *prev, const char *cur) {
+    struct mg_str po, co;
+    struct mg_iobuf io = {NULL, 0, 0, 256};
+    int changed;
+
+    if (!prev) return frame_full(topic, cur);
+
+    po = mg_str(prev);
+    co = mg_str(cur);
+    if (!is_json_object(co) || !is_json_object(po)) {
+        return strcmp(prev, cur) == 0 ? NULL : frame_full(topic, cur);
+    }
+
+    io_puts(&io, "{\"topic\":\"", 10);
+    io_puts(&io, topic, strlen(topic));
+    io_puts(&io, "\",\"data\":{", 10);
+    changed = diff_object(&io, po, co, 1);
+    io_puts(&io, "}}", 2);
+
+    if (changed < 0) {
+        mg_iobuf_free(&io);
+        return frame_full(topic, cur);
+    }
+    if (changed == 0) {
+        mg_iobuf_free(&io);
+        return NULL;
+    }
+    return io_finish(&io);
+}
+
+static void frame_free(TelemetryFrame *f) {
+    if (!f) return;
+    free(f->snapshot);
+    free(f->frame);
+    free(f);
+}
+
+/* 采样一个主题, 有变化时排队 */
+static void sample_and_queue(int idx) {
+    TelemetryTopic *t = &g_topics[idx];
+    TelemetryFrame *f;
+    char *body = sample_topic(t);
+    char *frame;
+
+    if (!body) return;
+
+    frame = frame_delta(t->name, t->last, body);
+    if (!frame) {
+        free(body);
+        return;
+    }
+
+    f = calloc(1, sizeof(TelemetryFrame));
+    if (!f || !(f->snapshot = strdup(body))) {
+        free(f);
+        free(frame);
+        free(body);
+        return;
+    }
+    f->topic = idx;
+    f->frame = frame;
+    free(t->last);
+    t->last = body;
+
+    pthread_mutex_lock(&g_tm_mutex);
+    if (g_pending_tail) g_pending_tail->next = f;
+    else __atomic_store_n(&g_pending_head, f, __ATOMIC_RELEASE);
+    g_pending_tail = f;
+    pthread_mutex_unlock(&g_tm_mutex);
+
+    mg_wakeup(g_tm_mgr, g_tm_wake_id, "T", 1);
+}
+
+static void *telemetry_thread(void *arg) {
+    (void)arg;
+
+    /* 推送频段/小区时的 AT 查询不能与用户的锁频、AT 控制台请求同级 */
+    at_sched_set_thread_priority(AT_PRIO_BACKGROUND);
+
+    pthread_mutex_lock(&g_tm_mutex);
+    while (!g_tm_stop) {
+        int64_t now = now_ms();
+        int64_t wait_ms = TELEMETRY_TICK_MS;
+        struct timespec ts;
+
+        for (int i = 0; i < TOPIC_COUNT && !g_tm_stop; i++) {
+            TelemetryTopic *t = &g_topics[i];
+
+            if (t->subscribers == 0) continue;
+            if (t->resync) {
+                /* 首个订阅者: 丢弃基准, 立即采样并发完整数据 */
+                free(t->last);
+                t->last = NULL;
+                t->next_ms = 0;
+                t->resync = 0;
+            }
+            if (now < t->next_ms) {
+                if (t->next_ms - now < wait_ms) wait_ms = t->next_ms - now;
+                continue;
+            }
+
+            t->next_ms = now + t->interval_ms;
+            pthread_mutex_unlock(&g_tm_mutex);
+            sample_and_queue(i);
+            pthread_mutex_lock(&g_tm_mutex);
+            now = now_ms();
+        }
+        if (g_tm_stop) break;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += wait_ms / 1000;
+        ts.tv_nsec += (wait_ms % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&g_tm_cond, &g_tm_mutex, &ts);
+    }
+    pthread_mutex_unlock(&g_tm_mutex);
+    return NULL;
+}
+
+/* 向连接发送帧, 慢连接只记录需要补发 */
+static void ws_send_frame(struct mg_connection *c, WsSub *sub, int idx, const char *frame) {
+    uint32_t bit = 1u << idx;
+    TelemetryTopic *t = &g_topics[idx];
+
+    if (c->send.len > TELEMETRY_SEND_MAX) {
+        sub->stale |= bit;
+        return;
+    }
+    if ((sub->stale & bit) && t->snapshot) {
+        mg_ws_printf(c, WEBSOCKET_OP_TEXT, "{\"topic\":\"%s\",\"full\":true,\"data\":%s}",
+                     t->name, t->snapshot);
+        sub->stale &= ~bit;
+        return;
+    }
+    mg_ws_send(c, frame, strlen(frame), WEBSOCKET_OP_TEXT);
+}
+
+/* 事件循环: 发送所有待发帧 */
+static void drain_pending(struct mg_mgr *mgr) {
+    TelemetryFrame *list;
+
+    pthread_mutex_lock(&g_tm_mutex);
+    list = g_pending_head;
+    __atomic_store_n(&g_pending_head, NULL, __ATOMIC_RELAXED);
+    g_pending_tail = NULL;
+    pthread_mutex_unlock(&g_tm_mutex);
+    if (!list) return;
+
+    while (list) {
+        TelemetryFrame *f = list;
+        TelemetryTopic *t = &g_topics[f->topic];
+        uint32_t bit = 1u << f->topic;
+
+        list = f->next;
+        free(t->snapshot);
+        t->snapshot = f->snapshot;
+        f->snapshot = NULL;
+
+        for (struct mg_connection *c = mgr->conns; c != NULL; c = c->next) {
+            WsSub *sub = ws_sub(c);
+            if (sub && (sub->topics & bit) && !c->is_closing) {
+                ws_send_frame(c, sub, f->topic, f->frame);
+            }
+        }
+        frame_free(f);
+    }
+}
+
+/* 处理订阅消息: {"sub":[...]} / {"unsub":[...]} */
+static void handle_ws_message(struct mg_connection *c, WsSub *sub, struct mg_ws_message *wm) {
+    static const char *const ops[] = {"$.sub", "$.unsub"};
+    int wake = 0;
+
+    for (int op = 0; op < 2; op++) {
+        struct mg_str list, v;
+        size_t ofs = 0;
+        int len = 0;
+        int o = mg_json_get(wm->data, ops[op], &len);
+
+        if (o < 0 || len < 2 || wm->data.buf[o] != '[') continue;
+        list = mg_str_n(wm->data.buf + o, (size_t)len);
+
+        while ((ofs = mg_json_next(list, ofs, NULL, &v)) > 0) {
+            int idx;
+            uint32_t bit;
+
+            if (v.len < 2 || v.buf[0] != '"') continue;
+            idx = topic_find(mg_str_n(v.buf + 1, v.len - 2));
+            if (idx < 0) continue;
+            bit = 1u << idx;
+
+            if (op == 0 && !(sub->topics & bit)) {
+                int first;
+
+                sub->topics |= bit;
+                sub->stale &= ~bit;
+                pthread_mutex_lock(&g_tm_mutex);
+                first = g_topics[idx].subscribers++ == 0;
+                if (first) g_topics[idx].resync = 1;
+                pthread_mutex_unlock(&g_tm_mutex);
+
+                /* 无人订阅期间数据未更新, 等待重新采样; 否则立即发送 */
+                if (first) {
+                    free(g_topics[idx].snapshot);
+                    g_topics[idx].snapshot = NULL;
+                    wake = 1;
+                } else if (g_topics[idx].snapshot) {
+                    mg_ws_printf(c, WEBSOCKET_OP_TEXT, "{\"topic\":\"%s\",\"full\":true,\"data\":%s}",
+                                 g_topics[idx].name, g_topics[idx].snapshot);
+                }
+            } else if (op == 1 && (sub->topics & bit)) {
+                sub->topics &= ~bit;
+                pthread_mutex_lock(&g_tm_mutex);
+                g_topics[idx].subscribers--;
+                pthread_mutex_unlock(&g_tm_mutex);
+            }
+        }
+    }
+
+    if (wake) {
+        pthread_mutex_lock(&g_tm_mutex);
+        pthread_cond_signal(&g_tm_cond);
+        pthread_mutex_unlock(&g_tm_mutex);
+    }
+}
+
+/* 连接关闭: 退订全部主题 */
+static void ws_close(WsSub *sub) {
+    pthread_mutex_lock(&g_tm_mutex);
+    for (int i = 0; i < TOPIC_COUNT; i++) {
+        if (sub->topics & (1u << i)) g_topics[i].subscribers--;
+    }
+    pthread_mutex_unlock(&g_tm_mutex);
+    sub->topics = 0;
+    sub->magic = 0;
+}
+
+/* ==================== 公共接口 ==================== */
+
+int telemetry_init(struct mg_mgr *mgr, unsigned long wake_id) {
+    pthread_condattr_t attr;
+
+    if (!mgr || g_tm_running) return -1;
+
+    /* 线程池已初始化时 mg_wakeup_init 返回 false, 这里只检查管道 */
+    if (mgr->pipe == MG_INVALID_SOCKET && !mg_wakeup_init(mgr)) {
+        printf("[TELEMETRY] mg_wakeup 初始化失败\n");
+        return -1;
+    }
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_tm_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_tm_mgr = mgr;
+    g_tm_wake_id = wake_id;
+    g_tm_stop = 0;
+
+    if (pthread_create(&g_tm_thread, NULL, telemetry_thread, NULL) != 0) {
+        printf("[TELEMETRY] 创建采样线程失败\n");
+        pthread_cond_destroy(&g_tm_cond);
+        return -1;
+    }
+    g_tm_running = 1;
+    printf("[TELEMETRY] 遥测推送已启动: %d 个主题\n", TOPIC_COUNT);
+    return 0;
+}
+
+void telemetry_deinit(void) {
+    TelemetryFrame *f;
+
+    if (!g_tm_running) return;
+
+    pthread_mutex_lock(&g_tm_mutex);
+    g_tm_stop = 1;
+    pthread_cond_signal(&g_tm_cond);
+    pthread_mutex_unlock(&g_tm_mutex);
+    pthread_join(g_tm_thread, NULL);
+    pthread_cond_destroy(&g_tm_cond);
+    g_tm_running = 0;
+
+    while ((f = g_pending_head) != NULL) {
+        g_pending_head = f->next;
+        frame_free(f);
+    }
+    g_pending_tail = NULL;
+
+    for (int i = 0; i < TOPIC_COUNT; i++) {
+        free(g_topics[i].last);
+        free(g_topics[i].snapshot);
+        g_topics[i].last = g_topics[i].snapshot = NULL;
+        g_topics[i].next_ms = 0;
+    }
+}
+
+void telemetry_ws_open(struct mg_connection *c) {
+    WsSub sub = {TELEMETRY_MAGIC, 0, 0};
+
+    /* mongoose 默认 MG_DATA_SIZE 为 32, 足够存放订阅状态 */
+    memcpy(c->data, &sub, sizeof(sub));
+}
+
+int telemetry_handle_event(struct mg_connection *c, int ev, void *ev_data) {
+    WsSub *sub;
+
+    if (ev == MG_EV_WAKEUP) {
+        struct mg_str *data = (struct mg_str *)ev_data;
+        if (!c->is_listening || data->len != 1 || data->buf[0] != 'T') return 0;
+        drain_pending(c->mgr);
+        return 1;
+    }
+
+    /*
+     * mg_wakeup 以非阻塞方式发送且不检查结果, 事件循环繁忙、socketpair
+     * 缓冲区满时唤醒会丢失, 之后的帧又只追加到队列. 轮询时无锁查看队列头,
+     * 只有确实积压时才取锁
+     */
+    if (ev == MG_EV_POLL) {
+        if (c->is_listening && __atomic_load_n(&g_pending_head, __ATOMIC_ACQUIRE)) {
+            drain_pending(c->mgr);
+        }
+        return 0;
+    }
+
+    sub = ws_sub(c);
+    if (!sub) return 0;
+
+    if (ev == MG_EV_WS_MSG) {
+        handle_ws_message(c, sub, (struct mg_ws_message *)ev_data);
+        return 1;
+    }
+    if (ev == MG_EV_CLOSE) {
+        ws_close(sub);
+        return 1;
+    }
+    return 0;
+}
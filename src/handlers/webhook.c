@@ -0,0 +1,579 @@
+/**
+ * @file webhook.c
+ * @brief Webhook 投递队列实现
+ *
+ * 队列只存在于数据库中, 事件循环按 id 顺序取出到期的通知, 为每条通知
+ * 分配一个连接槽. 槽与目标绑定, 请求完成后若服务端允许 keep-alive,
+ * 槽保持连接空闲等待同一目标的下一条通知. 超时、空闲回收与退避到期
+ * 都由一次性定时器驱动, 队列为空且无连接时不会唤醒事件循环.
+ *
+ * 不校验证书的通知只复用同样不校验的连接, 反之亦然.
+ *
+ * 复用的空闲连接可能已被服务端关闭, 此时请求在收到任何响应前断开,
+ * 不计入失败次数, 立即换新连接重发.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "mongoose.h"
+#include "webhook.h"
+#include "database.h"
+#include "json_writer.h"
+#include "http_utils.h"
+
+/* 每次从队列中取出的到期通知数 */
+#define WEBHOOK_FETCH_MAX   64
+
+/* 有连接时的检查周期 (超时、空闲回收) */
+#define WEBHOOK_TICK_MS     1000
+
+#define WEBHOOK_DEST_LEN    160
+#define WEBHOOK_ERROR_LEN   96
+
+typedef struct {
+    long long id;
+    int attempts;
+    int insecure;               /* https 不校验证书 */
+    long long created_ms;       /* 入队时间 (Unix 毫秒) */
+    char *url;
+    char *headers;
+    char *body;
+} WebhookJob;
+
+/* 连接槽, 作为连接的 fn_data */
+typedef struct {
+    struct mg_connection *c;    /* NULL 表示空槽 */
+    char dest[WEBHOOK_DEST_LEN]; /* 协议://主机:端口 */
+    int insecure;               /* 建立连接时未校验证书 */
+    WebhookJob *job;            /* NULL 表示空闲 */
+    int reused;                 /* 当前请求使用的是复用连接 */
+    int responded;              /* 连接上收到过响应 */
+    uint64_t started;           /* 请求开始 (mg_millis) */
+    uint64_t deadline;          /* 在途: 超时时间; 空闲: 回收时间 */
+    char error[WEBHOOK_ERROR_LEN];
+} WebhookConn;
+
+/* 以下状态只在事件循环中访问 */
+static struct mg_mgr *g_wh_mgr = NULL;
+static WebhookConn g_conns[WEBHOOK_CONN_MAX];
+static uint64_t g_timer_due = 0;            /* 已设置的最早定时器, 0 表示无 */
+static struct mg_str g_ca = {NULL, 0};      /* WEBHOOK_CA_FILE 的内容 */
+
+/* 运行状态、唤醒标记与统计 (g_wh_mutex 保护) */
+static pthread_mutex_t g_wh_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long g_wh_wake_id = 0;
+static int g_wh_running = 0;
+static int g_wh_kick = 0;
+
+static struct {
+    unsigned long long enqueued;
+    unsigned long long delivered;
+    unsigned long long failed;              /* 失败的请求次数 (含重试) */
+    unsigned long long dropped;             /* 放弃投递的通知数 */
+    unsigned long long reused;              /* 走复用连接的请求数 */
+    unsigned long long latency_total_ms;    /* 成功请求耗时之和 */
+    long long latency_last_ms;
+    long long latency_max_ms;
+    long long delay_last_ms;                /* 最近一条从入队到送达的时间 */
+    long long last_success;                 /* Unix 秒 */
+    long long last_error_at;
+    char last_error[WEBHOOK_DEST_LEN + 2 + WEBHOOK_ERROR_LEN];     /* "目标: 错误" */
+} g_stats;
+
+static void webhook_pump(void);
+
+/* ==================== 工具 ==================== */
+
+static long long unix_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 目标键: 协议://主机:端口 */
+static void dest_of(const char *url, char *buf, size_t size) {
+    struct mg_str host = mg_url_host(url);
+
+    snprintf(buf, size, "%s://%.*s:%u", mg_url_is_ssl(url) ? "https" : "http",
+             (int)host.len, host.buf, mg_url_port(url));
+}
+
+static void job_free(WebhookJob *job) {
+    if (!job) return;
+    free(job->url);
+    free(job->headers);
+    free(job->body);
+    free(job);
+}
+
+static int job_in_flight(long long id) {
+    for (int i = 0; i < WEBHOOK_CONN_MAX; i++) {
+        if (g_conns[i].job && g_conns[i].job->id == id) return 1;
+    }
+    return 0;
+}
+
+static void record_error(const char *dest, const char *error) {
+    pthread_mutex_lock(&g_wh_mutex);
+    g_stats.failed++;
+    g_stats.last_error_at = (long long)time(NULL);
+    snprintf(g_stats.last_error, sizeof(g_stats.last_error), "%s: %s", dest, error);
+    pthread_mutex_unlock(&g_wh_mutex);
+}
+
+/* ==================== 定时器 ==================== */
+
+static void on_webhook_timer(void *arg);
+
+/* 在 delay_ms 后唤醒, 已有更早的定时器时不重复设置 */
+static void arm_timer(uint64_t delay_ms) {
+    uint64_t due = mg_millis() + delay_ms;
+
+    if (g_timer_due != 0 && g_timer_due <= due) return;
+    if (mg_timer_add(g_wh_mgr, delay_ms, MG_TIMER_ONCE, on_webhook_timer, NULL) != NULL) {
+        g_timer_due = due;
+    }
+}
+
+/* 按在途连接与队列中最早的退避时间设置下一次唤醒 */
+static void schedule_next(void) {
+    long long now = unix_ms();
+    DbIter it;
+
+    for (int i = 0; i < WEBHOOK_CONN_MAX; i++) {
+        if (g_conns[i].c) {
+            arm_timer(WEBHOOK_TICK_MS);
+            break;
+        }
+    }
+
+    if (db_iter_begin(&it, "SELECT MIN(next_at) FROM webhook_queue WHERE next_at > ?;", "l", now) == 0) {
+        if (db_iter_next(&it) == 1 && !db_col_is_null(&it, 0)) {
+            arm_timer((uint64_t)(db_col_int64(&it, 0) - now));
+        }
+        db_iter_end(&it);
+    }
+}
+
+/* 请求超时与空闲连接回收 */
+static void check_conns(void) {
+    uint64_t now = mg_millis();
+
+    for (int i = 0; i < WEBHOOK_CONN_MAX; i++) {
+        WebhookConn *wc = &g_conns[i];
+
+        if (!wc->c || wc->c->is_closing || now < wc->deadline) continue;
+        if (wc->job) snprintf(wc->error, sizeof(wc->error), "timeout");
+        wc->c->is_closing = 1;
+    }
+}
+
+static void on_webhook_timer(void *arg) {
+    (void)arg;
+
+    if (g_timer_due <= mg_millis()) g_timer_due = 0;
+    if (!g_wh_running) return;
+    check_conns();
+    webhook_pump();
+}
+
+/* ==================== 请求 ==================== */
+
+static void send_request(WebhookConn *wc) {
+    WebhookJob *job = wc->job;
+    struct mg_connection *c = wc->c;
+    struct mg_str host = mg_url_host(job->url);
+    unsigned short port = mg_url_port(job->url);
+    int has_type = 0;
+
+    mg_printf(c, "POST %s HTTP/1.1\r\nHost: %.*s", mg_url_uri(job->url), (int)host.len, host.buf);
+    if (port != (mg_url_is_ssl(job->url) ? 443 : 80)) mg_printf(c, ":%u", port);
+    mg_printf(c, "\r\nUser-Agent: ofono-server\r\nContent-Length: %lu\r\n", (unsigned long)strlen(job->body));
+
+    /* 自定义请求头, 每行一个 "Name: Value" */
+    for (const char *p = job->headers; p && *p;) {
+        const char *end = strchr(p, '\n');
+        const char *next = end ? end + 1 : p + strlen(p);
+        size_t len = (size_t)((end ? end : next) - p);
+
+        while (len > 0 && (*p == ' ' || *p == '\r')) p++, len--;
+        while (len > 0 && (p[len - 1] == '\r' || p[len - 1] == ' ')) len--;
+        if (len > 0 && memchr(p, ':', len)) {
+            if (len >= 13 && strncasecmp(p, "Content-Type:", 13) == 0) has_type = 1;
+            mg_printf(c, "%.*s\r\n", (int)len, p);
+        }
+        p = next;
+    }
+    if (!has_type) mg_printf(c, "Content-Type: application/json\r\n");
+
+    mg_printf(c, "\r\n");
+    mg_send(c, job->body, strlen(job->body));
+}
+
+/* 请求结束: status 为 HTTP 状态码, 0 表示网络错误 */
+static void finish_job(WebhookConn *wc, int status) {
+    WebhookJob *job = wc->job;
+    long long rtt = (long long)(mg_millis() - wc->started);
+
+    wc->job = NULL;
+    if (!job) return;
+
+    if (status >= 200 && status < 300) {
+        db_exec_bind("DELETE FROM webhook_queue WHERE id = ?;", "l", job->id);
+
+        pthread_mutex_lock(&g_wh_mutex);
+        g_stats.delivered++;
+        g_stats.latency_total_ms += (unsigned long long)rtt;
+        g_stats.latency_last_ms = rtt;
+        if (rtt > g_stats.latency_max_ms) g_stats.latency_max_ms = rtt;
+        g_stats.delay_last_ms = unix_ms() - job->created_ms;
+        g_stats.last_success = (long long)time(NULL);
+        pthread_mutex_unlock(&g_wh_mutex);
+
+        printf("[WEBHOOK] #%lld 已送达 %s (HTTP %d, %lld ms)\n", job->id, wc->dest, status, rtt);
+    } else {
+        /* 网络错误、超时、408/429 与 5xx 可重试, 其余 4xx 重试也不会成功 */
+        int retry = status == 0 || status == 408 || status == 429 || status >= 500;
+        int attempts = job->attempts + 1;
+        char error[WEBHOOK_ERROR_LEN];
+
+        if (status) snprintf(error, sizeof(error), "HTTP %d", status);
+        else snprintf(error, sizeof(error), "%s", wc->error[0] ? wc->error : "connection closed");
+        record_error(wc->dest, error);
+
+        if (retry && attempts < WEBHOOK_MAX_ATTEMPTS) {
+            long long backoff = (long long)WEBHOOK_BACKOFF_BASE_S << (attempts - 1);
+
+            if (backoff > WEBHOOK_BACKOFF_MAX_S) backoff = WEBHOOK_BACKOFF_MAX_S;
+            db_exec_bind("UPDATE webhook_queue SET attempts = ?, next_at = ?, last_error = ? WHERE id = ?;",
+                         "ilsl", attempts, unix_ms() + backoff * 1000, error, job->id);
+            printf("[WEBHOOK] #%lld 投递失败 (%s), %lld 秒后第 %d 次重试\n",
+                   job->id, error, backoff, attempts + 1);
+        } else {
+            db_exec_bind("DELETE FROM webhook_queue WHERE id = ?;", "l", job->id);
+            pthread_mutex_lock(&g_wh_mutex);
+            g_stats.dropped++;
+            pthread_mutex_unlock(&g_wh_mutex);
+            printf("[WEBHOOK] #%lld 投递失败 (%s), 已尝试 %d 次, 放弃\n", job->id, error, attempts);
+        }
+    }
+    job_free(job);
+}
+
+static void webhook_conn_fn(struct mg_connection *c, int ev, void *ev_data) {
+    WebhookConn *wc = (WebhookConn *)c->fn_data;
+
+    if (!wc || wc->c != c) return;
+
+    if (ev == MG_EV_CONNECT) {
+        if (strncmp(wc->dest, "https:", 6) == 0) {
+            struct mg_tls_opts opts;
+
+            memset(&opts, 0, sizeof(opts));
+            opts.name = mg_url_host(wc->job->url);
+            opts.ca = g_ca;
+            opts.skip_verification = wc->insecure;
+            mg_tls_init(c, &opts);
+        }
+        send_request(wc);
+    } else if (ev == MG_EV_HTTP_MSG) {
+        struct mg_http_message *hm = (struct mg_http_message *)ev_data;
+        struct mg_str *conn_hdr = mg_http_get_header(hm, "Connection");
+        /* 响应行解析后版本号位于 method 字段 */
+        int keep_alive = mg_strcmp(hm->method, mg_str("HTTP/1.1")) == 0 &&
+                         !(conn_hdr && mg_strcasecmp(*conn_hdr, mg_str("close")) == 0);
+
+        wc->responded = 1;
+        finish_job(wc, mg_http_status(hm));
+        if (!keep_alive) {
+            c->is_draining = 1;
+        } else {
+            wc->deadline = mg_millis() + WEBHOOK_IDLE_MS;
+        }
+        if (g_wh_running) webhook_pump();
+    } else if (ev == MG_EV_ERROR) {
+        snprintf(wc->error, sizeof(wc->error), "%s", (const char *)ev_data);
+    } else if (ev == MG_EV_CLOSE) {
+        wc->c = NULL;
+        if (wc->job) {
+            if (!g_wh_running) {
+                /* 停止时保留在队列中, 下次启动继续投递 */
+                job_free(wc->job);
+                wc->job = NULL;
+            } else if (wc->reused && !wc->responded) {
+                /* 空闲连接已被对端关闭, 不计失败, 换新连接重发 */
+                job_free(wc->job);
+                wc->job = NULL;
+            } else {
+                finish_job(wc, 0);
+            }
+        }
+        if (g_wh_running) webhook_pump();
+    }
+}
+
+/*
+ * 为通知分配连接并发出请求
+ * @return 0 已发出 (或已按失败处理), -1 目标并发已满或无空闲槽, 保留到下一轮
+ */
+static int dispatch_job(WebhookJob *job) {
+    WebhookConn *idle = NULL, *free_slot = NULL;
+    char dest[sizeof(g_conns[0].dest)];
+    int busy = 0;
+
+    dest_of(job->url, dest, sizeof(dest));
+
+    for (int i = 0; i < WEBHOOK_CONN_MAX; i++) {
+        WebhookConn *wc = &g_conns[i];
+
+        if (!wc->c) {
+            if (!free_slot) free_slot = wc;
+            continue;
+        }
+        if (strcmp(wc->dest, dest) != 0 || wc->insecure != job->insecure) continue;
+        if (wc->job) busy++;
+        else if (!idle && !wc->c->is_closing && !wc->c->is_draining) idle = wc;
+    }
+    if (busy >= WEBHOOK_HOST_CONCURRENCY) return -1;
+
+    if (idle) {
+        idle->job = job;
+        idle->reused = 1;
+        idle->responded = 0;
+        idle->error[0] = '\0';
+        idle->started = mg_millis();
+        idle->deadline = idle->started + WEBHOOK_TIMEOUT_MS;
+        pthread_mutex_lock(&g_wh_mutex);
+        g_stats.reused++;
+        pthread_mutex_unlock(&g_wh_mutex);
+        send_request(idle);
+        return 0;
+    }
+
+    if (!free_slot) {
+        /* 回收一个其他目标的空闲连接, 关闭后再分配 */
+        for (int i = 0; i < WEBHOOK_CONN_MAX; i++) {
+            if (g_conns[i].c && !g_conns[i].job) {
+                g_conns[i].c->is_closing = 1;
+                break;
+            }
+        }
+        return -1;
+    }
+
+    memset(free_slot, 0, sizeof(*free_slot));
+    snprintf(free_slot->dest, sizeof(free_slot->dest), "%s", dest);
+    free_slot->insecure = job->insecure;
+    free_slot->job = job;
+    free_slot->started = mg_millis();
+    free_slot->deadline = free_slot->started + WEBHOOK_TIMEOUT_MS;
+    free_slot->c = mg_http_connect(g_wh_mgr, job->url, webhook_conn_fn, free_slot);
+    if (!free_slot->c) {
+        snprintf(free_slot->error, sizeof(free_slot->error), "connect failed");
+        finish_job(free_slot, 0);
+    }
+    return 0;
+}
+
+/* 取出到期的通知并发出, 结束后设置下一次唤醒 */
+static void webhook_pump(void) {
+    WebhookJob *jobs[WEBHOOK_FETCH_MAX];
+    int n = 0;
+    DbIter it;
+
+    if (db_iter_begin(&it,
+            "SELECT id, url, headers, body, attempts, created_at, insecure FROM webhook_queue "
+            "WHERE next_at <= ? ORDER BY id LIMIT ?;",
+            "li", unix_ms(), WEBHOOK_FETCH_MAX) == 0) {
+        while (n < WEBHOOK_FETCH_MAX && db_iter_next(&it) == 1) {
+            WebhookJob *job;
+            long long id = db_col_int64(&it, 0);
+
+            if (job_in_flight(id)) continue;
+            job = (WebhookJob *)calloc(1, sizeof(WebhookJob));
+            if (!job) break;
+            job->id = id;
+            job->url = strdup(db_col_text(&it, 1) ? db_col_text(&it, 1) : "");
+            job->headers = strdup(db_col_text(&it, 2) ? db_col_text(&it, 2) : "");
+            job->body = strdup(db_col_text(&it, 3) ? db_col_text(&it, 3) : "");
+            job->attempts = db_col_int(&it, 4);
+            job->created_ms = db_col_int64(&it, 5);
+            job->insecure = db_col_int(&it, 6);
+            if (!job->url || !job->headers || !job->body) {
+                job_free(job);
+                break;
+            }
+            jobs[n++] = job;
+        }
+        db_iter_end(&it);
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (dispatch_job(jobs[i]) != 0) job_free(jobs[i]);
+    }
+    schedule_next();
+}
+
+/* ==================== 公共接口 ==================== */
+
+int webhook_init(struct mg_mgr *mgr, unsigned long wake_id) {
+    int pending;
+
+    if (!mgr || g_wh_running) return -1;
+
+    if (mgr->pipe == MG_INVALID_SOCKET && !mg_wakeup_init(mgr)) {
+        printf("[WEBHOOK] mg_wakeup 初始化失败\n");
+        return -1;
+    }
+
+    g_wh_mgr = mgr;
+    memset(g_conns, 0, sizeof(g_conns));
+    g_timer_due = 0;
+
+    g_ca = mg_file_read(&mg_fs_posix, WEBHOOK_CA_FILE);
+    if (g_ca.buf) {
+        printf("[WEBHOOK] 已载入 CA 证书: %s\n", WEBHOOK_CA_FILE);
+    } else {
+        printf("[WEBHOOK] 未找到 %s, https 只校验主机名与证书链\n", WEBHOOK_CA_FILE);
+    }
+
+    pthread_mutex_lock(&g_wh_mutex);
+    g_wh_wake_id = wake_id;
+    g_wh_running = 1;
+    g_wh_kick = 0;
+    pthread_mutex_unlock(&g_wh_mutex);
+
+    /* 上次未送达的通知 */
+    pending = db_query_int("SELECT COUNT(*) FROM webhook_queue;", 0);
+    printf("[WEBHOOK] 投递队列已启动, 待投递 %d 条\n", pending);
+    if (pending > 0) webhook_pump();
+    return 0;
+}
+
+void webhook_deinit(void) {
+    pthread_mutex_lock(&g_wh_mutex);
+    if (!g_wh_running) {
+        pthread_mutex_unlock(&g_wh_mutex);
+        return;
+    }
+    g_wh_running = 0;
+    pthread_mutex_unlock(&g_wh_mutex);
+
+    /* 在途请求留在队列中, 连接随 mg_mgr_free 关闭 */
+    for (int i = 0; i < WEBHOOK_CONN_MAX; i++) {
+        if (g_conns[i].c) g_conns[i].c->is_closing = 1;
+    }
+
+    /* mg_tls_init 已复制证书, 连接关闭前释放也不受影响 */
+    mg_free((void *)g_ca.buf);
+    g_ca.buf = NULL;
+    g_ca.len = 0;
+}
+
+int webhook_enqueue(const char *url, const char *headers, const char *body, int insecure) {
+    long long now = unix_ms();
+    long long id;
+    int trimmed;
+
+    if (!url || (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0)) {
+        printf("[WEBHOOK] 不支持的地址: %s\n", url ? url : "(null)");
+        return -1;
+    }
+
+    id = db_insert_bind(
+        "INSERT INTO webhook_queue (url, headers, body, attempts, next_at, created_at, insecure) "
+        "VALUES (?, ?, ?, 0, ?, ?, ?);",
+        "ssslli", url, headers ? headers : "", body ? body : "", now, now, insecure ? 1 : 0);
+    if (id <= 0) return -1;
+
+    trimmed = db_exec_bind("DELETE FROM webhook_queue WHERE id <= "
+                           "(SELECT id FROM webhook_queue ORDER BY id DESC LIMIT 1 OFFSET ?);",
+                           "i", WEBHOOK_QUEUE_MAX);
+
+    pthread_mutex_lock(&g_wh_mutex);
+    g_stats.enqueued++;
+    if (trimmed > 0) g_stats.dropped += (unsigned long long)trimmed;
+    __atomic_store_n(&g_wh_kick, 1, __ATOMIC_RELEASE);
+    if (g_wh_running) mg_wakeup(g_wh_mgr, g_wh_wake_id, "W", 1);
+    pthread_mutex_unlock(&g_wh_mutex);
+
+    printf("[WEBHOOK] #%lld 已入队: %s\n", id, url);
+    return 0;
+}
+
+int webhook_handle_event(struct mg_connection *c, int ev, void *ev_data) {
+    int kick;
+
+    if (ev == MG_EV_WAKEUP) {
+        struct mg_str *data = (struct mg_str *)ev_data;
+        if (!c->is_listening || data->len != 1 || data->buf[0] != 'W') return 0;
+    } else if (ev != MG_EV_POLL || !c->is_listening) {
+        return 0;
+    }
+
+    /*
+     * 丢失的唤醒 (见 telemetry.c) 在这里的代价更大: 空闲时没有定时器,
+     * 新通知要等到下一次入队才会投递. 因此轮询时也检查标记 (原子读, 不取锁).
+     * g_wh_running 只在事件循环线程中修改
+     */
+    kick = __atomic_load_n(&g_wh_kick, __ATOMIC_ACQUIRE) &&
+           __atomic_exchange_n(&g_wh_kick, 0, __ATOMIC_ACQ_REL);
+
+    if (kick && g_wh_running) webhook_pump();
+    return ev == MG_EV_WAKEUP;
+}
+
+/* GET /api/webhook/stats */
+void handle_webhook_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    int in_flight = 0, conns = 0, queued, retrying;
+    JsonWriter w;
+
+    HTTP_CHECK_GET(c, hm);
+
+    queued = db_query_int("SELECT COUNT(*) FROM webhook_queue;", 0);
+    retrying = db_query_int("SELECT COUNT(*) FROM webhook_queue WHERE attempts > 0;", 0);
+
+    for (int i = 0; i < WEBHOOK_CONN_MAX; i++) {
+        if (!g_conns[i].c) continue;
+        conns++;
+        if (g_conns[i].job) in_flight++;
+    }
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    json_kv_int(&w, "queued", queued);
+    json_kv_int(&w, "retrying", retrying);
+    json_kv_int(&w, "inFlight", in_flight);
+    json_kv_int(&w, "connections", conns);
+
+    pthread_mutex_lock(&g_wh_mutex);
+    json_kv_uint(&w, "enqueued", g_stats.enqueued);
+    json_kv_uint(&w, "delivered", g_stats.delivered);
+    json_kv_uint(&w, "failed", g_stats.failed);
+    json_kv_uint(&w, "dropped", g_stats.dropped);
+    json_kv_uint(&w, "reused", g_stats.reused);
+    json_key(&w, "latencyMs");
+    json_obj_begin(&w);
+    json_kv_int(&w, "last", g_stats.latency_last_ms);
+    json_kv_int(&w, "avg", g_stats.delivered ? (long long)(g_stats.latency_total_ms / g_stats.delivered) : 0);
+    json_kv_int(&w, "max", g_stats.latency_max_ms);
+    json_obj_end(&w);
+    json_kv_int(&w, "lastDelayMs", g_stats.delay_last_ms);
+    json_kv_int(&w, "lastSuccess", g_stats.last_success);
+    json_kv_str(&w, "lastError", g_stats.last_error);
+    json_kv_int(&w, "lastErrorAt", g_stats.last_error_at);
+    pthread_mutex_unlock(&g_wh_mutex);
+
+    json_obj_end(&w);
+    json_obj_end(&w);
+    json_end(&w);
+}
@@ -0,0 +1,385 @@
+/**
+ * @file worker_pool.c
+ * @brief 阻塞型 API 处理函数的工作线程池实现
+ *
+ * 事件循环线程只负责复制请求并排队. 工作线程在一个私有的伪连接上
+ * 调用原处理函数, 处理函数写入的 HTTP 响应被收集到任务中, 再通过
+ * mg_wakeup 通知事件循环把响应写回真实连接. 挂起期间 c->is_resp 保持
+ * 为1, mongoose 不会解析同一连接上的后续请求.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <glib.h>
+#include "mongoose.h"
+#include "worker_pool.h"
+#include "http_utils.h"
+
+/* 最多统计的路由数 */
+#define WORKER_MAX_ROUTE_STATS 48
+
+typedef enum {
+    JOB_QUEUED = 0,
+    JOB_RUNNING,
+    JOB_DONE
+} JobState;
+
+/* 单路由统计 */
+typedef struct {
+    const Route *route;
+    unsigned long submitted;
+    unsigned long completed;
+    unsigned long rejected;
+    int queued;                 /* 当前排队数 */
+    int running;                /* 当前执行数 */
+    gint64 wait_total_us;
+    gint64 wait_max_us;
+    gint64 exec_total_us;
+    gint64 exec_max_us;
+} RouteStats;
+
+typedef struct WorkerJob {
+    struct WorkerJob *next;
+    const Route *route;
+    RouteStats *stats;
+    unsigned long conn_id;
+    struct mg_addr rem;
+    struct mg_addr loc;
+    char *req;                      /* 请求报文副本 */
+    struct mg_http_message hm;      /* 指向 req 的解析结果 */
+    struct mg_iobuf out;            /* 处理函数生成的响应 */
+    JobState state;
+    int orphaned;                   /* 执行中连接已关闭, 由工作线程释放 */
+    int conn_close;                 /* 响应后关闭连接 */
+    gint64 queued_us;
+} WorkerJob;
+
+static pthread_mutex_t g_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t *g_threads = NULL;
+static int g_thread_count = 0;
+static int g_queue_max = WORKER_POOL_QUEUE_MAX;
+static int g_stop = 0;
+static struct mg_mgr *g_mgr = NULL;
+
+static WorkerJob *g_queue_head = NULL;
+static WorkerJob *g_queue_tail = NULL;
+static int g_queue_len = 0;
+static int g_running_count = 0;
+static unsigned long g_rejected = 0;
+
+static RouteStats g_stats[WORKER_MAX_ROUTE_STATS];
+static int g_stats_count = 0;
+
+/* ==================== 内部函数 ==================== */
+
+/* 查找或创建路由统计 (需持有锁) */
+static RouteStats *get_stats(const Route *route) {
+    for (int i = 0; i < g_stats_count; i++) {
+        if (g_stats[i].route == route) return &g_stats[i];
+    }
+    if (g_stats_count >= WORKER_MAX_ROUTE_STATS) return NULL;
+    memset(&g_stats[g_stats_count], 0, sizeof(RouteStats));
+    g_stats[g_stats_count].route = route;
+    return &g_stats[g_stats_count++];
+}
+
+static void job_free(WorkerJob *job) {
+    if (!job) return;
+    mg_iobuf_free(&job->out);
+    free(job->req);
+    free(job);
+}
+
+/* 从队列中摘除任务 (需持有锁) */
+static void queue_remove(WorkerJob *job) {
+    WorkerJob **pp = &g_queue_head;
+    WorkerJob *prev = NULL;
+
+    while (*pp && *pp != job) {
+        prev = *pp;
+        pp = &(*pp)->next;
+    }
+    if (!*pp) return;
+
+    *pp = job->next;
+    if (g_queue_tail == job) g_queue_tail = prev;
+    job->next = NULL;
+    g_queue_len--;
+}
+
+/* 在伪连接上执行处理函数并收集响应 */
+static void job_execute(WorkerJob *job) {
+    struct mg_connection fake;
+    RouteMatch match;
+
+    memset(&fake, 0, sizeof(fake));
+    fake.id = job->conn_id;
+    fake.rem = job->rem;
+    fake.loc = job->loc;
+    fake.is_accepted = 1;
+    fake.is_resp = 1;
+    fake.send.align = MG_IO_SIZE;
+
+    /* 通配段需指向副本, 重新查找一次 (路由树只读, 线程安全) */
+    if (router_lookup(job->hm.method, job->hm.uri, &match) != 0 || match.route != job->route) {
+        memset(&match, 0, sizeof(match));
+        match.route = job->route;
+    }
+    router_invoke(&match, &fake, &job->hm);
+
+    if (fake.send.len == 0) {
+        mg_http_reply(&fake, 500, HTTP_CORS_HEADERS, "{\"error\":\"%s\"}", "处理函数未返回响应");
+    }
+
+    job->out = fake.send;
+    if (fake.is_draining) job->conn_close = 1;
+    mg_iobuf_free(&fake.recv);
+}
+
+static void *worker_thread(void *arg) {
+    (void)arg;
+
+    for (;;) {
+        WorkerJob *job;
+        gint64 start_us, end_us, wait_us, exec_us;
+
+        pthread_mutex_lock(&g_pool_mutex);
+        while (!g_stop && !g_queue_head) {
+            pthread_cond_wait(&g_pool_cond, &g_pool_mutex);
+        }
+        if (g_stop) {
+            pthread_mutex_unlock(&g_pool_mutex);
+            break;
+        }
+        job = g_queue_head;
+        queue_remove(job);
+        job->state = JOB_RUNNING;
+        g_running_count++;
+        if (job->stats) {
+            job->stats->queued--;
+            job->stats->running++;
+        }
+        pthread_mutex_unlock(&g_pool_mutex);
+
+        start_us = g_get_monotonic_time();
+        job_execute(job);
+        end_us = g_get_monotonic_time();
+        wait_us = start_us - job->queued_us;
+        exec_us = end_us - start_us;
+
+        pthread_mutex_lock(&g_pool_mutex);
+        g_running_count--;
+        if (job->stats) {
+            RouteStats *st = job->stats;
+            st->running--;
+            st->completed++;
+            st->wait_total_us += wait_us;
+            st->exec_total_us += exec_us;
+            if (wait_us > st->wait_max_us) st->wait_max_us = wait_us;
+            if (exec_us > st->exec_max_us) st->exec_max_us = exec_us;
+        }
+        if (job->orphaned) {
+            job_free(job);
+        } else {
+            job->state = JOB_DONE;
+            if (!mg_wakeup(g_mgr, job->conn_id, &job, sizeof(job))) {
+                printf("[WORKER] mg_wakeup 失败, 连接 %lu\n", job->conn_id);
+            }
+        }
+        pthread_mutex_unlock(&g_pool_mutex);
+    }
+
+    return NULL;
+}
+
+/* ==================== 公共接口 ==================== */
+
+int worker_pool_init(struct mg_mgr *mgr, int threads, int queue_max) {
+    if (!mgr || threads <= 0) return -1;
+
+    if (!mg_wakeup_init(mgr)) {
+        printf("[WORKER] mg_wakeup 初始化失败\n");
+        return -1;
+    }
+
+    g_threads = calloc((size_t)threads, sizeof(pthread_t));
+    if (!g_threads) return -1;
+
+    g_mgr = mgr;
+    g_queue_max = queue_max > 0 ? queue_max : WORKER_POOL_QUEUE_MAX;
+    g_stop = 0;
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&g_threads[i], NULL, worker_thread, NULL) != 0) {
+            printf("[WORKER] 创建工作线程失败\n");
+            break;
+        }
+        g_thread_count++;
+    }
+
+    if (g_thread_count == 0) {
+        free(g_threads);
+        g_threads = NULL;
+        return -1;
+    }
+
+    printf("[WORKER] 线程池已启动: %d 线程, 队列上限 %d\n", g_thread_count, g_queue_max);
+    return 0;
+}
+
+void worker_pool_deinit(void) {
+    pthread_mutex_lock(&g_pool_mutex);
+    g_stop = 1;
+    pthread_cond_broadcast(&g_pool_cond);
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    for (int i = 0; i < g_thread_count; i++) {
+        pthread_join(g_threads[i], NULL);
+    }
+    free(g_threads);
+    g_threads = NULL;
+    g_thread_count = 0;
+
+    /* 仍在排队的任务随连接关闭 (MG_EV_CLOSE) 释放 */
+}
+
+int worker_pool_submit(const RouteMatch *match, struct mg_connection *c, struct mg_http_message *hm) {
+    WorkerJob *job;
+    struct mg_str *cc;
+    size_t head_len, body_ofs;
+
+    if (g_thread_count == 0 || c->fn_data != NULL) return -1;
+
+    job = calloc(1, sizeof(WorkerJob));
+    if (!job) return -1;
+
+    /* 复制完整请求, mongoose 会在本事件返回后删除接收缓冲区中的数据 */
+    job->req = malloc(hm->message.len + 1);
+    if (!job->req) {
+        free(job);
+        return -1;
+    }
+    memcpy(job->req, hm->message.buf, hm->message.len);
+    job->req[hm->message.len] = '\0';
+
+    body_ofs = (size_t)(hm->body.buf - hm->message.buf);
+    if (mg_http_parse(job->req, hm->message.len, &job->hm) <= 0) {
+        job_free(job);
+        return -1;
+    }
+    head_len = body_ofs <= hm->message.len ? body_ofs : hm->message.len;
+    job->hm.body = mg_str_n(job->req + head_len, hm->body.len);
+    job->hm.message = mg_str_n(job->req, hm->message.len);
+
+    cc = mg_http_get_header(hm, "Connection");
+    job->conn_close = cc != NULL && mg_strcasecmp(*cc, mg_str("close")) == 0;
+    job->route = match->route;
+    job->conn_id = c->id;
+    job->rem = c->rem;
+    job->loc = c->loc;
+    job->queued_us = g_get_monotonic_time();
+
+    pthread_mutex_lock(&g_pool_mutex);
+    job->stats = get_stats(match->route);
+    if (g_queue_len >= g_queue_max) {
+        g_rejected++;
+        if (job->stats) job->stats->rejected++;
+        pthread_mutex_unlock(&g_pool_mutex);
+        job_free(job);
+        return -1;
+    }
+    if (g_queue_tail) g_queue_tail->next = job;
+    else g_queue_head = job;
+    g_queue_tail = job;
+    g_queue_len++;
+    if (job->stats) {
+        job->stats->submitted++;
+        job->stats->queued++;
+    }
+    pthread_cond_signal(&g_pool_cond);
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    /* 挂起连接: 任务指针保存在 fn_data 中, 直到 MG_EV_WAKEUP 或 MG_EV_CLOSE */
+    c->fn_data = job;
+    return 0;
+}
+
+int worker_pool_handle_event(struct mg_connection *c, int ev, void *ev_data) {
+    WorkerJob *job = (WorkerJob *)c->fn_data;
+
+    if (ev == MG_EV_WAKEUP) {
+        struct mg_str *data = (struct mg_str *)ev_data;
+        WorkerJob *done = NULL;
+
+        if (data->len != sizeof(done)) return 0;
+        memcpy(&done, data->buf, sizeof(done));
+        if (!job || done != job) return 1;
+
+        /* 此时任务已完成, 工作线程不再访问它 */
+        c->fn_data = NULL;
+        mg_send(c, job->out.buf, job->out.len);
+        c->is_resp = 0;
+        if (job->conn_close) c->is_draining = 1;
+        job_free(job);
+
+        /* 挂起期间流水线发来的请求, 不会再有 MG_EV_READ 触发解析 */
+        if (!c->is_draining && c->recv.len > 0) {
+            long n = 0;
+            mg_call(c, MG_EV_READ, &n);
+        }
+        return 1;
+    }
+
+    if (ev == MG_EV_CLOSE && job) {
+        c->fn_data = NULL;
+        pthread_mutex_lock(&g_pool_mutex);
+        if (job->state == JOB_QUEUED) {
+            queue_remove(job);
+            if (job->stats) job->stats->queued--;
+            job_free(job);
+        } else if (job->state == JOB_RUNNING) {
+            job->orphaned = 1;
+        } else {
+            /* 已完成但唤醒消息尚未送达, 该消息会因连接不存在而被丢弃 */
+            job_free(job);
+        }
+        pthread_mutex_unlock(&g_pool_mutex);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* GET /api/workers/stats - 线程池及各路由排队/执行统计 */
+void handle_worker_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    char json[8192];
+    int len;
+
+    pthread_mutex_lock(&g_pool_mutex);
+    len = snprintf(json, sizeof(json),
+        "{\"Code\":0,\"Error\":\"\",\"Data\":{"
+        "\"threads\":%d,\"queue_max\":%d,\"queued\":%d,\"running\":%d,\"rejected\":%lu,\"routes\":[",
+        g_thread_count, g_queue_max, g_queue_len, g_running_count, g_rejected);
+
+    for (int i = 0; i < g_stats_count && len < (int)sizeof(json) - 512; i++) {
+        RouteStats *st = &g_stats[i];
+        unsigned long n = st->completed ? st->completed : 1;
+        len += snprintf(json + len, sizeof(json) - len,
+            "%s{\"method\":\"%s\",\"path\":\"%s\",\"submitted\":%lu,\"completed\":%lu,"
+            "\"rejected\":%lu,\"queued\":%d,\"running\":%d,"
+            "\"avg_wait_ms\":%.1f,\"max_wait_ms\":%.1f,\"avg_exec_ms\":%.1f,\"max_exec_ms\":%.1f}",
+            i > 0 ? "," : "", st->route->method, st->route->path,
+            st->submitted, st->completed, st->rejected, st->queued, st->running,
+            st->wait_total_us / 1000.0 / n, st->wait_max_us / 1000.0,
+            st->exec_total_us / 1000.0 / n, st->exec_max_us / 1000.0);
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    snprintf(json + len, sizeof(json) - len, "]}}");
+    HTTP_OK(c, json);
+}
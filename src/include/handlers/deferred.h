@@ -0,0 +1,78 @@
+/**
+ * @file deferred.h
+ * @brief 延迟回复: 处理函数发起异步调用后返回, 在回调中再写 HTTP 响应
+ *
+ * 用法 (均在事件循环线程):
+ *   DeferredReply *d = deferred_begin(c, 10000);
+ *   ofono_xxx_async(..., deferred_cancellable(d), on_done, d);
+ *   ...
+ *   static void on_done(int rc, ..., void *user_data) {
+ *       DeferredReply *d = user_data;
+ *       struct mg_connection *c = deferred_conn(d);
+ *       if (c) HTTP_OK(c, "...");
+ *       deferred_end(d);
+ *   }
+ *
+ * 挂起期间 c->is_resp 保持为1. 客户端断开或超过期限时取消 GCancellable,
+ * 异步调用随即以 G_IO_ERROR_CANCELLED 完成, 回调仍然恰好执行一次.
+ */
+
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+#include <gio/gio.h>
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 默认期限 (ms), 略长于 oFono 调用自身的超时 */
+#define DEFERRED_DEFAULT_TIMEOUT_MS 10000
+
+typedef struct DeferredReply DeferredReply;
+
+/**
+ * 挂起连接并开始计时
+ * @param timeout_ms 期限, 到期后取消异步调用
+ * @return 延迟回复句柄
+ */
+DeferredReply *deferred_begin(struct mg_connection *c, int timeout_ms);
+
+/**
+ * 异步调用使用的 GCancellable (由句柄持有)
+ */
+GCancellable *deferred_cancellable(DeferredReply *d);
+
+/**
+ * 仍可回复的连接, 客户端已断开时返回 NULL
+ */
+struct mg_connection *deferred_conn(DeferredReply *d);
+
+/**
+ * 是否因超过期限而被取消 (用于返回 504)
+ */
+int deferred_timed_out(DeferredReply *d);
+
+/**
+ * 响应已写入 (或连接已断开), 恢复连接并释放句柄.
+ * 连接上已缓冲后续请求时, 在下一轮事件循环中继续处理
+ */
+void deferred_end(DeferredReply *d);
+
+/**
+ * 处理挂起连接关闭 (MG_EV_CLOSE)
+ * @return 1已处理, 0非延迟回复连接
+ */
+int deferred_handle_event(struct mg_connection *c, int ev, void *ev_data);
+
+/**
+ * 当前挂起的延迟回复数
+ */
+int deferred_pending_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEFERRED_H */
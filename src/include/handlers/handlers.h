@@ -28,6 +28,9 @@ void handle_delete_automation_rule(struct mg_connection *c, struct mg_http_messa
 
 /* 短信 API */
 void handle_sms_list(struct mg_connection *c, struct mg_http_message *hm);
+void handle_sms_conversations(struct mg_connection *c, struct mg_http_message *hm);
+void handle_sms_unread(struct mg_connection *c, struct mg_http_message *hm);
+void handle_sms_mark_read(struct mg_connection *c, struct mg_http_message *hm);
 void handle_sms_send(struct mg_connection *c, struct mg_http_message *hm);
 void handle_sms_delete(struct mg_connection *c, struct mg_http_message *hm);
 void handle_sms_webhook_get(struct mg_connection *c, struct mg_http_message *hm);
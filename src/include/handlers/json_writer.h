@@ -0,0 +1,83 @@
+/**
+ * @file json_writer.h
+ * @brief 流式 JSON 响应 - 直接写入连接发送缓冲区
+ *
+ * 用法:
+ *   JsonWriter w;
+ *   json_begin(&w, c, 200);
+ *   json_obj_begin(&w);
+ *   json_kv_int(&w, "Code", 0);
+ *   json_key(&w, "Data");
+ *   json_arr_begin(&w);
+ *   ...
+ *   json_arr_end(&w);
+ *   json_obj_end(&w);
+ *   json_end(&w);
+ *
+ * 响应头先写入, Content-Length 在 json_end 时回填, 无中间缓冲区也无长度上限.
+ * 逗号由写入器自动插入, 字符串按 JSON 规则转义 (UTF-8 原样输出).
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 最大嵌套深度 */
+#define JSON_MAX_DEPTH 16
+
+typedef struct {
+    struct mg_connection *c;
+    size_t body_start;                  /* 响应体在 c->send 中的起始偏移 */
+    int depth;
+    int after_key;                      /* 刚写完键, 下一个值不加逗号 */
+    unsigned char has_items[JSON_MAX_DEPTH];
+} JsonWriter;
+
+/**
+ * 写入响应头并开始响应体 (带 CORS 头, Content-Type: application/json)
+ * @param status HTTP状态码
+ */
+void json_begin(JsonWriter *w, struct mg_connection *c, int status);
+
+/**
+ * 结束响应, 回填 Content-Length
+ */
+void json_end(JsonWriter *w);
+
+void json_obj_begin(JsonWriter *w);
+void json_obj_end(JsonWriter *w);
+void json_arr_begin(JsonWriter *w);
+void json_arr_end(JsonWriter *w);
+
+/* 对象键 (会转义) */
+void json_key(JsonWriter *w, const char *key);
+
+/* 值 */
+void json_str(JsonWriter *w, const char *s);            /* NULL 输出 null */
+void json_str_n(JsonWriter *w, const char *s, size_t len);
+void json_int(JsonWriter *w, long long v);
+void json_uint(JsonWriter *w, unsigned long long v);
+void json_double(JsonWriter *w, double v, int precision);   /* NaN/Inf 输出 null */
+void json_bool(JsonWriter *w, int v);
+void json_null(JsonWriter *w);
+void json_raw(JsonWriter *w, const char *raw);          /* 已是合法JSON的片段 */
+
+/* 键值对便捷函数 */
+void json_kv_str(JsonWriter *w, const char *key, const char *s);
+void json_kv_int(JsonWriter *w, const char *key, long long v);
+void json_kv_uint(JsonWriter *w, const char *key, unsigned long long v);
+void json_kv_double(JsonWriter *w, const char *key, double v, int precision);
+void json_kv_bool(JsonWriter *w, const char *key, int v);
+void json_kv_null(JsonWriter *w, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_WRITER_H */
@@ -0,0 +1,87 @@
+/**
+ * @file router.h
+ * @brief API 路由表 - 启动时编译为按路径段组织的前缀树
+ */
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 单条路由最多的通配段数 */
+#define ROUTER_MAX_PARAMS 4
+
+/* 路由标志 */
+#define ROUTE_AUTH    0x01      /* 需要Token */
+#define ROUTE_WORKER  0x02      /* 在工作线程池中执行 (阻塞型处理函数) */
+
+/* 路由处理函数 (与 handlers.h 中的 handle_* 一致) */
+typedef void (*RouteHandler)(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * 路由定义
+ * method: "GET"/"POST"/... 精确匹配, "*" 匹配任意方法 (精确匹配优先)
+ * path:   以 '/' 分隔, 段为 "*" 时匹配任意单段并作为参数捕获
+ * flags:  ROUTE_AUTH / ROUTE_WORKER 组合
+ */
+typedef struct {
+    const char *method;
+    const char *path;
+    RouteHandler handler;
+    unsigned int flags;
+} Route;
+
+/* 路由匹配结果 */
+typedef struct {
+    const Route *route;                         /* 命中的路由, NULL 表示未命中 */
+    int path_found;                             /* 路径存在但方法不匹配时为1 */
+    int param_count;
+    struct mg_str params[ROUTER_MAX_PARAMS];    /* 通配段捕获 (指向原 URI) */
+} RouteMatch;
+
+/**
+ * 编译路由表
+ * @param routes 路由数组 (需在程序生命周期内有效)
+ * @param count 路由数量
+ * @return 0成功, -1失败
+ */
+int router_init(const Route *routes, int count);
+
+/**
+ * 释放路由树
+ */
+void router_deinit(void);
+
+/**
+ * 查找路由
+ * @param method 请求方法
+ * @param uri 请求路径 (不含查询串)
+ * @param match 输出匹配结果
+ * @return 0命中, -1未命中 (match->path_found 区分 404/405)
+ */
+int router_lookup(struct mg_str method, struct mg_str uri, RouteMatch *match);
+
+/**
+ * 调用路由处理函数, 调用期间可通过 router_param 取得通配段
+ * @param match router_lookup 的结果
+ */
+void router_invoke(const RouteMatch *match, struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * 获取当前请求的第 idx 个通配段 (仅在 router_invoke 调用的处理函数内有效, 线程安全)
+ * @param idx 通配段序号, 从0开始
+ * @param buf 输出缓冲区 (已URL解码)
+ * @param size 缓冲区大小
+ * @return 解码后长度, -1表示不存在或解码失败
+ */
+int router_param(int idx, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ROUTER_H */
@@ -0,0 +1,57 @@
+/**
+ * @file telemetry.h
+ * @brief WebSocket 遥测推送 (/api/ws/log)
+ *
+ * 客户端发送 {"sub":["info","cells"]} / {"unsub":["cells"]} 订阅主题.
+ * 订阅后立即收到一帧完整数据, 之后只收到变化的字段:
+ *   {"topic":"info","full":true,"data":{...}}   完整数据 (与对应 GET 接口响应体一致)
+ *   {"topic":"info","data":{"cpu_usage":3.20}}  增量, 按顶层字段合并
+ *   {"topic":"band","data":{"Data":{"rsrp":-91}}}  {Code, Error, Data} 信封内的
+ *                                               Data 两侧都是对象时再按字段合并一层
+ * 每个主题只有一个采样线程在采样, 与连接数无关; 无订阅者的主题不采样.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 采样线程调度粒度 (ms) */
+#define TELEMETRY_TICK_MS       1000
+
+/* 发送缓冲超过该值的慢连接跳过增量, 追上后补发完整数据 */
+#define TELEMETRY_SEND_MAX      (256 * 1024)
+
+/**
+ * 启动采样线程
+ * @param mgr mongoose 管理器 (须已调用 mg_wakeup_init)
+ * @param wake_id 接收唤醒的连接 (HTTP 监听连接)
+ * @return 0成功, -1失败
+ */
+int telemetry_init(struct mg_mgr *mgr, unsigned long wake_id);
+
+/**
+ * 停止采样线程并释放缓存 (须在 mg_mgr_free 之前调用)
+ */
+void telemetry_deinit(void);
+
+/**
+ * 标记已升级的 WebSocket 连接为遥测连接
+ */
+void telemetry_ws_open(struct mg_connection *c);
+
+/**
+ * 处理遥测相关事件 (MG_EV_WS_MSG / MG_EV_CLOSE / MG_EV_WAKEUP / MG_EV_POLL)
+ * @return 1已处理, 0非遥测事件
+ */
+int telemetry_handle_event(struct mg_connection *c, int ev, void *ev_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,72 @@
+/**
+ * @file webhook.h
+ * @brief Webhook 投递队列 (持久化、重试退避、按目标限流、连接复用)
+ *
+ * 待发通知先写入数据库 webhook_queue 表, 由事件循环用 mg_http_connect
+ * 发送, 进程重启后未送达的通知继续投递. 失败按指数退避重试, 超过最大
+ * 次数或收到不可重试的 4xx 后丢弃. 同一目标 (协议+主机+端口) 同时
+ * 在途的请求数受限, 响应允许 keep-alive 时连接保留一段时间供后续复用.
+ * https 目标使用 mongoose 内置 TLS, 默认校验服务端证书的主机名与证书链,
+ * 并以 WEBHOOK_CA_FILE 中的根证书为信任锚 (文件不存在时只校验前两项).
+ * 内置 TLS 只接受一个 CA 证书, 文件中只放目标服务所用的根证书.
+ * 自签名证书的目标可在配置中单独关闭校验 (入队时 insecure=1).
+ */
+
+#ifndef WEBHOOK_H
+#define WEBHOOK_H
+
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WEBHOOK_QUEUE_MAX           500     /* 队列上限, 超出时丢弃最旧的 */
+#define WEBHOOK_CONN_MAX            8       /* 同时打开的连接数 */
+#define WEBHOOK_HOST_CONCURRENCY    2       /* 同一目标同时在途的请求数 */
+#define WEBHOOK_MAX_ATTEMPTS        8
+#define WEBHOOK_BACKOFF_BASE_S      5       /* 第 n 次失败后等待 5 * 2^(n-1) 秒 */
+#define WEBHOOK_BACKOFF_MAX_S       3600
+#define WEBHOOK_TIMEOUT_MS          15000   /* 连接+请求+响应 总超时 */
+#define WEBHOOK_IDLE_MS             15000   /* 空闲连接保留时间 */
+#define WEBHOOK_CA_FILE             "/home/root/9898/webhook_ca.pem"
+
+/**
+ * 启动投递 (须在 mg_mgr_init 之后、数据库初始化之后调用)
+ * @param mgr mongoose 管理器 (须已调用 mg_wakeup_init)
+ * @param wake_id 接收唤醒的连接 (HTTP 监听连接)
+ * @return 0成功, -1失败
+ */
+int webhook_init(struct mg_mgr *mgr, unsigned long wake_id);
+
+/**
+ * 停止投递, 关闭投递连接 (须在 mg_mgr_free 之前调用, 队列保留在数据库中)
+ */
+void webhook_deinit(void);
+
+/**
+ * 加入投递队列 (线程安全, 任意线程可调用)
+ * @param url http:// 或 https:// 地址
+ * @param headers 附加请求头, 每行一个 "Name: Value", 可为 NULL
+ * @param body 请求体, 未指定 Content-Type 时按 application/json 发送
+ * @param insecure 非0时 https 不校验服务端证书
+ * @return 0成功, -1失败
+ */
+int webhook_enqueue(const char *url, const char *headers, const char *body, int insecure);
+
+/**
+ * 处理投递相关事件 (监听连接上的 MG_EV_WAKEUP / MG_EV_POLL)
+ * @return 1已处理, 0非投递事件
+ */
+int webhook_handle_event(struct mg_connection *c, int ev, void *ev_data);
+
+/**
+ * GET /api/webhook/stats - 队列长度、成功/失败计数与投递延迟
+ */
+void handle_webhook_stats(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEBHOOK_H */
@@ -0,0 +1,59 @@
+/**
+ * @file worker_pool.h
+ * @brief 阻塞型 API 处理函数的工作线程池
+ *
+ * 标记 ROUTE_WORKER 的路由在工作线程中执行, 连接在此期间保持挂起,
+ * 响应通过 mg_wakeup 投递回事件循环线程后再写入连接.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "mongoose.h"
+#include "router.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 默认线程数与队列上限 */
+#define WORKER_POOL_THREADS     2
+#define WORKER_POOL_QUEUE_MAX   16
+
+/**
+ * 初始化线程池
+ * @param mgr mongoose 管理器 (用于 mg_wakeup)
+ * @param threads 工作线程数
+ * @param queue_max 最大排队任务数, 超出时拒绝
+ * @return 0成功, -1失败
+ */
+int worker_pool_init(struct mg_mgr *mgr, int threads, int queue_max);
+
+/**
+ * 停止并回收工作线程 (须在 mg_mgr_free 之前调用)
+ */
+void worker_pool_deinit(void);
+
+/**
+ * 将请求提交到线程池执行, 成功后连接挂起直到任务完成
+ * @param match 路由匹配结果
+ * @param c 连接
+ * @param hm 请求 (会被完整复制)
+ * @return 0已排队, -1队列已满或内存不足 (调用方负责回复)
+ */
+int worker_pool_submit(const RouteMatch *match, struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * 处理与挂起连接相关的事件 (MG_EV_WAKEUP / MG_EV_CLOSE)
+ * @return 1已处理, 0非线程池事件
+ */
+int worker_pool_handle_event(struct mg_connection *c, int ev, void *ev_data);
+
+/* GET /api/workers/stats - 线程池及各路由排队/执行统计 */
+void handle_worker_stats(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORKER_POOL_H */
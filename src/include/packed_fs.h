@@ -0,0 +1,45 @@
+/**
+ * @file packed_fs.h
+ * @brief Embedded dashboard files (generated by tools/pack_fs.py)
+ */
+
+#ifndef PACKED_FS_H
+#define PACKED_FS_H
+
+#include <stddef.h>
+#include <time.h>
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One embedded file, the table is sorted by path (strcmp order) */
+typedef struct {
+    const char *path;               /* URL path, e.g. "/assets/index-B3kfa9Xc.js" */
+    const unsigned char *data;      /* Stored bytes (gzip stream when gzip is set) */
+    size_t size;                    /* Stored size */
+    size_t raw_size;                /* Size after decompression */
+    int gzip;                       /* data is gzip compressed */
+    const char *mime;
+    const char *etag;               /* Strong ETag of the identity representation */
+    const char *etag_gzip;          /* Strong ETag of the gzip representation, NULL if none */
+    time_t mtime;
+} PackedFile;
+
+extern const PackedFile g_packed_files[];
+extern const size_t g_packed_file_count;
+
+/**
+ * @brief Serve static files
+ * @param c Mongoose connection
+ * @param hm HTTP message
+ * @return 1 success, 0 not found
+ */
+int serve_packed_file(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PACKED_FS_H */
@@ -0,0 +1,98 @@
+/**
+ * @file at_sched.h
+ * @brief AT 命令调度器 (优先级队列 + 相同读命令合并 + 调用方期限)
+ *
+ * 所有 AT 命令由一个调度线程依次通过 SendAtcmd 发送:
+ *   - 按优先级出队: 交互 > 控制 > 后台, 同级先进先出
+ *   - 只读命令与排队中或执行中的相同命令合并, 所有等待方共享一次响应
+ *   - 每个同步调用方有自己的期限, 到期即返回, 不影响其他等待方
+ *   - "Operation already in progress" 时命令延后重试, 期间其他命令照常执行
+ */
+
+#ifndef AT_SCHED_H
+#define AT_SCHED_H
+
+#include <stddef.h>
+#include <gio/gio.h>
+#include "mongoose.h"
+#include "dbus_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 优先级 (数值越小越优先) */
+typedef enum {
+    AT_PRIO_INTERACTIVE = 0,    /* HTTP 请求, 用户在等待 */
+    AT_PRIO_CONTROL,            /* 自动化/流量控制等内部状态变更 */
+    AT_PRIO_BACKGROUND,         /* 周期采样 */
+    AT_PRIO_COUNT
+} AtPriority;
+
+/* 同步调用默认期限 (ms), 覆盖排队时间与一次 SendAtcmd */
+#define AT_SCHED_DEFAULT_DEADLINE_MS  20000
+
+/* 调制解调器忙时的重试间隔与次数 */
+#define AT_SCHED_RETRY_DELAY_MS       500
+#define AT_SCHED_MAX_RETRIES          1
+
+/* 传输层返回值 */
+#define AT_TRANSPORT_OK     0
+#define AT_TRANSPORT_ERROR  -1
+#define AT_TRANSPORT_BUSY   -2      /* 调制解调器忙, 稍后重试 */
+
+/**
+ * 发送一条 AT 命令 (在调度线程中调用, 可阻塞)
+ * @param result 成功时返回响应 (g_free 释放)
+ * @param error 失败原因
+ */
+typedef int (*AtTransport)(const char *command, char **result, char *error, size_t error_size);
+
+/**
+ * 启动调度线程 (重复调用无副作用)
+ * @return 0 成功, -1 失败
+ */
+int at_sched_start(AtTransport transport);
+
+/**
+ * 停止调度线程, 排队中的命令以失败完成
+ */
+void at_sched_stop(void);
+
+/**
+ * 设置当前线程提交命令的默认优先级 (未设置时为 AT_PRIO_INTERACTIVE)
+ */
+void at_sched_set_thread_priority(AtPriority prio);
+
+/**
+ * 当前线程的默认优先级
+ */
+AtPriority at_sched_thread_priority(void);
+
+/**
+ * 同步执行, 阻塞到完成或期限到达
+ * @param deadline_ms 期限, <=0 使用默认值
+ * @param result 成功时返回响应 (g_free 释放)
+ * @param error 失败原因
+ * @return 0 成功, -1 失败或超时
+ */
+int at_sched_execute(const char *command, AtPriority prio, int deadline_ms,
+                     char **result, char *error, size_t error_size);
+
+/**
+ * 异步执行, 回调在 GLib 主循环线程执行且恰好一次
+ * @return 0 已提交, -1 调度器未启动
+ */
+int at_sched_submit_async(const char *command, AtPriority prio, GCancellable *cancellable,
+                          AtAsyncCallback cb, void *user_data);
+
+/**
+ * GET /api/at/stats - 各优先级排队深度、合并次数与等待/执行耗时
+ */
+void handle_at_stats(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AT_SCHED_H */
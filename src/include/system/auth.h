@@ -31,6 +31,11 @@ extern "C" {
  */
 int auth_init(void);
 
+/**
+ * 关闭认证模块, 等待未写回的会话落盘
+ */
+void auth_deinit(void);
+
 /**
  * 用户登录
  * @param password 用户输入的密码
@@ -0,0 +1,116 @@
+/**
+ * @file cell_log.h
+ * @brief 小区测量记录 (路测数据, 文件环形缓冲 + 切换检测)
+ *
+ * 后台线程按配置的间隔采集服务小区与最强的若干邻小区 (AT+SPENGMD),
+ * 写入固定长度的二进制记录文件. 文件以 mmap 方式作为环形缓冲使用,
+ * 大小固定, 写满后覆盖最旧的记录. 与上一条记录相比发生的切换
+ * (PCI/ARFCN 变化)、频段变化、制式变化会在记录中打上标记.
+ *
+ * 文件布局: 一个 128 字节文件头 + CELL_LOG_CAPACITY 条 128 字节记录,
+ * 序号为 s 的记录位于槽位 (s - 1) % CELL_LOG_CAPACITY.
+ * 记录先写内容后写序号, 掉电时最多丢失最后一条.
+ *
+ * 配置 (config 表):
+ *   cell_log_enabled   0/1, 默认 0
+ *   cell_log_interval  采样间隔 (秒), 默认 5
+ */
+
+#ifndef CELL_LOG_H
+#define CELL_LOG_H
+
+#include <stdint.h>
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CELL_LOG_PATH               "/home/root/9898/cell_log.bin"
+#define CELL_LOG_CAPACITY           32768       /* 4 MB, 默认间隔下约 45 小时 */
+#define CELL_LOG_MAX_NEIGHBORS      6
+
+#define CELL_LOG_INTERVAL_DEFAULT   5
+#define CELL_LOG_INTERVAL_MIN       1
+#define CELL_LOG_INTERVAL_MAX       3600
+
+/* 制式 */
+typedef enum {
+    CELL_LOG_RAT_LTE = 0,
+    CELL_LOG_RAT_NR
+} CellLogRat;
+
+/* 记录标记 */
+#define CELL_LOG_F_HANDOVER     0x01    /* 服务小区 PCI/ARFCN 变化 */
+#define CELL_LOG_F_BAND_CHANGE  0x02    /* 服务频段变化 */
+#define CELL_LOG_F_RAT_CHANGE   0x04    /* 制式变化 */
+
+/* 单个小区, 信号值单位 0.01 dB */
+typedef struct {
+    uint32_t arfcn;
+    uint16_t pci;
+    uint16_t band;              /* 0 表示模块未给出 */
+    int16_t rsrp;
+    int16_t rsrq;
+    int16_t sinr;
+    uint16_t reserved;
+} CellLogCell;
+
+/* 一条记录 (128 字节, 文件中按本机字节序保存) */
+typedef struct {
+    uint32_t seq;               /* 从 1 开始递增, 0 表示空槽 */
+    uint32_t ts;                /* Unix 秒 */
+    uint8_t rat;                /* CellLogRat */
+    uint8_t flags;              /* CELL_LOG_F_* */
+    uint8_t neighbor_count;
+    uint8_t reserved[5];
+    CellLogCell serving;
+    CellLogCell neighbors[CELL_LOG_MAX_NEIGHBORS];      /* 按 RSRP 降序 */
+} CellLogRecord;
+
+/**
+ * 打开记录文件并按配置启动采样线程 (须在数据库初始化之后调用)
+ * @return 0 成功, -1 记录文件不可用
+ */
+int cell_log_init(void);
+
+/**
+ * 停止采样线程, 同步并关闭记录文件
+ */
+void cell_log_deinit(void);
+
+/**
+ * 读取指定序号的记录
+ * @return 0 成功, -1 不存在或已被覆盖
+ */
+int cell_log_read(uint32_t seq, CellLogRecord *rec);
+
+/**
+ * 当前保存的序号范围
+ * @param oldest 最旧记录序号
+ * @param next 下一条记录序号 (oldest == next 表示为空)
+ */
+void cell_log_range(uint32_t *oldest, uint32_t *next);
+
+/**
+ * GET/POST /api/cell_log/config - 查询/设置开关与采样间隔
+ */
+void handle_cell_log_config(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * GET /api/cell_log/export?format=csv|ndjson&from=&to=
+ * 分块传输, 按发送进度逐批从记录文件读取, 不在内存中生成整份数据.
+ * from/to 为 Unix 秒, 省略时导出全部.
+ */
+void handle_cell_log_export(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * DELETE /api/cell_log - 清空记录
+ */
+void handle_cell_log_clear(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CELL_LOG_H */
@@ -3,6 +3,7 @@
  * @brief 数据库操作模块 - SQLite3 统一接口
  * 
  * 提供数据库初始化、SQL执行、配置管理等功能
+ * 进程内持有一个长期连接, 带参数语句走预编译缓存和参数绑定
  */
 
 #ifndef DATABASE_H
@@ -41,19 +42,37 @@ const char *db_get_path(void);
  *============================================================================*/
 
 /**
- * 执行SQL命令（无锁）
+ * 执行SQL命令（可包含多条语句）
  * @param sql SQL语句
  * @return 0成功, -1失败
  */
 int db_execute(const char *sql);
 
 /**
- * 执行SQL命令（带互斥锁，线程安全）
+ * 执行SQL命令（与 db_execute 相同, 保留兼容）
  * @param sql SQL语句
  * @return 0成功, -1失败
  */
 int db_execute_safe(const char *sql);
 
+/**
+ * 开始事务 (BEGIN IMMEDIATE)
+ * 成功后持有数据库锁直到 db_commit / db_rollback, 同一线程内可继续调用其他 db_* 接口
+ * @return 0成功, -1失败 (无需调用 db_rollback)
+ */
+int db_begin(void);
+
+/**
+ * 提交事务并释放锁, 提交失败时自动回滚
+ * @return 0成功, -1失败
+ */
+int db_commit(void);
+
+/**
+ * 回滚事务并释放锁
+ */
+void db_rollback(void);
+
 /**
  * 查询整数结果
  * @param sql SQL查询语句
@@ -81,6 +100,84 @@ int db_query_string(const char *sql, char *buf, size_t size);
  */
 int db_query_rows(const char *sql, const char *separator, char *buf, size_t size);
 
+/*============================================================================
+ * 预编译语句与行迭代接口
+ *
+ * 参数类型串: 'i'=int, 'l'=long long, 'd'=double,
+ *             's'=const char* (NULL 绑定为 NULL), 'n'=NULL (不消耗参数)
+ * 同一条 SQL 文本的预编译语句会被缓存复用, 请使用 '?' 占位符而不是拼接
+ *============================================================================*/
+
+/* 行迭代器 (栈上分配, 字段由模块内部使用) */
+typedef struct {
+    void *stmt;
+    int cached;
+    int done;
+} DbIter;
+
+/* 行回调, 返回非0停止遍历 */
+typedef int (*DbRowCallback)(DbIter *it, void *ctx);
+
+/**
+ * 开始查询并绑定参数
+ * 成功后持有数据库锁直到 db_iter_end, 期间不要执行耗时操作
+ * @param it 迭代器
+ * @param sql SQL语句 (单条)
+ * @param types 参数类型串, 可为NULL
+ * @return 0成功, -1失败 (无需调用 db_iter_end)
+ */
+int db_iter_begin(DbIter *it, const char *sql, const char *types, ...);
+
+/**
+ * 取下一行
+ * @return 1有数据, 0结束, -1出错
+ */
+int db_iter_next(DbIter *it);
+
+/**
+ * 结束查询, 归还语句并释放锁
+ */
+void db_iter_end(DbIter *it);
+
+/* 当前行字段访问 (col 从0开始) */
+int db_col_count(DbIter *it);
+int db_col_is_null(DbIter *it, int col);
+int db_col_int(DbIter *it, int col);
+long long db_col_int64(DbIter *it, int col);
+double db_col_double(DbIter *it, int col);
+
+/**
+ * 文本字段 (NULL 返回 "")
+ * 返回的指针在下一次 db_iter_next / db_iter_end 前有效
+ */
+const char *db_col_text(DbIter *it, int col);
+
+/**
+ * 复制文本字段到缓冲区 (截断并保证以0结尾)
+ * @return 复制的字节数
+ */
+size_t db_col_text_copy(DbIter *it, int col, char *buf, size_t size);
+
+/**
+ * 遍历查询结果
+ * @param cb 行回调
+ * @param ctx 回调上下文
+ * @return 遍历的行数, -1失败
+ */
+int db_query_each(const char *sql, DbRowCallback cb, void *ctx, const char *types, ...);
+
+/**
+ * 执行带参数的单条语句
+ * @return 影响的行数, -1失败
+ */
+int db_exec_bind(const char *sql, const char *types, ...);
+
+/**
+ * 执行带参数的 INSERT
+ * @return 新行 rowid, -1失败
+ */
+long long db_insert_bind(const char *sql, const char *types, ...);
+
 /*============================================================================
  * 字符串处理
  *============================================================================*/
@@ -101,14 +198,31 @@ void db_unescape_string(char *str);
 
 /*============================================================================
  * 配置管理接口
+ *
+ * config 表在 db_init 时载入内存, 读取不访问数据库也不加锁;
+ * 写入先落库再更新内存, 值发生变化时同步调用已注册的监听者.
+ * config_set 内部先取配置锁再取数据库锁, 不能在事务或迭代器期间调用.
  *============================================================================*/
 
+#define CONFIG_CACHE_SLOTS      256     /* 内存表槽位数 (2 的幂) */
+#define CONFIG_KEY_MAX          64
+#define CONFIG_VALUE_MAX        256     /* 更长的值只保存在数据库 */
+#define CONFIG_MAX_LISTENERS    16
+
+/**
+ * 配置变化回调, 在调用 config_set 的线程上执行 (不持有任何锁)
+ * @param key 配置键名
+ * @param value 新值
+ * @param user_data 注册时传入的数据
+ */
+typedef void (*ConfigChangeCallback)(const char *key, const char *value, void *user_data);
+
 /**
  * 获取配置值（字符串）
  * @param key 配置键名
  * @param value 输出值缓冲区
  * @param value_size 缓冲区大小
- * @return 0成功, -1失败
+ * @return 0成功, -1失败或键不存在
  */
 int config_get(const char *key, char *value, size_t value_size);
 
@@ -152,6 +266,20 @@ long long config_get_ll(const char *key, long long default_val);
  */
 int config_set_ll(const char *key, long long value);
 
+/**
+ * 注册配置变化监听
+ * @param key 配置键名, NULL 表示全部键
+ * @param cb 回调
+ * @param user_data 回调数据
+ * @return 0成功, -1失败
+ */
+int config_add_listener(const char *key, ConfigChangeCallback cb, void *user_data);
+
+/**
+ * 移除 (cb, user_data) 对应的全部监听
+ */
+void config_remove_listener(ConfigChangeCallback cb, void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,63 @@
+/**
+ * @file db_maint.h
+ * @brief 数据库维护 (WAL 检查点、增量 VACUUM、ANALYZE、表容量上限)
+ *
+ * 后台线程负责 9898.db 的日常维护:
+ *   启动时       PRAGMA quick_check, 结果在统计接口中给出
+ *   每 5 分钟    被动 WAL 检查点, WAL 文件过大时截断
+ *   每小时       按表的行数/字节上限删除最旧的记录;
+ *                空闲页占比超过阈值时增量 VACUUM;
+ *                上次 ANALYZE 之后的修改行数超过阈值时 ANALYZE
+ * 旧数据库 (auto_vacuum=NONE) 整体 VACUUM 一次转为 auto_vacuum=INCREMENTAL,
+ * 之后只做增量回收. 整库 VACUUM 期间持有数据库锁, 只在库不超过
+ * DB_MAINT_CONVERT_MAX_BYTES 或本地时间处于低峰时段时执行; 在此之前
+ * 不回收文件空间, 删除产生的空闲页由后续写入重用.
+ */
+
+#ifndef DB_MAINT_H
+#define DB_MAINT_H
+
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DB_MAINT_CHECKPOINT_S       300
+#define DB_MAINT_INTERVAL_S         3600
+#define DB_MAINT_FIRST_DELAY_S      120             /* 启动后首次维护的延迟 */
+#define DB_MAINT_WAL_TRUNCATE_BYTES (4 * 1024 * 1024)
+#define DB_MAINT_FREE_RATIO         0.20            /* 空闲页占比阈值 */
+#define DB_MAINT_FREE_MIN_PAGES     64              /* 空闲页少于此数不回收 */
+#define DB_MAINT_VACUUM_STEP        256             /* 每条语句回收的页数 */
+#define DB_MAINT_ANALYZE_CHANGES    2000
+#define DB_MAINT_CONVERT_MAX_BYTES  (4 * 1024 * 1024)  /* 不超过此大小随时转换回收模式 */
+#define DB_MAINT_OFFPEAK_START_H    2               /* 低峰时段 [2:00, 5:00) 本地时间 */
+#define DB_MAINT_OFFPEAK_END_H      5
+
+/**
+ * 启动维护线程 (须在 db_init 之后调用)
+ * @return 0成功, -1失败
+ */
+int db_maint_init(void);
+
+/**
+ * 停止维护线程, 退出前做一次被动检查点
+ */
+void db_maint_deinit(void);
+
+/**
+ * GET /api/db/stats - 数据库/WAL 大小、空闲页、各表行数与上限、最近维护时间
+ */
+void handle_db_stats(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/db/maintenance - 立即执行一次维护
+ */
+void handle_db_maintenance(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_MAINT_H */
@@ -0,0 +1,86 @@
+/**
+ * @file dbus_conn.h
+ * @brief 共享 D-Bus 连接管理 (所有模块共用一条系统总线连接)
+ *
+ * - 一条私有系统总线连接, 断开后按 1s..30s 指数退避重连
+ * - 监视 org.ofono 的所有者, oFono 重启时清空代理缓存
+ * - 按 (modem 路径, 接口) 缓存 GDBusProxy
+ * - 连接/oFono 状态变化以事件通知各模块, 回调在 GLib 主循环线程执行
+ */
+
+#ifndef DBUS_CONN_H
+#define DBUS_CONN_H
+
+#include <gio/gio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 重连退避 (ms) */
+#define DBUS_CONN_BACKOFF_MIN_MS    1000
+#define DBUS_CONN_BACKOFF_MAX_MS    30000
+
+#define DBUS_CONN_MAX_LISTENERS     8
+
+typedef enum {
+    DBUS_CONN_EV_CONNECTED = 0,     /* 新连接建立, 可在其上订阅信号 */
+    DBUS_CONN_EV_OFONO_APPEARED,    /* org.ofono 出现 (含重启后) */
+    DBUS_CONN_EV_OFONO_VANISHED,    /* org.ofono 退出 */
+    DBUS_CONN_EV_DISCONNECTED       /* 连接关闭, conn 为已关闭的旧连接 */
+} DbusConnEvent;
+
+/**
+ * 状态事件回调 (主循环线程)
+ * @param conn 事件对应的连接, 仅在回调期间有效
+ */
+typedef void (*DbusConnListener)(DbusConnEvent ev, GDBusConnection *conn, void *user_data);
+
+/**
+ * 建立连接并开始监视 oFono (重复调用无副作用)
+ * @return 0 已连接, -1 暂未连接 (后台继续重试)
+ */
+int dbus_conn_start(void);
+
+/**
+ * 关闭连接, 停止重试并清空监听者
+ */
+void dbus_conn_stop(void);
+
+/**
+ * 获取共享连接, 未连接且已过退避期时立即尝试重连 (任意线程)
+ * @return 新引用 (g_object_unref 释放), 不可用时返回 NULL
+ */
+GDBusConnection *dbus_conn_get(void);
+
+/**
+ * 获取 oFono 对象的缓存代理 (任意线程)
+ * 代理不加载属性也不订阅信号, 属性与信号由 ofono.c 的镜像负责
+ * @param path 对象路径, 如 "/ril_0"
+ * @param iface 接口名
+ * @param error 失败原因 (可为 NULL)
+ * @return 新引用 (g_object_unref 释放), 失败返回 NULL
+ */
+GDBusProxy *dbus_conn_proxy(const char *path, const char *iface, GError **error);
+
+/**
+ * org.ofono 当前是否有所有者
+ */
+int dbus_conn_ofono_available(void);
+
+/**
+ * 注册状态监听者, 已连接/oFono 已就绪时会补发对应事件
+ * @return 0 成功, -1 已满
+ */
+int dbus_conn_add_listener(DbusConnListener fn, void *user_data);
+
+/**
+ * 注销状态监听者
+ */
+void dbus_conn_remove_listener(DbusConnListener fn, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DBUS_CONN_H */
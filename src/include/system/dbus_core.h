@@ -6,6 +6,8 @@
 #ifndef DBUS_CORE_H
 #define DBUS_CORE_H
 
+#include <gio/gio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,12 +31,41 @@ int is_dbus_initialized(void);
 
 /**
  * @brief 执行 AT 命令 (带重试和超时)
+ *
+ * 经 AT 调度器 (at_sched.h) 排队, 优先级取当前线程的默认优先级,
+ * 期限为 AT_SCHED_DEFAULT_DEADLINE_MS.
  * @param command AT 命令字符串
  * @param result 返回结果指针 (调用者需用 g_free 释放)
  * @return 0 成功, -1 失败
  */
 int execute_at(const char *command, char **result);
 
+/**
+ * @brief 以指定优先级和期限执行 AT 命令
+ * @param priority AtPriority
+ * @param deadline_ms 期限 (含排队时间), <=0 使用默认值
+ * @return 0 成功, -1 失败或超时
+ */
+int execute_at_ex(const char *command, int priority, int deadline_ms, char **result);
+
+/**
+ * @brief 异步 AT 命令完成回调 (GLib 主循环线程)
+ * @param rc 0 成功, -1 失败, -2 已取消
+ * @param result 响应 (已去除首尾空白, 回调返回后失效), 失败时为 NULL
+ * @param error 失败原因, 成功时为 NULL
+ */
+typedef void (*AtAsyncCallback)(int rc, const char *result, const char *error, void *user_data);
+
+/**
+ * @brief 异步执行 AT 命令, 只能在 GLib 主循环线程调用
+ *
+ * 与 execute_at 进入同一个调度队列 (优先级取当前线程的默认优先级),
+ * 排队期间可被 cancellable 取消.
+ * @return 0 已排队 (回调恰好执行一次), -1 参数错误或调度器未启动 (回调不执行)
+ */
+int execute_at_async(const char *command, GCancellable *cancellable,
+                     AtAsyncCallback cb, void *user_data);
+
 /**
  * @brief 获取最后一次错误信息
  * @return 错误信息字符串
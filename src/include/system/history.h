@@ -0,0 +1,73 @@
+/**
+ * @file history.h
+ * @brief 指标历史 (内存环形缓冲, 三级分辨率)
+ *
+ * 每个序列保存三级历史, 写入时同步降采样:
+ *   1s  x 600   (10 分钟)  仅保存样本值
+ *   1m  x 1440  (24 小时)  min/max/avg
+ *   15m x 2880  (30 天)    min/max/avg
+ * 数值按序列的比例因子 (速率为对数刻度) 量化为 int16 保存, 存储区大小固定,
+ * 不随运行时间增长.
+ * 槽位按墙上时间对齐, 无样本的槽位输出为 null.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 历史序列 */
+typedef enum {
+    HIST_CPU = 0,           /* CPU 使用率 % */
+    HIST_MEM,               /* 内存使用率 % */
+    HIST_TEMP,              /* 温度 摄氏度 */
+    HIST_SIGNAL,            /* 信号强度 dBm */
+    HIST_SINR,              /* SINR dB (后台每 10 秒查询一次) */
+    HIST_RX,                /* 下行速率 kbps */
+    HIST_TX,                /* 上行速率 kbps */
+    HIST_SERIES_COUNT
+} HistSeries;
+
+/* 各级槽位数 */
+#define HIST_FINE_SLOTS     600
+#define HIST_MINUTE_SLOTS   1440
+#define HIST_QUARTER_SLOTS  2880
+
+/**
+ * @brief 启动 1 秒采样线程 (须在 sysinfo_sampler_start 之后调用)
+ * @return 0 成功, -1 失败
+ */
+int history_init(void);
+
+/**
+ * @brief 停止采样线程, 历史数据保留
+ */
+void history_deinit(void);
+
+/**
+ * @brief 记录一个样本 (当前时间), 可在任意线程调用
+ */
+void history_record(HistSeries series, double value);
+
+/**
+ * @brief 历史存储占用的字节数
+ */
+size_t history_memory_usage(void);
+
+/**
+ * @brief GET /api/metrics/history?series=cpu,rx&from=&to=&res=
+ *
+ * from/to 为 Unix 秒 (默认最近 10 分钟), res 为 1s/1m/15m,
+ * 省略时选择能覆盖 from 的最细分辨率.
+ */
+void handle_metrics_history(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HISTORY_H */
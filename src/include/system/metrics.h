@@ -0,0 +1,100 @@
+/**
+ * @file metrics.h
+ * @brief procfs/sysfs 指标读取 (常驻文件描述符, 不创建进程)
+ *
+ * 每个指标文件只打开一次, 之后用 pread 从偏移 0 重新读取, 内核会重新
+ * 生成内容. 解析不分配内存, 可在任意线程调用.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 最多读取的温区数 */
+#define METRICS_MAX_THERMAL_ZONES 16
+
+/* 打开失败的文件至少间隔该时间再重试 (ms) */
+#define METRICS_RETRY_MS 10000
+
+/* /proc/meminfo (kB) */
+typedef struct {
+    unsigned long total;
+    unsigned long free;
+    unsigned long available;
+    unsigned long buffers;
+    unsigned long cached;
+} MemMetrics;
+
+/* /proc/stat 首行 cpu 累计时间 (jiffies) */
+typedef struct {
+    unsigned long long user;
+    unsigned long long nice;
+    unsigned long long system;
+    unsigned long long idle;
+    unsigned long long iowait;
+    unsigned long long irq;
+    unsigned long long softirq;
+    unsigned long long steal;
+} CpuMetrics;
+
+/* /sys/class/power_supply/battery/uevent */
+typedef struct {
+    char status[32];
+    char health[32];
+    int capacity;               /* % */
+    int temperature;            /* 0.1 摄氏度 */
+    int voltage_now;            /* uV */
+    int current_now;            /* uA */
+} BatteryMetrics;
+
+/**
+ * @brief 读取内存信息
+ * @return 0 成功, -1 失败
+ */
+int metrics_meminfo(MemMetrics *out);
+
+/**
+ * @brief 读取 CPU 累计时间
+ * @return 0 成功, -1 失败
+ */
+int metrics_cpu(CpuMetrics *out);
+
+/**
+ * @brief 系统运行时间
+ * @return 秒, -1 失败
+ */
+double metrics_uptime(void);
+
+/**
+ * @brief 所有温区的平均温度 (温区在首次调用时发现)
+ * @return 摄氏度, -1 失败
+ */
+double metrics_thermal_temp(void);
+
+/**
+ * @brief 读取电池状态, 失败时 status/health 为 "Unknown", 数值为 0
+ * @return 0 成功, -1 失败
+ */
+int metrics_battery(BatteryMetrics *out);
+
+/**
+ * @brief 读取网卡累计收发字节数 (/proc/net/dev)
+ * @return 0 成功, -1 失败或网卡不存在
+ */
+int metrics_net_bytes(const char *iface, unsigned long long *rx, unsigned long long *tx);
+
+/**
+ * @brief 关闭所有常驻文件描述符
+ */
+void metrics_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_H */
@@ -195,13 +195,106 @@ int ofono_get_neighbor_cells(NeighborCell *cells, int max_count);
 int ofono_get_network_info(char *tech, int tech_size, char *band, int band_size);
 
 /**
- * 获取服务小区制式
+ * 获取服务小区制式 (oFono 原始值, 如 "nr", "lte")
  * @param buffer 输出缓冲区
  * @param size 缓冲区大小
  * @return 成功返回0，失败返回错误码
  */
 int ofono_get_serving_cell_tech(char *buffer, int size);
 
+/* ==================== 属性镜像 ==================== */
+
+/*
+ * Modem / RadioSettings / NetworkRegistration / ConnectionManager /
+ * ConnectionContext / SimManager 的属性在内存中镜像, 由 PropertyChanged
+ * 等信号保持最新. 上面的读取函数优先返回镜像, 镜像未就绪时回退到同步调用.
+ */
+
+/**
+ * 属性变化回调, 在 GLib 主循环线程中调用
+ * @param path 对象路径 (如 /ril_0 或 /ril_0/context2)
+ * @param iface 接口名
+ * @param key 属性名
+ * @param value 新值 (回调返回后失效)
+ */
+typedef void (*OfonoPropertyObserver)(const char *path, const char *iface,
+                                      const char *key, GVariant *value, void *user_data);
+
+/**
+ * 注册属性变化观察者
+ * @return 成功返回0，已满返回-1
+ */
+int ofono_add_property_observer(OfonoPropertyObserver fn, void *user_data);
+
+/**
+ * 读取镜像中的 modem 在线状态
+ * @return 成功返回0，镜像未就绪返回-1
+ */
+int ofono_get_modem_online(const char *modem_path, int *online);
+
+/**
+ * 读取镜像中的 modem 序列号 (IMEI)
+ * @return 成功返回0，镜像未就绪或为空返回-1
+ */
+int ofono_get_modem_serial(const char *modem_path, char *buffer, int size);
+
+/**
+ * 读取镜像中的 SIM 标识, iccid/imsi 可为 NULL
+ * @return 请求的字段都已知返回0，否则返回-1
+ */
+int ofono_get_sim_identity(const char *modem_path, char *iccid, int iccid_size,
+                           char *imsi, int imsi_size);
+
+/**
+ * 读取镜像中的漫游状态, 不发起 D-Bus 调用
+ * @return 成功返回0，镜像未就绪返回-1
+ */
+int ofono_get_roaming_cached(int *roaming_allowed, int *is_roaming);
+
+/* ==================== 异步接口 ==================== */
+
+/*
+ * 异步调用不阻塞调用线程, 只能在 GLib 主循环线程 (即 HTTP 事件循环) 发起,
+ * 回调也在该线程执行. 返回0表示已发起, 之后回调恰好执行一次; 返回-1表示
+ * 未能发起 (未连接或参数错误, 原因见 dbus_get_last_error), 回调不会执行.
+ * cancellable 被取消时调用以 rc=-2 完成.
+ */
+
+/**
+ * 异步调用完成回调
+ * @param rc 0成功, -1失败, -2已取消
+ * @param reply 返回值元组, 仅成功时非NULL (回调返回后失效)
+ * @param error 失败原因, 成功时为NULL
+ */
+typedef void (*OfonoAsyncCallback)(int rc, GVariant *reply, const char *error, void *user_data);
+
+/**
+ * 异步调用 oFono 方法
+ * @param path 对象路径
+ * @param iface 接口名
+ * @param method 方法名
+ * @param params 参数 (浮动引用会被接管, 可为NULL)
+ * @param timeout_ms D-Bus 超时
+ * @return 0已发起, -1失败
+ */
+int ofono_call_async(const char *path, const char *iface, const char *method,
+                     GVariant *params, int timeout_ms, GCancellable *cancellable,
+                     OfonoAsyncCallback cb, void *user_data);
+
+/**
+ * 异步设置数据连接开关 (internet context 取自镜像, 未就绪时先异步查询)
+ * @return 0已发起, -1失败
+ */
+int ofono_set_data_status_async(int active, GCancellable *cancellable,
+                                OfonoAsyncCallback cb, void *user_data);
+
+/**
+ * 异步设置漫游允许状态
+ * @return 0已发起, -1失败
+ */
+int ofono_set_roaming_allowed_async(int allowed, GCancellable *cancellable,
+                                    OfonoAsyncCallback cb, void *user_data);
+
 /**
  * 验证 AT 命令格式
  * @param cmd 命令字符串
@@ -30,13 +30,28 @@ extern "C" {
  */
 int execute_shell(const char *cmd, char *output, size_t size);
 
+/* 插件元信息 (字段长度不小于 128, 与元信息提取上限一致) */
+typedef struct {
+    const char *filename;
+    const char *content;            /* 插件源码, 仅在回调期间有效 */
+    size_t content_len;
+    char name[128];
+    char version[128];
+    char author[128];
+    char description[256];
+    char icon[128];
+    char color[128];
+} PluginInfo;
+
+typedef void (*PluginVisitor)(const PluginInfo *info, void *ctx);
+
 /**
- * @brief 获取插件列表
- * @param json_output JSON输出缓冲区
- * @param size 缓冲区大小
- * @return 插件数量, -1 失败
+ * @brief 遍历插件目录, 对每个插件调用回调
+ * @param cb 回调函数
+ * @param ctx 回调上下文
+ * @return 插件数量
  */
-int get_plugin_list(char *json_output, size_t size);
+int plugin_foreach(PluginVisitor cb, void *ctx);
 
 /**
  * @brief 保存插件
@@ -28,6 +28,7 @@ typedef struct {
     char url[512];
     char body[2048];
     char headers[512];
+    int tls_insecure;           /* https 不校验服务端证书 (自签名证书的目标) */
 } WebhookConfig;
 
 /**
@@ -60,6 +61,63 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
  */
 int sms_get_list(SmsMessage *messages, int max_count);
 
+/* 收件箱分页查询单页上限 */
+#define SMS_PAGE_DEFAULT 100
+#define SMS_PAGE_MAX     200
+
+/* 收件箱查询条件 (结果按 id 降序, 即接收顺序从新到旧) */
+typedef struct {
+    int before_id;          /* >0 时只返回 id < before_id (向前翻页) */
+    int after_id;           /* >0 时只返回 id > after_id (增量拉取新短信) */
+    int limit;              /* 1..SMS_PAGE_MAX, 其他值取 SMS_PAGE_DEFAULT */
+    const char *sender;     /* 非空时只返回该号码的短信 */
+    const char *keyword;    /* 非空时按内容搜索 */
+} SmsQuery;
+
+/* 会话摘要 (按号码分组) */
+typedef struct {
+    char sender[64];
+    int count;
+    int unread;
+    int last_id;
+    time_t last_timestamp;
+    char last_content[1024];
+} SmsConversation;
+
+/**
+ * 逐条回调 (回调期间持有数据库锁, 不要执行耗时操作)
+ */
+typedef void (*SmsMessageCallback)(const SmsMessage *msg, void *user_data);
+typedef void (*SmsConversationCallback)(const SmsConversation *conv, void *user_data);
+
+/**
+ * 按条件查询收件箱
+ * 内容搜索优先使用 FTS5 (trigram) 索引, 关键词不足3个字符或 FTS5 不可用时逐条匹配
+ * @return 返回的条数, -1失败
+ */
+int sms_query(const SmsQuery *query, SmsMessageCallback cb, void *user_data);
+
+/**
+ * 按号码汇总会话, 最近有短信的号码在前
+ * @param limit 最多返回的会话数
+ * @return 返回的会话数, -1失败
+ */
+int sms_get_conversations(int limit, SmsConversationCallback cb, void *user_data);
+
+/**
+ * 获取未读数、总数与最新短信ID (用于轮询是否有新短信)
+ * @return 0成功, -1失败
+ */
+int sms_get_unread_stats(int *unread, int *total, int *latest_id);
+
+/**
+ * 标记已读
+ * @param id >0 时只标记该条
+ * @param sender 非空时标记该号码的全部短信 (id<=0 时生效)
+ * @return 标记的条数, -1失败 (id 与 sender 都未指定时标记全部)
+ */
+int sms_mark_read(int id, const char *sender);
+
 /**
  * 获取短信总数
  * @return 短信数量, -1失败
@@ -94,8 +152,8 @@ int sms_get_webhook_config(WebhookConfig *config);
 int sms_save_webhook_config(const WebhookConfig *config);
 
 /**
- * 测试Webhook
- * @return 0成功, -1失败
+ * 测试Webhook (测试通知加入投递队列, 结果见 /api/webhook/stats)
+ * @return 0已入队, -1未启用或入队失败
  */
 int sms_test_webhook(void);
 
@@ -116,6 +174,15 @@ typedef struct {
  */
 int sms_get_sent_list(SentSmsMessage *messages, int max_count);
 
+/**
+ * 批量写入发送记录 (群发队列, 同一事务)
+ * 记录标记为 queued, 不受发件箱条数上限约束, 由数据库维护按表容量清理
+ * @param messages 记录数组, id 字段忽略
+ * @param count 数量
+ * @return 写入的条数, -1失败
+ */
+int sms_save_sent_batch(const SentSmsMessage *messages, int count);
+
 /**
  * 获取最大存储数量配置
  * @return 最大数量
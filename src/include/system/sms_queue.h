@@ -0,0 +1,96 @@
+/**
+ * @file sms_queue.h
+ * @brief 群发短信队列 (限速、并发上限、逐个收件人状态)
+ *
+ * 一次请求提交一个任务, 任务包含多个 (收件人, 内容). 发送线程按配置
+ * 的最小间隔依次异步调用 MessageManager.SendMessage, 同时等待 oFono
+ * 应答的消息数不超过配置的上限. 每个收件人的状态:
+ *   queued     排队中
+ *   submitting 已提交给 oFono, 等待应答
+ *   pending    oFono 已接受, 等待模块发出
+ *   sent       已发出 (org.ofono.Message State=sent)
+ *   failed     提交被拒绝或发送失败
+ *   cancelled  任务取消时尚未提交
+ * 收件人到达 sent/failed 后写入发送记录, 同一轮的记录在一个事务中写入;
+ * 任务被替换或队列停止时仍为 pending 的收件人按 pending 写入.
+ * 任务只保存在内存中, 保留最近 SMS_QUEUE_MAX_JOBS 个.
+ *
+ * 配置 (config 表):
+ *   sms_send_interval_ms  两次提交的最小间隔, 默认 1000
+ *   sms_send_inflight     同时等待应答的条数, 默认 2
+ */
+
+#ifndef SMS_QUEUE_H
+#define SMS_QUEUE_H
+
+#include <time.h>
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SMS_QUEUE_MAX_JOBS          16
+#define SMS_QUEUE_MAX_ITEMS         200     /* 单个任务的收件人数上限 */
+
+#define SMS_SEND_INTERVAL_DEFAULT   1000
+#define SMS_SEND_INTERVAL_MIN       200
+#define SMS_SEND_INTERVAL_MAX       60000
+#define SMS_SEND_INFLIGHT_DEFAULT   2
+#define SMS_SEND_INFLIGHT_MAX       8
+
+/* 一条待发短信 */
+typedef struct {
+    const char *recipient;
+    const char *content;
+} SmsQueueMessage;
+
+/**
+ * 启动发送线程 (须在数据库与 D-Bus 初始化之后调用)
+ * @return 0成功, -1失败
+ */
+int sms_queue_init(void);
+
+/**
+ * 停止发送线程, 未提交的收件人标记为取消
+ */
+void sms_queue_deinit(void);
+
+/**
+ * 提交群发任务
+ * @param messages 短信数组, 内容会被复制
+ * @param count 数量 (1..SMS_QUEUE_MAX_ITEMS)
+ * @return 任务ID (>0), -1 参数无效或未完成的任务已满
+ */
+int sms_queue_submit(const SmsQueueMessage *messages, int count);
+
+/**
+ * 取消任务中尚未提交的收件人
+ * @return 0成功, -1任务不存在
+ */
+int sms_queue_cancel(int job_id);
+
+/**
+ * POST /api/sms/jobs - 提交任务
+ *   {"recipients":["10086","10010"],"content":"..."}
+ *   或 {"messages":[{"recipient":"10086","content":"..."}]}
+ * GET /api/sms/jobs - 最近任务的进度
+ */
+void handle_sms_jobs(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * GET /api/sms/jobs/:id - 任务详情 (逐个收件人状态)
+ * DELETE /api/sms/jobs/:id - 取消任务
+ */
+void handle_sms_job(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * GET/POST /api/sms/queue/config - 查询/设置发送间隔与并发上限
+ */
+void handle_sms_queue_config(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SMS_QUEUE_H */
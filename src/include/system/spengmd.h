@@ -0,0 +1,60 @@
+/**
+ * @file spengmd.h
+ * @brief AT+SPENGMD 工程模式输出解析 (服务小区/邻小区)
+ *
+ * 响应格式: 以 '-' 分行、',' 分列, ",-" 表示负数, "--" 表示换行且第二个
+ * '-' 是下一行的负号, 响应在 "OK" 处结束, 其中的 \r\n 忽略.
+ * 解析器一次遍历原始响应, 不复制、不分配内存, 直接写入带字段名的结构体.
+ *
+ * 支持的布局:
+ *   AT+SPENGMD=0,6,0   LTE 服务小区, 每行第0列依次为各字段 (SINR 在第33行)
+ *   AT+SPENGMD=0,6,6   LTE 邻小区, 每行一个小区
+ *   AT+SPENGMD=0,14,1  NR 服务小区, 同 LTE 服务小区 (SINR 在第15行)
+ *   AT+SPENGMD=0,14,2  NR 邻小区, 每列一个小区, 第0..5行依次为各字段
+ */
+
+#ifndef SPENGMD_H
+#define SPENGMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 邻小区最大数量 */
+#define SPENGMD_MAX_CELLS   32
+
+typedef enum {
+    SPENGMD_LTE = 0,
+    SPENGMD_NR
+} SpengmdRat;
+
+typedef struct {
+    int band;           /* 频段号, 0 表示模块未给出 */
+    int arfcn;          /* (E)ARFCN */
+    int pci;
+    double rsrp;        /* dBm */
+    double rsrq;        /* dB */
+    double sinr;        /* dB */
+} SpengmdCell;
+
+/**
+ * 解析服务小区 (AT+SPENGMD=0,6,0 / 0,14,1)
+ * @param resp AT 响应
+ * @param cell 输出
+ * @return 0 成功, -1 行数不足 (响应不完整或格式不符)
+ */
+int spengmd_parse_serving(const char *resp, SpengmdRat rat, SpengmdCell *cell);
+
+/**
+ * 解析邻小区 (AT+SPENGMD=0,6,6 / 0,14,2), 跳过 ARFCN 或 PCI 为 0 的项
+ * @param cells 输出数组
+ * @param max 数组容量
+ * @return 小区数
+ */
+int spengmd_parse_neighbors(const char *resp, SpengmdRat rat, SpengmdCell *cells, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPENGMD_H */
@@ -0,0 +1,79 @@
+/**
+ * @file storage_io.h
+ * @brief 闪存写入统计 (按子系统计数写入次数、字节数与 fsync 次数)
+ *
+ * 数据库写入由 database.c 在事务提交时按写入 WAL 的页数统计, 并按
+ * 语句涉及的表归入子系统; 检查点写回数据库文件的页数由 db_maint 统计.
+ * 文件写入通过 storage_write_file (临时文件 + rename, 可选 fsync).
+ * 统计只保存在内存中, 统计接口给出开机以来的总量与折算的日写入量,
+ * 用于估算 NAND 磨损. 本进程与 vnstatd 的实际块设备写入量取自 /proc/<pid>/io.
+ */
+
+#ifndef STORAGE_IO_H
+#define STORAGE_IO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "mongoose.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    STORAGE_SMS = 0,        /* sms / sent_sms / sms_fts / sms_config */
+    STORAGE_AUTH,           /* auth_tokens */
+    STORAGE_CONFIG,         /* config */
+    STORAGE_WEBHOOK,        /* webhook_queue / webhook_config */
+    STORAGE_DB,             /* 其他表、建表、VACUUM、检查点 */
+    STORAGE_PLUGIN,         /* 插件文件、插件存储、用户脚本 */
+    STORAGE_CELL_LOG,       /* 小区测量记录文件 */
+    STORAGE_CRON,           /* crontab */
+    STORAGE_COUNT
+} StorageSubsys;
+
+/* storage_write_file 标志 */
+#define STORAGE_WRITE_SYNC  0x01    /* 重命名前 fsync, 掉电后不会得到半个文件 */
+
+/**
+ * 记录统计起点 (服务启动时在其他模块之前调用, 日写入量按此折算)
+ */
+void storage_io_init(void);
+
+/**
+ * 计入一次写入
+ * @param subsys 子系统
+ * @param bytes 写入字节数
+ * @param fsyncs fsync/msync 次数
+ */
+void storage_account(StorageSubsys subsys, long long bytes, int fsyncs);
+
+/**
+ * 按表名归类数据库写入
+ * @return 子系统, 未知的表归入 STORAGE_DB
+ */
+StorageSubsys storage_subsys_for_table(const char *table);
+
+/**
+ * 整体替换文件内容 (写临时文件后 rename) 并计入统计
+ * @param subsys 子系统
+ * @param path 目标路径
+ * @param data 内容
+ * @param len 长度
+ * @param mode 文件权限
+ * @param flags STORAGE_WRITE_*
+ * @return 0成功, -1失败
+ */
+int storage_write_file(StorageSubsys subsys, const char *path, const void *data, size_t len,
+                       mode_t mode, int flags);
+
+/**
+ * GET /api/storage/stats - 各子系统写入量、开机时长与折算的日写入量
+ */
+void handle_storage_stats(struct mg_connection *c, struct mg_http_message *hm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STORAGE_IO_H */
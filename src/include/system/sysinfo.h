@@ -48,13 +48,48 @@ typedef struct {
     int uplink_rate;
 } SystemInfo;
 
+/* 采样分组, 各组按自己的间隔在后台刷新 (按耗时从低到高排列) */
+typedef enum {
+    SYSINFO_GROUP_LOAD = 0,         /* 内存, 运行时间, CPU */
+    SYSINFO_GROUP_LOCAL,            /* 序列号, 温度, 电源, WiFi 配置 */
+    SYSINFO_GROUP_RADIO,            /* 卡槽, 信号, 飞行模式, 网络模式/类型/频段, QoS */
+    SYSINFO_GROUP_IDENTITY,         /* uname, IMEI/ICCID/IMSI/运营商 */
+    SYSINFO_GROUP_COUNT
+} SysinfoGroup;
+
+#define SYSINFO_GROUP_BIT(g)            (1u << (g))
+#define SYSINFO_GROUP_ALL               ((1u << SYSINFO_GROUP_COUNT) - 1)
+
+/* 各组刷新间隔 (ms) */
+#define SYSINFO_IDENTITY_INTERVAL_MS    300000
+#define SYSINFO_LOAD_INTERVAL_MS        1000
+#define SYSINFO_LOCAL_INTERVAL_MS       10000
+#define SYSINFO_RADIO_INTERVAL_MS       5000
+
 /**
- * @brief 获取完整系统信息
+ * @brief 获取系统信息快照 (不访问硬件, 不阻塞)
  * @param info 输出系统信息结构
  * @return 0 成功, -1 失败
  */
 int get_system_info(SystemInfo *info);
 
+/**
+ * @brief 启动后台采样线程 (须在 D-Bus 初始化之后)
+ * @return 0 成功, -1 失败 (get_system_info 退化为调用方线程采集)
+ */
+int sysinfo_sampler_start(void);
+
+/**
+ * @brief 停止后台采样线程
+ */
+void sysinfo_sampler_stop(void);
+
+/**
+ * @brief 请求尽快刷新指定分组 (状态变更后调用)
+ * @param groups SYSINFO_GROUP_BIT() 组合
+ */
+void sysinfo_invalidate(unsigned int groups);
+
 /**
  * @brief 获取系统运行时间
  * @return 运行时间(秒), -1 失败
@@ -1,22 +1,533 @@
 /**
  * @file packed_fs.c
- * @brief Static file service - serve files from dist directory
+ * @brief Static file service - dashboard embedded at build time
+ *
+ * The dashboard is packed into read-only arrays by tools/pack_fs.py
+ * (see `make pack`). Lookups are a binary search over the sorted index,
+ * MIME types and ETags are precomputed, and bodies are written to the
+ * socket straight from .rodata. Gzip entries are sent as-is to clients
+ * accepting gzip and inflated for the rest.
+ *
+ * Development override: if OFONO_WEB_DIR is set, files found there win
+ * over the embedded copy. A binary built without a pack falls back to
+ * ./dist. Disk files get the same treatment as before: .br/.gz siblings,
+ * content ETags and sendfile().
  */
 
 #include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <gio/gio.h>
 #include "mongoose.h"
+#include "packed_fs.h"
 
-/* Static file directory */
+/* Static file directory (used when no pack is embedded) */
 #define STATIC_DIR "./dist"
 
-/* Static file service options */
-static struct mg_http_serve_opts s_opts = {
-    .root_dir = STATIC_DIR,
-    .ssi_pattern = NULL,
-    .extra_headers = "Cache-Control: max-age=3600\r\n"
-                     "Access-Control-Allow-Origin: *\r\n"
+/* Environment variable naming the development override directory */
+#define STATIC_OVERRIDE_ENV "OFONO_WEB_DIR"
+
+/* Files up to this size are copied into the send buffer together with the headers */
+#define STATIC_INLINE_MAX   (8 * 1024)
+
+/* Max bytes pushed by sendfile() per poll, keeps other connections responsive */
+#define STATIC_SEND_BUDGET  (256 * 1024)
+
+/* Content ETag cache slots (direct mapped by path hash) */
+#define STATIC_ETAG_SLOTS   64
+
+#define STATIC_CACHE_DEFAULT    "max-age=3600"
+#define STATIC_CACHE_IMMUTABLE  "public, max-age=31536000, immutable"
+#define STATIC_CACHE_REVALIDATE "no-cache"
+
+#define STATIC_HEADERS "Access-Control-Allow-Origin: *\r\n"
+
+/* Content encodings accepted by the client */
+#define ENC_GZIP 0x01
+#define ENC_BR   0x02
+
+typedef struct {
+    char path[MG_PATH_MAX];
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    char etag[24];
+} EtagEntry;
+
+/* In-flight body transfer, stored in c->pfn_data */
+typedef struct {
+    int fd;                 /* File for sendfile(), -1 when sending from mem */
+    const unsigned char *mem;
+    off_t offset;
+    off_t end;
+    mg_event_handler_t saved_pfn;
+    void *saved_pfn_data;
+} StaticSend;
+
+static const struct {
+    const char *ext;
+    const char *type;
+} s_mime_types[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"webmanifest", "application/manifest+json"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"wasm", "application/wasm"},
+    {"txt", "text/plain; charset=utf-8"},
+    {NULL, NULL},
 };
 
+/* Only touched from the event loop thread */
+static EtagEntry s_etags[STATIC_ETAG_SLOTS];
+
+static const char *guess_mime(const char *path) {
+    const char *dot = strrchr(path, '.');
+    if (dot && strchr(dot, '/') == NULL) {
+        for (int i = 0; s_mime_types[i].ext; i++) {
+            if (strcasecmp(dot + 1, s_mime_types[i].ext) == 0) return s_mime_types[i].type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+/**
+ * @brief Content hashed build output, e.g. /assets/index-B3kfa9Xc.js
+ * The name part after the last '-' or '.' before the extension is at least
+ * 8 characters of [A-Za-z0-9_].
+ */
+static int is_hashed_name(const char *path) {
+    const char *base = strrchr(path, '/');
+    const char *ext, *p;
+    size_t n = 0;
+
+    base = base ? base + 1 : path;
+    ext = strrchr(base, '.');
+    if (!ext || ext == base) return 0;
+
+    for (p = ext - 1; p > base && *p != '-' && *p != '.'; p--) {
+        if (!isalnum((unsigned char)*p) && *p != '_') return 0;
+        n++;
+    }
+    return p > base && n >= 8;
+}
+
+static struct mg_str str_trim(struct mg_str s) {
+    while (s.len > 0 && isspace((unsigned char)s.buf[0])) s.buf++, s.len--;
+    while (s.len > 0 && isspace((unsigned char)s.buf[s.len - 1])) s.len--;
+    return s;
+}
+
+/* Parse Accept-Encoding, honouring q=0 */
+static int accepted_encodings(struct mg_http_message *hm) {
+    struct mg_str *ae = mg_http_get_header(hm, "Accept-Encoding");
+    struct mg_str s, entry, name, params;
+    int enc = 0;
+
+    if (!ae) return 0;
+    s = *ae;
+    while (mg_span(s, &entry, &s, ',')) {
+        int on = 1;
+        if (!mg_span(entry, &name, &params, ';')) continue;
+        name = str_trim(name);
+        params = str_trim(params);
+        if (params.len >= 3 && strncasecmp(params.buf, "q=0", 3) == 0) {
+            size_t i = 3;
+            if (i < params.len && params.buf[i] == '.') i++;
+            while (i < params.len && params.buf[i] == '0') i++;
+            if (i == params.len) on = 0;
+        }
+        if (!on) continue;
+        if (mg_strcasecmp(name, mg_str("br")) == 0) enc |= ENC_BR;
+        else if (mg_strcasecmp(name, mg_str("gzip")) == 0) enc |= ENC_GZIP;
+        else if (mg_strcasecmp(name, mg_str("*")) == 0) enc |= ENC_BR | ENC_GZIP;
+    }
+    return enc;
+}
+
+/* If-None-Match: list of tags or "*", weak comparison per RFC 7232 */
+static int etag_matches(struct mg_http_message *hm, const char *etag) {
+    struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+    struct mg_str s, tag;
+
+    if (!inm) return 0;
+    s = *inm;
+    while (mg_span(s, &tag, &s, ',')) {
+        tag = str_trim(tag);
+        if (tag.len == 1 && tag.buf[0] == '*') return 1;
+        if (tag.len > 2 && tag.buf[0] == 'W' && tag.buf[1] == '/') {
+            tag.buf += 2;
+            tag.len -= 2;
+        }
+        if (mg_strcmp(tag, mg_str(etag)) == 0) return 1;
+    }
+    return 0;
+}
+
+/* FNV-1a over the file content */
+static int hash_file(int fd, off_t size, uint64_t *out) {
+    char buf[4096];
+    uint64_t h = 0xcbf29ce484222325ULL;
+    off_t off = 0;
+
+    while (off < size) {
+        ssize_t n = pread(fd, buf, sizeof(buf), off);
+        if (n <= 0) return -1;
+        for (ssize_t i = 0; i < n; i++) {
+            h ^= (unsigned char)buf[i];
+            h *= 0x100000001b3ULL;
+        }
+        off += n;
+    }
+    *out = h;
+    return 0;
+}
+
+/**
+ * @brief Strong ETag for an open file, recomputed only when the file changes
+ */
+static const char *content_etag(const char *path, int fd, const struct stat *st) {
+    EtagEntry *e = &s_etags[mg_crc32(0, path, strlen(path)) % STATIC_ETAG_SLOTS];
+    uint64_t h;
+
+    if (strcmp(e->path, path) == 0 && e->dev == st->st_dev && e->ino == st->st_ino &&
+        e->size == st->st_size && e->mtime == st->st_mtime) {
+        return e->etag;
+    }
+    if (hash_file(fd, st->st_size, &h) != 0) return NULL;
+
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    e->dev = st->st_dev;
+    e->ino = st->st_ino;
+    e->size = st->st_size;
+    e->mtime = st->st_mtime;
+    snprintf(e->etag, sizeof(e->etag), "\"%016llx\"", (unsigned long long)h);
+    return e->etag;
+}
+
+static int open_regular(const char *path, struct stat *st) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    if (fstat(fd, st) != 0 || !S_ISREG(st->st_mode)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Open the best representation of a file
+ * @param enc Accepted encodings, on return the chosen one (0 = identity)
+ * @param chosen Output: path of the opened file
+ */
+static int open_variant(const char *path, int *enc, char *chosen, size_t size, struct stat *st) {
+    static const struct { int flag; const char *suffix; } variants[] = {
+        {ENC_BR, ".br"},
+        {ENC_GZIP, ".gz"},
+    };
+
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        if (!(*enc & variants[i].flag)) continue;
+        snprintf(chosen, size, "%s%s", path, variants[i].suffix);
+        int fd = open_regular(chosen, st);
+        if (fd >= 0) {
+            *enc = variants[i].flag;
+            return fd;
+        }
+    }
+    *enc = 0;
+    snprintf(chosen, size, "%s", path);
+    return open_regular(chosen, st);
+}
+
+static void static_send_finish(struct mg_connection *c) {
+    StaticSend *s = (StaticSend *)c->pfn_data;
+
+    if (s->fd >= 0) close(s->fd);
+    c->pfn = s->saved_pfn;
+    c->pfn_data = s->saved_pfn_data;
+    c->is_resp = 0;
+    free(s);
+    MG_EPOLL_MOD(c, c->send.len > 0);
+}
+
+/**
+ * @brief Protocol handler while a body is in flight
+ * Waits for the headers to leave the send buffer, then pushes the body with
+ * sendfile() or send() from the embedded array. On EAGAIN, write readiness is requested explicitly because the
+ * send buffer is empty and mongoose would not ask for it.
+ */
+static void static_send_cb(struct mg_connection *c, int ev, void *ev_data) {
+    StaticSend *s = (StaticSend *)c->pfn_data;
+
+    if (ev == MG_EV_WRITE || ev == MG_EV_POLL) {
+        size_t budget = STATIC_SEND_BUDGET;
+
+        if (c->send.len > 0 || c->is_closing) return;
+
+        while (s->offset < s->end && budget > 0) {
+            size_t want = (size_t)(s->end - s->offset);
+            if (want > budget) want = budget;
+
+            ssize_t n;
+            if (s->mem) {
+                n = send((int)(size_t)c->fd, s->mem + s->offset, want, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (n > 0) s->offset += n;
+            } else {
+                n = sendfile((int)(size_t)c->fd, s->fd, &s->offset, want);
+            }
+            if (n > 0) {
+                budget -= (size_t)n;
+            } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                MG_EPOLL_MOD(c, 1);
+                return;
+            } else {
+                /* Peer gone or file truncated, the length promised can't be met */
+                c->is_closing = 1;
+                break;
+            }
+        }
+        if (s->offset >= s->end || c->is_closing) {
+            static_send_finish(c);
+        } else {
+            MG_EPOLL_MOD(c, 1);
+        }
+    } else if (ev == MG_EV_CLOSE) {
+        static_send_finish(c);
+    }
+    (void)ev_data;
+}
+
+/**
+ * @brief Hand the body over to static_send_cb
+ * @return 0 started, -1 out of memory (connection is closed)
+ */
+static int static_send_start(struct mg_connection *c, int fd, const unsigned char *mem, off_t size) {
+    StaticSend *s = calloc(1, sizeof(StaticSend));
+    if (!s) {
+        c->is_closing = 1;
+        c->is_resp = 0;
+        return -1;
+    }
+    s->fd = fd;
+    s->mem = mem;
+    s->offset = 0;
+    s->end = size;
+    s->saved_pfn = c->pfn;
+    s->saved_pfn_data = c->pfn_data;
+    c->pfn = static_send_cb;
+    c->pfn_data = s;
+    return 0;
+}
+
+/**
+ * @brief Send a file with validators and caching headers
+ * @param path Path of the identity representation on disk
+ * @return 1 served, 0 file not found
+ */
+static int serve_file(struct mg_connection *c, struct mg_http_message *hm, const char *path,
+                      const char *cache_control) {
+    char chosen[MG_PATH_MAX + 4];
+    struct stat st;
+    int enc = accepted_encodings(hm);
+    int fd = open_variant(path, &enc, chosen, sizeof(chosen), &st);
+    const char *etag, *encoding;
+    char etag_line[40] = "";
+
+    if (fd < 0) return 0;
+
+    etag = content_etag(chosen, fd, &st);
+    encoding = enc == ENC_BR ? "Content-Encoding: br\r\n" :
+               enc == ENC_GZIP ? "Content-Encoding: gzip\r\n" : "";
+
+    if (etag && etag_matches(hm, etag)) {
+        close(fd);
+        mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: %s\r\n"
+                  "Vary: Accept-Encoding\r\n" STATIC_HEADERS "Content-Length: 0\r\n\r\n",
+                  etag, cache_control);
+        c->is_resp = 0;
+        return 1;
+    }
+
+    if (etag) snprintf(etag_line, sizeof(etag_line), "ETag: %s\r\n", etag);
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %lld\r\n"
+              "%s%sCache-Control: %s\r\nVary: Accept-Encoding\r\n" STATIC_HEADERS "\r\n",
+              guess_mime(path), (long long)st.st_size, encoding, etag_line, cache_control);
+
+    if (mg_strcasecmp(hm->method, mg_str("HEAD")) == 0 || c->is_closing || st.st_size == 0) {
+        close(fd);
+        c->is_resp = 0;
+        return 1;
+    }
+
+    /* Small files and TLS connections go through the send buffer */
+    if (st.st_size <= STATIC_INLINE_MAX || c->is_tls) {
+        size_t remaining = (size_t)st.st_size;
+        off_t off = 0;
+        while (remaining > 0) {
+            char buf[4096];
+            ssize_t n = pread(fd, buf, remaining < sizeof(buf) ? remaining : sizeof(buf), off);
+            if (n <= 0) {
+                c->is_closing = 1;
+                break;
+            }
+            mg_send(c, buf, (size_t)n);
+            off += n;
+            remaining -= (size_t)n;
+        }
+        close(fd);
+        c->is_resp = 0;
+        return 1;
+    }
+
+    if (static_send_start(c, fd, NULL, st.st_size) != 0) close(fd);
+    return 1;
+}
+
+/* ==================== Embedded files ==================== */
+
+static int packed_cmp(const void *key, const void *elem) {
+    return strcmp((const char *)key, ((const PackedFile *)elem)->path);
+}
+
+static const PackedFile *packed_find(const char *path) {
+    if (g_packed_file_count == 0) return NULL;
+    return bsearch(path, g_packed_files, g_packed_file_count, sizeof(PackedFile), packed_cmp);
+}
+
+/* Inflate a gzip entry for clients that don't accept gzip */
+static GBytes *packed_inflate(const PackedFile *pf) {
+    GConverter *conv = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+    guint8 *out = g_malloc(pf->raw_size + 1);
+    gsize read = 0, written = 0;
+    GConverterResult r;
+
+    r = g_converter_convert(conv, pf->data, pf->size, out, pf->raw_size + 1,
+                            G_CONVERTER_INPUT_AT_END, &read, &written, NULL);
+    g_object_unref(conv);
+    if (r != G_CONVERTER_FINISHED || written != pf->raw_size) {
+        g_free(out);
+        return NULL;
+    }
+    return g_bytes_new_take(out, written);
+}
+
+/**
+ * @brief Send an embedded file
+ */
+static void serve_packed_entry(struct mg_connection *c, struct mg_http_message *hm,
+                               const PackedFile *pf, const char *cache_control) {
+    int use_gzip = pf->gzip && (accepted_encodings(hm) & ENC_GZIP);
+    const char *etag = use_gzip ? pf->etag_gzip : pf->etag;
+    GBytes *inflated = NULL;
+    const unsigned char *body = pf->data;
+    size_t size = use_gzip || !pf->gzip ? pf->size : pf->raw_size;
+
+    if (etag_matches(hm, etag)) {
+        mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: %s\r\n"
+                  "Vary: Accept-Encoding\r\n" STATIC_HEADERS "Content-Length: 0\r\n\r\n",
+                  etag, cache_control);
+        c->is_resp = 0;
+        return;
+    }
+
+    if (pf->gzip && !use_gzip) {
+        inflated = packed_inflate(pf);
+        if (!inflated) {
+            mg_http_reply(c, 500, STATIC_HEADERS, "Corrupt embedded file\n");
+            return;
+        }
+        body = g_bytes_get_data(inflated, NULL);
+    }
+
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %llu\r\n"
+              "%sETag: %s\r\nCache-Control: %s\r\nVary: Accept-Encoding\r\n" STATIC_HEADERS "\r\n",
+              pf->mime, (unsigned long long)size, use_gzip ? "Content-Encoding: gzip\r\n" : "",
+              etag, cache_control);
+
+    if (mg_strcasecmp(hm->method, mg_str("HEAD")) == 0 || c->is_closing || size == 0) {
+        c->is_resp = 0;
+    } else if (inflated || size <= STATIC_INLINE_MAX || c->is_tls) {
+        mg_send(c, body, size);
+        c->is_resp = 0;
+    } else {
+        static_send_start(c, -1, body, (off_t)size);
+    }
+    if (inflated) g_bytes_unref(inflated);
+}
+
+#if MG_ENABLE_PACKED_FS
+/*
+ * mongoose packed-fs hooks (mg_fs_packed). Gzip entries are exposed under
+ * their ".gz" name, which is what mg_http_serve_file() looks for.
+ */
+const char *mg_unpack(const char *path, size_t *size, time_t *mtime) {
+    const PackedFile *pf = packed_find(path);
+    size_t len = strlen(path);
+
+    if (!pf && len > 3 && strcmp(path + len - 3, ".gz") == 0) {
+        char base[MG_PATH_MAX];
+        snprintf(base, sizeof(base), "%.*s", (int)(len - 3), path);
+        pf = packed_find(base);
+        if (pf && !pf->gzip) pf = NULL;
+    } else if (pf && pf->gzip) {
+        pf = NULL;
+    }
+
+    if (size) *size = pf ? pf->size : 0;
+    if (mtime) *mtime = pf ? pf->mtime : 0;
+    return pf ? (const char *)pf->data : NULL;
+}
+
+const char *mg_unlist(size_t no) {
+    static char name[MG_PATH_MAX];
+
+    if (no >= g_packed_file_count) return NULL;
+    if (!g_packed_files[no].gzip) return g_packed_files[no].path;
+    snprintf(name, sizeof(name), "%s.gz", g_packed_files[no].path);
+    return name;
+}
+#endif
+
+/* Development override directory, resolved once */
+static const char *override_dir(void) {
+    static int resolved = 0;
+    static const char *dir = NULL;
+
+    if (!resolved) {
+        const char *env = getenv(STATIC_OVERRIDE_ENV);
+        dir = env && env[0] ? env : NULL;
+        if (!dir && g_packed_file_count == 0) dir = STATIC_DIR;
+        if (dir) printf("[HTTP] 静态文件目录: %s\n", dir);
+        resolved = 1;
+    }
+    return dir;
+}
+
+/* ==================== Entry point ==================== */
+
 /**
  * @brief Serve static files
  * @param c Mongoose connection
@@ -25,17 +536,38 @@ static struct mg_http_serve_opts s_opts = {
  */
 int serve_packed_file(struct mg_connection *c, struct mg_http_message *hm) {
     char path[512] = {0};
-    size_t len = hm->uri.len < sizeof(path) - 1 ? hm->uri.len : sizeof(path) - 1;
-    memcpy(path, hm->uri.buf, len);
+    char full[MG_PATH_MAX];
+    const char *dir = override_dir();
+    const char *cache;
+    const PackedFile *pf;
+    int n = mg_url_decode(hm->uri.buf, hm->uri.len, path, sizeof(path), 0);
+
+    /* Reject undecodable paths and anything trying to leave the web root */
+    if (n <= 0 || path[0] != '/' || strstr(path, "..") != NULL || strchr(path, '\\') != NULL) {
+        mg_http_reply(c, 400, STATIC_HEADERS, "Invalid path\n");
+        return 1;
+    }
 
     /* Root path or SPA routes - serve index.html */
-    if (strcmp(path, "/") == 0 || 
+    if (strcmp(path, "/") == 0 ||
         (strstr(path, ".") == NULL && strncmp(path, "/api/", 5) != 0)) {
-        mg_http_serve_file(c, hm, STATIC_DIR "/index.html", &s_opts);
+        snprintf(path, sizeof(path), "/index.html");
+    }
+
+    cache = strcmp(path, "/index.html") == 0 ? STATIC_CACHE_REVALIDATE :
+            is_hashed_name(path) ? STATIC_CACHE_IMMUTABLE : STATIC_CACHE_DEFAULT;
+
+    if (dir) {
+        snprintf(full, sizeof(full), "%s%s", dir, path);
+        if (serve_file(c, hm, full, cache)) return 1;
+    }
+
+    pf = packed_find(path);
+    if (pf) {
+        serve_packed_entry(c, hm, pf, cache);
         return 1;
     }
 
-    /* Serve static files from dist directory */
-    mg_http_serve_dir(c, hm, &s_opts);
+    mg_http_reply(c, 404, STATIC_HEADERS, "Not found\n");
     return 1;
 }
@@ -14,6 +14,7 @@
 #include "exec_utils.h"
 #include "http_utils.h"
 #include "ofono.h"
+#include "spengmd.h"
 
 /* 频段映射结构 */
 typedef struct {
@@ -312,9 +313,6 @@ void handle_unlock_bands(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_OK(c, "{\"success\":true,\"message\":\"频段解锁成功\"}");
 }
 
-/* 解析小区数据 (复用 handlers.c 中的函数) */
-extern int parse_cell_to_vec(const char *input, char data[64][16][32]);
-
 /**
  * 根据 NR ARFCN 推算 5G 频段
  * 参考 3GPP TS 38.104
@@ -375,6 +373,28 @@ static int is_5g_network(void) {
     return 0; /* 4G 或其他 */
 }
 
+/* 追加一个小区的 JSON, 模块未给出频段时按 ARFCN 推算 */
+static int append_cell_json(char *json, int size, int len, int index,
+                            const SpengmdCell *cell, int is_5g, int serving) {
+    char band[16];
+
+    if (len >= size) return len;
+
+    if (cell->band > 0) {
+        snprintf(band, sizeof(band), "%d", cell->band);
+    } else {
+        const char *guess = is_5g ? arfcn_to_nr_band(cell->arfcn) : earfcn_to_lte_band(cell->arfcn);
+        g_strlcpy(band, guess[0] ? guess : "0", sizeof(band));  /* 未知频段默认显示0 */
+    }
+
+    return len + snprintf(json + len, size - len,
+        "%s{\"rat\":\"%s\",\"band\":\"%c%s\",\"arfcn\":%d,\"pci\":%d,"
+        "\"rsrp\":%.2f,\"rsrq\":%.2f,\"sinr\":%.2f,\"isServing\":%s}",
+        index > 0 ? "," : "", is_5g ? "5G" : "4G", is_5g ? 'N' : 'B', band,
+        cell->arfcn, cell->pci, cell->rsrp, cell->rsrq, cell->sinr,
+        serving ? "true" : "false");
+}
+
 /* GET /api/cells - 获取小区信息 */
 void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_GET(c, hm);
@@ -389,108 +409,25 @@ void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
     char json[8192] = "{\"Code\":0,\"Error\":\"\",\"Data\":[";
     int json_len = strlen(json);
     int cell_count = 0;
+    SpengmdRat rat = is_5g ? SPENGMD_NR : SPENGMD_LTE;
+    SpengmdCell cells[SPENGMD_MAX_CELLS];
 
-    if (is_5g) {
-        /* 5G 主小区 */
-        if (execute_at("AT+SPENGMD=0,14,1", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
-            int rows = parse_cell_to_vec(result, data);
-            if (rows > 15) {
-                char cell_json[512];
-                snprintf(cell_json, sizeof(cell_json),
-                    "{\"rat\":\"5G\",\"band\":\"N%s\",\"arfcn\":%d,\"pci\":%d,"
-                    "\"rsrp\":%.2f,\"rsrq\":%.2f,\"sinr\":%.2f,\"isServing\":true}",
-                    data[0][0], atoi(data[1][0]), atoi(data[2][0]),
-                    atof(data[3][0]) / 100.0, atof(data[4][0]) / 100.0,
-                    atof(data[15][0]) / 100.0);
-                json_len += snprintf(json + json_len, sizeof(json) - json_len, "%s", cell_json);
-                cell_count++;
-            }
-            g_free(result);
-            result = NULL;
-        }
-
-        /* 5G 邻小区 */
-        if (execute_at("AT+SPENGMD=0,14,2", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
-            int rows = parse_cell_to_vec(result, data);
-            if (rows > 5) {
-                int col_count = 0;
-                for (int i = 0; i < 16 && data[0][i][0]; i++) col_count++;
-                for (int i = 0; i < col_count; i++) {
-                    int arfcn = atoi(data[1][i]);
-                    int pci = atoi(data[2][i]);
-                    if (arfcn == 0 || pci == 0) continue;
-                    
-                    /* 频段处理：如果为空或"0"，通过 ARFCN 推算 */
-                    const char *band_str = data[0][i];
-                    if (strlen(band_str) == 0 || strcmp(band_str, "0") == 0) {
-                        band_str = arfcn_to_nr_band(arfcn);
-                    }
-                    
-                    char cell_json[512];
-                    snprintf(cell_json, sizeof(cell_json),
-                        "%s{\"rat\":\"5G\",\"band\":\"N%s\",\"arfcn\":%d,\"pci\":%d,"
-                        "\"rsrp\":%.2f,\"rsrq\":%.2f,\"sinr\":%.2f,\"isServing\":false}",
-                        cell_count > 0 ? "," : "",
-                        band_str, arfcn, pci,
-                        atof(data[3][i]) / 100.0, atof(data[4][i]) / 100.0,
-                        atof(data[5][i]) / 100.0);
-                    json_len += snprintf(json + json_len, sizeof(json) - json_len, "%s", cell_json);
-                    cell_count++;
-                }
-            }
-            g_free(result);
-        }
-    } else {
-        /* 4G 主小区 */
-        if (execute_at("AT+SPENGMD=0,6,0", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
-            int rows = parse_cell_to_vec(result, data);
-            if (rows > 33) {
-                char cell_json[512];
-                snprintf(cell_json, sizeof(cell_json),
-                    "{\"rat\":\"4G\",\"band\":\"B%s\",\"arfcn\":%d,\"pci\":%d,"
-                    "\"rsrp\":%.2f,\"rsrq\":%.2f,\"sinr\":%.2f,\"isServing\":true}",
-                    data[0][0], atoi(data[1][0]), atoi(data[2][0]),
-                    atof(data[3][0]) / 100.0, atof(data[4][0]) / 100.0,
-                    atof(data[33][0]) / 100.0);
-                json_len += snprintf(json + json_len, sizeof(json) - json_len, "%s", cell_json);
-                cell_count++;
-            }
-            g_free(result);
-            result = NULL;
+    /* 主小区: 5G AT+SPENGMD=0,14,1, 4G AT+SPENGMD=0,6,0 */
+    if (execute_at(is_5g ? "AT+SPENGMD=0,14,1" : "AT+SPENGMD=0,6,0", &result) == 0 && result) {
+        if (spengmd_parse_serving(result, rat, &cells[0]) == 0) {
+            json_len = append_cell_json(json, sizeof(json), json_len, cell_count++, &cells[0], is_5g, 1);
         }
+        g_free(result);
+        result = NULL;
+    }
 
-        /* 4G 邻小区 */
-        if (execute_at("AT+SPENGMD=0,6,6", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
-            int rows = parse_cell_to_vec(result, data);
-            for (int i = 0; i < rows; i++) {
-                int arfcn = atoi(data[i][0]);
-                int pci = atoi(data[i][1]);
-                if (arfcn == 0 || pci == 0) continue;
-                
-                /* 频段处理：如果为空或"0"，通过 EARFCN 推算 */
-                const char *band = data[i][12];
-                if (strlen(band) == 0 || strcmp(band, "0") == 0) {
-                    band = earfcn_to_lte_band(arfcn);
-                    if (strlen(band) == 0) band = "0";  /* 未知频段默认显示0 */
-                }
-                
-                char cell_json[512];
-                snprintf(cell_json, sizeof(cell_json),
-                    "%s{\"rat\":\"4G\",\"band\":\"B%s\",\"arfcn\":%d,\"pci\":%d,"
-                    "\"rsrp\":%.2f,\"rsrq\":%.2f,\"sinr\":%.2f,\"isServing\":false}",
-                    cell_count > 0 ? "," : "",
-                    band, arfcn, pci,
-                    atof(data[i][2]) / 100.0, atof(data[i][3]) / 100.0,
-                    atof(data[i][6]) / 100.0);
-                json_len += snprintf(json + json_len, sizeof(json) - json_len, "%s", cell_json);
-                cell_count++;
-            }
-            g_free(result);
+    /* 邻小区: 5G AT+SPENGMD=0,14,2, 4G AT+SPENGMD=0,6,6 */
+    if (execute_at(is_5g ? "AT+SPENGMD=0,14,2" : "AT+SPENGMD=0,6,6", &result) == 0 && result) {
+        int n = spengmd_parse_neighbors(result, rat, cells, SPENGMD_MAX_CELLS);
+        for (int i = 0; i < n; i++) {
+            json_len = append_cell_json(json, sizeof(json), json_len, cell_count++, &cells[i], is_5g, 0);
         }
+        g_free(result);
     }
 
     snprintf(json + json_len, sizeof(json) - json_len, "]}");
@@ -7,69 +7,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include <glib.h>
-#include <gio/gio.h>
 #include "airplane.h"
 #include "sysinfo.h"
 #include "ofono.h"
+#include "dbus_core.h"
 
-int send_at(const char *cmd, char **result) {
-    GDBusConnection *conn = NULL;
-    GVariant *ret = NULL;
-    GError *error = NULL;
-    int rc = -1;
-    char slot[16], ril_path[32];
+/* 当前数据卡的 modem 路径, 未知时返回 NULL */
+static const char *current_modem_path(char *ril_path) {
+    char slot[16];
+    if (get_current_slot(slot, ril_path) != 0 || strcmp(ril_path, "unknown") == 0) return NULL;
+    return ril_path;
+}
 
+/* 经共享 D-Bus 连接与 AT 调度器发送 (dbus_core.h), 不再每次单独建立连接 */
+int send_at(const char *cmd, char **result) {
     if (!cmd || !result) return -1;
-    *result = NULL;
-
-    /* 获取当前 RIL 路径 */
-    if (get_current_slot(slot, ril_path) != 0 || strcmp(ril_path, "unknown") == 0) {
-        strcpy(ril_path, "/ril_0");  /* 默认使用 ril_0 */
-    }
-
-    /* 连接系统 D-Bus */
-    conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
-    if (!conn) {
-        if (error) g_error_free(error);
-        return -1;
-    }
-
-    /* 调用 SendAtcmd */
-    ret = g_dbus_connection_call_sync(
-        conn,
-        "org.ofono",
-        ril_path,
-        "org.ofono.Modem",
-        "SendAtcmd",
-        g_variant_new("(s)", cmd),
-        G_VARIANT_TYPE("(s)"),
-        G_DBUS_CALL_FLAGS_NONE,
-        8000,  /* 8秒超时 */
-        NULL,
-        &error
-    );
-
-    if (ret) {
-        const gchar *res_str = NULL;
-        g_variant_get(ret, "(s)", &res_str);
-        if (res_str) {
-            *result = g_strdup(res_str);
-            rc = 0;
-        }
-        g_variant_unref(ret);
-    }
-
-    if (error) g_error_free(error);
-    if (conn && G_IS_OBJECT(conn)) {
-        g_object_unref(conn);
-    }
-    return rc;
+    return execute_at(cmd, result);
 }
 
-
 int get_airplane_mode(void) {
     char *result = NULL;
+    char ril_path[32];
     int mode = -1;
+    int online;
+
+    /* 与 set_airplane_mode 一致: 飞行模式即 modem 离线 */
+    if (ofono_get_modem_online(current_modem_path(ril_path), &online) == 0) {
+        return online ? 0 : 1;
+    }
 
     if (send_at("AT+CFUN?", &result) == 0 && result) {
         if (strstr(result, "+CFUN: 0")) {
@@ -97,8 +62,13 @@ int set_airplane_mode(int enabled) {
 
 int get_iccid(char *iccid, size_t size) {
     char *result = NULL;
+    char ril_path[32];
     int rc = -1;
 
+    if (ofono_get_sim_identity(current_modem_path(ril_path), iccid, (int)size, NULL, 0) == 0) {
+        return 0;
+    }
+
     if (send_at("AT+CCID", &result) != 0 || !result) return -1;
 
     /* 解析 +CCID: "xxx" 或纯数字行 */
@@ -152,8 +122,14 @@ int get_iccid(char *iccid, size_t size) {
 
 int get_imei(char *imei, size_t size) {
     char *result = NULL;
+    char ril_path[32];
     int rc = -1;
 
+    /* oFono Modem.Serial 即 IMEI */
+    if (ofono_get_modem_serial(current_modem_path(ril_path), imei, (int)size) == 0) {
+        return 0;
+    }
+
     if (send_at("AT+SPIMEI?", &result) != 0 || !result) return -1;
 
     /* 解析响应，提取 15 位数字 */
@@ -200,8 +176,13 @@ int get_imei(char *imei, size_t size) {
 
 int get_imsi(char *imsi, size_t size) {
     char *result = NULL;
+    char ril_path[32];
     int rc = -1;
 
+    if (ofono_get_sim_identity(current_modem_path(ril_path), NULL, 0, imsi, (int)size) == 0) {
+        return 0;
+    }
+
     if (send_at("AT+CIMI", &result) != 0 || !result) return -1;
 
     /* 解析响应，提取 15 位数字 */
@@ -0,0 +1,579 @@
+/**
+ * @file at_sched.c
+ * @brief AT 命令调度器实现
+ *
+ * 任务 (AtJob) 对应一次 SendAtcmd, 等待方 (AtWaiter) 挂在任务上.
+ * 同步等待方在调用方栈上, 到期时自行从任务摘除; 异步等待方在堆上,
+ * 结果通过 g_idle_add 投递到主循环, 投递回调负责释放.
+ * 所有队列与等待方状态由 g_sched_mutex 保护.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <time.h>
+#include <glib.h>
+#include "at_sched.h"
+#include "http_utils.h"
+#include "json_writer.h"
+
+typedef enum {
+    WAITER_NEW = 0,             /* 尚未挂到任务 */
+    WAITER_QUEUED,              /* 等待任务完成 */
+    WAITER_DONE                 /* 已完成或已取消 */
+} WaiterState;
+
+typedef struct AtJob AtJob;
+
+typedef struct AtWaiter {
+    struct AtWaiter *next;
+    AtJob *job;
+    WaiterState state;
+    AtPriority prio;
+    int rc;
+    char *result;
+    char error[256];
+    /* 异步等待方 */
+    AtAsyncCallback cb;
+    void *user_data;
+    GCancellable *cancellable;
+    gulong cancel_id;
+    int cancelled;
+} AtWaiter;
+
+struct AtJob {
+    AtJob *next;
+    char *command;
+    AtPriority prio;
+    int coalescable;
+    int retry;
+    long long not_before_ms;    /* 忙重试前不出队 */
+    long long enqueue_ms;
+    AtWaiter *waiters;
+};
+
+/* 单优先级统计 */
+typedef struct {
+    unsigned long submitted;    /* 提交的调用数 (含合并) */
+    unsigned long coalesced;    /* 合并到已有任务的调用数 */
+    unsigned long executed;     /* 实际发送的命令数 */
+    unsigned long failed;
+    unsigned long timeouts;     /* 同步调用方期限到达 */
+    unsigned long cancelled;    /* 异步调用方取消 */
+    unsigned long retries;
+    int queued;                 /* 当前排队任务数 */
+    int max_queued;
+    long long wait_total_ms;
+    long long wait_max_ms;
+    long long exec_total_ms;
+    long long exec_max_ms;
+} AtClassStats;
+
+static const char *g_prio_names[AT_PRIO_COUNT] = {"interactive", "control", "background"};
+
+/*
+ * 可合并的只读命令. 以 '?' 结尾的查询命令总是可合并;
+ * prefix 为 1 时按前缀匹配, 否则须完全相同.
+ */
+static const struct {
+    const char *cmd;
+    int prefix;
+} g_read_commands[] = {
+    {"AT+SPENGMD=0,", 1},
+    {"AT+CGEQOSRDP",  0},
+    {"AT+SPLBAND=0",  0},
+    {"AT+SPLBAND=3",  0},
+    {"AT+CSQ",        0},
+    {"AT+CESQ",       0},
+    {"AT+CGSN",       0},
+    {"AT+CIMI",       0},
+    {"AT+CCID",       0},
+    {"ATI",           0},
+};
+
+static pthread_mutex_t g_sched_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_sched_once = PTHREAD_ONCE_INIT;
+static pthread_cond_t g_sched_cond;        /* 有新任务或停止 */
+static pthread_cond_t g_done_cond;         /* 有任务完成 */
+static pthread_t g_sched_thread;
+static int g_sched_running = 0;
+static int g_sched_stop = 0;
+static AtTransport g_transport = NULL;
+
+static AtJob *g_queues[AT_PRIO_COUNT];
+static AtJob *g_inflight = NULL;
+static long long g_inflight_start_ms = 0;
+static AtClassStats g_stats[AT_PRIO_COUNT];
+
+static __thread int g_thread_prio = AT_PRIO_INTERACTIVE;
+
+/* ==================== 内部函数 ==================== */
+
+/* 条件变量使用单调时钟, 只初始化一次 (停止后仍可能有调用方在等待) */
+static void sched_once_init(void) {
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_sched_cond, &attr);
+    pthread_cond_init(&g_done_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void ms_to_timespec(long long ms, struct timespec *ts) {
+    ts->tv_sec = ms / 1000;
+    ts->tv_nsec = (ms % 1000) * 1000000;
+}
+
+static int is_read_command(const char *cmd) {
+    size_t len = strlen(cmd);
+
+    if (len > 0 && cmd[len - 1] == '?') return 1;
+    for (size_t i = 0; i < sizeof(g_read_commands) / sizeof(g_read_commands[0]); i++) {
+        const char *r = g_read_commands[i].cmd;
+        if (g_read_commands[i].prefix ? strncasecmp(cmd, r, strlen(r)) == 0
+                                      : strcasecmp(cmd, r) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 以下函数需持有 g_sched_mutex */
+
+static void queue_append(AtJob *job) {
+    AtJob **pp = &g_queues[job->prio];
+    while (*pp) pp = &(*pp)->next;
+    job->next = NULL;
+    *pp = job;
+
+    AtClassStats *st = &g_stats[job->prio];
+    st->queued++;
+    if (st->queued > st->max_queued) st->max_queued = st->queued;
+}
+
+static void queue_push_front(AtJob *job) {
+    job->next = g_queues[job->prio];
+    g_queues[job->prio] = job;
+
+    AtClassStats *st = &g_stats[job->prio];
+    st->queued++;
+    if (st->queued > st->max_queued) st->max_queued = st->queued;
+}
+
+static int queue_remove(AtJob *job) {
+    for (AtJob **pp = &g_queues[job->prio]; *pp; pp = &(*pp)->next) {
+        if (*pp == job) {
+            *pp = job->next;
+            job->next = NULL;
+            g_stats[job->prio].queued--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static AtJob *find_coalescable(const char *command) {
+    if (g_inflight && g_inflight->coalescable && strcmp(g_inflight->command, command) == 0) {
+        return g_inflight;
+    }
+    for (int p = 0; p < AT_PRIO_COUNT; p++) {
+        for (AtJob *job = g_queues[p]; job; job = job->next) {
+            if (job->coalescable && strcmp(job->command, command) == 0) return job;
+        }
+    }
+    return NULL;
+}
+
+static void job_free(AtJob *job) {
+    g_free(job->command);
+    g_free(job);
+}
+
+static void waiter_unlink(AtWaiter *w) {
+    AtJob *job = w->job;
+
+    if (!job) return;
+    for (AtWaiter **pp = &job->waiters; *pp; pp = &(*pp)->next) {
+        if (*pp == w) {
+            *pp = w->next;
+            break;
+        }
+    }
+    w->next = NULL;
+    w->job = NULL;
+
+    /* 排队中的任务已无人等待时丢弃, 执行中的任务照常完成 */
+    if (!job->waiters && job != g_inflight && queue_remove(job)) {
+        job_free(job);
+    }
+}
+
+/* 异步结果投递 (主循环线程) */
+static gboolean deliver_async(gpointer user_data) {
+    AtWaiter *w = (AtWaiter *)user_data;
+
+    if (w->cancellable) {
+        g_cancellable_disconnect(w->cancellable, w->cancel_id);
+        g_object_unref(w->cancellable);
+    }
+    w->cb(w->rc, w->result, w->rc == 0 ? NULL : w->error, w->user_data);
+    g_free(w->result);
+    g_free(w);
+    return G_SOURCE_REMOVE;
+}
+
+/* 完成一个等待方 (需持锁) */
+static void waiter_finish(AtWaiter *w, int rc, const char *result, const char *error) {
+    w->state = WAITER_DONE;
+    w->rc = rc;
+    w->result = rc == 0 ? g_strdup(result ? result : "") : NULL;
+    g_strlcpy(w->error, error ? error : "", sizeof(w->error));
+    if (w->cb) g_idle_add(deliver_async, w);
+}
+
+/* 异步等待方被取消, 可能在任意线程触发 */
+static void on_waiter_cancelled(GCancellable *cancellable, gpointer user_data) {
+    AtWaiter *w = (AtWaiter *)user_data;
+    (void)cancellable;
+
+    pthread_mutex_lock(&g_sched_mutex);
+    w->cancelled = 1;
+    if (w->state == WAITER_QUEUED) {
+        g_stats[w->prio].cancelled++;
+        waiter_unlink(w);
+        waiter_finish(w, -2, NULL, "已取消");
+    }
+    pthread_mutex_unlock(&g_sched_mutex);
+}
+
+/* 挂到已有任务或新建任务 (需持锁) */
+static void attach_waiter(const char *command, AtWaiter *w) {
+    int coalescable = is_read_command(command);
+    AtJob *job = coalescable ? find_coalescable(command) : NULL;
+    AtClassStats *st = &g_stats[w->prio];
+
+    st->submitted++;
+    if (job) {
+        st->coalesced++;
+        /* 高优先级调用方合并到低优先级排队任务时提升任务优先级 */
+        if (job != g_inflight && w->prio < job->prio) {
+            queue_remove(job);
+            job->prio = w->prio;
+            queue_append(job);
+        }
+    } else {
+        job = g_new0(AtJob, 1);
+        job->command = g_strdup(command);
+        job->prio = w->prio;
+        job->coalescable = coalescable;
+        job->enqueue_ms = now_ms();
+        queue_append(job);
+        pthread_cond_signal(&g_sched_cond);
+    }
+
+    /* 按到达顺序完成 */
+    AtWaiter **pp = &job->waiters;
+    while (*pp) pp = &(*pp)->next;
+    w->job = job;
+    w->state = WAITER_QUEUED;
+    w->next = NULL;
+    *pp = w;
+}
+
+/* 取出可执行的最高优先级任务, 没有时返回 NULL 并给出下次检查时间 */
+static AtJob *take_next(long long now, long long *wake_ms) {
+    *wake_ms = -1;
+    for (int p = 0; p < AT_PRIO_COUNT; p++) {
+        for (AtJob *job = g_queues[p]; job; job = job->next) {
+            if (job->not_before_ms <= now) {
+                queue_remove(job);
+                return job;
+            }
+            if (*wake_ms < 0 || job->not_before_ms < *wake_ms) *wake_ms = job->not_before_ms;
+        }
+    }
+    return NULL;
+}
+
+/* 以相同结果完成任务的所有等待方并释放任务 (需持锁) */
+static void job_complete(AtJob *job, int rc, const char *result, const char *error) {
+    AtWaiter *w = job->waiters;
+
+    job->waiters = NULL;
+    while (w) {
+        AtWaiter *next = w->next;
+        w->next = NULL;
+        w->job = NULL;
+        waiter_finish(w, rc, result, error);
+        w = next;
+    }
+    job_free(job);
+    pthread_cond_broadcast(&g_done_cond);
+}
+
+static void *sched_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_sched_mutex);
+    while (!g_sched_stop) {
+        long long now = now_ms();
+        long long wake_ms;
+        AtJob *job = take_next(now, &wake_ms);
+
+        if (!job) {
+            if (wake_ms < 0) {
+                pthread_cond_wait(&g_sched_cond, &g_sched_mutex);
+            } else {
+                struct timespec ts;
+                ms_to_timespec(wake_ms, &ts);
+                pthread_cond_timedwait(&g_sched_cond, &g_sched_mutex, &ts);
+            }
+            continue;
+        }
+
+        AtClassStats *st = &g_stats[job->prio];
+        long long wait = now - job->enqueue_ms;
+        st->wait_total_ms += wait;
+        if (wait > st->wait_max_ms) st->wait_max_ms = wait;
+
+        g_inflight = job;
+        g_inflight_start_ms = now;
+        pthread_mutex_unlock(&g_sched_mutex);
+
+        char *result = NULL;
+        char error[256] = {0};
+        int rc = g_transport(job->command, &result, error, sizeof(error));
+
+        pthread_mutex_lock(&g_sched_mutex);
+        long long exec = now_ms() - g_inflight_start_ms;
+        g_inflight = NULL;
+        st = &g_stats[job->prio];
+        st->executed++;
+        st->exec_total_ms += exec;
+        if (exec > st->exec_max_ms) st->exec_max_ms = exec;
+
+        if (rc == AT_TRANSPORT_BUSY && job->retry < AT_SCHED_MAX_RETRIES && job->waiters) {
+            /* 延后重试, 不占用调度线程 */
+            job->retry++;
+            st->retries++;
+            job->not_before_ms = now_ms() + AT_SCHED_RETRY_DELAY_MS;
+            queue_push_front(job);
+        } else if (!job->waiters) {
+            /* 所有等待方都已超时或取消 */
+            job_free(job);
+        } else {
+            if (rc != AT_TRANSPORT_OK) st->failed++;
+            job_complete(job, rc == AT_TRANSPORT_OK ? 0 : -1, result, error);
+        }
+        g_free(result);
+    }
+
+    /* 停止: 排队中的任务以失败完成 */
+    for (int p = 0; p < AT_PRIO_COUNT; p++) {
+        while (g_queues[p]) {
+            AtJob *job = g_queues[p];
+            queue_remove(job);
+            job_complete(job, -1, NULL, "AT 调度器已停止");
+        }
+    }
+    pthread_mutex_unlock(&g_sched_mutex);
+    return NULL;
+}
+
+/* ==================== 公共接口 ==================== */
+
+int at_sched_start(AtTransport transport) {
+    int ret = 0;
+
+    pthread_once(&g_sched_once, sched_once_init);
+
+    pthread_mutex_lock(&g_sched_mutex);
+    if (g_sched_running) {
+        pthread_mutex_unlock(&g_sched_mutex);
+        return 0;
+    }
+
+    g_transport = transport;
+    g_sched_stop = 0;
+    if (pthread_create(&g_sched_thread, NULL, sched_thread, NULL) != 0) {
+        printf("[AT] 创建调度线程失败\n");
+        ret = -1;
+    } else {
+        g_sched_running = 1;
+        printf("[AT] 调度线程已启动\n");
+    }
+    pthread_mutex_unlock(&g_sched_mutex);
+    return ret;
+}
+
+void at_sched_stop(void) {
+    pthread_mutex_lock(&g_sched_mutex);
+    if (!g_sched_running) {
+        pthread_mutex_unlock(&g_sched_mutex);
+        return;
+    }
+    g_sched_stop = 1;
+    pthread_cond_signal(&g_sched_cond);
+    pthread_mutex_unlock(&g_sched_mutex);
+
+    pthread_join(g_sched_thread, NULL);
+
+    pthread_mutex_lock(&g_sched_mutex);
+    g_sched_running = 0;
+    pthread_mutex_unlock(&g_sched_mutex);
+    printf("[AT] 调度线程已停止\n");
+}
+
+void at_sched_set_thread_priority(AtPriority prio) {
+    if (prio >= 0 && prio < AT_PRIO_COUNT) g_thread_prio = prio;
+}
+
+AtPriority at_sched_thread_priority(void) {
+    return (AtPriority)g_thread_prio;
+}
+
+int at_sched_execute(const char *command, AtPriority prio, int deadline_ms,
+                     char **result, char *error, size_t error_size) {
+    AtWaiter w;
+    struct timespec ts;
+    int rc;
+
+    *result = NULL;
+    if (prio < 0 || prio >= AT_PRIO_COUNT) prio = AT_PRIO_INTERACTIVE;
+    if (deadline_ms <= 0) deadline_ms = AT_SCHED_DEFAULT_DEADLINE_MS;
+    memset(&w, 0, sizeof(w));
+    w.prio = prio;
+
+    pthread_mutex_lock(&g_sched_mutex);
+    if (!g_sched_running || g_sched_stop) {
+        pthread_mutex_unlock(&g_sched_mutex);
+        g_strlcpy(error, "AT 调度器未启动", error_size);
+        return -1;
+    }
+
+    attach_waiter(command, &w);
+    ms_to_timespec(now_ms() + deadline_ms, &ts);
+    while (w.state != WAITER_DONE) {
+        if (pthread_cond_timedwait(&g_done_cond, &g_sched_mutex, &ts) != 0 &&
+            w.state != WAITER_DONE) {
+            g_stats[prio].timeouts++;
+            waiter_unlink(&w);
+            pthread_mutex_unlock(&g_sched_mutex);
+            snprintf(error, error_size, "AT 命令等待超时 (%d ms): %s", deadline_ms, command);
+            return -1;
+        }
+    }
+    pthread_mutex_unlock(&g_sched_mutex);
+
+    rc = w.rc;
+    if (rc == 0) {
+        *result = w.result;
+    } else {
+        g_strlcpy(error, w.error, error_size);
+    }
+    return rc;
+}
+
+int at_sched_submit_async(const char *command, AtPriority prio, GCancellable *cancellable,
+                          AtAsyncCallback cb, void *user_data) {
+    AtWaiter *w;
+
+    if (prio < 0 || prio >= AT_PRIO_COUNT) prio = AT_PRIO_INTERACTIVE;
+
+    w = g_new0(AtWaiter, 1);
+    w->prio = prio;
+    w->cb = cb;
+    w->user_data = user_data;
+    if (cancellable) {
+        /* 在加锁前连接: 已取消时处理函数会立即执行 */
+        w->cancellable = g_object_ref(cancellable);
+        w->cancel_id = g_cancellable_connect(cancellable, G_CALLBACK(on_waiter_cancelled), w, NULL);
+    }
+
+    pthread_mutex_lock(&g_sched_mutex);
+    if (!g_sched_running || g_sched_stop) {
+        pthread_mutex_unlock(&g_sched_mutex);
+        if (w->cancellable) {
+            g_cancellable_disconnect(w->cancellable, w->cancel_id);
+            g_object_unref(w->cancellable);
+        }
+        g_free(w);
+        return -1;
+    }
+    if (w->cancelled) {
+        g_stats[prio].submitted++;
+        g_stats[prio].cancelled++;
+        waiter_finish(w, -2, NULL, "已取消");
+    } else {
+        attach_waiter(command, w);
+    }
+    pthread_mutex_unlock(&g_sched_mutex);
+    return 0;
+}
+
+/* GET /api/at/stats - 各优先级排队深度、合并次数与等待/执行耗时 */
+void handle_at_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    AtClassStats stats[AT_PRIO_COUNT];
+    char inflight[128] = {0};
+    long long inflight_ms = 0;
+
+    pthread_mutex_lock(&g_sched_mutex);
+    memcpy(stats, g_stats, sizeof(stats));
+    if (g_inflight) {
+        g_strlcpy(inflight, g_inflight->command, sizeof(inflight));
+        inflight_ms = now_ms() - g_inflight_start_ms;
+    }
+    pthread_mutex_unlock(&g_sched_mutex);
+
+    JsonWriter w;
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    if (inflight[0]) {
+        json_kv_str(&w, "inflight", inflight);
+        json_kv_int(&w, "inflight_ms", inflight_ms);
+    } else {
+        json_kv_null(&w, "inflight");
+        json_kv_int(&w, "inflight_ms", 0);
+    }
+    json_key(&w, "classes");
+    json_arr_begin(&w);
+    for (int p = 0; p < AT_PRIO_COUNT; p++) {
+        AtClassStats *st = &stats[p];
+        unsigned long n = st->executed ? st->executed : 1;
+        json_obj_begin(&w);
+        json_kv_str(&w, "name", g_prio_names[p]);
+        json_kv_uint(&w, "submitted", st->submitted);
+        json_kv_uint(&w, "coalesced", st->coalesced);
+        json_kv_uint(&w, "executed", st->executed);
+        json_kv_uint(&w, "failed", st->failed);
+        json_kv_uint(&w, "timeouts", st->timeouts);
+        json_kv_uint(&w, "cancelled", st->cancelled);
+        json_kv_uint(&w, "retries", st->retries);
+        json_kv_int(&w, "queued", st->queued);
+        json_kv_int(&w, "max_queued", st->max_queued);
+        json_kv_double(&w, "avg_wait_ms", (double)st->wait_total_ms / n, 1);
+        json_kv_int(&w, "max_wait_ms", st->wait_max_ms);
+        json_kv_double(&w, "avg_exec_ms", (double)st->exec_total_ms / n, 1);
+        json_kv_int(&w, "max_exec_ms", st->exec_max_ms);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_obj_end(&w);
+    json_obj_end(&w);
+    json_end(&w);
+}
@@ -1,6 +1,6 @@
 /**
  * @file auth.c
- * @brief 后台认证模块实现 - 支持多Token (CLI 适配版)
+ * @brief 后台认证模块实现 - 支持多Token (内存会话表 + 后台持久化)
  */
 
 #include <stdio.h>
@@ -9,6 +9,7 @@
 #include <time.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 #include "auth.h"
 #include "sha256.h"
 #include "database.h"
@@ -19,6 +20,9 @@ extern int run_command(char *output, size_t output_size, const char *cmd, ...);
 /* 配置键名 */
 #define KEY_PASSWORD_HASH   "auth_password_hash"
 
+/* 新增/过期的会话延迟写回, 同一时间段内的多次登录合并为一次事务 */
+#define AUTH_PERSIST_DELAY_S    60
+
 /**
  * 生成随机Token
  */
@@ -62,33 +66,171 @@ static int verify_password(const char *password)
     return (strcmp(stored_hash, input_hash) == 0) ? 0 : -1;
 }
 
+/*============================================================================
+ * 内存会话表
+ *
+ * Token 集合常驻内存, 校验只做内存比较. 修改后标记为脏, 由后台线程
+ * 将整个会话表快照写回 auth_tokens 表.
+ *============================================================================*/
+
+typedef struct {
+    char token[AUTH_TOKEN_SIZE];
+    long long expire_time;
+    long long created_at;
+    int used;
+} AuthSession;
+
+static AuthSession g_sessions[AUTH_MAX_TOKENS];
+static pthread_mutex_t g_session_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* 后台持久化 */
+static pthread_t g_persist_thread;
+static pthread_cond_t g_persist_cond;
+static int g_persist_dirty = 0;
+static int g_persist_urgent = 0;    /* 注销/改密: 立即写回, 重启后旧Token不能复活 */
+static int g_persist_running = 0;
+
 /**
- * 清理过期Token
+ * 常量时间比较, 耗时与内容无关
+ * @return 0相同, 非0不同
  */
-static int cleanup_expired_tokens(void)
+static int token_compare(const char *a, const char *b)
 {
-    char sql[256];
-    long long now = (long long)time(NULL);
-    snprintf(sql, sizeof(sql), "DELETE FROM auth_tokens WHERE expire_time <= %lld;", now);
-    return db_execute_safe(sql);
+    unsigned char diff = 0;
+    for (int i = 0; i < AUTH_TOKEN_SIZE - 1; i++) {
+        diff |= (unsigned char)a[i] ^ (unsigned char)b[i];
+    }
+    return diff;
 }
 
 /**
- * 获取当前Token数量
+ * 将输入规范为定长 Token, 长度不符时返回-1
  */
-static int get_token_count(void)
+static int token_normalize(const char *src, char *dst)
 {
-    return db_query_int("SELECT COUNT(*) FROM auth_tokens;", 0);
+    size_t len = strnlen(src, AUTH_TOKEN_SIZE);
+    if (len != AUTH_TOKEN_SIZE - 1) return -1;
+    memcpy(dst, src, AUTH_TOKEN_SIZE);
+    return 0;
 }
 
-/**
- * 删除最早的Token
- */
-static int delete_oldest_token(void)
+/* 清理过期会话 (需持有锁), 返回清理数量 */
+static int sessions_expire(long long now)
+{
+    int removed = 0;
+    for (int i = 0; i < AUTH_MAX_TOKENS; i++) {
+        if (g_sessions[i].used && g_sessions[i].expire_time <= now) {
+            memset(&g_sessions[i], 0, sizeof(AuthSession));
+            removed++;
+        }
+    }
+    return removed;
+}
+
+/* 标记会话表需要写回 (需持有锁) */
+static void sessions_mark_dirty(int urgent)
+{
+    g_persist_dirty = 1;
+    if (urgent) g_persist_urgent = 1;
+    pthread_cond_signal(&g_persist_cond);
+}
+
+/* 将快照写入 auth_tokens (不持有会话锁), 任一语句失败则整体回滚 */
+static int sessions_write(const AuthSession *snap, int count)
+{
+    if (db_begin() != 0) return -1;
+
+    if (db_exec_bind("DELETE FROM auth_tokens;", NULL) < 0) {
+        db_rollback();
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (db_insert_bind("INSERT INTO auth_tokens (token, expire_time, created_at) VALUES (?, ?, ?);",
+                           "sll", snap[i].token, snap[i].expire_time, snap[i].created_at) <= 0) {
+            db_rollback();
+            return -1;
+        }
+    }
+    return db_commit();
+}
+
+/* 写回一次 (调用方持有锁, 写库期间释放) */
+static void sessions_flush_locked(void)
+{
+    AuthSession snap[AUTH_MAX_TOKENS];
+    int count = 0;
+
+    for (int i = 0; i < AUTH_MAX_TOKENS; i++) {
+        if (g_sessions[i].used) snap[count++] = g_sessions[i];
+    }
+    g_persist_dirty = 0;
+    g_persist_urgent = 0;
+    pthread_mutex_unlock(&g_session_mutex);
+
+    int ret = sessions_write(snap, count);
+
+    pthread_mutex_lock(&g_session_mutex);
+    if (ret != 0) {
+        /* 数据库中仍是上一次的快照, 延迟后重试 */
+        printf("[AUTH] 会话写回数据库失败\n");
+        g_persist_dirty = 1;
+    }
+}
+
+static void *persist_thread(void *arg)
 {
-    return db_execute_safe(
-        "DELETE FROM auth_tokens WHERE id = "
-        "(SELECT id FROM auth_tokens ORDER BY created_at ASC LIMIT 1);");
+    (void)arg;
+
+    pthread_mutex_lock(&g_session_mutex);
+    while (g_persist_running) {
+        while (g_persist_running && !g_persist_dirty) {
+            pthread_cond_wait(&g_persist_cond, &g_session_mutex);
+        }
+        if (g_persist_running && !g_persist_urgent) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ts.tv_sec += AUTH_PERSIST_DELAY_S;
+            while (g_persist_running && !g_persist_urgent) {
+                if (pthread_cond_timedwait(&g_persist_cond, &g_session_mutex, &ts) != 0) break;
+            }
+        }
+        if (g_persist_dirty) {
+            sessions_flush_locked();
+        }
+    }
+    pthread_mutex_unlock(&g_session_mutex);
+    return NULL;
+}
+
+/* 从数据库加载未过期会话 */
+static void sessions_load(void)
+{
+    char sql[256];
+    char rows[2048] = {0};
+    char *saveptr = NULL;
+    long long now = (long long)time(NULL);
+    int n = 0;
+
+    snprintf(sql, sizeof(sql),
+        "SELECT token, expire_time, created_at FROM auth_tokens "
+        "WHERE expire_time > %lld ORDER BY created_at DESC LIMIT %d;", now, AUTH_MAX_TOKENS);
+    if (db_query_rows(sql, "|", rows, sizeof(rows)) != 0) return;
+
+    pthread_mutex_lock(&g_session_mutex);
+    for (char *line = strtok_r(rows, "\n", &saveptr); line && n < AUTH_MAX_TOKENS;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        AuthSession *s = &g_sessions[n];
+        if (sscanf(line, "%64[0-9a-f]|%lld|%lld", s->token, &s->expire_time, &s->created_at) == 3 &&
+            strlen(s->token) == AUTH_TOKEN_SIZE - 1) {
+            s->used = 1;
+            n++;
+        } else {
+            memset(s, 0, sizeof(AuthSession));
+        }
+    }
+    pthread_mutex_unlock(&g_session_mutex);
+
+    printf("[AUTH] 已加载 %d 个会话\n", n);
 }
 
 int auth_init(void)
@@ -101,65 +243,103 @@ int auth_init(void)
         config_set(KEY_PASSWORD_HASH, hash);
     }
     
-    cleanup_expired_tokens();
+    sessions_load();
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_persist_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    /* 启动时写回一次, 顺带清除库中的过期Token */
+    pthread_mutex_lock(&g_session_mutex);
+    g_persist_running = 1;
+    g_persist_dirty = 1;
+    pthread_mutex_unlock(&g_session_mutex);
+    if (pthread_create(&g_persist_thread, NULL, persist_thread, NULL) != 0) {
+        printf("[AUTH] 持久化线程创建失败\n");
+        pthread_mutex_lock(&g_session_mutex);
+        g_persist_running = 0;
+        sessions_flush_locked();
+        pthread_mutex_unlock(&g_session_mutex);
+    }
+
     printf("[AUTH] 认证模块初始化完成\n");
     return 0;
 }
 
+void auth_deinit(void)
+{
+    pthread_mutex_lock(&g_session_mutex);
+    if (!g_persist_running) {
+        pthread_mutex_unlock(&g_session_mutex);
+        return;
+    }
+    g_persist_running = 0;
+    pthread_cond_signal(&g_persist_cond);
+    pthread_mutex_unlock(&g_session_mutex);
+
+    /* 线程退出前会写回未落盘的修改 */
+    pthread_join(g_persist_thread, NULL);
+    pthread_cond_destroy(&g_persist_cond);
+}
+
 int auth_login(const char *password, char *token, size_t token_size)
 {
-    char sql[512];
-    long long now, expire_time;
-    int count;
+    long long now;
+    int slot = -1;
     
     if (!password || !token || token_size < AUTH_TOKEN_SIZE) return -2;
     
     if (verify_password(password) != 0) return -1;
     
-    cleanup_expired_tokens();
-    
-    count = get_token_count();
-    while (count >= AUTH_MAX_TOKENS && count > 0) {
-        delete_oldest_token();
-        count--;
-    }
-    
     if (generate_token(token, token_size) != 0) return -2;
     
     now = (long long)time(NULL);
-    expire_time = now + AUTH_TOKEN_EXPIRE_SECONDS;
-    
-    /* 注意：token 是 hex 格式，不含特殊字符，直接拼接到 SQL 是安全的 */
-    snprintf(sql, sizeof(sql),
-        "INSERT INTO auth_tokens (token, expire_time, created_at) VALUES ('%s', %lld, %lld);",
-        token, expire_time, now);
-    
-    if (db_execute_safe(sql) != 0) return -2;
+
+    pthread_mutex_lock(&g_session_mutex);
+    sessions_expire(now);
+
+    /* 优先使用空位, 已满时替换最早创建的Token */
+    for (int i = 0; i < AUTH_MAX_TOKENS; i++) {
+        if (!g_sessions[i].used) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || g_sessions[i].created_at < g_sessions[slot].created_at) {
+            slot = i;
+        }
+    }
+
+    memcpy(g_sessions[slot].token, token, AUTH_TOKEN_SIZE);
+    g_sessions[slot].expire_time = now + AUTH_TOKEN_EXPIRE_SECONDS;
+    g_sessions[slot].created_at = now;
+    g_sessions[slot].used = 1;
+    sessions_mark_dirty(0);
+    pthread_mutex_unlock(&g_session_mutex);
     
     return 0;
 }
 
 int auth_verify_token(const char *token)
 {
-    char sql[512];
+    char input[AUTH_TOKEN_SIZE];
     long long now;
-    char escaped_token[128];
+    int found = 0;
     
-    if (!token || strlen(token) == 0) return -1;
+    if (!token || token_normalize(token, input) != 0) return -1;
     
     now = (long long)time(NULL);
-    db_escape_string(token, escaped_token, sizeof(escaped_token));
-    
-    snprintf(sql, sizeof(sql), 
-        "SELECT COUNT(*) FROM auth_tokens WHERE token = '%s' AND expire_time > %lld;", 
-        escaped_token, now);
-    
-    if (db_query_int(sql, 0) > 0) {
-        return 0;
+
+    pthread_mutex_lock(&g_session_mutex);
+    /* 遍历全部槽位, 不提前退出 */
+    for (int i = 0; i < AUTH_MAX_TOKENS; i++) {
+        int match = token_compare(g_sessions[i].token, input) == 0;
+        found |= match & g_sessions[i].used & (g_sessions[i].expire_time > now);
     }
-    
-    cleanup_expired_tokens();
-    return -1;
+    pthread_mutex_unlock(&g_session_mutex);
+
+    return found ? 0 : -1;
 }
 
 int auth_change_password(const char *old_password, const char *new_password)
@@ -173,30 +353,47 @@ int auth_change_password(const char *old_password, const char *new_password)
     sha256_hash_string(new_password, new_hash);
     if (config_set(KEY_PASSWORD_HASH, new_hash) != 0) return -2;
     
-    db_execute_safe("DELETE FROM auth_tokens;");
+    pthread_mutex_lock(&g_session_mutex);
+    memset(g_sessions, 0, sizeof(g_sessions));
+    sessions_mark_dirty(1);
+    pthread_mutex_unlock(&g_session_mutex);
     return 0;
 }
 
 int auth_logout(const char *token)
 {
-    char sql[256];
-    char escaped_token[128];
+    char input[AUTH_TOKEN_SIZE];
     
     if (!token || strlen(token) == 0) return -1;
+    if (token_normalize(token, input) != 0) return 0;
     
-    db_escape_string(token, escaped_token, sizeof(escaped_token));
-    snprintf(sql, sizeof(sql), "DELETE FROM auth_tokens WHERE token = '%s';", escaped_token);
-    db_execute_safe(sql);
+    pthread_mutex_lock(&g_session_mutex);
+    for (int i = 0; i < AUTH_MAX_TOKENS; i++) {
+        if (g_sessions[i].used && token_compare(g_sessions[i].token, input) == 0) {
+            memset(&g_sessions[i], 0, sizeof(AuthSession));
+            sessions_mark_dirty(1);
+        }
+    }
+    pthread_mutex_unlock(&g_session_mutex);
     
     return 0;
 }
 
 int auth_get_status(int *logged_in)
 {
+    long long now = (long long)time(NULL);
+
     if (!logged_in) return -1;
     *logged_in = 0;
-    cleanup_expired_tokens();
-    if (get_token_count() > 0) *logged_in = 1;
+
+    pthread_mutex_lock(&g_session_mutex);
+    for (int i = 0; i < AUTH_MAX_TOKENS; i++) {
+        if (g_sessions[i].used && g_sessions[i].expire_time > now) {
+            *logged_in = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_session_mutex);
     return 0;
 }
 
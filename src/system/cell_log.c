@@ -0,0 +1,670 @@
+/**
+ * @file cell_log.c
+ * @brief 小区测量记录实现
+ *
+ * 记录文件整体 mmap (MAP_SHARED), 写入只是内存拷贝, 由内核回写到闪存,
+ * 同一页内的多条记录合并为一次写. 文件头保存下一条序号, 启动时若发现
+ * 头部落后于已写入的记录 (写完记录后掉电), 按记录序号向前修正.
+ * 清空只移动起始序号, 不擦写整个文件.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include "mongoose.h"
+#include "cell_log.h"
+#include "spengmd.h"
+#include "ofono.h"
+#include "dbus_core.h"
+#include "at_sched.h"
+#include "history.h"
+#include "database.h"
+#include "storage_io.h"
+#include "json_writer.h"
+#include "http_utils.h"
+
+#define CELL_LOG_MAGIC      0x474f4c43      /* "CLOG" */
+#define CELL_LOG_VERSION    1
+
+/* 导出: 发送缓冲低于该值时读取下一批 */
+#define CELL_LOG_EXPORT_LOW_WATER   (16 * 1024)
+#define CELL_LOG_EXPORT_BATCH       8192
+#define CELL_LOG_EXPORT_LINE_MAX    1024
+
+/* 文件头, 占用第 0 个记录槽位 */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t capacity;
+    uint32_t next_seq;          /* 下一条记录序号 */
+    uint32_t first_seq;         /* 清空后的起始序号 */
+    uint8_t reserved[108];
+} CellLogHeader;
+
+typedef char cell_log_record_size_check[sizeof(CellLogRecord) == 128 ? 1 : -1];
+typedef char cell_log_header_size_check[sizeof(CellLogHeader) == sizeof(CellLogRecord) ? 1 : -1];
+
+/* 导出进度, 保存在 c->pfn_data */
+typedef struct {
+    uint32_t next;              /* 下一条待发送序号 */
+    uint32_t end;               /* 导出开始时的 next_seq, 之后的记录不导出 */
+    long long from;
+    long long to;
+    int ndjson;
+    mg_event_handler_t saved_pfn;
+    void *saved_pfn_data;
+} CellLogExport;
+
+/* 记录文件 (g_log_mutex 保护) */
+static pthread_mutex_t g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static void *g_map = NULL;
+static size_t g_map_size = 0;
+static CellLogHeader *g_header = NULL;
+static CellLogRecord *g_records = NULL;
+
+/* 采样线程 (g_sampler_mutex 保护) */
+static pthread_mutex_t g_sampler_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_sampler_cond;
+static pthread_t g_sampler_thread;
+static int g_sampler_stop = 0;
+static int g_sampler_running = 0;
+static int g_enabled = 0;
+static int g_interval = CELL_LOG_INTERVAL_DEFAULT;
+static int g_config_changed = 0;
+
+/* 上一条记录, 用于检测切换 (仅采样线程访问) */
+static CellLogRecord g_prev;
+static int g_prev_valid = 0;
+
+/* ==================== 记录文件 ==================== */
+
+static uint32_t oldest_seq(void) {
+    uint32_t next = g_header->next_seq;
+    uint32_t oldest = next > CELL_LOG_CAPACITY ? next - CELL_LOG_CAPACITY : 1;
+    return g_header->first_seq > oldest ? g_header->first_seq : oldest;
+}
+
+static CellLogRecord *slot_of(uint32_t seq) {
+    return &g_records[(seq - 1) % CELL_LOG_CAPACITY];
+}
+
+static int header_valid(const CellLogHeader *h) {
+    return h->magic == CELL_LOG_MAGIC && h->version == CELL_LOG_VERSION &&
+           h->record_size == sizeof(CellLogRecord) && h->capacity == CELL_LOG_CAPACITY &&
+           h->next_seq >= 1 && h->first_seq >= 1 && h->first_seq <= h->next_seq;
+}
+
+/* 打开并映射记录文件, 格式不符时重建 (需持有 g_log_mutex) */
+static int open_log_file(void) {
+    size_t size = sizeof(CellLogRecord) * ((size_t)CELL_LOG_CAPACITY + 1);
+    CellLogHeader header;
+    struct stat st;
+    int valid = 0;
+    void *map;
+    int fd;
+
+    fd = open(CELL_LOG_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        printf("[CELL_LOG] 打开 %s 失败: %s\n", CELL_LOG_PATH, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == size &&
+        pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) {
+        valid = header_valid(&header);
+    }
+
+    /* 重建时先截断, 旧内容不会被误认为有效记录 (扩展部分为稀疏空洞) */
+    if (!valid && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0)) {
+        printf("[CELL_LOG] 创建记录文件失败: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("[CELL_LOG] mmap 失败: %s\n", strerror(errno));
+        return -1;
+    }
+
+    g_map = map;
+    g_map_size = size;
+    g_header = (CellLogHeader *)map;
+    g_records = (CellLogRecord *)map + 1;
+
+    if (!valid) {
+        memset(g_header, 0, sizeof(*g_header));
+        g_header->magic = CELL_LOG_MAGIC;
+        g_header->version = CELL_LOG_VERSION;
+        g_header->record_size = sizeof(CellLogRecord);
+        g_header->capacity = CELL_LOG_CAPACITY;
+        g_header->next_seq = 1;
+        g_header->first_seq = 1;
+        printf("[CELL_LOG] 已创建记录文件 %s (%zu 字节)\n", CELL_LOG_PATH, size);
+        return 0;
+    }
+
+    /* 记录已写入但文件头未回写 */
+    while (slot_of(g_header->next_seq)->seq == g_header->next_seq) {
+        g_header->next_seq++;
+    }
+    printf("[CELL_LOG] 已打开记录文件, 共 %u 条\n", g_header->next_seq - oldest_seq());
+    return 0;
+}
+
+static void close_log_file(void) {
+    if (!g_map) return;
+    msync(g_map, g_map_size, MS_SYNC);
+    storage_account(STORAGE_CELL_LOG, 0, 1);
+    munmap(g_map, g_map_size);
+    g_map = NULL;
+    g_header = NULL;
+    g_records = NULL;
+}
+
+/* 追加一条记录, 填写序号 */
+static void append_record(CellLogRecord *rec) {
+    CellLogRecord *slot;
+
+    pthread_mutex_lock(&g_log_mutex);
+    if (!g_header) {
+        pthread_mutex_unlock(&g_log_mutex);
+        return;
+    }
+    rec->seq = g_header->next_seq;
+    slot = slot_of(rec->seq);
+
+    /* 先清序号再写内容, 序号最后写入 */
+    slot->seq = 0;
+    __sync_synchronize();
+    memcpy((char *)slot + sizeof(slot->seq), (const char *)rec + sizeof(rec->seq),
+           sizeof(*rec) - sizeof(rec->seq));
+    __sync_synchronize();
+    slot->seq = rec->seq;
+    g_header->next_seq = rec->seq + 1;
+    pthread_mutex_unlock(&g_log_mutex);
+
+    /* 记录与文件头中的序号 (回写时按页合并, 这里按逻辑字节计) */
+    storage_account(STORAGE_CELL_LOG, sizeof(*rec) + sizeof(g_header->next_seq), 0);
+}
+
+int cell_log_read(uint32_t seq, CellLogRecord *rec) {
+    int ret = -1;
+
+    pthread_mutex_lock(&g_log_mutex);
+    if (g_header && seq >= oldest_seq() && seq < g_header->next_seq) {
+        *rec = *slot_of(seq);
+        ret = rec->seq == seq ? 0 : -1;
+    }
+    pthread_mutex_unlock(&g_log_mutex);
+    return ret;
+}
+
+void cell_log_range(uint32_t *oldest, uint32_t *next) {
+    pthread_mutex_lock(&g_log_mutex);
+    if (g_header) {
+        *oldest = oldest_seq();
+        *next = g_header->next_seq;
+    } else {
+        *oldest = *next = 1;
+    }
+    pthread_mutex_unlock(&g_log_mutex);
+}
+
+/* ==================== 采样 ==================== */
+
+static int16_t to_centi(double v) {
+    double q = v * 100.0;
+    q = q < 0 ? q - 0.5 : q + 0.5;
+    if (q > INT16_MAX) return INT16_MAX;
+    if (q < INT16_MIN) return INT16_MIN;
+    return (int16_t)q;
+}
+
+static void fill_cell(CellLogCell *out, const SpengmdCell *in) {
+    out->arfcn = in->arfcn > 0 ? (uint32_t)in->arfcn : 0;
+    out->pci = (uint16_t)in->pci;
+    out->band = in->band > 0 ? (uint16_t)in->band : 0;
+    out->rsrp = to_centi(in->rsrp);
+    out->rsrq = to_centi(in->rsrq);
+    out->sinr = to_centi(in->sinr);
+    out->reserved = 0;
+}
+
+static int compare_rsrp_desc(const void *a, const void *b) {
+    double ra = ((const SpengmdCell *)a)->rsrp;
+    double rb = ((const SpengmdCell *)b)->rsrp;
+    return ra < rb ? 1 : ra > rb ? -1 : 0;
+}
+
+/* 采集一次, 未驻留 LTE/NR 或 AT 查询失败时返回 -1 */
+static int sample_cells(CellLogRecord *rec) {
+    SpengmdCell serving, cells[SPENGMD_MAX_CELLS];
+    SpengmdRat rat;
+    char tech[16] = {0};
+    char *result = NULL;
+    int n = 0, ret;
+
+    if (ofono_get_serving_cell_tech(tech, sizeof(tech)) != 0) return -1;
+    if (strcmp(tech, "nr") == 0) {
+        rat = SPENGMD_NR;
+    } else if (strcmp(tech, "lte") == 0) {
+        rat = SPENGMD_LTE;
+    } else {
+        return -1;
+    }
+
+    if (execute_at(rat == SPENGMD_NR ? "AT+SPENGMD=0,14,1" : "AT+SPENGMD=0,6,0", &result) != 0 || !result) {
+        g_free(result);
+        return -1;
+    }
+    ret = spengmd_parse_serving(result, rat, &serving);
+    g_free(result);
+    result = NULL;
+    if (ret != 0 || serving.arfcn == 0) return -1;
+    /* 同一次查询记入 SINR 历史, 历史采样线程在间隔内不再查询 */
+    history_record(HIST_SINR, serving.sinr);
+
+    if (execute_at(rat == SPENGMD_NR ? "AT+SPENGMD=0,14,2" : "AT+SPENGMD=0,6,6", &result) == 0 && result) {
+        n = spengmd_parse_neighbors(result, rat, cells, SPENGMD_MAX_CELLS);
+    }
+    g_free(result);
+
+    memset(rec, 0, sizeof(*rec));
+    rec->ts = (uint32_t)time(NULL);
+    rec->rat = rat == SPENGMD_NR ? CELL_LOG_RAT_NR : CELL_LOG_RAT_LTE;
+    fill_cell(&rec->serving, &serving);
+
+    qsort(cells, n, sizeof(cells[0]), compare_rsrp_desc);
+    if (n > CELL_LOG_MAX_NEIGHBORS) n = CELL_LOG_MAX_NEIGHBORS;
+    for (int i = 0; i < n; i++) fill_cell(&rec->neighbors[i], &cells[i]);
+    rec->neighbor_count = (uint8_t)n;
+    return 0;
+}
+
+/* 与上一条记录比较, 打上切换标记 */
+static void detect_changes(CellLogRecord *rec) {
+    const CellLogCell *a, *b;
+
+    if (!g_prev_valid) return;
+    a = &g_prev.serving;
+    b = &rec->serving;
+
+    if (rec->rat != g_prev.rat) {
+        rec->flags |= CELL_LOG_F_RAT_CHANGE;
+        printf("[CELL_LOG] 制式变化 %s -> %s\n",
+               g_prev.rat == CELL_LOG_RAT_NR ? "NR" : "LTE", rec->rat == CELL_LOG_RAT_NR ? "NR" : "LTE");
+    }
+    if (a->pci != b->pci || a->arfcn != b->arfcn) {
+        rec->flags |= CELL_LOG_F_HANDOVER;
+        printf("[CELL_LOG] 小区切换 PCI %u/%u -> %u/%u\n", a->pci, a->arfcn, b->pci, b->arfcn);
+    }
+    if (a->band && b->band && a->band != b->band) {
+        rec->flags |= CELL_LOG_F_BAND_CHANGE;
+        printf("[CELL_LOG] 频段变化 %u -> %u\n", a->band, b->band);
+    }
+}
+
+static void sample_once(void) {
+    CellLogRecord rec;
+
+    if (sample_cells(&rec) != 0) return;
+    detect_changes(&rec);
+    append_record(&rec);
+    g_prev = rec;
+    g_prev_valid = 1;
+}
+
+static long long get_current_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void *sampler_thread(void *arg) {
+    long long next_due = get_current_ms();
+    (void)arg;
+
+    /* 周期采样的 AT 查询排在用户请求之后 */
+    at_sched_set_thread_priority(AT_PRIO_BACKGROUND);
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    while (!g_sampler_stop) {
+        struct timespec ts;
+
+        if (g_config_changed) {
+            g_config_changed = 0;
+            next_due = get_current_ms();
+        }
+        if (!g_enabled) {
+            pthread_cond_wait(&g_sampler_cond, &g_sampler_mutex);
+            continue;
+        }
+
+        if (get_current_ms() >= next_due) {
+            int interval_ms = g_interval * 1000;
+
+            pthread_mutex_unlock(&g_sampler_mutex);
+            sample_once();
+            pthread_mutex_lock(&g_sampler_mutex);
+
+            /* 采样耗时超过间隔时不补采 */
+            next_due += interval_ms;
+            if (next_due <= get_current_ms()) next_due = get_current_ms() + interval_ms;
+            continue;
+        }
+
+        ts.tv_sec = next_due / 1000;
+        ts.tv_nsec = (next_due % 1000) * 1000000;
+        pthread_cond_timedwait(&g_sampler_cond, &g_sampler_mutex, &ts);
+    }
+    pthread_mutex_unlock(&g_sampler_mutex);
+    return NULL;
+}
+
+static int clamp_interval(int v) {
+    if (v < CELL_LOG_INTERVAL_MIN) return CELL_LOG_INTERVAL_MIN;
+    if (v > CELL_LOG_INTERVAL_MAX) return CELL_LOG_INTERVAL_MAX;
+    return v;
+}
+
+int cell_log_init(void) {
+    pthread_condattr_t attr;
+    uint32_t next;
+
+    if (g_sampler_running) return 0;
+
+    pthread_mutex_lock(&g_log_mutex);
+    if (open_log_file() != 0) {
+        pthread_mutex_unlock(&g_log_mutex);
+        return -1;
+    }
+    /* 从最新记录继续检测切换 */
+    next = g_header->next_seq;
+    g_prev_valid = next > oldest_seq() && slot_of(next - 1)->seq == next - 1;
+    if (g_prev_valid) g_prev = *slot_of(next - 1);
+    pthread_mutex_unlock(&g_log_mutex);
+
+    g_enabled = config_get_int("cell_log_enabled", 0) ? 1 : 0;
+    g_interval = clamp_interval(config_get_int("cell_log_interval", CELL_LOG_INTERVAL_DEFAULT));
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_sampler_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_sampler_stop = 0;
+    if (pthread_create(&g_sampler_thread, NULL, sampler_thread, NULL) != 0) {
+        printf("[CELL_LOG] 创建采样线程失败\n");
+        pthread_cond_destroy(&g_sampler_cond);
+        pthread_mutex_lock(&g_log_mutex);
+        close_log_file();
+        pthread_mutex_unlock(&g_log_mutex);
+        return -1;
+    }
+    g_sampler_running = 1;
+    printf("[CELL_LOG] 小区记录%s, 间隔 %d 秒\n", g_enabled ? "已启用" : "未启用", g_interval);
+    return 0;
+}
+
+void cell_log_deinit(void) {
+    if (!g_sampler_running) return;
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    g_sampler_stop = 1;
+    pthread_cond_signal(&g_sampler_cond);
+    pthread_mutex_unlock(&g_sampler_mutex);
+
+    pthread_join(g_sampler_thread, NULL);
+    pthread_cond_destroy(&g_sampler_cond);
+    g_sampler_running = 0;
+
+    pthread_mutex_lock(&g_log_mutex);
+    close_log_file();
+    pthread_mutex_unlock(&g_log_mutex);
+}
+
+/* ==================== 导出 ==================== */
+
+static const char *rat_name(uint8_t rat) {
+    return rat == CELL_LOG_RAT_NR ? "NR" : "LTE";
+}
+
+static int format_csv(char *buf, size_t size, const CellLogRecord *r) {
+    const CellLogCell *s = &r->serving;
+    int len = snprintf(buf, size, "%u,%u,%s,%u,%u,%u,%.2f,%.2f,%.2f,%d,%d,%d,",
+                       r->seq, r->ts, rat_name(r->rat), s->band, s->arfcn, s->pci,
+                       s->rsrp / 100.0, s->rsrq / 100.0, s->sinr / 100.0,
+                       (r->flags & CELL_LOG_F_HANDOVER) ? 1 : 0,
+                       (r->flags & CELL_LOG_F_BAND_CHANGE) ? 1 : 0,
+                       (r->flags & CELL_LOG_F_RAT_CHANGE) ? 1 : 0);
+
+    /* 邻小区: pci/arfcn/rsrp/rsrq/sinr, 以 ';' 分隔 */
+    for (int i = 0; i < r->neighbor_count && i < CELL_LOG_MAX_NEIGHBORS && len < (int)size; i++) {
+        const CellLogCell *n = &r->neighbors[i];
+        len += snprintf(buf + len, size - len, "%s%u/%u/%.2f/%.2f/%.2f", i ? ";" : "",
+                        n->pci, n->arfcn, n->rsrp / 100.0, n->rsrq / 100.0, n->sinr / 100.0);
+    }
+    if (len < (int)size) len += snprintf(buf + len, size - len, "\n");
+    return len < (int)size ? len : -1;
+}
+
+static int format_cell_json(char *buf, size_t size, const CellLogCell *c) {
+    return snprintf(buf, size, "\"band\":%u,\"arfcn\":%u,\"pci\":%u,\"rsrp\":%.2f,\"rsrq\":%.2f,\"sinr\":%.2f",
+                    c->band, c->arfcn, c->pci, c->rsrp / 100.0, c->rsrq / 100.0, c->sinr / 100.0);
+}
+
+static int format_ndjson(char *buf, size_t size, const CellLogRecord *r) {
+    int len = snprintf(buf, size, "{\"seq\":%u,\"ts\":%u,\"rat\":\"%s\",", r->seq, r->ts, rat_name(r->rat));
+
+    if (len < (int)size) len += format_cell_json(buf + len, size - len, &r->serving);
+    if (len < (int)size) {
+        len += snprintf(buf + len, size - len, ",\"handover\":%s,\"bandChange\":%s,\"ratChange\":%s,\"neighbors\":[",
+                        (r->flags & CELL_LOG_F_HANDOVER) ? "true" : "false",
+                        (r->flags & CELL_LOG_F_BAND_CHANGE) ? "true" : "false",
+                        (r->flags & CELL_LOG_F_RAT_CHANGE) ? "true" : "false");
+    }
+    for (int i = 0; i < r->neighbor_count && i < CELL_LOG_MAX_NEIGHBORS && len < (int)size; i++) {
+        len += snprintf(buf + len, size - len, "%s{", i ? "," : "");
+        if (len < (int)size) len += format_cell_json(buf + len, size - len, &r->neighbors[i]);
+        if (len < (int)size) len += snprintf(buf + len, size - len, "}");
+    }
+    if (len < (int)size) len += snprintf(buf + len, size - len, "]}\n");
+    return len < (int)size ? len : -1;
+}
+
+static void export_finish(struct mg_connection *c) {
+    CellLogExport *e = (CellLogExport *)c->pfn_data;
+
+    c->pfn = e->saved_pfn;
+    c->pfn_data = e->saved_pfn_data;
+    free(e);
+}
+
+/* 读取下一批记录写入一个分块, 全部发送后写结束块并恢复 HTTP 协议处理 */
+static void export_fill(struct mg_connection *c) {
+    CellLogExport *e = (CellLogExport *)c->pfn_data;
+    char buf[CELL_LOG_EXPORT_BATCH];
+    size_t len = 0;
+
+    while (e->next < e->end && len + CELL_LOG_EXPORT_LINE_MAX <= sizeof(buf)) {
+        CellLogRecord rec;
+        int n;
+
+        if (cell_log_read(e->next, &rec) != 0) {
+            /* 导出期间被覆盖或清空, 跳到当前最旧的记录 */
+            uint32_t oldest, next;
+            cell_log_range(&oldest, &next);
+            e->next = oldest > e->next ? oldest : e->next + 1;
+            continue;
+        }
+        e->next++;
+        if ((long long)rec.ts < e->from || (long long)rec.ts > e->to) continue;
+
+        n = e->ndjson ? format_ndjson(buf + len, CELL_LOG_EXPORT_LINE_MAX, &rec)
+                      : format_csv(buf + len, CELL_LOG_EXPORT_LINE_MAX, &rec);
+        if (n > 0) len += (size_t)n;
+    }
+
+    if (len > 0) mg_http_write_chunk(c, buf, len);
+    if (e->next >= e->end) {
+        mg_http_write_chunk(c, "", 0);
+        export_finish(c);
+    }
+}
+
+/* 导出期间的协议处理函数: 发送缓冲排空到低水位后读取下一批 */
+static void export_cb(struct mg_connection *c, int ev, void *ev_data) {
+    if (ev == MG_EV_WRITE || ev == MG_EV_POLL) {
+        if (c->is_closing || c->send.len > CELL_LOG_EXPORT_LOW_WATER) return;
+        export_fill(c);
+    } else if (ev == MG_EV_CLOSE) {
+        export_finish(c);
+    }
+    (void)ev_data;
+}
+
+static long long query_ll(struct mg_http_message *hm, const char *name, long long def) {
+    char buf[32];
+    if (mg_http_get_var(&hm->query, name, buf, sizeof(buf)) <= 0) return def;
+    return atoll(buf);
+}
+
+/* GET /api/cell_log/export - 导出记录 */
+void handle_cell_log_export(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    CellLogExport *e;
+    char format[16];
+    uint32_t oldest, next;
+    int ndjson;
+
+    if (mg_http_get_var(&hm->query, "format", format, sizeof(format)) <= 0) {
+        strcpy(format, "csv");
+    }
+    if (strcmp(format, "csv") != 0 && strcmp(format, "ndjson") != 0) {
+        HTTP_ERROR(c, 400, "format 仅支持 csv/ndjson");
+        return;
+    }
+    ndjson = strcmp(format, "ndjson") == 0;
+
+    e = calloc(1, sizeof(*e));
+    if (!e) {
+        HTTP_ERROR(c, 500, "内存不足");
+        return;
+    }
+    cell_log_range(&oldest, &next);
+    e->next = oldest;
+    e->end = next;
+    e->from = query_ll(hm, "from", 0);
+    e->to = query_ll(hm, "to", INT64_MAX);
+    e->ndjson = ndjson;
+
+    mg_printf(c, "HTTP/1.1 200 OK\r\n"
+              "Content-Type: %s\r\n"
+              "Content-Disposition: attachment; filename=\"cell_log.%s\"\r\n"
+              "Access-Control-Allow-Origin: *\r\n"
+              "Transfer-Encoding: chunked\r\n\r\n",
+              ndjson ? "application/x-ndjson" : "text/csv; charset=utf-8", format);
+    if (!ndjson) {
+        mg_http_printf_chunk(c, "seq,ts,rat,band,arfcn,pci,rsrp,rsrq,sinr,"
+                             "handover,band_change,rat_change,neighbors\n");
+    }
+
+    e->saved_pfn = c->pfn;
+    e->saved_pfn_data = c->pfn_data;
+    c->pfn = export_cb;
+    c->pfn_data = e;
+    export_fill(c);
+}
+
+/* ==================== 配置接口 ==================== */
+
+/* GET/POST /api/cell_log/config - 查询/设置记录配置 */
+void handle_cell_log_config(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_ANY(c, hm);
+
+    if (http_is_method(hm, "POST")) {
+        bool bval = false;
+        double val = 0;
+        int enabled, interval;
+
+        pthread_mutex_lock(&g_sampler_mutex);
+        enabled = g_enabled;
+        interval = g_interval;
+        pthread_mutex_unlock(&g_sampler_mutex);
+
+        if (mg_json_get_bool(hm->body, "$.enabled", &bval)) enabled = bval ? 1 : 0;
+        if (mg_json_get_num(hm->body, "$.interval", &val)) {
+            if (val < CELL_LOG_INTERVAL_MIN || val > CELL_LOG_INTERVAL_MAX) {
+                HTTP_OK(c, "{\"Code\":1,\"Error\":\"采样间隔需在 1-3600 秒之间\",\"Data\":null}");
+                return;
+            }
+            interval = (int)val;
+        }
+
+        config_set_int("cell_log_enabled", enabled);
+        config_set_int("cell_log_interval", interval);
+
+        pthread_mutex_lock(&g_sampler_mutex);
+        g_enabled = enabled;
+        g_interval = interval;
+        g_config_changed = 1;
+        pthread_cond_signal(&g_sampler_cond);
+        pthread_mutex_unlock(&g_sampler_mutex);
+
+        printf("[CELL_LOG] 配置已更新: %s, 间隔 %d 秒\n", enabled ? "启用" : "停用", interval);
+    } else if (!http_is_method(hm, "GET")) {
+        http_method_error(c);
+        return;
+    }
+
+    uint32_t oldest, next;
+    int enabled, interval;
+    JsonWriter w;
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    enabled = g_enabled;
+    interval = g_interval;
+    pthread_mutex_unlock(&g_sampler_mutex);
+    cell_log_range(&oldest, &next);
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    json_kv_bool(&w, "enabled", enabled && g_sampler_running);
+    json_kv_int(&w, "interval", interval);
+    json_kv_int(&w, "capacity", CELL_LOG_CAPACITY);
+    json_kv_int(&w, "count", next - oldest);
+    json_kv_int(&w, "oldestSeq", oldest);
+    json_kv_int(&w, "nextSeq", next);
+    json_obj_end(&w);
+    json_obj_end(&w);
+    json_end(&w);
+}
+
+/* DELETE /api/cell_log - 清空记录 */
+void handle_cell_log_clear(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_DELETE(c, hm);
+
+    pthread_mutex_lock(&g_log_mutex);
+    if (g_header) g_header->first_seq = g_header->next_seq;
+    pthread_mutex_unlock(&g_log_mutex);
+
+    printf("[CELL_LOG] 记录已清空\n");
+    HTTP_SUCCESS(c, "记录已清空");
+}
@@ -20,8 +20,8 @@
 #include "charge.h"
 #include "database.h"  /* 使用数据库配置函数 */
 #include "http_utils.h"
+#include "metrics.h"
 
-#define BATTERY_UEVENT "/sys/class/power_supply/battery/uevent"
 #define BATTERY_STOP_CHARGE "/sys/class/power_supply/battery/charger.0/stop_charge"
 #define UEVENT_BUFFER_SIZE 2048
 
@@ -33,61 +33,23 @@ typedef struct {
 } ChargeConfig;
 
 /* 电池信息 */
-typedef struct {
-    char status[32];
-    char health[32];
-    int capacity;
-    int temperature;
-    int voltage_now;
-    int current_now;
-} BatteryInfo;
+typedef BatteryMetrics BatteryInfo;
 
 static ChargeConfig charge_config = {0, 20, 80};
 static pthread_mutex_t charge_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int uevent_socket_fd = -1;
 static GIOChannel *uevent_channel = NULL;
 static guint uevent_watch_id = 0;
+static gint charge_apply_pending = 0;
 
 /* 电池状态变化回调 */
 static battery_change_callback_t battery_callback = NULL;
 
 
 
-/* 读取电池信息 */
+/* 读取电池信息 (常驻描述符, 失败时为 Unknown/0) */
 static void get_battery_info(BatteryInfo *info) {
-    memset(info, 0, sizeof(BatteryInfo));
-    strcpy(info->status, "Unknown");
-    strcpy(info->health, "Unknown");
-
-    FILE *f = fopen(BATTERY_UEVENT, "r");
-    if (!f) return;
-
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-        char *eq = strchr(line, '=');
-        if (!eq) continue;
-        *eq = '\0';
-        char *key = line;
-        char *value = eq + 1;
-        /* 去除换行 */
-        size_t len = strlen(value);
-        if (len > 0 && value[len - 1] == '\n') value[len - 1] = '\0';
-
-        if (strcmp(key, "POWER_SUPPLY_STATUS") == 0) {
-            strncpy(info->status, value, sizeof(info->status) - 1);
-        } else if (strcmp(key, "POWER_SUPPLY_HEALTH") == 0) {
-            strncpy(info->health, value, sizeof(info->health) - 1);
-        } else if (strcmp(key, "POWER_SUPPLY_CAPACITY") == 0) {
-            info->capacity = atoi(value);
-        } else if (strcmp(key, "POWER_SUPPLY_TEMP") == 0) {
-            info->temperature = atoi(value);
-        } else if (strcmp(key, "POWER_SUPPLY_VOLTAGE_NOW") == 0) {
-            info->voltage_now = atoi(value);
-        } else if (strcmp(key, "POWER_SUPPLY_CURRENT_NOW") == 0) {
-            info->current_now = atoi(value);
-        }
-    }
-    fclose(f);
+    metrics_battery(info);
 }
 
 
@@ -101,18 +63,21 @@ static int set_charging(int enable) {
     return 0;
 }
 
-/* 加载充电配置 - 从SQLite数据库读取 */
+/* 加载充电配置 - 从配置内存表读取 */
 static void load_charge_config(void) {
+    pthread_mutex_lock(&charge_mutex);
     charge_config.enabled = config_get_int("charge_enabled", 0);
     charge_config.start_threshold = config_get_int("charge_start_threshold", 20);
     charge_config.stop_threshold = config_get_int("charge_stop_threshold", 80);
+    pthread_mutex_unlock(&charge_mutex);
 }
 
 /* 保存充电配置 - 写入SQLite数据库 */
-static void save_charge_config(void) {
-    config_set_int("charge_enabled", charge_config.enabled);
-    config_set_int("charge_start_threshold", charge_config.start_threshold);
-    config_set_int("charge_stop_threshold", charge_config.stop_threshold);
+static void save_charge_config(const ChargeConfig *cfg) {
+    /* 先写阈值, 启用开关最后写, 监听者看到启用时阈值已是新值 */
+    config_set_int("charge_start_threshold", cfg->start_threshold);
+    config_set_int("charge_stop_threshold", cfg->stop_threshold);
+    config_set_int("charge_enabled", cfg->enabled);
 }
 
 /* 检查并控制充电 */
@@ -290,9 +255,40 @@ static void stop_charge_monitor(void) {
     printf("[charge] uevent 监听已停止\n");
 }
 
+/* 在主循环中应用配置: 启停监控, 已启用时按新阈值检查一次 */
+static gboolean apply_charge_config(gpointer data) {
+    (void)data;
+    g_atomic_int_set(&charge_apply_pending, 0);
+
+    load_charge_config();
+    pthread_mutex_lock(&charge_mutex);
+    int enabled = charge_config.enabled;
+    pthread_mutex_unlock(&charge_mutex);
+
+    if (!enabled) {
+        stop_charge_monitor();
+    } else if (uevent_watch_id > 0) {
+        check_and_control_charging();
+    } else {
+        start_charge_monitor();
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/* 充电配置变化 (可能来自任意线程), 同一轮的多个键合并为一次应用 */
+static void on_charge_config_changed(const char *key, const char *value, void *user_data) {
+    (void)value;
+    (void)user_data;
+    if (strncmp(key, "charge_", 7) != 0) return;
+    if (g_atomic_int_compare_and_exchange(&charge_apply_pending, 0, 1)) {
+        g_idle_add(apply_charge_config, NULL);
+    }
+}
+
 /* 初始化充电控制 */
 void init_charge(void) {
     load_charge_config();
+    config_add_listener(NULL, on_charge_config_changed, NULL);
 
     if (charge_config.enabled) {
         start_charge_monitor();
@@ -348,21 +344,13 @@ void handle_charge_config(struct mg_connection *c, struct mg_http_message *hm) {
             return;
         }
 
-        /* 更新配置 */
+        /* 更新配置, 启停监控由配置监听在主循环中完成 */
+        ChargeConfig cfg = {enabled, start, stop};
         pthread_mutex_lock(&charge_mutex);
-        int was_enabled = charge_config.enabled;
-        charge_config.enabled = enabled;
-        charge_config.start_threshold = start;
-        charge_config.stop_threshold = stop;
+        charge_config = cfg;
         pthread_mutex_unlock(&charge_mutex);
 
-        save_charge_config();
-
-        if (enabled) {
-            start_charge_monitor();
-        } else if (was_enabled) {
-            stop_charge_monitor();
-        }
+        save_charge_config(&cfg);
 
         HTTP_OK(c, "{\"Code\":0,\"Error\":\"\",\"Data\":\"充电配置已更新\"}");
     }
@@ -1,26 +1,60 @@
 /**
  * @file database.c
- * @brief 数据库操作模块实现 - SQLite3 CLI 封装接口
- * 安全加固版本：杜绝 Shell 注入，自研参数转义逻辑，无需 sqlite3.h 依赖
+ * @brief 数据库操作模块实现 - 进程内 SQLite3
+ *
+ * 进程内持有一个长期打开的连接, 所有访问经 g_db_mutex 串行化.
+ * 带参数的语句使用预编译语句缓存与参数绑定, 旧的文本接口保持
+ * sqlite3 CLI 的输出格式 (字段以分隔符连接, 行以换行分隔).
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <strings.h>
 #include <pthread.h>
-#include <unistd.h>
+#include <sched.h>
+#include <sqlite3.h>
 #include "database.h"
-
-/* 外部函数 - 执行命令 */
-extern int run_command(char *output, size_t output_size, const char *cmd, ...);
+#include "storage_io.h"
 
 /*============================================================================
  * 全局变量
  *============================================================================*/
 
+/* 预编译语句缓存容量 */
+#define DB_STMT_CACHE_SIZE  24
+
+/* 其他进程 (插件脚本等) 占用数据库时的等待时间 */
+#define DB_BUSY_TIMEOUT_MS  2000
+
+typedef struct {
+    char *sql;
+    unsigned int hash;
+    sqlite3_stmt *stmt;
+    int in_use;
+    unsigned long last_used;
+} DbStmtCache;
+
 static char g_db_path[256] = "9898.db";
-static pthread_mutex_t g_db_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* 可重入: 行回调中允许再次访问数据库 */
+static pthread_mutex_t g_db_mutex;
+static pthread_once_t g_db_mutex_once = PTHREAD_ONCE_INIT;
 static int g_db_initialized = 0;
+static sqlite3 *g_db = NULL;
+
+static DbStmtCache g_stmt_cache[DB_STMT_CACHE_SIZE];
+static unsigned long g_stmt_tick = 0;
+
+/* 写入统计: 事务结束时按写入 WAL 的页数计入第一条写语句涉及的子系统 */
+static int g_io_page_size = 4096;
+static int g_io_pages = 0;          /* 上次统计时的 SQLITE_DBSTATUS_CACHE_WRITE */
+static int g_io_subsys = -1;        /* 当前事务所属子系统, -1 未确定 */
+
+/* 配置内存表已载入 (见配置管理) */
+static int g_config_loaded = 0;
+static void config_cache_load(void);
 
 /*============================================================================
  * 内部工具函数
@@ -44,19 +78,299 @@ static void sql_escape(const char *src, char *dst, size_t dst_size) {
     dst[j] = '\0';
 }
 
+static void db_mutex_init(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&g_db_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void db_lock(void) {
+    pthread_once(&g_db_mutex_once, db_mutex_init);
+    pthread_mutex_lock(&g_db_mutex);
+}
+
+static void db_unlock(void) {
+    pthread_mutex_unlock(&g_db_mutex);
+}
+
+static unsigned int sql_hash(const char *sql) {
+    unsigned int h = 5381;
+    while (*sql) h = h * 33 + (unsigned char)*sql++;
+    return h;
+}
+
 /**
- * 执行 SQLite CLI 命令
+ * 取 SQL 中第一张被写入的表 (INTO/UPDATE/FROM 之后的标识符) 对应的子系统
+ * @return 子系统, 没有表名 (BEGIN/COMMIT/PRAGMA 等) 时返回 -1
  */
-static int sqlite_cli_exec(const char *sql, char *output, size_t output_size) {
-    if (!sql) return -1;
-    return run_command(output, output_size, "sqlite3", g_db_path, sql, NULL);
+static int io_classify(const char *sql) {
+    static const char *const keywords[] = {"INTO ", "UPDATE ", "FROM "};
+
+    for (const char *p = sql; *p; p++) {
+        for (size_t k = 0; k < sizeof(keywords) / sizeof(keywords[0]); k++) {
+            size_t len = strlen(keywords[k]);
+            char table[64];
+            size_t n = 0;
+            const char *t;
+
+            if (strncasecmp(p, keywords[k], len) != 0) continue;
+            for (t = p + len; *t == ' '; t++) {}
+            while (n < sizeof(table) - 1 && (isalnum((unsigned char)*t) || *t == '_')) {
+                table[n++] = *t++;
+            }
+            if (n == 0) continue;
+            table[n] = '\0';
+            return (int)storage_subsys_for_table(table);
+        }
+    }
+    return -1;
+}
+
+/**
+ * 语句执行后调用 (需持有锁). 自动提交模式下计入本次写入 WAL 的页数,
+ * 显式事务中只记录子系统, 到 COMMIT 时一并计入
+ */
+static void io_account_locked(const char *sql, int is_write) {
+    int cur = 0, hi = 0;
+
+    if (!g_db) return;
+    if (is_write && g_io_subsys < 0 && sql) g_io_subsys = io_classify(sql);
+    if (!sqlite3_get_autocommit(g_db)) return;
+
+    sqlite3_db_status(g_db, SQLITE_DBSTATUS_CACHE_WRITE, &cur, &hi, 0);
+    if (cur > g_io_pages) {
+        /* WAL 每帧 = 24 字节帧头 + 一页 */
+        storage_account(g_io_subsys >= 0 ? (StorageSubsys)g_io_subsys : STORAGE_DB,
+                        (long long)(cur - g_io_pages) * (g_io_page_size + 24), 0);
+    }
+    g_io_pages = cur;
+    g_io_subsys = -1;
+}
+
+/**
+ * 执行多条 SQL (需持有锁)
+ */
+static int sqlite_exec_locked(const char *sql) {
+    char *errmsg = NULL;
+    int ret = 0;
+
+    if (!g_db || !sql) return -1;
+    if (sqlite3_exec(g_db, sql, NULL, NULL, &errmsg) != SQLITE_OK) {
+        printf("[DB] 执行失败: %s\n", errmsg ? errmsg : sqlite3_errmsg(g_db));
+        sqlite3_free(errmsg);
+        ret = -1;
+    }
+    io_account_locked(sql, 1);
+    return ret;
+}
+
+/**
+ * 执行 SQL 并按 CLI 格式输出结果 (需持有锁)
+ * 字段以 sep 连接, 行以换行分隔, 末尾不带换行
+ */
+static int sqlite_text_query_locked(const char *sql, const char *sep, char *output, size_t output_size) {
+    const char *tail = sql;
+    size_t len = 0, sep_len = strlen(sep);
+    int first_row = 1;
+
+    if (!g_db || !sql) return -1;
+    if (output && output_size > 0) output[0] = '\0';
+
+    while (tail && *tail) {
+        sqlite3_stmt *stmt = NULL;
+        int rc;
+
+        if (sqlite3_prepare_v2(g_db, tail, -1, &stmt, &tail) != SQLITE_OK) {
+            printf("[DB] 预编译失败: %s\n", sqlite3_errmsg(g_db));
+            return -1;
+        }
+        if (!stmt) break;   /* 只剩空白或注释 */
+
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            int cols = sqlite3_column_count(stmt);
+            if (!output || output_size == 0) continue;
+
+            for (int i = -1; i < cols; i++) {
+                const char *piece;
+                size_t n;
+
+                if (i < 0) {
+                    if (first_row) continue;
+                    piece = "\n";
+                    n = 1;
+                } else {
+                    if (i > 0) {
+                        n = sep_len < output_size - 1 - len ? sep_len : output_size - 1 - len;
+                        memcpy(output + len, sep, n);
+                        len += n;
+                    }
+                    piece = (const char *)sqlite3_column_text(stmt, i);
+                    if (!piece) piece = "";
+                    n = (size_t)sqlite3_column_bytes(stmt, i);
+                }
+                if (n > output_size - 1 - len) n = output_size - 1 - len;
+                memcpy(output + len, piece, n);
+                len += n;
+            }
+            output[len] = '\0';
+            first_row = 0;
+        }
+        sqlite3_finalize(stmt);
+
+        if (rc != SQLITE_DONE) {
+            printf("[DB] 查询失败: %s\n", sqlite3_errmsg(g_db));
+            return -1;
+        }
+    }
+    io_account_locked(sql, 0);
+    return 0;
+}
+
+/* 记录页大小与当前写入计数, 之后的差值才计入统计 (需持有锁) */
+static void io_init_locked(void) {
+    char page_size[16] = {0};
+    int hi = 0;
+
+    if (sqlite_text_query_locked("PRAGMA page_size;", "|", page_size, sizeof(page_size)) == 0 &&
+        atoi(page_size) > 0) {
+        g_io_page_size = atoi(page_size);
+    }
+    sqlite3_db_status(g_db, SQLITE_DBSTATUS_CACHE_WRITE, &g_io_pages, &hi, 0);
+    g_io_subsys = -1;
+}
+
+/*============================================================================
+ * 预编译语句缓存
+ *============================================================================*/
+
+/**
+ * 获取预编译语句 (需持有锁)
+ * 缓存命中且空闲时复用; 正被迭代器占用时临时编译一条不缓存的语句
+ */
+static sqlite3_stmt *stmt_acquire(const char *sql, int *cached) {
+    unsigned int hash = sql_hash(sql);
+    DbStmtCache *victim = NULL;
+    sqlite3_stmt *stmt = NULL;
+    int busy = 0;
+
+    *cached = 0;
+    if (!g_db) return NULL;
+
+    for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+        DbStmtCache *e = &g_stmt_cache[i];
+        if (e->sql && e->hash == hash && strcmp(e->sql, sql) == 0) {
+            if (e->in_use) {
+                busy = 1;
+                break;
+            }
+            e->in_use = 1;
+            e->last_used = ++g_stmt_tick;
+            *cached = 1;
+            return e->stmt;
+        }
+        if (!e->in_use && (!victim || !e->sql || (victim->sql && e->last_used < victim->last_used))) {
+            victim = e;
+        }
+    }
+
+    if (sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL) != SQLITE_OK || !stmt) {
+        printf("[DB] 预编译失败: %s\n", sqlite3_errmsg(g_db));
+        if (stmt) sqlite3_finalize(stmt);
+        return NULL;
+    }
+
+    if (busy || !victim) return stmt;
+
+    /* 淘汰最久未用的空闲条目 */
+    if (victim->sql) {
+        sqlite3_finalize(victim->stmt);
+        free(victim->sql);
+        victim->sql = NULL;
+    }
+    victim->sql = strdup(sql);
+    if (!victim->sql) return stmt;
+    victim->hash = hash;
+    victim->stmt = stmt;
+    victim->in_use = 1;
+    victim->last_used = ++g_stmt_tick;
+    *cached = 1;
+    return stmt;
+}
+
+/* 归还预编译语句 (需持有锁) */
+static void stmt_release(sqlite3_stmt *stmt, int cached) {
+    if (!stmt) return;
+    if (!cached) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+        if (g_stmt_cache[i].stmt == stmt) {
+            g_stmt_cache[i].in_use = 0;
+            break;
+        }
+    }
+}
+
+static void stmt_cache_clear(void) {
+    for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+        if (g_stmt_cache[i].sql) {
+            sqlite3_finalize(g_stmt_cache[i].stmt);
+            free(g_stmt_cache[i].sql);
+        }
+    }
+    memset(g_stmt_cache, 0, sizeof(g_stmt_cache));
+}
+
+/**
+ * 按类型串绑定参数
+ * 'i'=int, 'l'=long long, 'd'=double, 's'=文本 (NULL指针绑定为NULL), 'n'=NULL
+ */
+static int bind_params(sqlite3_stmt *stmt, const char *types, va_list ap) {
+    int idx = 1;
+
+    for (const char *t = types ? types : ""; *t; t++, idx++) {
+        int rc;
+        switch (*t) {
+            case 'i':
+                rc = sqlite3_bind_int(stmt, idx, va_arg(ap, int));
+                break;
+            case 'l':
+                rc = sqlite3_bind_int64(stmt, idx, (sqlite3_int64)va_arg(ap, long long));
+                break;
+            case 'd':
+                rc = sqlite3_bind_double(stmt, idx, va_arg(ap, double));
+                break;
+            case 's': {
+                const char *s = va_arg(ap, const char *);
+                rc = s ? sqlite3_bind_text(stmt, idx, s, -1, SQLITE_TRANSIENT)
+                       : sqlite3_bind_null(stmt, idx);
+                break;
+            }
+            case 'n':
+                rc = sqlite3_bind_null(stmt, idx);
+                break;
+            default:
+                printf("[DB] 未知参数类型: %c\n", *t);
+                return -1;
+        }
+        if (rc != SQLITE_OK) {
+            printf("[DB] 参数绑定失败: %s\n", sqlite3_errmsg(g_db));
+            return -1;
+        }
+    }
+    return 0;
 }
 
 /**
  * 创建数据库表结构
  */
 static int db_create_tables(void) {
-    const char *sql = 
+    const char *sql =
         "CREATE TABLE IF NOT EXISTS sms ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "sender TEXT NOT NULL,"
@@ -64,12 +378,15 @@ static int db_create_tables(void) {
         "timestamp INTEGER NOT NULL,"
         "is_read INTEGER DEFAULT 0"
         ");"
+        "CREATE INDEX IF NOT EXISTS idx_sms_sender ON sms(sender);"
+        "CREATE INDEX IF NOT EXISTS idx_sms_unread ON sms(is_read) WHERE is_read = 0;"
         "CREATE TABLE IF NOT EXISTS sent_sms ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "recipient TEXT NOT NULL,"
         "content TEXT NOT NULL,"
         "timestamp INTEGER NOT NULL,"
-        "status TEXT DEFAULT 'sent'"
+        "status TEXT DEFAULT 'sent',"
+        "queued INTEGER DEFAULT 0"
         ");"
         "CREATE TABLE IF NOT EXISTS webhook_config ("
         "id INTEGER PRIMARY KEY,"
@@ -77,8 +394,21 @@ static int db_create_tables(void) {
         "platform TEXT,"
         "url TEXT,"
         "body TEXT,"
-        "headers TEXT"
+        "headers TEXT,"
+        "tls_insecure INTEGER DEFAULT 0"
+        ");"
+        "CREATE TABLE IF NOT EXISTS webhook_queue ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "url TEXT NOT NULL,"
+        "headers TEXT,"
+        "body TEXT,"
+        "attempts INTEGER DEFAULT 0,"
+        "next_at INTEGER NOT NULL,"
+        "created_at INTEGER NOT NULL,"
+        "last_error TEXT,"
+        "insecure INTEGER DEFAULT 0"
         ");"
+        "CREATE INDEX IF NOT EXISTS idx_webhook_queue_next ON webhook_queue(next_at);"
         "CREATE TABLE IF NOT EXISTS sms_config ("
         "id INTEGER PRIMARY KEY,"
         "max_count INTEGER DEFAULT 50,"
@@ -104,8 +434,8 @@ static int db_create_tables(void) {
         "action TEXT NOT NULL,"
         "enabled INTEGER DEFAULT 1"
         ");";
-    
-    return sqlite_cli_exec(sql, NULL, 0);
+
+    return sqlite_exec_locked(sql);
 }
 
 /*============================================================================
@@ -113,39 +443,74 @@ static int db_create_tables(void) {
  *============================================================================*/
 
 int db_init(const char *path) {
-    pthread_mutex_lock(&g_db_mutex);
+    db_lock();
     if (g_db_initialized) {
-        pthread_mutex_unlock(&g_db_mutex);
+        db_unlock();
         return 0;
     }
-    
+
     if (path && strlen(path) > 0) {
         strncpy(g_db_path, path, sizeof(g_db_path) - 1);
         g_db_path[sizeof(g_db_path) - 1] = '\0';
     }
-    
-    printf("[DB] 初始化数据库 (CLI 封装): %s\n", g_db_path);
-    
+
+    printf("[DB] 初始化数据库 (SQLite %s): %s\n", sqlite3_libversion(), g_db_path);
+
+    if (sqlite3_open_v2(g_db_path, &g_db,
+            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        printf("[DB] 打开数据库失败: %s\n", g_db ? sqlite3_errmsg(g_db) : "out of memory");
+        sqlite3_close(g_db);
+        g_db = NULL;
+        db_unlock();
+        return -1;
+    }
+    sqlite3_busy_timeout(g_db, DB_BUSY_TIMEOUT_MS);
+
+    /* 新建的数据库直接使用增量回收, 旧库由 db_maint 转换 */
+    sqlite_exec_locked("PRAGMA auto_vacuum=INCREMENTAL;");
+
     /* 优化性能 */
-    sqlite_cli_exec("PRAGMA journal_mode=WAL;", NULL, 0);
-    sqlite_cli_exec("PRAGMA synchronous=NORMAL;", NULL, 0);
-    
+    sqlite_exec_locked("PRAGMA journal_mode=WAL;");
+    sqlite_exec_locked("PRAGMA synchronous=NORMAL;");
+
     if (db_create_tables() != 0) {
-        pthread_mutex_unlock(&g_db_mutex);
+        sqlite3_close(g_db);
+        g_db = NULL;
+        db_unlock();
         return -1;
     }
-    
-    /* 尝试增加列（忽略错误，如果已存在） */
-    sqlite_cli_exec("ALTER TABLE sms_config ADD COLUMN sms_fix_enabled INTEGER DEFAULT 0;", NULL, 0);
-    
+
+    /* 尝试增加列（已存在时报错，忽略） */
+    sqlite3_exec(g_db, "ALTER TABLE sms_config ADD COLUMN sms_fix_enabled INTEGER DEFAULT 0;",
+                 NULL, NULL, NULL);
+    sqlite3_exec(g_db, "ALTER TABLE sent_sms ADD COLUMN queued INTEGER DEFAULT 0;",
+                 NULL, NULL, NULL);
+    sqlite3_exec(g_db, "ALTER TABLE webhook_config ADD COLUMN tls_insecure INTEGER DEFAULT 0;",
+                 NULL, NULL, NULL);
+    sqlite3_exec(g_db, "ALTER TABLE webhook_queue ADD COLUMN insecure INTEGER DEFAULT 0;",
+                 NULL, NULL, NULL);
+
+    io_init_locked();
+
     g_db_initialized = 1;
-    pthread_mutex_unlock(&g_db_mutex);
+    db_unlock();
+
+    /* 锁顺序见 g_config_mutex, 须在释放数据库锁之后载入 */
+    config_cache_load();
     printf("[DB] 数据库初始化完成\n");
     return 0;
 }
 
 void db_deinit(void) {
+    __atomic_store_n(&g_config_loaded, 0, __ATOMIC_RELEASE);
+    db_lock();
+    stmt_cache_clear();
+    if (g_db) {
+        sqlite3_close(g_db);
+        g_db = NULL;
+    }
     g_db_initialized = 0;
+    db_unlock();
     printf("[DB] 数据库模块已关闭\n");
 }
 
@@ -155,22 +520,44 @@ const char *db_get_path(void) {
 
 int db_execute(const char *sql) {
     if (!sql) return -1;
-    return sqlite_cli_exec(sql, NULL, 0);
+    db_lock();
+    int ret = sqlite_exec_locked(sql);
+    db_unlock();
+    return ret;
 }
 
 int db_execute_safe(const char *sql) {
-    pthread_mutex_lock(&g_db_mutex);
-    int ret = db_execute(sql);
-    pthread_mutex_unlock(&g_db_mutex);
+    return db_execute(sql);
+}
+
+int db_begin(void) {
+    db_lock();
+    if (sqlite_exec_locked("BEGIN IMMEDIATE;") != 0) {
+        db_unlock();
+        return -1;
+    }
+    return 0;
+}
+
+int db_commit(void) {
+    int ret = sqlite_exec_locked("COMMIT;");
+
+    if (ret != 0) sqlite_exec_locked("ROLLBACK;");
+    db_unlock();
     return ret;
 }
 
+void db_rollback(void) {
+    sqlite_exec_locked("ROLLBACK;");
+    db_unlock();
+}
+
 int db_query_int(const char *sql, int default_val) {
     char output[64] = {0};
-    pthread_mutex_lock(&g_db_mutex);
-    int rc = sqlite_cli_exec(sql, output, sizeof(output));
-    pthread_mutex_unlock(&g_db_mutex);
-    
+    db_lock();
+    int rc = sqlite_text_query_locked(sql, "|", output, sizeof(output));
+    db_unlock();
+
     if (rc != 0 || strlen(output) == 0) {
         return default_val;
     }
@@ -179,37 +566,173 @@ int db_query_int(const char *sql, int default_val) {
 
 int db_query_string(const char *sql, char *buf, size_t size) {
     if (!sql || !buf || size == 0) return -1;
-    
-    pthread_mutex_lock(&g_db_mutex);
-    int rc = sqlite_cli_exec(sql, buf, size);
-    pthread_mutex_unlock(&g_db_mutex);
-    
-    if (rc != 0) return -1;
-    
-    /* 移除尾部换行符 */
-    size_t len = strlen(buf);
-    if (len > 0 && buf[len-1] == '\n') {
-        buf[len-1] = '\0';
-    }
-    
-    return 0;
+
+    db_lock();
+    int rc = sqlite_text_query_locked(sql, "|", buf, size);
+    db_unlock();
+
+    return (rc == 0) ? 0 : -1;
 }
 
 int db_query_rows(const char *sql, const char *separator, char *buf, size_t size) {
     if (!sql || !buf || size == 0) return -1;
-    
-    char cmd_with_sep[5120];
-    const char *sep = separator ? separator : "|";
-    
-    /* 使用 sqlite3 -separator 命令选项或直接在 SQL 中处理 */
-    /* 这里我们采用简单的方式：让 sqlite 输出默认格式 */
-    pthread_mutex_lock(&g_db_mutex);
-    int rc = sqlite_cli_exec(sql, buf, size);
-    pthread_mutex_unlock(&g_db_mutex);
-    
+
+    db_lock();
+    int rc = sqlite_text_query_locked(sql, separator ? separator : "|", buf, size);
+    db_unlock();
+
     return (rc == 0) ? 0 : -1;
 }
 
+/*============================================================================
+ * 预编译语句与行迭代
+ *============================================================================*/
+
+static int db_iter_begin_v(DbIter *it, const char *sql, const char *types, va_list ap) {
+    memset(it, 0, sizeof(*it));
+    if (!sql) return -1;
+
+    db_lock();
+    it->stmt = stmt_acquire(sql, &it->cached);
+    if (!it->stmt) {
+        db_unlock();
+        return -1;
+    }
+    if (bind_params((sqlite3_stmt *)it->stmt, types, ap) != 0) {
+        stmt_release((sqlite3_stmt *)it->stmt, it->cached);
+        it->stmt = NULL;
+        db_unlock();
+        return -1;
+    }
+    /* 锁保持到 db_iter_end */
+    return 0;
+}
+
+int db_iter_begin(DbIter *it, const char *sql, const char *types, ...) {
+    va_list ap;
+    int ret;
+
+    if (!it) return -1;
+    va_start(ap, types);
+    ret = db_iter_begin_v(it, sql, types, ap);
+    va_end(ap);
+    return ret;
+}
+
+int db_iter_next(DbIter *it) {
+    int rc;
+
+    if (!it || !it->stmt || it->done) return 0;
+    rc = sqlite3_step((sqlite3_stmt *)it->stmt);
+    if (rc == SQLITE_ROW) return 1;
+
+    it->done = 1;
+    if (rc == SQLITE_DONE) return 0;
+    printf("[DB] 查询失败: %s\n", sqlite3_errmsg(g_db));
+    return -1;
+}
+
+void db_iter_end(DbIter *it) {
+    sqlite3_stmt *stmt;
+
+    if (!it || !it->stmt) return;
+    stmt = (sqlite3_stmt *)it->stmt;
+    io_account_locked(sqlite3_sql(stmt), !sqlite3_stmt_readonly(stmt));
+    stmt_release(stmt, it->cached);
+    it->stmt = NULL;
+    db_unlock();
+}
+
+int db_col_count(DbIter *it) {
+    return it && it->stmt ? sqlite3_column_count((sqlite3_stmt *)it->stmt) : 0;
+}
+
+int db_col_is_null(DbIter *it, int col) {
+    return sqlite3_column_type((sqlite3_stmt *)it->stmt, col) == SQLITE_NULL;
+}
+
+int db_col_int(DbIter *it, int col) {
+    return sqlite3_column_int((sqlite3_stmt *)it->stmt, col);
+}
+
+long long db_col_int64(DbIter *it, int col) {
+    return (long long)sqlite3_column_int64((sqlite3_stmt *)it->stmt, col);
+}
+
+double db_col_double(DbIter *it, int col) {
+    return sqlite3_column_double((sqlite3_stmt *)it->stmt, col);
+}
+
+const char *db_col_text(DbIter *it, int col) {
+    const char *s = (const char *)sqlite3_column_text((sqlite3_stmt *)it->stmt, col);
+    return s ? s : "";
+}
+
+size_t db_col_text_copy(DbIter *it, int col, char *buf, size_t size) {
+    const char *s;
+    size_t n;
+
+    if (!buf || size == 0) return 0;
+    s = (const char *)sqlite3_column_text((sqlite3_stmt *)it->stmt, col);
+    n = s ? (size_t)sqlite3_column_bytes((sqlite3_stmt *)it->stmt, col) : 0;
+    if (n > size - 1) n = size - 1;
+    if (n > 0) memcpy(buf, s, n);
+    buf[n] = '\0';
+    return n;
+}
+
+int db_query_each(const char *sql, DbRowCallback cb, void *ctx, const char *types, ...) {
+    DbIter it;
+    va_list ap;
+    int rows = 0, rc;
+
+    va_start(ap, types);
+    rc = db_iter_begin_v(&it, sql, types, ap);
+    va_end(ap);
+    if (rc != 0) return -1;
+
+    while ((rc = db_iter_next(&it)) == 1) {
+        rows++;
+        if (cb && cb(&it, ctx) != 0) break;
+    }
+    db_iter_end(&it);
+
+    return rc < 0 ? -1 : rows;
+}
+
+int db_exec_bind(const char *sql, const char *types, ...) {
+    DbIter it;
+    va_list ap;
+    int rc;
+
+    va_start(ap, types);
+    rc = db_iter_begin_v(&it, sql, types, ap);
+    va_end(ap);
+    if (rc != 0) return -1;
+
+    while ((rc = db_iter_next(&it)) == 1) {}
+    if (rc == 0) rc = sqlite3_changes(g_db);
+    db_iter_end(&it);
+    return rc;
+}
+
+long long db_insert_bind(const char *sql, const char *types, ...) {
+    DbIter it;
+    va_list ap;
+    long long rowid = -1;
+    int rc;
+
+    va_start(ap, types);
+    rc = db_iter_begin_v(&it, sql, types, ap);
+    va_end(ap);
+    if (rc != 0) return -1;
+
+    while ((rc = db_iter_next(&it)) == 1) {}
+    if (rc == 0) rowid = (long long)sqlite3_last_insert_rowid(g_db);
+    db_iter_end(&it);
+    return rowid;
+}
+
 /*============================================================================
  * 字符串处理
  *============================================================================*/
@@ -219,35 +742,274 @@ void db_escape_string(const char *src, char *dst, size_t size) {
 }
 
 void db_unescape_string(char *str) {
-    /* CLI 输出不需要特别反转义 */
+    /* 查询结果为原始文本, 不需要反转义 */
+    (void)str;
 }
 
 /*============================================================================
- * 配置管理 (封装转义逻辑)
+ * 配置管理
+ *
+ * config 表在 db_init 时整表载入内存哈希表 (开放寻址, 槽位固定).
+ * 键一经发布不再变化, 值由每个槽位的顺序锁保护, 读取不加锁也不访问
+ * 数据库. 写入先落库, 成功后更新内存并通知监听者. 值超过
+ * CONFIG_VALUE_MAX、键过长或槽位用尽时, 对应读取回落到数据库.
  *============================================================================*/
 
+typedef struct {
+    int used;                       /* 发布后 key 不再变化 */
+    unsigned int seq;               /* 奇数表示正在写入 */
+    int spilled;                    /* 值过长, 只保存在数据库 */
+    char key[CONFIG_KEY_MAX];
+    char value[CONFIG_VALUE_MAX];
+} ConfigSlot;
+
+typedef struct {
+    char key[CONFIG_KEY_MAX];       /* 空串表示监听全部键 */
+    ConfigChangeCallback cb;
+    void *user_data;
+} ConfigListener;
+
+static ConfigSlot g_config_slots[CONFIG_CACHE_SLOTS];
+static int g_config_overflow = 0;   /* 有键未能进入内存表 */
+/*
+ * 串行化写者与监听者注册.
+ * 锁顺序固定为 g_config_mutex -> g_db_mutex: 持有它时可以访问数据库,
+ * 持有数据库锁 (事务、迭代器) 时不能调用 config_set.
+ */
+static pthread_mutex_t g_config_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ConfigListener g_config_listeners[CONFIG_MAX_LISTENERS];
+static int g_config_listener_count = 0;
+
+static unsigned int config_hash(const char *key) {
+    unsigned int h = 2166136261u;
+    while (*key) {
+        h ^= (unsigned char)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* 查找槽位, 不存在返回 NULL (无锁) */
+static ConfigSlot *config_slot_find(const char *key) {
+    unsigned int i = config_hash(key) & (CONFIG_CACHE_SLOTS - 1);
+    int n;
+
+    for (n = 0; n < CONFIG_CACHE_SLOTS; n++) {
+        ConfigSlot *slot = &g_config_slots[i];
+        if (!__atomic_load_n(&slot->used, __ATOMIC_ACQUIRE)) return NULL;
+        if (strcmp(slot->key, key) == 0) return slot;
+        i = (i + 1) & (CONFIG_CACHE_SLOTS - 1);
+    }
+    return NULL;
+}
+
+/* 查找或占用槽位 (须持有 g_config_mutex), 表满返回 NULL */
+static ConfigSlot *config_slot_claim(const char *key) {
+    unsigned int i = config_hash(key) & (CONFIG_CACHE_SLOTS - 1);
+    int n;
+
+    if (strlen(key) >= CONFIG_KEY_MAX) return NULL;
+    for (n = 0; n < CONFIG_CACHE_SLOTS; n++) {
+        ConfigSlot *slot = &g_config_slots[i];
+        if (!slot->used) {
+            strcpy(slot->key, key);
+            slot->spilled = 1;      /* 值写入前读者回落到数据库 */
+            __atomic_store_n(&slot->used, 1, __ATOMIC_RELEASE);
+            return slot;
+        }
+        if (strcmp(slot->key, key) == 0) return slot;
+        i = (i + 1) & (CONFIG_CACHE_SLOTS - 1);
+    }
+    return NULL;
+}
+
+/* 更新槽位的值 (须持有 g_config_mutex) */
+static void config_slot_store(ConfigSlot *slot, const char *value) {
+    unsigned int seq = slot->seq;
+    size_t len = strlen(value);
+
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (len < CONFIG_VALUE_MAX) {
+        memcpy(slot->value, value, len + 1);
+        slot->spilled = 0;
+    } else {
+        slot->value[0] = '\0';
+        slot->spilled = 1;
+    }
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * 读取槽位的值
+ * @return 0成功, 1值只在数据库中
+ */
+static int config_slot_load(ConfigSlot *slot, char *value, size_t value_size) {
+    unsigned int s1, s2;
+    int spilled;
+
+    for (;;) {
+        s1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (!(s1 & 1)) {
+            spilled = slot->spilled;
+            strncpy(value, slot->value, value_size - 1);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            s2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+            if (s1 == s2) break;
+        }
+        sched_yield();
+    }
+    value[value_size - 1] = '\0';
+    return spilled ? 1 : 0;
+}
+
+static int config_db_get(const char *key, char *value, size_t value_size) {
+    DbIter it;
+    int found;
+
+    if (db_iter_begin(&it, "SELECT value FROM config WHERE key = ?;", "s", key) != 0) {
+        return -1;
+    }
+    found = db_iter_next(&it) == 1;
+    if (found) db_col_text_copy(&it, 0, value, value_size);
+    db_iter_end(&it);
+
+    return found ? 0 : -1;
+}
+
+/* 载入整张 config 表 (db_init 释放数据库锁之后调用, 先取 g_config_mutex 再查询) */
+static void config_cache_load(void) {
+    DbIter it;
+    int count = 0;
+
+    pthread_mutex_lock(&g_config_mutex);
+    if (db_iter_begin(&it, "SELECT key, value FROM config;", NULL) == 0) {
+        while (db_iter_next(&it) == 1) {
+            const char *key = db_col_text(&it, 0);
+            const char *value = db_col_text(&it, 1);
+            ConfigSlot *slot;
+
+            if (!key) continue;
+            slot = config_slot_claim(key);
+            if (!slot) {
+                g_config_overflow = 1;
+                continue;
+            }
+            config_slot_store(slot, value ? value : "");
+            count++;
+        }
+        db_iter_end(&it);
+        __atomic_store_n(&g_config_loaded, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_config_mutex);
+    printf("[DB] 已载入 %d 项配置%s\n", count, g_config_overflow ? " (部分回落到数据库)" : "");
+}
+
+static void config_notify(const char *key, const char *value) {
+    ConfigListener listeners[CONFIG_MAX_LISTENERS];
+    int count, i;
+
+    pthread_mutex_lock(&g_config_mutex);
+    count = g_config_listener_count;
+    memcpy(listeners, g_config_listeners, sizeof(ConfigListener) * count);
+    pthread_mutex_unlock(&g_config_mutex);
+
+    for (i = 0; i < count; i++) {
+        if (listeners[i].key[0] && strcmp(listeners[i].key, key) != 0) continue;
+        listeners[i].cb(key, value, listeners[i].user_data);
+    }
+}
+
 int config_get(const char *key, char *value, size_t value_size) {
-    char sql[512];
-    char escaped_key[256];
-    sql_escape(key, escaped_key, sizeof(escaped_key));
-    
-    snprintf(sql, sizeof(sql), "SELECT value FROM config WHERE key = '%s';", escaped_key);
-    return db_query_string(sql, value, value_size);
+    ConfigSlot *slot;
+
+    if (!key || !value || value_size == 0) return -1;
+    value[0] = '\0';
+
+    if (!__atomic_load_n(&g_config_loaded, __ATOMIC_ACQUIRE)) {
+        return config_db_get(key, value, value_size);
+    }
+
+    slot = config_slot_find(key);
+    if (!slot) {
+        return __atomic_load_n(&g_config_overflow, __ATOMIC_RELAXED) ?
+               config_db_get(key, value, value_size) : -1;
+    }
+    if (config_slot_load(slot, value, value_size) != 0) {
+        return config_db_get(key, value, value_size);
+    }
+    return 0;
 }
 
 int config_set(const char *key, const char *value) {
-    char sql[4096];
-    char escaped_key[256];
-    char escaped_value[3072];
-    
-    sql_escape(key, escaped_key, sizeof(escaped_key));
-    sql_escape(value, escaped_value, sizeof(escaped_value));
-    
-    snprintf(sql, sizeof(sql), 
-        "INSERT OR REPLACE INTO config (key, value) VALUES ('%s', '%s');", 
-        escaped_key, escaped_value);
-    
-    return db_execute_safe(sql);
+    ConfigSlot *slot = NULL;
+    char old[CONFIG_VALUE_MAX];
+
+    if (!key || !value) return -1;
+
+    pthread_mutex_lock(&g_config_mutex);
+    if (g_config_loaded) {
+        slot = config_slot_find(key);
+        /* 值未变化: 不写库也不通知 */
+        if (slot && config_slot_load(slot, old, sizeof(old)) == 0 && strcmp(old, value) == 0) {
+            pthread_mutex_unlock(&g_config_mutex);
+            return 0;
+        }
+    }
+
+    if (db_exec_bind("INSERT OR REPLACE INTO config (key, value) VALUES (?, ?);",
+                     "ss", key, value) < 0) {
+        pthread_mutex_unlock(&g_config_mutex);
+        return -1;
+    }
+
+    if (g_config_loaded) {
+        if (!slot) slot = config_slot_claim(key);
+        if (slot) {
+            config_slot_store(slot, value);
+        } else {
+            __atomic_store_n(&g_config_overflow, 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&g_config_mutex);
+
+    config_notify(key, value);
+    return 0;
+}
+
+int config_add_listener(const char *key, ConfigChangeCallback cb, void *user_data) {
+    ConfigListener *l;
+
+    if (!cb || (key && strlen(key) >= CONFIG_KEY_MAX)) return -1;
+
+    pthread_mutex_lock(&g_config_mutex);
+    if (g_config_listener_count >= CONFIG_MAX_LISTENERS) {
+        pthread_mutex_unlock(&g_config_mutex);
+        printf("[DB] 配置监听已满: %s\n", key ? key : "*");
+        return -1;
+    }
+    l = &g_config_listeners[g_config_listener_count++];
+    snprintf(l->key, sizeof(l->key), "%s", key ? key : "");
+    l->cb = cb;
+    l->user_data = user_data;
+    pthread_mutex_unlock(&g_config_mutex);
+    return 0;
+}
+
+void config_remove_listener(ConfigChangeCallback cb, void *user_data) {
+    int i;
+
+    pthread_mutex_lock(&g_config_mutex);
+    for (i = 0; i < g_config_listener_count; ) {
+        if (g_config_listeners[i].cb == cb && g_config_listeners[i].user_data == user_data) {
+            memmove(&g_config_listeners[i], &g_config_listeners[i + 1],
+                    sizeof(ConfigListener) * (g_config_listener_count - i - 1));
+            g_config_listener_count--;
+        } else {
+            i++;
+        }
+    }
+    pthread_mutex_unlock(&g_config_mutex);
 }
 
 int config_get_int(const char *key, int default_val) {
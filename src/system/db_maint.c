@@ -0,0 +1,488 @@
+/**
+ * @file db_maint.c
+ * @brief 数据库维护实现
+ *
+ * 所有维护语句都经过 database.c 的连接与互斥锁, 与业务写入串行执行.
+ * 增量回收按 DB_MAINT_VACUUM_STEP 页分批执行, 批次之间释放锁. 旧数据库
+ * 转为增量回收模式需要一次整库 VACUUM, 不能分批, 只在库较小或低峰时段执行.
+ * 各表的统计 (行数、估算字节数) 在维护时计算并缓存, 统计接口只读缓存,
+ * 数据库与 WAL 文件大小在请求时实时读取.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "mongoose.h"
+#include "db_maint.h"
+#include "database.h"
+#include "webhook.h"
+#include "storage_io.h"
+#include "json_writer.h"
+#include "http_utils.h"
+
+/* 表容量上限: 行数或估算字节数超出时删除最旧的记录 (按 id) */
+typedef struct {
+    const char *table;
+    const char *size_expr;          /* 单行字节数估算 */
+    int max_rows;
+    long long max_bytes;
+} DbBudget;
+
+static const DbBudget g_budgets[] = {
+    {"sms", "length(sender) + length(content) + 24",
+     5000, 2LL * 1024 * 1024},
+    {"sent_sms", "length(recipient) + length(content) + ifnull(length(status), 0) + 24",
+     2000, 1LL * 1024 * 1024},
+    {"webhook_queue", "length(url) + ifnull(length(headers), 0) + ifnull(length(body), 0)"
+                      " + ifnull(length(last_error), 0) + 40",
+     WEBHOOK_QUEUE_MAX, 2LL * 1024 * 1024},
+};
+
+#define DB_BUDGET_COUNT ((int)(sizeof(g_budgets) / sizeof(g_budgets[0])))
+
+typedef struct {
+    long long rows;
+    long long bytes;
+    long long trimmed;              /* 累计删除的行数 */
+} DbTableStats;
+
+/* 维护结果 (g_stats_mutex 保护) */
+typedef struct {
+    char integrity[128];
+    time_t integrity_at;
+    time_t checkpoint_at;
+    int checkpoint_busy;
+    int checkpoint_log;             /* WAL 中的帧数 */
+    int checkpoint_done;            /* 已写回数据库的帧数 */
+    time_t maint_at;
+    long long maint_ms;             /* 上次维护耗时 */
+    time_t vacuum_at;
+    int vacuum_pages;
+    time_t analyze_at;
+    DbTableStats tables[DB_BUDGET_COUNT];
+} DbMaintStats;
+
+static pthread_mutex_t g_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DbMaintStats g_stats;
+
+static pthread_mutex_t g_maint_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_maint_cond;
+static pthread_t g_maint_thread;
+static int g_maint_stop = 0;
+static int g_maint_running = 0;
+static int g_run_now = 0;
+
+/* 上次 ANALYZE 时连接的累计修改行数 (只在维护线程中访问) */
+static int g_changes_base = 0;
+
+static long long get_current_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static long long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_size : 0;
+}
+
+static long long wal_size(void) {
+    char path[300];
+    snprintf(path, sizeof(path), "%s-wal", db_get_path());
+    return file_size(path);
+}
+
+/* ==================== 维护步骤 ==================== */
+
+static void run_integrity_check(void) {
+    DbIter it;
+    char first[128] = "error";
+    int rows = 0;
+
+    /* 正常时只返回一行 "ok", 否则每行一个问题 */
+    if (db_iter_begin(&it, "PRAGMA quick_check;", NULL) == 0) {
+        while (db_iter_next(&it) == 1) {
+            if (rows++ == 0) db_col_text_copy(&it, 0, first, sizeof(first));
+        }
+        db_iter_end(&it);
+    }
+
+    if (rows == 1 && strcmp(first, "ok") == 0) {
+        printf("[DB_MAINT] 完整性检查通过\n");
+    } else {
+        printf("[DB_MAINT] 完整性检查发现 %d 处问题: %s\n", rows, first);
+    }
+
+    pthread_mutex_lock(&g_stats_mutex);
+    snprintf(g_stats.integrity, sizeof(g_stats.integrity), "%s", first);
+    g_stats.integrity_at = time(NULL);
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+/*
+ * 检查点写回数据库文件的页数计入写入统计. wal_checkpoint 返回的是当前
+ * WAL 中已写回的累计帧数, WAL 从头重用后 (帧数变小) 重新计数.
+ * 写回后 fsync WAL 与数据库文件各一次.
+ */
+static void account_checkpoint(int log, int done) {
+    static int last_log = 0, last_done = 0;
+    int copied = done;
+
+    if (log >= last_log && done >= last_done) copied = done - last_done;
+    last_log = log;
+    last_done = done;
+    if (copied <= 0) return;
+
+    storage_account(STORAGE_DB, (long long)copied * db_query_int("PRAGMA page_size;", 4096), 2);
+}
+
+static void run_checkpoint(void) {
+    DbIter it;
+    int busy = -1, log = 0, done = 0;
+
+    if (db_iter_begin(&it, "PRAGMA wal_checkpoint(PASSIVE);", NULL) != 0) return;
+    if (db_iter_next(&it) == 1) {
+        busy = db_col_int(&it, 0);
+        log = db_col_int(&it, 1);
+        done = db_col_int(&it, 2);
+    }
+    db_iter_end(&it);
+    account_checkpoint(log, done);
+
+    /* 全部帧已写回时截断, 否则 WAL 文件保持最大时的大小 */
+    if (busy == 0 && log == done && wal_size() > DB_MAINT_WAL_TRUNCATE_BYTES) {
+        db_execute("PRAGMA wal_checkpoint(TRUNCATE);");
+        printf("[DB_MAINT] WAL 已截断 (%d 帧)\n", log);
+    }
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.checkpoint_at = time(NULL);
+    g_stats.checkpoint_busy = busy;
+    g_stats.checkpoint_log = log;
+    g_stats.checkpoint_done = done;
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+static void table_usage(const DbBudget *b, long long *rows, long long *bytes) {
+    char sql[384];
+    DbIter it;
+
+    *rows = 0;
+    *bytes = 0;
+    snprintf(sql, sizeof(sql), "SELECT COUNT(*), IFNULL(SUM(%s), 0) FROM %s;", b->size_expr, b->table);
+    if (db_iter_begin(&it, sql, NULL) != 0) return;
+    if (db_iter_next(&it) == 1) {
+        *rows = db_col_int64(&it, 0);
+        *bytes = db_col_int64(&it, 1);
+    }
+    db_iter_end(&it);
+}
+
+/* 按上限删除最旧的记录, 返回删除的行数 */
+static int enforce_budget(const DbBudget *b, DbTableStats *ts) {
+    char sql[512];
+    long long rows, bytes;
+    int trimmed = 0;
+
+    table_usage(b, &rows, &bytes);
+
+    if (rows > b->max_rows) {
+        snprintf(sql, sizeof(sql),
+                 "DELETE FROM %s WHERE id <= "
+                 "(SELECT id FROM %s ORDER BY id DESC LIMIT 1 OFFSET ?);", b->table, b->table);
+        int n = db_exec_bind(sql, "i", b->max_rows);
+        if (n > 0) trimmed += n;
+    }
+
+    if (trimmed > 0) table_usage(b, &rows, &bytes);
+
+    if (bytes > b->max_bytes) {
+        /* 从最新的记录向前累加, 第一条使总量超限的记录及更旧的全部删除 */
+        snprintf(sql, sizeof(sql),
+                 "DELETE FROM %s WHERE id <= (SELECT id FROM "
+                 "(SELECT id, SUM(%s) OVER (ORDER BY id DESC) AS acc FROM %s) "
+                 "WHERE acc > ? ORDER BY id DESC LIMIT 1);", b->table, b->size_expr, b->table);
+        int n = db_exec_bind(sql, "l", b->max_bytes);
+        if (n > 0) {
+            trimmed += n;
+            table_usage(b, &rows, &bytes);
+        }
+    }
+
+    if (trimmed > 0) {
+        printf("[DB_MAINT] %s 超出上限, 删除 %d 条最旧的记录\n", b->table, trimmed);
+    }
+    ts->rows = rows;
+    ts->bytes = bytes;
+    ts->trimmed += trimmed;
+    return trimmed;
+}
+
+/* 本地时间处于低峰时段; 系统时间尚未同步 (早于 2020 年) 时视为不是 */
+static int is_off_peak(void) {
+    time_t now = time(NULL);
+    struct tm tm;
+
+    if (localtime_r(&now, &tm) == NULL || tm.tm_year + 1900 < 2020) return 0;
+    return tm.tm_hour >= DB_MAINT_OFFPEAK_START_H && tm.tm_hour < DB_MAINT_OFFPEAK_END_H;
+}
+
+/*
+ * 旧数据库转为增量回收模式. 转换需要一次完整 VACUUM, 期间持有数据库锁,
+ * 耗时与文件大小成正比, 所以只在库较小或低峰时段执行; 其余时候跳过,
+ * 删除的空间留在空闲页中由后续写入重用, 文件大小由各表上限约束.
+ */
+static void ensure_incremental_vacuum(void) {
+    static int skip_logged = 0;
+    long long bytes;
+
+    if (db_query_int("PRAGMA auto_vacuum;", 2) != 0) return;
+
+    bytes = (long long)db_query_int("PRAGMA page_count;", 0) * db_query_int("PRAGMA page_size;", 4096);
+    if (bytes > DB_MAINT_CONVERT_MAX_BYTES && !is_off_peak()) {
+        if (!skip_logged) {
+            printf("[DB_MAINT] 数据库 %lld 字节, 推迟到低峰时段再切换增量回收模式\n", bytes);
+            skip_logged = 1;
+        }
+        return;
+    }
+
+    if (db_execute("PRAGMA auto_vacuum=INCREMENTAL;") != 0 || db_execute("VACUUM;") != 0) {
+        printf("[DB_MAINT] 切换到增量回收模式失败\n");
+        return;
+    }
+    printf("[DB_MAINT] 已切换到增量回收模式\n");
+}
+
+static void run_incremental_vacuum(void) {
+    char sql[64];
+    int pages = db_query_int("PRAGMA page_count;", 0);
+    int free_pages = db_query_int("PRAGMA freelist_count;", 0);
+    int reclaimed = 0;
+
+    if (free_pages < DB_MAINT_FREE_MIN_PAGES || free_pages <= pages * DB_MAINT_FREE_RATIO) return;
+
+    snprintf(sql, sizeof(sql), "PRAGMA incremental_vacuum(%d);", DB_MAINT_VACUUM_STEP);
+    while (free_pages > 0 && !__atomic_load_n(&g_maint_stop, __ATOMIC_RELAXED)) {
+        if (db_execute(sql) != 0) break;
+        int left = db_query_int("PRAGMA freelist_count;", 0);
+        if (left >= free_pages) break;      /* auto_vacuum=NONE 时不回收 */
+        reclaimed += free_pages - left;
+        free_pages = left;
+    }
+    if (reclaimed == 0) return;
+
+    printf("[DB_MAINT] 增量回收 %d 页 (共 %d 页)\n", reclaimed, pages);
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.vacuum_at = time(NULL);
+    g_stats.vacuum_pages = reclaimed;
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+static void run_analyze(int force) {
+    int changes = db_query_int("SELECT total_changes();", 0);
+
+    if (!force && changes - g_changes_base < DB_MAINT_ANALYZE_CHANGES) return;
+    if (db_execute("ANALYZE;") != 0) return;
+
+    printf("[DB_MAINT] ANALYZE 完成 (距上次修改 %d 行)\n", changes - g_changes_base);
+    /* ANALYZE 自身写入 sqlite_stat1, 不计入下一轮 */
+    g_changes_base = db_query_int("SELECT total_changes();", 0);
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.analyze_at = time(NULL);
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+static void run_maintenance(void) {
+    DbTableStats tables[DB_BUDGET_COUNT];
+    long long start = get_current_ms();
+    int trimmed = 0;
+
+    pthread_mutex_lock(&g_stats_mutex);
+    memcpy(tables, g_stats.tables, sizeof(tables));
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    for (int i = 0; i < DB_BUDGET_COUNT; i++) {
+        trimmed += enforce_budget(&g_budgets[i], &tables[i]);
+    }
+
+    ensure_incremental_vacuum();
+    run_incremental_vacuum();
+    /* 从未分析过的数据库立即分析一次 */
+    run_analyze(db_query_int("SELECT COUNT(*) FROM sqlite_master WHERE name = 'sqlite_stat1';", 0) == 0);
+    if (trimmed > 0) run_checkpoint();
+
+    pthread_mutex_lock(&g_stats_mutex);
+    memcpy(g_stats.tables, tables, sizeof(tables));
+    g_stats.maint_at = time(NULL);
+    g_stats.maint_ms = get_current_ms() - start;
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+/* ==================== 维护线程 ==================== */
+
+static void *maint_thread(void *arg) {
+    long long next_checkpoint = get_current_ms() + DB_MAINT_CHECKPOINT_S * 1000LL;
+    long long next_maint = get_current_ms() + DB_MAINT_FIRST_DELAY_S * 1000LL;
+    (void)arg;
+
+    run_integrity_check();
+    g_changes_base = db_query_int("SELECT total_changes();", 0);
+
+    pthread_mutex_lock(&g_maint_mutex);
+    while (!g_maint_stop) {
+        long long now = get_current_ms();
+        long long due = next_checkpoint < next_maint ? next_checkpoint : next_maint;
+        struct timespec ts;
+
+        if (g_run_now || now >= next_maint) {
+            g_run_now = 0;
+            pthread_mutex_unlock(&g_maint_mutex);
+            run_checkpoint();
+            run_maintenance();
+            pthread_mutex_lock(&g_maint_mutex);
+            next_maint = get_current_ms() + DB_MAINT_INTERVAL_S * 1000LL;
+            next_checkpoint = get_current_ms() + DB_MAINT_CHECKPOINT_S * 1000LL;
+            continue;
+        }
+        if (now >= next_checkpoint) {
+            pthread_mutex_unlock(&g_maint_mutex);
+            run_checkpoint();
+            pthread_mutex_lock(&g_maint_mutex);
+            next_checkpoint = get_current_ms() + DB_MAINT_CHECKPOINT_S * 1000LL;
+            continue;
+        }
+
+        ts.tv_sec = due / 1000;
+        ts.tv_nsec = (due % 1000) * 1000000;
+        pthread_cond_timedwait(&g_maint_cond, &g_maint_mutex, &ts);
+    }
+    pthread_mutex_unlock(&g_maint_mutex);
+    return NULL;
+}
+
+int db_maint_init(void) {
+    pthread_condattr_t attr;
+
+    if (g_maint_running) return 0;
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    snprintf(g_stats.integrity, sizeof(g_stats.integrity), "pending");
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_maint_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_maint_stop = 0;
+    g_run_now = 0;
+    if (pthread_create(&g_maint_thread, NULL, maint_thread, NULL) != 0) {
+        printf("[DB_MAINT] 创建维护线程失败\n");
+        pthread_cond_destroy(&g_maint_cond);
+        return -1;
+    }
+    g_maint_running = 1;
+    printf("[DB_MAINT] 数据库维护已启动\n");
+    return 0;
+}
+
+void db_maint_deinit(void) {
+    if (!g_maint_running) return;
+
+    pthread_mutex_lock(&g_maint_mutex);
+    g_maint_stop = 1;
+    pthread_cond_signal(&g_maint_cond);
+    pthread_mutex_unlock(&g_maint_mutex);
+
+    pthread_join(g_maint_thread, NULL);
+    pthread_cond_destroy(&g_maint_cond);
+    g_maint_running = 0;
+
+    run_checkpoint();
+}
+
+/* ==================== HTTP 接口 ==================== */
+
+/* GET /api/db/stats */
+void handle_db_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    DbMaintStats st;
+    JsonWriter w;
+    int page_size = db_query_int("PRAGMA page_size;", 0);
+    int pages = db_query_int("PRAGMA page_count;", 0);
+    int free_pages = db_query_int("PRAGMA freelist_count;", 0);
+    int auto_vacuum = db_query_int("PRAGMA auto_vacuum;", 0);
+
+    pthread_mutex_lock(&g_stats_mutex);
+    st = g_stats;
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    json_kv_str(&w, "path", db_get_path());
+    json_kv_int(&w, "dbBytes", file_size(db_get_path()));
+    json_kv_int(&w, "walBytes", wal_size());
+    json_kv_int(&w, "pageSize", page_size);
+    json_kv_int(&w, "pageCount", pages);
+    json_kv_int(&w, "freePages", free_pages);
+    json_kv_str(&w, "autoVacuum", auto_vacuum == 2 ? "incremental" : auto_vacuum == 1 ? "full" : "none");
+    json_kv_str(&w, "integrity", st.integrity);
+    json_kv_int(&w, "integrityAt", st.integrity_at);
+
+    json_key(&w, "checkpoint");
+    json_obj_begin(&w);
+    json_kv_int(&w, "at", st.checkpoint_at);
+    json_kv_int(&w, "busy", st.checkpoint_busy);
+    json_kv_int(&w, "walFrames", st.checkpoint_log);
+    json_kv_int(&w, "checkpointed", st.checkpoint_done);
+    json_obj_end(&w);
+
+    json_kv_int(&w, "maintenanceAt", st.maint_at);
+    json_kv_int(&w, "maintenanceMs", st.maint_ms);
+    json_kv_int(&w, "vacuumAt", st.vacuum_at);
+    json_kv_int(&w, "vacuumPages", st.vacuum_pages);
+    json_kv_int(&w, "analyzeAt", st.analyze_at);
+
+    json_key(&w, "tables");
+    json_arr_begin(&w);
+    for (int i = 0; i < DB_BUDGET_COUNT; i++) {
+        json_obj_begin(&w);
+        json_kv_str(&w, "name", g_budgets[i].table);
+        json_kv_int(&w, "rows", st.tables[i].rows);
+        json_kv_int(&w, "bytes", st.tables[i].bytes);
+        json_kv_int(&w, "maxRows", g_budgets[i].max_rows);
+        json_kv_int(&w, "maxBytes", g_budgets[i].max_bytes);
+        json_kv_int(&w, "trimmed", st.tables[i].trimmed);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+
+    json_obj_end(&w);
+    json_obj_end(&w);
+    json_end(&w);
+}
+
+/* POST /api/db/maintenance */
+void handle_db_maintenance(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    if (!g_maint_running) {
+        HTTP_OK(c, "{\"Code\":1,\"Error\":\"维护线程未运行\",\"Data\":null}");
+        return;
+    }
+
+    pthread_mutex_lock(&g_maint_mutex);
+    g_run_now = 1;
+    pthread_cond_signal(&g_maint_cond);
+    pthread_mutex_unlock(&g_maint_mutex);
+
+    HTTP_OK(c, "{\"Code\":0,\"Error\":\"\",\"Data\":\"维护已开始\"}");
+}
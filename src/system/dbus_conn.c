@@ -0,0 +1,381 @@
+/**
+ * @file dbus_conn.c
+ * @brief 共享 D-Bus 连接管理实现
+ *
+ * 连接使用私有的系统总线连接 (而非 g_bus_get 单例), 关闭后可以干净地
+ * 重建. 状态由 g_conn_mutex 保护, 任意线程都可以取连接或代理; 名称监视、
+ * "closed" 信号与监听者回调都在默认 GMainContext (主循环) 中执行.
+ * 事件经一个队列按产生顺序投递, 保证监听者先看到 CONNECTED 再看到
+ * OFONO_APPEARED, 先看到 OFONO_VANISHED 再看到 DISCONNECTED.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "dbus_conn.h"
+#include "ofono.h"
+
+/* 缓存代理不加载属性、不订阅信号: 创建时不产生额外的 D-Bus 往返 */
+#define PROXY_FLAGS (G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES | \
+                     G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS)
+
+typedef struct {
+    DbusConnEvent ev;
+    GDBusConnection *conn;
+    int upto;                       /* 只发给产生事件时已注册的监听者 */
+    DbusConnListener only;          /* 非 NULL 时只补发给该监听者 */
+    void *only_data;
+} PendingEvent;
+
+/* 以下状态由 g_conn_mutex 保护 */
+static pthread_mutex_t g_conn_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int g_started = 0;
+static GDBusConnection *g_conn = NULL;
+static gulong g_closed_handler = 0;
+static guint g_watch_id = 0;
+static int g_ofono_available = 0;
+static GHashTable *g_proxies = NULL;        /* "path\niface" -> GDBusProxy */
+
+static int g_backoff_ms = DBUS_CONN_BACKOFF_MIN_MS;
+static gint64 g_next_attempt_us = 0;        /* 退避期内不发起按需重连 */
+static guint g_retry_id = 0;
+
+static struct {
+    DbusConnListener fn;
+    void *user_data;
+} g_listeners[DBUS_CONN_MAX_LISTENERS];
+static int g_listener_count = 0;
+
+static GQueue g_events = G_QUEUE_INIT;
+static guint g_dispatch_id = 0;
+
+/* 仅用于日志, DISABLE_PRINTF 时未被引用 */
+__attribute__((unused))
+static const char *event_name(DbusConnEvent ev) {
+    switch (ev) {
+    case DBUS_CONN_EV_CONNECTED:      return "CONNECTED";
+    case DBUS_CONN_EV_OFONO_APPEARED: return "OFONO_APPEARED";
+    case DBUS_CONN_EV_OFONO_VANISHED: return "OFONO_VANISHED";
+    case DBUS_CONN_EV_DISCONNECTED:   return "DISCONNECTED";
+    }
+    return "?";
+}
+
+/* ==================== 事件投递 ==================== */
+
+static void free_event(PendingEvent *e) {
+    if (e->conn) g_object_unref(e->conn);
+    g_free(e);
+}
+
+/* 主循环中依次投递排队事件, 回调期间不持锁 */
+static gboolean dispatch_events(gpointer user_data) {
+    (void)user_data;
+
+    for (;;) {
+        struct {
+            DbusConnListener fn;
+            void *user_data;
+        } listeners[DBUS_CONN_MAX_LISTENERS];
+        int count;
+        PendingEvent *e;
+
+        pthread_mutex_lock(&g_conn_mutex);
+        e = g_queue_pop_head(&g_events);
+        if (!e) {
+            g_dispatch_id = 0;
+            pthread_mutex_unlock(&g_conn_mutex);
+            return G_SOURCE_REMOVE;
+        }
+        count = MIN(g_listener_count, e->upto);
+        memcpy(listeners, g_listeners, sizeof(listeners[0]) * count);
+        pthread_mutex_unlock(&g_conn_mutex);
+
+        if (!e->only) printf("[DBUS] 通知事件 %s (%d 个监听者)\n", event_name(e->ev), count);
+        for (int i = 0; i < count; i++) {
+            if (e->only && (listeners[i].fn != e->only || listeners[i].user_data != e->only_data)) {
+                continue;
+            }
+            listeners[i].fn(e->ev, e->conn, listeners[i].user_data);
+        }
+        free_event(e);
+    }
+}
+
+static void post_event_locked(DbusConnEvent ev, GDBusConnection *conn,
+                              DbusConnListener only, void *only_data) {
+    PendingEvent *e = g_new0(PendingEvent, 1);
+
+    e->ev = ev;
+    e->conn = conn ? g_object_ref(conn) : NULL;
+    e->upto = g_listener_count;
+    e->only = only;
+    e->only_data = only_data;
+    g_queue_push_tail(&g_events, e);
+
+    if (!g_dispatch_id) {
+        g_dispatch_id = g_idle_add_full(G_PRIORITY_DEFAULT, dispatch_events, NULL, NULL);
+    }
+}
+
+/* ==================== 连接状态机 ==================== */
+
+static int connect_locked(void);
+
+static gboolean on_retry(gpointer user_data) {
+    (void)user_data;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    g_retry_id = 0;
+    if (g_started && !g_conn) connect_locked();
+    pthread_mutex_unlock(&g_conn_mutex);
+    return G_SOURCE_REMOVE;
+}
+
+/* 退避期结束后由主循环重试, 即使没有调用方按需重连也能恢复 */
+static void schedule_retry_locked(int delay_ms) {
+    g_next_attempt_us = g_get_monotonic_time() + (gint64)delay_ms * 1000;
+    if (g_started && !g_retry_id) {
+        g_retry_id = g_timeout_add((guint)delay_ms, on_retry, NULL);
+    }
+}
+
+/* 放弃当前连接, notify 时向监听者发送 VANISHED/DISCONNECTED */
+static void drop_connection_locked(int notify) {
+    GDBusConnection *conn = g_conn;
+
+    if (!conn) return;
+
+    g_conn = NULL;
+    g_signal_handler_disconnect(conn, g_closed_handler);
+    g_closed_handler = 0;
+    if (g_watch_id) {
+        g_bus_unwatch_name(g_watch_id);
+        g_watch_id = 0;
+    }
+    g_hash_table_remove_all(g_proxies);
+
+    if (notify) {
+        if (g_ofono_available) post_event_locked(DBUS_CONN_EV_OFONO_VANISHED, conn, NULL, NULL);
+        post_event_locked(DBUS_CONN_EV_DISCONNECTED, conn, NULL, NULL);
+    }
+    g_ofono_available = 0;
+    g_object_unref(conn);
+}
+
+static void on_ofono_appeared(GDBusConnection *conn, const gchar *name,
+                              const gchar *name_owner, gpointer user_data) {
+    (void)name; (void)user_data;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (conn == g_conn) {
+        /* 代理已解析到旧的所有者, oFono 重启后全部重建 */
+        g_hash_table_remove_all(g_proxies);
+        g_ofono_available = 1;
+        post_event_locked(DBUS_CONN_EV_OFONO_APPEARED, conn, NULL, NULL);
+        printf("[DBUS] oFono 已就绪 (%s)\n", name_owner);
+    }
+    pthread_mutex_unlock(&g_conn_mutex);
+}
+
+static void on_ofono_vanished(GDBusConnection *conn, const gchar *name, gpointer user_data) {
+    (void)name; (void)user_data;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (conn == g_conn && g_ofono_available) {
+        g_hash_table_remove_all(g_proxies);
+        g_ofono_available = 0;
+        post_event_locked(DBUS_CONN_EV_OFONO_VANISHED, conn, NULL, NULL);
+        printf("[DBUS] oFono 已退出\n");
+    }
+    pthread_mutex_unlock(&g_conn_mutex);
+}
+
+static void on_closed(GDBusConnection *conn, gboolean remote_peer_vanished,
+                      GError *error, gpointer user_data) {
+    (void)user_data;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (conn == g_conn) {
+        printf("[DBUS] 连接已关闭 (remote_peer_vanished=%d, %s), %d ms 后重连\n",
+               remote_peer_vanished, error ? error->message : "无", g_backoff_ms);
+        drop_connection_locked(1);
+        schedule_retry_locked(g_backoff_ms);
+    }
+    pthread_mutex_unlock(&g_conn_mutex);
+}
+
+/* 确保已连接; 退避期内直接失败 */
+static int connect_locked(void) {
+    GError *error = NULL;
+    GDBusConnection *conn = NULL;
+    gchar *address;
+
+    if (g_conn) {
+        if (!g_dbus_connection_is_closed(g_conn)) return 0;
+        /* 已关闭但 "closed" 信号尚未投递 */
+        drop_connection_locked(1);
+    }
+    if (g_get_monotonic_time() < g_next_attempt_us) return -1;
+
+    address = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
+    if (address) {
+        conn = g_dbus_connection_new_for_address_sync(address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+            NULL, NULL, &error);
+        g_free(address);
+    }
+
+    if (!conn) {
+        printf("[DBUS] 连接系统总线失败: %s, %d ms 后重试\n",
+               error ? error->message : "unknown", g_backoff_ms);
+        if (error) g_error_free(error);
+        schedule_retry_locked(g_backoff_ms);
+        g_backoff_ms = MIN(g_backoff_ms * 2, DBUS_CONN_BACKOFF_MAX_MS);
+        return -1;
+    }
+
+    g_conn = conn;
+    g_backoff_ms = DBUS_CONN_BACKOFF_MIN_MS;
+    g_next_attempt_us = 0;
+
+    /* "closed" 与名称监视回调都进入默认主上下文 (调用线程没有线程默认上下文) */
+    g_closed_handler = g_signal_connect(conn, "closed", G_CALLBACK(on_closed), NULL);
+    g_watch_id = g_bus_watch_name_on_connection(conn, OFONO_SERVICE,
+        G_BUS_NAME_WATCHER_FLAGS_NONE, on_ofono_appeared, on_ofono_vanished, NULL, NULL);
+
+    post_event_locked(DBUS_CONN_EV_CONNECTED, conn, NULL, NULL);
+    printf("[DBUS] 已连接系统总线 (%s)\n", g_dbus_connection_get_unique_name(conn));
+    return 0;
+}
+
+/* ==================== 公共接口 ==================== */
+
+int dbus_conn_start(void) {
+    int ret;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (!g_started) {
+        g_started = 1;
+        g_proxies = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+        g_backoff_ms = DBUS_CONN_BACKOFF_MIN_MS;
+        g_next_attempt_us = 0;
+    }
+    ret = connect_locked();
+    pthread_mutex_unlock(&g_conn_mutex);
+    return ret;
+}
+
+void dbus_conn_stop(void) {
+    PendingEvent *e;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (!g_started) {
+        pthread_mutex_unlock(&g_conn_mutex);
+        return;
+    }
+    g_started = 0;
+
+    if (g_retry_id) {
+        g_source_remove(g_retry_id);
+        g_retry_id = 0;
+    }
+    drop_connection_locked(0);
+
+    while ((e = g_queue_pop_head(&g_events)) != NULL) free_event(e);
+    if (g_dispatch_id) {
+        g_source_remove(g_dispatch_id);
+        g_dispatch_id = 0;
+    }
+    g_listener_count = 0;
+
+    g_hash_table_destroy(g_proxies);
+    g_proxies = NULL;
+    pthread_mutex_unlock(&g_conn_mutex);
+    printf("[DBUS] 连接管理已停止\n");
+}
+
+GDBusConnection *dbus_conn_get(void) {
+    GDBusConnection *conn = NULL;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (g_started && connect_locked() == 0) conn = g_object_ref(g_conn);
+    pthread_mutex_unlock(&g_conn_mutex);
+    return conn;
+}
+
+GDBusProxy *dbus_conn_proxy(const char *path, const char *iface, GError **error) {
+    GDBusProxy *proxy = NULL;
+    gchar *key;
+
+    if (!path || !iface) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "无效的参数");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (!g_started || connect_locked() != 0) {
+        pthread_mutex_unlock(&g_conn_mutex);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED, "D-Bus 未连接");
+        return NULL;
+    }
+
+    key = g_strdup_printf("%s\n%s", path, iface);
+    proxy = g_hash_table_lookup(g_proxies, key);
+    if (proxy) {
+        g_object_ref(proxy);
+        g_free(key);
+    } else {
+        proxy = g_dbus_proxy_new_sync(g_conn, PROXY_FLAGS, NULL,
+            OFONO_SERVICE, path, iface, NULL, error);
+        if (proxy) g_hash_table_insert(g_proxies, key, g_object_ref(proxy));
+        else g_free(key);
+    }
+    pthread_mutex_unlock(&g_conn_mutex);
+    return proxy;
+}
+
+int dbus_conn_ofono_available(void) {
+    int available;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    available = g_conn != NULL && g_ofono_available;
+    pthread_mutex_unlock(&g_conn_mutex);
+    return available;
+}
+
+int dbus_conn_add_listener(DbusConnListener fn, void *user_data) {
+    if (!fn) return -1;
+
+    pthread_mutex_lock(&g_conn_mutex);
+    if (g_listener_count >= DBUS_CONN_MAX_LISTENERS) {
+        pthread_mutex_unlock(&g_conn_mutex);
+        return -1;
+    }
+    g_listeners[g_listener_count].fn = fn;
+    g_listeners[g_listener_count].user_data = user_data;
+    g_listener_count++;
+
+    /* 晚注册的监听者补发当前状态 */
+    if (g_conn) {
+        post_event_locked(DBUS_CONN_EV_CONNECTED, g_conn, fn, user_data);
+        if (g_ofono_available) post_event_locked(DBUS_CONN_EV_OFONO_APPEARED, g_conn, fn, user_data);
+    }
+    pthread_mutex_unlock(&g_conn_mutex);
+    return 0;
+}
+
+void dbus_conn_remove_listener(DbusConnListener fn, void *user_data) {
+    pthread_mutex_lock(&g_conn_mutex);
+    for (int i = 0; i < g_listener_count; i++) {
+        if (g_listeners[i].fn == fn && g_listeners[i].user_data == user_data) {
+            memmove(&g_listeners[i], &g_listeners[i + 1],
+                    sizeof(g_listeners[0]) * (g_listener_count - i - 1));
+            g_listener_count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_conn_mutex);
+}
@@ -0,0 +1,473 @@
+/**
+ * @file history.c
+ * @brief 指标历史实现
+ *
+ * 每级分辨率是一个按时间寻址的环形缓冲: 槽位 = 时间 / 分辨率 % 槽位数.
+ * 写入样本时同时更新三级的当前槽, 聚合级在槽内维护 min/max 与累加和,
+ * 不需要单独的降采样任务. 时间前进时把跳过的槽位标记为空.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <glib.h>
+#include "mongoose.h"
+#include "history.h"
+#include "sysinfo.h"
+#include "metrics.h"
+#include "spengmd.h"
+#include "ofono.h"
+#include "dbus_core.h"
+#include "at_sched.h"
+#include "json_writer.h"
+#include "http_utils.h"
+
+/* 与 traffic.c 统计的网卡一致 */
+#define HISTORY_NET_IFACE "sipa_eth0"
+
+#define HISTORY_TICK_MS 1000
+
+/* SINR 只能通过 AT 查询获得, 采样间隔比其他序列长 */
+#define HISTORY_SINR_INTERVAL_MS 10000
+
+/* 空槽标记 */
+#define HIST_GAP INT16_MIN
+
+/* 查询参数 series 的最大长度 */
+#define HIST_QUERY_MAX 128
+
+typedef struct {
+    int16_t min;
+    int16_t max;
+    int16_t avg;
+} HistAgg;
+
+typedef struct {
+    const char *name;
+    double scale;               /* 存储值 = 实际值 * scale, 对数编码时为 ln(1 + 实际值) * scale */
+    int precision;              /* 输出小数位 */
+    int log;                    /* 对数编码 (非负、跨多个数量级的序列) */
+} HistSeriesDef;
+
+typedef struct {
+    const char *name;
+    int res;                    /* 秒 */
+    int slots;
+    int16_t *fine;              /* 1s 级: [series * slots + pos] */
+    HistAgg *agg;               /* 聚合级: [series * slots + pos] */
+    long long head;             /* 最新槽序号 (时间 / res), -1 为空 */
+    double sum[HIST_SERIES_COUNT];          /* 当前槽累加和 */
+    unsigned int count[HIST_SERIES_COUNT];  /* 当前槽样本数 */
+} HistTier;
+
+/*
+ * int16 量化: 百分比/温度/dB 保留两位小数.
+ * 速率 (kbps) 用对数编码: 相对误差不超过 0.025%, 上限约 13Gbps, 低速时仍能区分 1kbps
+ */
+static const HistSeriesDef g_series[HIST_SERIES_COUNT] = {
+    [HIST_CPU]    = {"cpu",    100.0,  2, 0},
+    [HIST_MEM]    = {"mem",    100.0,  2, 0},
+    [HIST_TEMP]   = {"temp",   100.0,  2, 0},
+    [HIST_SIGNAL] = {"signal", 100.0,  2, 0},
+    [HIST_SINR]   = {"sinr",   100.0,  2, 0},
+    [HIST_RX]     = {"rx",     2000.0, 0, 1},
+    [HIST_TX]     = {"tx",     2000.0, 0, 1},
+};
+
+static int16_t g_fine[HIST_SERIES_COUNT][HIST_FINE_SLOTS];
+static HistAgg g_minute[HIST_SERIES_COUNT][HIST_MINUTE_SLOTS];
+static HistAgg g_quarter[HIST_SERIES_COUNT][HIST_QUARTER_SLOTS];
+
+enum { TIER_FINE = 0, TIER_MINUTE, TIER_QUARTER, TIER_COUNT };
+
+static HistTier g_tiers[TIER_COUNT] = {
+    [TIER_FINE]    = {"1s",  1,   HIST_FINE_SLOTS,    &g_fine[0][0], NULL,           -1, {0}, {0}},
+    [TIER_MINUTE]  = {"1m",  60,  HIST_MINUTE_SLOTS,  NULL,          &g_minute[0][0], -1, {0}, {0}},
+    [TIER_QUARTER] = {"15m", 900, HIST_QUARTER_SLOTS, NULL,          &g_quarter[0][0], -1, {0}, {0}},
+};
+
+/* 保护 g_tiers 及存储区 */
+static pthread_mutex_t g_history_mutex = PTHREAD_MUTEX_INITIALIZER;
+static long long g_sinr_ms = 0;             /* 最近一次记录 SINR (单调毫秒) */
+
+/* 采样线程 */
+static pthread_mutex_t g_sampler_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_sampler_cond;
+static pthread_t g_sampler_thread;
+static int g_sampler_stop = 0;
+static int g_sampler_running = 0;
+
+/* ==================== 存储 ==================== */
+
+static int16_t quantize(HistSeries s, double v) {
+    double q = g_series[s].log ? log1p(v > 0 ? v : 0) * g_series[s].scale : v * g_series[s].scale;
+    q = q < 0 ? q - 0.5 : q + 0.5;      /* 四舍五入, 截断由下面的转换完成 */
+    if (q > INT16_MAX) return INT16_MAX;
+    if (q < -INT16_MAX) return -INT16_MAX;     /* INT16_MIN 保留为空槽 */
+    return (int16_t)q;
+}
+
+static double dequantize(HistSeries s, int16_t q) {
+    if (q == HIST_GAP) return NAN;
+    return g_series[s].log ? expm1(q / g_series[s].scale) : q / g_series[s].scale;
+}
+
+static void clear_slot(HistTier *t, int pos) {
+    for (int s = 0; s < HIST_SERIES_COUNT; s++) {
+        if (t->fine) {
+            t->fine[s * t->slots + pos] = HIST_GAP;
+        } else {
+            HistAgg *a = &t->agg[s * t->slots + pos];
+            a->min = a->max = a->avg = HIST_GAP;
+        }
+    }
+}
+
+/* 前进到 slot 并返回实际写入的槽序号 (需持有 g_history_mutex) */
+static long long tier_advance(HistTier *t, long long slot) {
+    if (slot == t->head) return slot;
+
+    /* 时钟小幅回拨时继续写入最新槽, 跨度超过整个缓冲则重置 */
+    if (t->head >= 0 && slot < t->head && t->head - slot < t->slots) {
+        return t->head;
+    }
+
+    if (t->head < 0 || slot < t->head || slot - t->head >= t->slots) {
+        for (int pos = 0; pos < t->slots; pos++) clear_slot(t, pos);
+    } else {
+        for (long long k = t->head + 1; k <= slot; k++) {
+            clear_slot(t, (int)(k % t->slots));
+        }
+    }
+    t->head = slot;
+    memset(t->sum, 0, sizeof(t->sum));
+    memset(t->count, 0, sizeof(t->count));
+    return slot;
+}
+
+static void tier_record(HistTier *t, HistSeries s, double v, time_t now) {
+    long long slot = tier_advance(t, (long long)now / t->res);
+    int pos = (int)(slot % t->slots);
+    int16_t q = quantize(s, v);
+
+    if (t->fine) {
+        t->fine[s * t->slots + pos] = q;
+        return;
+    }
+
+    HistAgg *a = &t->agg[s * t->slots + pos];
+    t->sum[s] += v;
+    t->count[s]++;
+    if (t->count[s] == 1) {
+        a->min = a->max = q;
+    } else {
+        if (q < a->min) a->min = q;
+        if (q > a->max) a->max = q;
+    }
+    a->avg = quantize(s, t->sum[s] / t->count[s]);
+}
+
+static long long get_current_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void history_record(HistSeries series, double value) {
+    time_t now = time(NULL);
+
+    if (series < 0 || series >= HIST_SERIES_COUNT || !isfinite(value)) return;
+
+    pthread_mutex_lock(&g_history_mutex);
+    if (series == HIST_SINR) g_sinr_ms = get_current_ms();
+    for (int i = 0; i < TIER_COUNT; i++) {
+        tier_record(&g_tiers[i], series, value, now);
+    }
+    pthread_mutex_unlock(&g_history_mutex);
+}
+
+size_t history_memory_usage(void) {
+    return sizeof(g_fine) + sizeof(g_minute) + sizeof(g_quarter) + sizeof(g_tiers);
+}
+
+/* ==================== 采样线程 ==================== */
+
+/* "XX%, -YY dBm" -> -YY */
+static int parse_signal_dbm(const char *s, double *dbm) {
+    const char *p = strstr(s, ", ");
+    if (!p) return -1;
+    *dbm = atof(p + 2);
+    return *dbm < 0 ? 0 : -1;
+}
+
+/*
+ * 查询服务小区 SINR. 小区记录启用时其采样已顺带记录 SINR, 间隔内已有
+ * 样本则不再查询, 避免同一 AT 命令重复下发.
+ */
+static void sample_sinr(void) {
+    SpengmdCell cell;
+    SpengmdRat rat;
+    char tech[16] = {0};
+    char *result = NULL;
+    long long now = get_current_ms();
+
+    /* 无论查询成败都等满一个间隔, 不在每个采样周期重试 */
+    pthread_mutex_lock(&g_history_mutex);
+    if (g_sinr_ms > 0 && now - g_sinr_ms < HISTORY_SINR_INTERVAL_MS) {
+        pthread_mutex_unlock(&g_history_mutex);
+        return;
+    }
+    g_sinr_ms = now;
+    pthread_mutex_unlock(&g_history_mutex);
+
+    /* 未驻留 LTE/NR 时没有 SINR, 槽位留空 */
+    if (ofono_get_serving_cell_tech(tech, sizeof(tech)) != 0) return;
+    if (strcmp(tech, "nr") == 0) {
+        rat = SPENGMD_NR;
+    } else if (strcmp(tech, "lte") == 0) {
+        rat = SPENGMD_LTE;
+    } else {
+        return;
+    }
+
+    if (execute_at(rat == SPENGMD_NR ? "AT+SPENGMD=0,14,1" : "AT+SPENGMD=0,6,0", &result) == 0 && result &&
+        spengmd_parse_serving(result, rat, &cell) == 0 && cell.arfcn != 0) {
+        history_record(HIST_SINR, cell.sinr);
+    }
+    g_free(result);
+}
+
+static void sample_once(void) {
+    static unsigned long long last_rx, last_tx;
+    static long long last_ms = -1;
+    SystemInfo info;
+    unsigned long long rx, tx;
+    long long now_ms = get_current_ms();
+    double dbm;
+
+    if (get_system_info(&info) == 0) {
+        history_record(HIST_CPU, info.cpu_usage);
+        if (info.total_ram > 0) history_record(HIST_MEM, info.ram_percent);
+        if (info.thermal_temp > 0) history_record(HIST_TEMP, info.thermal_temp);
+        if (parse_signal_dbm(info.signal_strength, &dbm) == 0) history_record(HIST_SIGNAL, dbm);
+    }
+
+    if (metrics_net_bytes(HISTORY_NET_IFACE, &rx, &tx) != 0) {
+        last_ms = -1;
+        return;
+    }
+    /* 计数器回绕或网卡重建时只更新基准 */
+    if (last_ms >= 0 && now_ms > last_ms && rx >= last_rx && tx >= last_tx) {
+        double sec = (now_ms - last_ms) / 1000.0;
+        history_record(HIST_RX, (rx - last_rx) * 8 / 1000.0 / sec);
+        history_record(HIST_TX, (tx - last_tx) * 8 / 1000.0 / sec);
+    }
+    last_rx = rx;
+    last_tx = tx;
+    last_ms = now_ms;
+}
+
+static void *sampler_thread(void *arg) {
+    long long next_due = get_current_ms();
+    (void)arg;
+
+    /* 周期采样的 AT 查询排在用户请求之后 */
+    at_sched_set_thread_priority(AT_PRIO_BACKGROUND);
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    while (!g_sampler_stop) {
+        struct timespec ts;
+
+        if (get_current_ms() >= next_due) {
+            pthread_mutex_unlock(&g_sampler_mutex);
+            sample_once();
+            /* 放在其他序列之后, AT 排队时不影响它们的采样时间 */
+            sample_sinr();
+            pthread_mutex_lock(&g_sampler_mutex);
+
+            /* 落后超过一个周期时不补采 */
+            next_due += HISTORY_TICK_MS;
+            if (next_due <= get_current_ms()) next_due = get_current_ms() + HISTORY_TICK_MS;
+            continue;
+        }
+
+        ts.tv_sec = next_due / 1000;
+        ts.tv_nsec = (next_due % 1000) * 1000000;
+        pthread_cond_timedwait(&g_sampler_cond, &g_sampler_mutex, &ts);
+    }
+    pthread_mutex_unlock(&g_sampler_mutex);
+    return NULL;
+}
+
+int history_init(void) {
+    pthread_condattr_t attr;
+
+    if (g_sampler_running) return 0;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_sampler_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_sampler_stop = 0;
+    if (pthread_create(&g_sampler_thread, NULL, sampler_thread, NULL) != 0) {
+        printf("[HISTORY] 创建采样线程失败\n");
+        pthread_cond_destroy(&g_sampler_cond);
+        return -1;
+    }
+    g_sampler_running = 1;
+    printf("[HISTORY] 指标历史已启动, 存储 %zu 字节\n", history_memory_usage());
+    return 0;
+}
+
+void history_deinit(void) {
+    if (!g_sampler_running) return;
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    g_sampler_stop = 1;
+    pthread_cond_signal(&g_sampler_cond);
+    pthread_mutex_unlock(&g_sampler_mutex);
+
+    pthread_join(g_sampler_thread, NULL);
+    pthread_cond_destroy(&g_sampler_cond);
+    g_sampler_running = 0;
+}
+
+/* ==================== HTTP 接口 ==================== */
+
+static int find_series(const char *name, size_t len) {
+    for (int s = 0; s < HIST_SERIES_COUNT; s++) {
+        if (strlen(g_series[s].name) == len && strncmp(g_series[s].name, name, len) == 0) return s;
+    }
+    return -1;
+}
+
+/* 解析 series=cpu,rx 为位掩码, 省略时返回全部 */
+static unsigned int parse_series_mask(struct mg_http_message *hm) {
+    char buf[HIST_QUERY_MAX];
+    unsigned int mask = 0;
+    const char *p;
+
+    if (mg_http_get_var(&hm->query, "series", buf, sizeof(buf)) <= 0) {
+        return (1u << HIST_SERIES_COUNT) - 1;
+    }
+    for (p = buf; *p; ) {
+        size_t len = strcspn(p, ",");
+        int s = find_series(p, len);
+        if (s >= 0) mask |= 1u << s;
+        p += len;
+        if (*p == ',') p++;
+    }
+    return mask;
+}
+
+static long long query_ll(struct mg_http_message *hm, const char *name, long long def) {
+    char buf[32];
+    if (mg_http_get_var(&hm->query, name, buf, sizeof(buf)) <= 0) return def;
+    return atoll(buf);
+}
+
+static void write_values(JsonWriter *w, HistTier *t, HistSeries s, long long first, long long last, int field) {
+    json_arr_begin(w);
+    for (long long k = first; k <= last; k++) {
+        int pos = (int)(k % t->slots);
+        int16_t q;
+
+        if (t->fine) {
+            q = t->fine[s * t->slots + pos];
+        } else {
+            HistAgg *a = &t->agg[s * t->slots + pos];
+            q = field == 0 ? a->min : field == 1 ? a->max : a->avg;
+        }
+        json_double(w, dequantize(s, q), g_series[s].precision);
+    }
+    json_arr_end(w);
+}
+
+/* GET /api/metrics/history - 获取指标历史 */
+void handle_metrics_history(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    long long now = (long long)time(NULL);
+    long long to = query_ll(hm, "to", now);
+    long long from = query_ll(hm, "from", to - HIST_FINE_SLOTS);
+    unsigned int mask = parse_series_mask(hm);
+    char res[8];
+    HistTier *t = NULL;
+    long long first, last;
+    JsonWriter w;
+
+    if (from > to || mask == 0) {
+        HTTP_ERROR(c, 400, "参数错误");
+        return;
+    }
+
+    if (mg_http_get_var(&hm->query, "res", res, sizeof(res)) > 0) {
+        for (int i = 0; i < TIER_COUNT; i++) {
+            if (strcmp(res, g_tiers[i].name) == 0) t = &g_tiers[i];
+        }
+        if (!t) {
+            HTTP_ERROR(c, 400, "res 仅支持 1s/1m/15m");
+            return;
+        }
+    } else {
+        /* 能覆盖 from 的最细分辨率 */
+        t = &g_tiers[TIER_QUARTER];
+        for (int i = 0; i < TIER_COUNT; i++) {
+            if (now - from < (long long)g_tiers[i].res * g_tiers[i].slots) {
+                t = &g_tiers[i];
+                break;
+            }
+        }
+    }
+
+    /* 发送期间持锁, 保证各序列的槽位范围一致 (纯内存拷贝, 耗时很短) */
+    pthread_mutex_lock(&g_history_mutex);
+    first = from / t->res;
+    last = to / t->res;
+    if (first <= t->head - t->slots) first = t->head - t->slots + 1;
+    if (last > t->head) last = t->head;
+    if (t->head < 0 || first > last) {
+        first = to / t->res;
+        last = first - 1;
+    }
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    json_kv_str(&w, "res", t->name);
+    json_kv_int(&w, "step", t->res);
+    json_kv_int(&w, "start", first * t->res);
+    json_kv_int(&w, "count", last - first + 1);
+    json_kv_uint(&w, "memory", history_memory_usage());
+    json_key(&w, "series");
+    json_obj_begin(&w);
+    for (int s = 0; s < HIST_SERIES_COUNT; s++) {
+        if (!(mask & (1u << s))) continue;
+        json_key(&w, g_series[s].name);
+        if (t->fine) {
+            write_values(&w, t, s, first, last, 2);
+        } else {
+            json_obj_begin(&w);
+            json_key(&w, "min");
+            write_values(&w, t, s, first, last, 0);
+            json_key(&w, "max");
+            write_values(&w, t, s, first, last, 1);
+            json_key(&w, "avg");
+            write_values(&w, t, s, first, last, 2);
+            json_obj_end(&w);
+        }
+    }
+    json_obj_end(&w);
+    json_obj_end(&w);
+    json_obj_end(&w);
+    pthread_mutex_unlock(&g_history_mutex);
+    json_end(&w);
+}
@@ -0,0 +1,350 @@
+/**
+ * @file metrics.c
+ * @brief procfs/sysfs 指标读取实现
+ *
+ * 文件描述符在首次使用时打开并一直保留, 每次读取只需一次 pread.
+ * procfs 的 seq_file 与 sysfs 属性在偏移 0 读取时都会重新生成内容.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include "metrics.h"
+
+#define THERMAL_DIR "/sys/class/thermal"
+
+typedef struct {
+    const char *path;
+    int fd;
+    long long retry_ms;         /* 打开失败后下次允许重试的时间 */
+} MetricFile;
+
+enum {
+    MF_MEMINFO = 0,
+    MF_STAT,
+    MF_UPTIME,
+    MF_BATTERY,
+    MF_NETDEV,
+    MF_COUNT
+};
+
+static MetricFile g_files[MF_COUNT] = {
+    [MF_MEMINFO] = {"/proc/meminfo", -1, 0},
+    [MF_STAT]    = {"/proc/stat", -1, 0},
+    [MF_UPTIME]  = {"/proc/uptime", -1, 0},
+    [MF_BATTERY] = {"/sys/class/power_supply/battery/uevent", -1, 0},
+    [MF_NETDEV]  = {"/proc/net/dev", -1, 0},
+};
+
+static int g_thermal_fds[METRICS_MAX_THERMAL_ZONES];
+static int g_thermal_count = -1;    /* -1: 尚未发现 */
+
+/* 只保护打开/关闭, 读取不加锁 (pread 不改变文件偏移) */
+static pthread_mutex_t g_metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* ==================== 内部函数 ==================== */
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 获取常驻描述符, 首次使用或重试时间到达时打开 */
+static int file_fd(MetricFile *f) {
+    int fd = __atomic_load_n(&f->fd, __ATOMIC_ACQUIRE);
+    if (fd >= 0) return fd;
+
+    pthread_mutex_lock(&g_metrics_mutex);
+    fd = f->fd;
+    if (fd < 0) {
+        long long now = now_ms();
+        if (now >= f->retry_ms) {
+            fd = open(f->path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                f->retry_ms = now + METRICS_RETRY_MS;
+            } else {
+                __atomic_store_n(&f->fd, fd, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_metrics_mutex);
+    return fd;
+}
+
+/* 从偏移 0 读取到 buf 并补 '\0', 返回长度, 失败返回 -1 */
+static int read_at0(int fd, char *buf, size_t size) {
+    ssize_t n;
+
+    if (fd < 0) return -1;
+    n = pread(fd, buf, size - 1, 0);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+static int read_file(int idx, char *buf, size_t size) {
+    return read_at0(file_fd(&g_files[idx]), buf, size);
+}
+
+/* 跳过空格和制表符 */
+static const char *skip_blank(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+/* 解析无符号十进制数, 返回数字之后的位置, 无数字返回 NULL */
+static const char *scan_ull(const char *p, unsigned long long *out) {
+    unsigned long long v = 0;
+
+    p = skip_blank(p);
+    if (*p < '0' || *p > '9') return NULL;
+    while (*p >= '0' && *p <= '9') {
+        v = v * 10 + (unsigned long long)(*p - '0');
+        p++;
+    }
+    *out = v;
+    return p;
+}
+
+/* 解析有符号十进制数 */
+static const char *scan_ll(const char *p, long long *out) {
+    unsigned long long v;
+    int neg = 0;
+
+    p = skip_blank(p);
+    if (*p == '-' || *p == '+') {
+        neg = *p == '-';
+        p++;
+    }
+    p = scan_ull(p, &v);
+    if (!p) return NULL;
+    *out = neg ? -(long long)v : (long long)v;
+    return p;
+}
+
+/* 下一行起始位置 */
+static const char *next_line(const char *p) {
+    const char *nl = strchr(p, '\n');
+    return nl ? nl + 1 : NULL;
+}
+
+/* 行以 key 开头时返回 key 之后的位置 */
+static const char *match_key(const char *line, const char *key, size_t key_len) {
+    return strncmp(line, key, key_len) == 0 ? line + key_len : NULL;
+}
+
+/* 复制到行尾 */
+static void copy_value(char *dst, size_t size, const char *p) {
+    size_t i = 0;
+    while (p[i] && p[i] != '\n' && i < size - 1) {
+        dst[i] = p[i];
+        i++;
+    }
+    dst[i] = '\0';
+}
+
+/* 发现温区 (需持有锁) */
+static void discover_thermal_zones(void) {
+    DIR *dir;
+    struct dirent *entry;
+    int count = 0;
+
+    dir = opendir(THERMAL_DIR);
+    if (!dir) {
+        __atomic_store_n(&g_thermal_count, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    while ((entry = readdir(dir)) != NULL && count < METRICS_MAX_THERMAL_ZONES) {
+        char path[300];
+        int fd;
+
+        if (strncmp(entry->d_name, "thermal_zone", 12) != 0) continue;
+        snprintf(path, sizeof(path), THERMAL_DIR "/%s/temp", entry->d_name);
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) g_thermal_fds[count++] = fd;
+    }
+    closedir(dir);
+
+    /* 描述符写入完成后再发布数量 */
+    __atomic_store_n(&g_thermal_count, count, __ATOMIC_RELEASE);
+    printf("[METRICS] 发现 %d 个温区\n", count);
+}
+
+/* ==================== 公共接口 ==================== */
+
+int metrics_meminfo(MemMetrics *out) {
+    static const struct {
+        const char *key;
+        size_t len;
+        size_t ofs;
+    } keys[] = {
+        {"MemTotal:",     9,  offsetof(MemMetrics, total)},
+        {"MemFree:",      8,  offsetof(MemMetrics, free)},
+        {"MemAvailable:", 13, offsetof(MemMetrics, available)},
+        {"Buffers:",      8,  offsetof(MemMetrics, buffers)},
+        {"Cached:",       7,  offsetof(MemMetrics, cached)},
+    };
+    char buf[2048];
+    const char *line;
+    int found = 0;
+
+    memset(out, 0, sizeof(MemMetrics));
+    if (read_file(MF_MEMINFO, buf, sizeof(buf)) <= 0) return -1;
+
+    for (line = buf; line && *line && found < 5; line = next_line(line)) {
+        for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+            const char *p = match_key(line, keys[i].key, keys[i].len);
+            unsigned long long v;
+            if (p && scan_ull(p, &v)) {
+                *(unsigned long *)((char *)out + keys[i].ofs) = (unsigned long)v;
+                found++;
+                break;
+            }
+        }
+    }
+    return out->total > 0 ? 0 : -1;
+}
+
+int metrics_cpu(CpuMetrics *out) {
+    unsigned long long *fields[] = {
+        &out->user, &out->nice, &out->system, &out->idle,
+        &out->iowait, &out->irq, &out->softirq, &out->steal
+    };
+    char buf[512];
+    const char *p;
+    int n = 0;
+
+    memset(out, 0, sizeof(CpuMetrics));
+    if (read_file(MF_STAT, buf, sizeof(buf)) <= 0) return -1;
+
+    p = match_key(buf, "cpu ", 4);
+    if (!p) return -1;
+
+    /* 旧内核可能缺少后面几列, 缺失的保持为 0 */
+    while (n < 8 && (p = scan_ull(p, fields[n])) != NULL) n++;
+    return n >= 4 ? 0 : -1;
+}
+
+double metrics_uptime(void) {
+    char buf[64];
+    unsigned long long sec, frac = 0;
+    const char *p;
+    double scale = 1.0;
+
+    if (read_file(MF_UPTIME, buf, sizeof(buf)) <= 0) return -1;
+
+    p = scan_ull(buf, &sec);
+    if (!p) return -1;
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            frac = frac * 10 + (unsigned long long)(*p - '0');
+            scale *= 10.0;
+            p++;
+        }
+    }
+    return (double)sec + (double)frac / scale;
+}
+
+double metrics_thermal_temp(void) {
+    long long sum = 0;
+    int count = 0;
+    int zones = __atomic_load_n(&g_thermal_count, __ATOMIC_ACQUIRE);
+
+    if (zones < 0) {
+        pthread_mutex_lock(&g_metrics_mutex);
+        if (g_thermal_count < 0) discover_thermal_zones();
+        zones = g_thermal_count;
+        pthread_mutex_unlock(&g_metrics_mutex);
+    }
+
+    for (int i = 0; i < zones; i++) {
+        char buf[32];
+        long long v;
+        if (read_at0(g_thermal_fds[i], buf, sizeof(buf)) > 0 && scan_ll(buf, &v)) {
+            sum += v;
+            count++;
+        }
+    }
+
+    /* 与原 awk 实现一致: 各温区毫摄氏度平均后换算 */
+    if (count == 0) return -1;
+    return (double)sum / count / 1000.0;
+}
+
+int metrics_battery(BatteryMetrics *out) {
+    char buf[2048];
+    const char *line;
+
+    memset(out, 0, sizeof(BatteryMetrics));
+    strcpy(out->status, "Unknown");
+    strcpy(out->health, "Unknown");
+    if (read_file(MF_BATTERY, buf, sizeof(buf)) <= 0) return -1;
+
+    for (line = buf; line && *line; line = next_line(line)) {
+        const char *p;
+        long long v;
+
+        if (strncmp(line, "POWER_SUPPLY_", 13) != 0) continue;
+        line += 13;
+
+        if ((p = match_key(line, "STATUS=", 7)) != NULL) {
+            copy_value(out->status, sizeof(out->status), p);
+        } else if ((p = match_key(line, "HEALTH=", 7)) != NULL) {
+            copy_value(out->health, sizeof(out->health), p);
+        } else if ((p = match_key(line, "CAPACITY=", 9)) != NULL && scan_ll(p, &v)) {
+            out->capacity = (int)v;
+        } else if ((p = match_key(line, "TEMP=", 5)) != NULL && scan_ll(p, &v)) {
+            out->temperature = (int)v;
+        } else if ((p = match_key(line, "VOLTAGE_NOW=", 12)) != NULL && scan_ll(p, &v)) {
+            out->voltage_now = (int)v;
+        } else if ((p = match_key(line, "CURRENT_NOW=", 12)) != NULL && scan_ll(p, &v)) {
+            out->current_now = (int)v;
+        }
+    }
+    return 0;
+}
+
+int metrics_net_bytes(const char *iface, unsigned long long *rx, unsigned long long *tx) {
+    char buf[4096];
+    const char *line;
+    size_t len = strlen(iface);
+
+    *rx = 0;
+    *tx = 0;
+    if (read_file(MF_NETDEV, buf, sizeof(buf)) <= 0) return -1;
+
+    /* "  sipa_eth0: rx_bytes packets errs drop fifo frame compressed multicast tx_bytes ..." */
+    for (line = buf; line && *line; line = next_line(line)) {
+        const char *p = skip_blank(line);
+        unsigned long long skip;
+
+        if (strncmp(p, iface, len) != 0 || p[len] != ':') continue;
+        p = scan_ull(p + len + 1, rx);
+        for (int i = 0; i < 7 && p; i++) p = scan_ull(p, &skip);
+        if (p) p = scan_ull(p, tx);
+        return p ? 0 : -1;
+    }
+    return -1;
+}
+
+void metrics_close(void) {
+    pthread_mutex_lock(&g_metrics_mutex);
+    for (int i = 0; i < MF_COUNT; i++) {
+        if (g_files[i].fd >= 0) close(g_files[i].fd);
+        g_files[i].fd = -1;
+        g_files[i].retry_ms = 0;
+    }
+    for (int i = 0; i < g_thermal_count; i++) {
+        close(g_thermal_fds[i]);
+    }
+    g_thermal_count = -1;
+    pthread_mutex_unlock(&g_metrics_mutex);
+}
@@ -3,7 +3,7 @@
  * @brief ofono D-Bus 接口实现 (合并自 dbus_core.c)
  * 
  * 包含：
- * - D-Bus 连接管理
+ * - 属性镜像 (连接与代理缓存见 dbus_conn.c)
  * - AT 命令执行
  * - oFono 服务调用（网络模式、APN、信号等）
  */
@@ -15,27 +15,21 @@
 #include <pthread.h>
 #include "ofono.h"
 #include "dbus_core.h"
-#include "sysinfo.h"
+#include "at_sched.h"
+#include "dbus_conn.h"
 
 /* ==================== 常量定义 ==================== */
 #define OFONO_MODEM_IFACE   "org.ofono.Modem"
+#define OFONO_MANAGER_IFACE "org.ofono.Manager"
+#define OFONO_CONNECTION_CONTEXT  "org.ofono.ConnectionContext"
+#define OFONO_CONNECTION_MANAGER  "org.ofono.ConnectionManager"
+#define OFONO_NETWORK_REGISTRATION "org.ofono.NetworkRegistration"
+#define OFONO_SIM_MANAGER   "org.ofono.SimManager"
 #define DEFAULT_MODEM_PATH  "/ril_0"
 #define AT_COMMAND_TIMEOUT  8000  /* 8秒超时 (毫秒) */
-#define MAX_RETRIES         1
 
 /* ==================== 全局变量 ==================== */
-static GDBusConnection *g_dbus_conn = NULL;
-static pthread_mutex_t g_at_mutex = PTHREAD_MUTEX_INITIALIZER;
 static char g_last_error[512] = {0};
-static char g_modem_path[64] = DEFAULT_MODEM_PATH;
-
-/* 全局 Proxy 缓存 */
-static struct {
-    GDBusProxy *modem;
-    GDBusProxy *nw_reg;
-    GDBusProxy *conn_mgr;
-    GDBusProxy *nw_mon;
-} g_proxies = {NULL, NULL, NULL, NULL};
 
 /* ==================== 内部辅助函数 ==================== */
 
@@ -47,225 +41,900 @@ static void set_error(const char *fmt, ...) {
     va_end(args);
 }
 
-/* 释放所有代理 */
-static void clear_proxies(void) {
-    if (g_proxies.modem && G_IS_OBJECT(g_proxies.modem)) g_object_unref(g_proxies.modem);
-    if (g_proxies.nw_reg && G_IS_OBJECT(g_proxies.nw_reg)) g_object_unref(g_proxies.nw_reg);
-    if (g_proxies.conn_mgr && G_IS_OBJECT(g_proxies.conn_mgr)) g_object_unref(g_proxies.conn_mgr);
-    if (g_proxies.nw_mon && G_IS_OBJECT(g_proxies.nw_mon)) g_object_unref(g_proxies.nw_mon);
-    memset(&g_proxies, 0, sizeof(g_proxies));
-}
+/* 确保共享 D-Bus 连接可用 (dbus_conn.h 负责重连与退避) */
+static int ensure_connection(void) {
+    GDBusConnection *conn = dbus_conn_get();
 
-/* 检查 D-Bus 连接是否有效 */
-static int is_connection_valid(void) {
-    if (!g_dbus_conn) return 0;
-    if (g_dbus_connection_is_closed(g_dbus_conn)) return 0;
+    if (!conn) return 0;
+    g_object_unref(conn);
     return 1;
 }
 
-/* 初始化所有代理 */
-static int init_proxies(void) {
-    GError *error = NULL;
-    
-    /* 1. Modem Proxy */
-    g_proxies.modem = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, g_modem_path, OFONO_MODEM_IFACE, NULL, &error);
-    if (!g_proxies.modem) goto fail;
-
-    /* 2. NetworkRegistration Proxy */
-    g_proxies.nw_reg = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, g_modem_path, "org.ofono.NetworkRegistration", NULL, &error);
-    if (!g_proxies.nw_reg) goto fail;
-
-    /* 3. ConnectionManager Proxy */
-    g_proxies.conn_mgr = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, g_modem_path, "org.ofono.ConnectionManager", NULL, &error);
-    if (!g_proxies.conn_mgr) goto fail;
-
-    /* 4. NetworkMonitor Proxy */
-    g_proxies.nw_mon = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, g_modem_path, "org.ofono.NetworkMonitor", NULL, &error);
-    if (!g_proxies.nw_mon) goto fail;
+/* 经共享代理缓存发起同步调用, params 为浮动引用 */
+static GVariant *proxy_call_sync(const char *path, const char *iface, const char *method,
+                                 GVariant *params, int timeout_ms, GError **error) {
+    GDBusProxy *proxy = dbus_conn_proxy(path, iface, error);
+    GVariant *ret;
 
+    if (!proxy) {
+        if (params) g_variant_unref(g_variant_ref_sink(params));
+        return NULL;
+    }
+    ret = g_dbus_proxy_call_sync(proxy, method, params,
+        G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, error);
+    g_object_unref(proxy);
+    return ret;
+}
+
+/* ==================== 属性镜像 ==================== */
+
+/*
+ * 启动时通过 GetModems/GetProperties/GetContexts 异步读取一次,
+ * 之后由 PropertyChanged/ContextAdded/ContextRemoved/ModemAdded/ModemRemoved
+ * 信号保持最新. 信号与异步应答都在 GLib 主循环线程处理, 其他线程的
+ * 读取只访问内存. 某接口尚未完成初始读取时, 读取函数回退到同步调用.
+ */
+
+#define OFONO_MAX_MODEMS    4
+#define OFONO_MAX_OBSERVERS 8
+#define MIRROR_SEED_TIMEOUT 10000
+
+/* 镜像的接口 */
+#define MIR_MODEM       (1u << 0)
+#define MIR_RADIO       (1u << 1)
+#define MIR_NETREG      (1u << 2)
+#define MIR_CONNMAN     (1u << 3)
+#define MIR_SIM         (1u << 4)
+#define MIR_CONTEXTS    (1u << 5)   /* ConnectionContext, 随 ConnectionManager 出现 */
+
+typedef struct {
+    int used;
+    char path[32];
+    unsigned int present;           /* Modem.Interfaces 中存在的接口 */
+    unsigned int pending;           /* 初始读取进行中 */
+    unsigned int seeded;            /* 已完成初始读取 */
+    /* org.ofono.Modem */
+    int online;
+    char serial[32];
+    char modem_tech_pref[64];
+    /* org.ofono.RadioSettings */
+    char tech_pref[64];
+    /* org.ofono.NetworkRegistration */
+    char reg_status[32];
+    int strength;
+    int strength_dbm;
+    int has_dbm;
+    /* org.ofono.ConnectionManager */
+    int attached;
+    int roaming_allowed;
+    /* org.ofono.SimManager */
+    char iccid[24];
+    char imsi[20];
+    /* org.ofono.ConnectionContext */
+    ApnContext contexts[MAX_APN_CONTEXTS];
+    int context_count;
+} ModemMirror;
+
+typedef struct {
+    guint generation;
+    unsigned int bit;
+    char path[32];
+} SeedRequest;
+
+static const struct {
+    const char *name;
+    unsigned int bit;
+} g_mirror_ifaces[] = {
+    {OFONO_MODEM_IFACE,          MIR_MODEM},
+    {OFONO_RADIO_SETTINGS,       MIR_RADIO},
+    {OFONO_NETWORK_REGISTRATION, MIR_NETREG},
+    {OFONO_CONNECTION_MANAGER,   MIR_CONNMAN},
+    {OFONO_SIM_MANAGER,          MIR_SIM},
+    {OFONO_CONNECTION_CONTEXT,   MIR_CONTEXTS},
+};
+
+/* 以下状态由 g_mirror_mutex 保护 */
+static pthread_mutex_t g_mirror_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ModemMirror g_modems[OFONO_MAX_MODEMS];
+static char g_datacard[64];                 /* 空表示未知 */
+static GDBusConnection *g_mirror_conn = NULL;
+static guint g_mirror_signal_id = 0;
+static guint g_mirror_generation = 0;       /* oFono 重启或连接重建时递增, 丢弃过期应答 */
+
+static struct {
+    OfonoPropertyObserver fn;
+    void *user_data;
+} g_observers[OFONO_MAX_OBSERVERS];
+static int g_observer_count = 0;
+
+static unsigned int iface_bit(const char *name) {
+    for (size_t i = 0; i < sizeof(g_mirror_ifaces) / sizeof(g_mirror_ifaces[0]); i++) {
+        if (g_strcmp0(name, g_mirror_ifaces[i].name) == 0) return g_mirror_ifaces[i].bit;
+    }
     return 0;
+}
+
+/* 仅用于日志, DISABLE_PRINTF 时未被引用 */
+__attribute__((unused))
+static const char *iface_name(unsigned int bit) {
+    for (size_t i = 0; i < sizeof(g_mirror_ifaces) / sizeof(g_mirror_ifaces[0]); i++) {
+        if (g_mirror_ifaces[i].bit == bit) return g_mirror_ifaces[i].name;
+    }
+    return NULL;
+}
+
+/* 字符串/对象路径属性复制, 类型不符时忽略 */
+static void copy_variant_str(char *dst, size_t size, GVariant *v) {
+    if (!g_variant_is_of_type(v, G_VARIANT_TYPE_STRING) &&
+        !g_variant_is_of_type(v, G_VARIANT_TYPE_OBJECT_PATH)) return;
+    g_strlcpy(dst, g_variant_get_string(v, NULL), size);
+}
+
+static void copy_variant_bool(int *dst, GVariant *v) {
+    if (g_variant_is_of_type(v, G_VARIANT_TYPE_BOOLEAN)) *dst = g_variant_get_boolean(v) ? 1 : 0;
+}
+
+/* 以下函数需持有 g_mirror_mutex */
+
+static ModemMirror *find_modem(const char *path) {
+    for (int i = 0; i < OFONO_MAX_MODEMS; i++) {
+        if (g_modems[i].used && strcmp(g_modems[i].path, path) == 0) return &g_modems[i];
+    }
+    return NULL;
+}
+
+/* context 路径 (/ril_0/context2) 所属的 modem */
+static ModemMirror *find_modem_of(const char *object_path) {
+    for (int i = 0; i < OFONO_MAX_MODEMS; i++) {
+        size_t len = strlen(g_modems[i].path);
+        if (g_modems[i].used && strncmp(g_modems[i].path, object_path, len) == 0 &&
+            object_path[len] == '/') {
+            return &g_modems[i];
+        }
+    }
+    return NULL;
+}
+
+static ModemMirror *add_modem(const char *path) {
+    ModemMirror *m = find_modem(path);
+    if (m) return m;
+    for (int i = 0; i < OFONO_MAX_MODEMS; i++) {
+        if (!g_modems[i].used) {
+            m = &g_modems[i];
+            memset(m, 0, sizeof(*m));
+            m->used = 1;
+            g_strlcpy(m->path, path, sizeof(m->path));
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static ApnContext *find_context(ModemMirror *m, const char *path) {
+    for (int i = 0; i < m->context_count; i++) {
+        if (strcmp(m->contexts[i].path, path) == 0) return &m->contexts[i];
+    }
+    return NULL;
+}
+
+/* 新建 context, 缺省值与原 GetContexts 解析一致 */
+static ApnContext *add_context(ModemMirror *m, const char *path) {
+    ApnContext *ctx = find_context(m, path);
+    if (ctx) return ctx;
+    if (m->context_count >= MAX_APN_CONTEXTS) return NULL;
+    ctx = &m->contexts[m->context_count++];
+    memset(ctx, 0, sizeof(*ctx));
+    g_strlcpy(ctx->path, path, sizeof(ctx->path));
+    strcpy(ctx->name, "Internet");
+    strcpy(ctx->protocol, "ip");
+    strcpy(ctx->auth_method, "chap");
+    return ctx;
+}
+
+static void remove_context(ModemMirror *m, const char *path) {
+    for (int i = 0; i < m->context_count; i++) {
+        if (strcmp(m->contexts[i].path, path) == 0) {
+            memmove(&m->contexts[i], &m->contexts[i + 1],
+                    (size_t)(m->context_count - i - 1) * sizeof(ApnContext));
+            m->context_count--;
+            return;
+        }
+    }
+}
+
+static void apply_context_prop(ApnContext *ctx, const char *key, GVariant *v) {
+    if (strcmp(key, "Name") == 0) copy_variant_str(ctx->name, sizeof(ctx->name), v);
+    else if (strcmp(key, "Active") == 0) copy_variant_bool(&ctx->active, v);
+    else if (strcmp(key, "AccessPointName") == 0) copy_variant_str(ctx->apn, sizeof(ctx->apn), v);
+    else if (strcmp(key, "Protocol") == 0) copy_variant_str(ctx->protocol, sizeof(ctx->protocol), v);
+    else if (strcmp(key, "Username") == 0) copy_variant_str(ctx->username, sizeof(ctx->username), v);
+    else if (strcmp(key, "Password") == 0) copy_variant_str(ctx->password, sizeof(ctx->password), v);
+    else if (strcmp(key, "AuthenticationMethod") == 0) copy_variant_str(ctx->auth_method, sizeof(ctx->auth_method), v);
+    else if (strcmp(key, "Type") == 0) copy_variant_str(ctx->context_type, sizeof(ctx->context_type), v);
+}
+
+static void apply_modem_prop(ModemMirror *m, unsigned int bit, const char *key, GVariant *v) {
+    switch (bit) {
+    case MIR_MODEM:
+        if (strcmp(key, "Online") == 0) {
+            copy_variant_bool(&m->online, v);
+        } else if (strcmp(key, "Serial") == 0) {
+            copy_variant_str(m->serial, sizeof(m->serial), v);
+        } else if (strcmp(key, "TechnologyPreference") == 0) {
+            copy_variant_str(m->modem_tech_pref, sizeof(m->modem_tech_pref), v);
+        } else if (strcmp(key, "Interfaces") == 0 && g_variant_is_of_type(v, G_VARIANT_TYPE_STRING_ARRAY)) {
+            GVariantIter iter;
+            const gchar *name;
+            unsigned int present = MIR_MODEM;
+
+            g_variant_iter_init(&iter, v);
+            while (g_variant_iter_next(&iter, "&s", &name)) {
+                present |= iface_bit(name);
+            }
+            if (present & MIR_CONNMAN) present |= MIR_CONTEXTS;
+
+            /* 消失的接口不再视为已读取, 重新出现时再读一次 */
+            m->seeded &= present;
+            m->pending &= present;
+            m->present = present;
+        }
+        break;
+    case MIR_RADIO:
+        if (strcmp(key, "TechnologyPreference") == 0) copy_variant_str(m->tech_pref, sizeof(m->tech_pref), v);
+        break;
+    case MIR_NETREG:
+        if (strcmp(key, "Status") == 0) {
+            copy_variant_str(m->reg_status, sizeof(m->reg_status), v);
+        } else if (strcmp(key, "Strength") == 0 && g_variant_is_of_type(v, G_VARIANT_TYPE_BYTE)) {
+            m->strength = g_variant_get_byte(v);
+        } else if (strcmp(key, "StrengthDbm") == 0 && g_variant_is_of_type(v, G_VARIANT_TYPE_INT32)) {
+            m->strength_dbm = g_variant_get_int32(v);
+            m->has_dbm = 1;
+        }
+        break;
+    case MIR_CONNMAN:
+        if (strcmp(key, "Attached") == 0) copy_variant_bool(&m->attached, v);
+        else if (strcmp(key, "RoamingAllowed") == 0) copy_variant_bool(&m->roaming_allowed, v);
+        break;
+    case MIR_SIM:
+        if (strcmp(key, "CardIdentifier") == 0) copy_variant_str(m->iccid, sizeof(m->iccid), v);
+        else if (strcmp(key, "SubscriberIdentity") == 0) copy_variant_str(m->imsi, sizeof(m->imsi), v);
+        break;
+    default:
+        break;
+    }
+}
+
+static void apply_modem_dict(ModemMirror *m, unsigned int bit, GVariant *dict) {
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *value;
+
+    g_variant_iter_init(&iter, dict);
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        apply_modem_prop(m, bit, key, value);
+        g_variant_unref(value);
+    }
+}
+
+static void apply_context_dict(ApnContext *ctx, GVariant *dict) {
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *value;
+
+    g_variant_iter_init(&iter, dict);
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        apply_context_prop(ctx, key, value);
+        g_variant_unref(value);
+    }
+}
+
+/* 取出需要初始读取的接口并标记为进行中 */
+static unsigned int take_unseeded(ModemMirror *m) {
+    unsigned int bits = m->present & ~m->seeded & ~m->pending & ~MIR_MODEM;
+    m->pending |= bits;
+    return bits;
+}
+
+/* ---- 异步初始读取 (不持锁调用) ---- */
+
+static void on_seed_reply(GObject *source, GAsyncResult *res, gpointer user_data) {
+    SeedRequest *req = user_data;
+    GError *error = NULL;
+    GVariant *ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+    ModemMirror *m;
+
+    pthread_mutex_lock(&g_mirror_mutex);
+    m = req->generation == g_mirror_generation ? find_modem(req->path) : NULL;
+    if (m) m->pending &= ~req->bit;
+
+    if (!ret) {
+        printf("[OFONO] 读取 %s %s 失败: %s\n", req->path, iface_name(req->bit),
+               error ? error->message : "unknown");
+    } else if (m && (m->present & req->bit)) {
+        GVariant *arg = g_variant_get_child_value(ret, 0);
+
+        if (req->bit == MIR_CONTEXTS) {
+            GVariantIter iter;
+            const gchar *path;
+            GVariant *props;
+
+            m->context_count = 0;
+            g_variant_iter_init(&iter, arg);
+            while (g_variant_iter_next(&iter, "(&o@a{sv})", &path, &props)) {
+                ApnContext *ctx = add_context(m, path);
+                if (ctx) apply_context_dict(ctx, props);
+                g_variant_unref(props);
+            }
+        } else {
+            apply_modem_dict(m, req->bit, arg);
+        }
+        m->seeded |= req->bit;
+        g_variant_unref(arg);
+    }
+    pthread_mutex_unlock(&g_mirror_mutex);
 
-fail:
-    printf("初始化 D-Bus 代理失败: %s\n", error ? error->message : "unknown");
+    if (ret) g_variant_unref(ret);
     if (error) g_error_free(error);
-    clear_proxies();
-    return -1;
+    g_free(req);
 }
 
-/* 确保 D-Bus 连接和代理有效 */
-static int ensure_connection(void) {
+static void seed_interfaces(GDBusConnection *conn, guint generation, const char *path, unsigned int bits) {
+    for (size_t i = 0; i < sizeof(g_mirror_ifaces) / sizeof(g_mirror_ifaces[0]); i++) {
+        unsigned int bit = g_mirror_ifaces[i].bit;
+        SeedRequest *req;
+
+        if (!(bits & bit)) continue;
+
+        req = g_new0(SeedRequest, 1);
+        req->generation = generation;
+        req->bit = bit;
+        g_strlcpy(req->path, path, sizeof(req->path));
+
+        if (bit == MIR_CONTEXTS) {
+            g_dbus_connection_call(conn, OFONO_SERVICE, path, OFONO_CONNECTION_MANAGER,
+                "GetContexts", NULL, G_VARIANT_TYPE("(a(oa{sv}))"),
+                G_DBUS_CALL_FLAGS_NONE, MIRROR_SEED_TIMEOUT, NULL, on_seed_reply, req);
+        } else {
+            g_dbus_connection_call(conn, OFONO_SERVICE, path, g_mirror_ifaces[i].name,
+                "GetProperties", NULL, G_VARIANT_TYPE("(a{sv})"),
+                G_DBUS_CALL_FLAGS_NONE, MIRROR_SEED_TIMEOUT, NULL, on_seed_reply, req);
+        }
+    }
+}
+
+/* 添加/更新 modem 并读取其余接口 (主循环线程) */
+static void mirror_add_modem(GDBusConnection *conn, const char *path, GVariant *props) {
+    ModemMirror *m;
+    unsigned int bits = 0;
+    guint generation;
+
+    pthread_mutex_lock(&g_mirror_mutex);
+    generation = g_mirror_generation;
+    m = add_modem(path);
+    if (m) {
+        apply_modem_dict(m, MIR_MODEM, props);
+        m->seeded |= MIR_MODEM;
+        bits = take_unseeded(m);
+    } else {
+        printf("[OFONO] modem 数量超过 %d, 忽略 %s\n", OFONO_MAX_MODEMS, path);
+    }
+    pthread_mutex_unlock(&g_mirror_mutex);
+
+    if (bits) seed_interfaces(conn, generation, path, bits);
+}
+
+static void on_modems_reply(GObject *source, GAsyncResult *res, gpointer user_data) {
+    GDBusConnection *conn = G_DBUS_CONNECTION(source);
+    guint generation = GPOINTER_TO_UINT(user_data);
     GError *error = NULL;
+    GVariant *ret = g_dbus_connection_call_finish(conn, res, &error);
+    GVariant *arg;
+    GVariantIter iter;
+    const gchar *path;
+    GVariant *props;
+
+    if (!ret) {
+        printf("[OFONO] GetModems 失败: %s\n", error ? error->message : "unknown");
+        if (error) g_error_free(error);
+        return;
+    }
 
-    if (is_connection_valid() && g_proxies.modem != NULL) {
-        return 1;
+    pthread_mutex_lock(&g_mirror_mutex);
+    if (generation != g_mirror_generation) {
+        pthread_mutex_unlock(&g_mirror_mutex);
+        g_variant_unref(ret);
+        return;
     }
+    pthread_mutex_unlock(&g_mirror_mutex);
 
-    /* 如果连接断开，先清理旧的 */
-    if (g_dbus_conn && G_IS_OBJECT(g_dbus_conn)) {
-        g_object_unref(g_dbus_conn);
-        g_dbus_conn = NULL;
+    arg = g_variant_get_child_value(ret, 0);
+    g_variant_iter_init(&iter, arg);
+    while (g_variant_iter_next(&iter, "(&o@a{sv})", &path, &props)) {
+        mirror_add_modem(conn, path, props);
+        g_variant_unref(props);
     }
-    clear_proxies();
+    g_variant_unref(arg);
+    g_variant_unref(ret);
+}
+
+static void on_datacard_reply(GObject *source, GAsyncResult *res, gpointer user_data) {
+    guint generation = GPOINTER_TO_UINT(user_data);
+    GError *error = NULL;
+    GVariant *ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+    const gchar *path = NULL;
 
-    g_dbus_conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
-    if (!g_dbus_conn) {
+    if (!ret) {
         if (error) g_error_free(error);
-        return 0;
+        return;
+    }
+    g_variant_get(ret, "(&o)", &path);
+    pthread_mutex_lock(&g_mirror_mutex);
+    if (generation == g_mirror_generation && path) {
+        g_strlcpy(g_datacard, path, sizeof(g_datacard));
     }
+    pthread_mutex_unlock(&g_mirror_mutex);
+    g_variant_unref(ret);
+}
+
+/* 清空镜像, 之后到达的旧应答被丢弃 (需持有 g_mirror_mutex) */
+static void mirror_reset_locked(void) {
+    g_mirror_generation++;
+    memset(g_modems, 0, sizeof(g_modems));
+    g_datacard[0] = '\0';
+}
+
+static void notify_observers(const char *path, const char *iface, const char *key, GVariant *value) {
+    OfonoPropertyObserver fns[OFONO_MAX_OBSERVERS];
+    void *data[OFONO_MAX_OBSERVERS];
+    int count;
 
-    /* 重新获取路径 */
-    char slot[16], ril_path[32];
-    if (get_current_slot(slot, ril_path) == 0 && strcmp(ril_path, "unknown") != 0) {
-        strncpy(g_modem_path, ril_path, sizeof(g_modem_path) - 1);
+    pthread_mutex_lock(&g_mirror_mutex);
+    count = g_observer_count;
+    for (int i = 0; i < count; i++) {
+        fns[i] = g_observers[i].fn;
+        data[i] = g_observers[i].user_data;
     }
+    pthread_mutex_unlock(&g_mirror_mutex);
 
-    if (init_proxies() != 0) return 0;
-    
-    return 1;
+    for (int i = 0; i < count; i++) {
+        fns[i](path, iface, key, value, data[i]);
+    }
+}
+
+/* ---- 信号处理 (主循环线程) ---- */
+
+static void on_ofono_signal(GDBusConnection *conn, const gchar *sender,
+    const gchar *object_path, const gchar *interface_name,
+    const gchar *signal_name, GVariant *parameters, gpointer user_data) {
+    unsigned int bit = iface_bit(interface_name);
+    unsigned int seed_bits = 0;
+    guint generation;
+    ModemMirror *m;
+    (void)sender; (void)user_data;
+
+    if (g_strcmp0(interface_name, OFONO_MANAGER_IFACE) == 0) {
+        if (g_strcmp0(signal_name, "ModemAdded") == 0 &&
+            g_variant_is_of_type(parameters, G_VARIANT_TYPE("(oa{sv})"))) {
+            const gchar *path;
+            GVariant *props;
+
+            g_variant_get(parameters, "(&o@a{sv})", &path, &props);
+            mirror_add_modem(conn, path, props);
+            g_variant_unref(props);
+        } else if (g_strcmp0(signal_name, "ModemRemoved") == 0 &&
+                   g_variant_is_of_type(parameters, G_VARIANT_TYPE("(o)"))) {
+            const gchar *path;
+
+            g_variant_get(parameters, "(&o)", &path);
+            pthread_mutex_lock(&g_mirror_mutex);
+            m = find_modem(path);
+            if (m) memset(m, 0, sizeof(*m));
+            pthread_mutex_unlock(&g_mirror_mutex);
+        }
+        return;
+    }
+
+    if (!bit) return;
+
+    if (g_strcmp0(signal_name, "PropertyChanged") == 0 &&
+        g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sv)"))) {
+        const gchar *key;
+        GVariant *value;
+
+        g_variant_get(parameters, "(&sv)", &key, &value);
+
+        pthread_mutex_lock(&g_mirror_mutex);
+        generation = g_mirror_generation;
+        if (bit == MIR_CONTEXTS) {
+            m = find_modem_of(object_path);
+            ApnContext *ctx = m ? find_context(m, object_path) : NULL;
+            if (ctx) apply_context_prop(ctx, key, value);
+        } else if ((m = find_modem(object_path)) != NULL) {
+            apply_modem_prop(m, bit, key, value);
+            if (bit == MIR_MODEM && strcmp(key, "Interfaces") == 0) seed_bits = take_unseeded(m);
+        }
+        pthread_mutex_unlock(&g_mirror_mutex);
+
+        if (seed_bits) seed_interfaces(conn, generation, object_path, seed_bits);
+        notify_observers(object_path, interface_name, key, value);
+        g_variant_unref(value);
+    } else if (bit == MIR_CONNMAN && g_strcmp0(signal_name, "ContextAdded") == 0 &&
+               g_variant_is_of_type(parameters, G_VARIANT_TYPE("(oa{sv})"))) {
+        const gchar *path;
+        GVariant *props;
+
+        g_variant_get(parameters, "(&o@a{sv})", &path, &props);
+        pthread_mutex_lock(&g_mirror_mutex);
+        m = find_modem(object_path);
+        if (m) {
+            ApnContext *ctx = add_context(m, path);
+            if (ctx) apply_context_dict(ctx, props);
+        }
+        pthread_mutex_unlock(&g_mirror_mutex);
+        g_variant_unref(props);
+    } else if (bit == MIR_CONNMAN && g_strcmp0(signal_name, "ContextRemoved") == 0 &&
+               g_variant_is_of_type(parameters, G_VARIANT_TYPE("(o)"))) {
+        const gchar *path;
+
+        g_variant_get(parameters, "(&o)", &path);
+        pthread_mutex_lock(&g_mirror_mutex);
+        m = find_modem(object_path);
+        if (m) remove_context(m, path);
+        pthread_mutex_unlock(&g_mirror_mutex);
+    }
+}
+
+/* oFono 出现 (含重启): 清空镜像后重新读取 */
+static void mirror_seed_all(GDBusConnection *conn) {
+    guint generation;
+
+    pthread_mutex_lock(&g_mirror_mutex);
+    mirror_reset_locked();
+    generation = g_mirror_generation;
+    pthread_mutex_unlock(&g_mirror_mutex);
+
+    printf("[OFONO] oFono 已就绪, 同步属性镜像\n");
+    g_dbus_connection_call(conn, OFONO_SERVICE, "/", OFONO_MANAGER_IFACE,
+        "GetModems", NULL, G_VARIANT_TYPE("(a(oa{sv}))"),
+        G_DBUS_CALL_FLAGS_NONE, MIRROR_SEED_TIMEOUT, NULL,
+        on_modems_reply, GUINT_TO_POINTER(generation));
+    g_dbus_connection_call(conn, OFONO_SERVICE, "/", OFONO_MANAGER_IFACE,
+        "GetDataCard", NULL, G_VARIANT_TYPE("(o)"),
+        G_DBUS_CALL_FLAGS_NONE, MIRROR_SEED_TIMEOUT, NULL,
+        on_datacard_reply, GUINT_TO_POINTER(generation));
+}
+
+/* 在新连接上订阅信号 (回调在默认主上下文中执行) */
+static void mirror_start(GDBusConnection *conn) {
+    pthread_mutex_lock(&g_mirror_mutex);
+    if (g_mirror_conn == conn) {
+        pthread_mutex_unlock(&g_mirror_mutex);
+        return;
+    }
+    if (g_mirror_conn) {
+        g_dbus_connection_signal_unsubscribe(g_mirror_conn, g_mirror_signal_id);
+        g_object_unref(g_mirror_conn);
+    }
+    mirror_reset_locked();
+    g_mirror_conn = g_object_ref(conn);
+
+    /* 订阅 org.ofono 发出的全部信号, 按接口分发 */
+    g_mirror_signal_id = g_dbus_connection_signal_subscribe(conn,
+        OFONO_SERVICE, NULL, NULL, NULL, NULL,
+        G_DBUS_SIGNAL_FLAGS_NONE, on_ofono_signal, NULL, NULL);
+    pthread_mutex_unlock(&g_mirror_mutex);
+}
+
+static void mirror_stop(void) {
+    pthread_mutex_lock(&g_mirror_mutex);
+    if (g_mirror_conn) {
+        g_dbus_connection_signal_unsubscribe(g_mirror_conn, g_mirror_signal_id);
+        g_object_unref(g_mirror_conn);
+        g_mirror_conn = NULL;
+        g_mirror_signal_id = 0;
+    }
+    mirror_reset_locked();
+    pthread_mutex_unlock(&g_mirror_mutex);
+}
+
+/* 共享连接状态变化 (主循环线程) */
+static void on_mirror_conn_event(DbusConnEvent ev, GDBusConnection *conn, void *user_data) {
+    (void)user_data;
+
+    switch (ev) {
+    case DBUS_CONN_EV_CONNECTED:
+        mirror_start(conn);
+        break;
+    case DBUS_CONN_EV_OFONO_APPEARED:
+        mirror_seed_all(conn);
+        break;
+    case DBUS_CONN_EV_OFONO_VANISHED:
+        pthread_mutex_lock(&g_mirror_mutex);
+        mirror_reset_locked();
+        pthread_mutex_unlock(&g_mirror_mutex);
+        printf("[OFONO] oFono 已退出, 属性镜像已清空\n");
+        break;
+    case DBUS_CONN_EV_DISCONNECTED:
+        mirror_stop();
+        break;
+    }
+}
+
+/* 写入成功后立即更新镜像, 不等待 PropertyChanged (value 可为浮动引用) */
+static void mirror_store(const char *path, unsigned int bit, const char *key, GVariant *value) {
+    ModemMirror *m;
+
+    g_variant_ref_sink(value);
+    pthread_mutex_lock(&g_mirror_mutex);
+    if (bit == MIR_CONTEXTS) {
+        m = find_modem_of(path);
+        ApnContext *ctx = m ? find_context(m, path) : NULL;
+        if (ctx) apply_context_prop(ctx, key, value);
+    } else if ((m = find_modem(path)) != NULL) {
+        apply_modem_prop(m, bit, key, value);
+    }
+    pthread_mutex_unlock(&g_mirror_mutex);
+    g_variant_unref(value);
+}
+
+/* 持锁返回已完成 bit 接口初始读取的 modem, 否则解锁并返回 NULL */
+static ModemMirror *mirror_lock_modem(const char *path, unsigned int bit) {
+    ModemMirror *m;
+
+    pthread_mutex_lock(&g_mirror_mutex);
+    m = path ? find_modem(path) : NULL;
+    if (m && (m->seeded & bit) == bit) return m;
+    pthread_mutex_unlock(&g_mirror_mutex);
+    return NULL;
+}
+
+/* 选择 internet context: 优先已配置 APN 的, 其次第一个 (需持有 g_mirror_mutex) */
+static ApnContext *pick_internet_context(ModemMirror *m) {
+    ApnContext *first = NULL;
+
+    for (int i = 0; i < m->context_count; i++) {
+        ApnContext *ctx = &m->contexts[i];
+        if (strcmp(ctx->context_type, "internet") != 0) continue;
+        if (ctx->apn[0] != '\0') return ctx;
+        if (!first) first = ctx;
+    }
+    return first;
+}
+
+int ofono_add_property_observer(OfonoPropertyObserver fn, void *user_data) {
+    int ret = -1;
+
+    if (!fn) return -1;
+    pthread_mutex_lock(&g_mirror_mutex);
+    if (g_observer_count < OFONO_MAX_OBSERVERS) {
+        g_observers[g_observer_count].fn = fn;
+        g_observers[g_observer_count].user_data = user_data;
+        g_observer_count++;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&g_mirror_mutex);
+    return ret;
+}
+
+int ofono_get_modem_online(const char *modem_path, int *online) {
+    ModemMirror *m = mirror_lock_modem(modem_path, MIR_MODEM);
+    if (!m) return -1;
+    *online = m->online;
+    pthread_mutex_unlock(&g_mirror_mutex);
+    return 0;
+}
+
+int ofono_get_modem_serial(const char *modem_path, char *buffer, int size) {
+    ModemMirror *m = mirror_lock_modem(modem_path, MIR_MODEM);
+    int ret = -1;
+
+    if (!m) return -1;
+    if (m->serial[0] != '\0') {
+        g_strlcpy(buffer, m->serial, size);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&g_mirror_mutex);
+    return ret;
+}
+
+int ofono_get_sim_identity(const char *modem_path, char *iccid, int iccid_size,
+                           char *imsi, int imsi_size) {
+    ModemMirror *m = mirror_lock_modem(modem_path, MIR_SIM);
+    int ret = 0;
+
+    if (!m) return -1;
+    /* 请求的字段都已知才算成功, 否则由调用方回退 */
+    if (iccid) {
+        if (m->iccid[0] != '\0') g_strlcpy(iccid, m->iccid, iccid_size);
+        else ret = -1;
+    }
+    if (imsi) {
+        if (m->imsi[0] != '\0') g_strlcpy(imsi, m->imsi, imsi_size);
+        else ret = -1;
+    }
+    pthread_mutex_unlock(&g_mirror_mutex);
+    return ret;
+}
+
+int ofono_get_roaming_cached(int *roaming_allowed, int *is_roaming) {
+    ModemMirror *m = mirror_lock_modem(DEFAULT_MODEM_PATH, MIR_CONNMAN | MIR_NETREG);
+
+    if (!m) return -1;
+    *roaming_allowed = m->roaming_allowed;
+    *is_roaming = strcmp(m->reg_status, "roaming") == 0 ? 1 : 0;
+    pthread_mutex_unlock(&g_mirror_mutex);
+    return 0;
+}
+
+/* 当前数据卡 modem 路径 (镜像未知时使用默认路径) */
+static void current_modem_path(char *path, size_t size) {
+    pthread_mutex_lock(&g_mirror_mutex);
+    g_strlcpy(path, g_datacard[0] != '\0' ? g_datacard : DEFAULT_MODEM_PATH, size);
+    pthread_mutex_unlock(&g_mirror_mutex);
 }
 
 /* ==================== dbus_core.h 接口实现 ==================== */
 
+static int g_mirror_listening = 0;      /* 仅主线程访问 */
+
 const char *dbus_get_last_error(void) {
     return g_last_error;
 }
 
 int is_dbus_initialized(void) {
-    return (g_dbus_conn != NULL && g_proxies.modem != NULL) ? 1 : 0;
+    return dbus_conn_ofono_available();
 }
 
 int init_dbus(void) {
-    return ensure_connection() ? 0 : -1;
+    int ret = dbus_conn_start();
+
+    if (!g_mirror_listening) {
+        dbus_conn_add_listener(on_mirror_conn_event, NULL);
+        g_mirror_listening = 1;
+    }
+    return ret;
 }
 
 void close_dbus(void) {
-    clear_proxies();
-    if (g_dbus_conn && G_IS_OBJECT(g_dbus_conn)) {
-        g_object_unref(g_dbus_conn);
-        g_dbus_conn = NULL;
+    if (g_mirror_listening) {
+        dbus_conn_remove_listener(on_mirror_conn_event, NULL);
+        g_mirror_listening = 0;
     }
+    mirror_stop();
+    dbus_conn_stop();
     printf("D-Bus 连接和 Proxy 池已关闭\n");
 }
 
-int execute_at(const char *command, char **result) {
-    GError *error = NULL;
+/*
+ * SendAtcmd 传输层, 只在 AT 调度线程中调用 (调度器保证串行).
+ * 连接关闭时重建连接后重试一次; 调制解调器忙时交给调度器延后重试.
+ */
+static int send_atcmd(const char *command, char **result, char *error, size_t error_size) {
+    GError *err = NULL;
     GVariant *ret = NULL;
-    int rc = -1;
-    int retry;
+    char path[64];
+    int reconnected = 0;
 
-    if (!command || !result) {
-        set_error("无效的参数");
-        return -1;
-    }
     *result = NULL;
+    current_modem_path(path, sizeof(path));
 
+    printf("准备发送 AT 命令: %s (%s)\n", command, path);
+
+    for (;;) {
+        err = NULL;
+        ret = proxy_call_sync(path, OFONO_MODEM_IFACE, "SendAtcmd",
+            g_variant_new("(s)", command), AT_COMMAND_TIMEOUT, &err);
+        if (ret) break;
+
+        printf("调用 SendAtcmd 失败 (%s): %s\n", command, err ? err->message : "unknown");
+
+        /* 连接关闭: 共享连接管理在下一次取代理时重建连接, 重试一次 */
+        if (err && strstr(err->message, "connection closed") && !reconnected) {
+            printf("检测到连接关闭，重试...\n");
+            g_error_free(err);
+            reconnected = 1;
+            continue;
+        }
+
+        /* 检测操作进行中错误 */
+        if (err && strstr(err->message, "Operation already in progress")) {
+            snprintf(error, error_size, "调用 SendAtcmd 失败: %s", err->message);
+            g_error_free(err);
+            return AT_TRANSPORT_BUSY;
+        }
+
+        snprintf(error, error_size, "调用 SendAtcmd 失败: %s", err ? err->message : "unknown");
+        if (err) g_error_free(err);
+        return AT_TRANSPORT_ERROR;
+    }
+
+    /* 提取结果字符串 */
+    const gchar *res_str = NULL;
+    g_variant_get(ret, "(&s)", &res_str);
+
+    if (!res_str) {
+        g_variant_unref(ret);
+        g_strlcpy(error, "空响应", error_size);
+        return AT_TRANSPORT_ERROR;
+    }
+
+    *result = g_strstrip(g_strdup(res_str));
+    printf("AT 命令 (%s) 响应: %s\n", command, *result);
+    g_variant_unref(ret);
+    return AT_TRANSPORT_OK;
+}
+
+/* 校验命令并确保调度线程已启动, 返回去除前导空白后的命令 */
+static const char *at_prepare(const char *command) {
     /* 去除首尾空白 */
     while (*command == ' ' || *command == '\t') command++;
 
     /* 验证 AT 命令格式 */
     if (!validate_at_command(command)) {
         set_error("无效的 AT 命令格式: %s", command);
-        return -1;
+        return NULL;
     }
 
-    /* 检查 D-Bus 是否已初始化 */
-    if (!is_dbus_initialized()) {
-        printf("D-Bus 未初始化，尝试初始化...\n");
-        if (init_dbus() != 0) {
-            return -1;
-        }
+    if (at_sched_start(send_atcmd) != 0) {
+        set_error("AT 调度器启动失败");
+        return NULL;
     }
+    return command;
+}
 
-    /* 获取互斥锁，确保串行执行 */
-    pthread_mutex_lock(&g_at_mutex);
-
-    printf("准备发送 AT 命令: %s\n", command);
-
-    /* 重试逻辑 */
-    for (retry = 0; retry <= MAX_RETRIES; retry++) {
-        error = NULL;
-
-        /* 调用 oFono 的 SendAtcmd 方法 */
-        ret = g_dbus_proxy_call_sync(
-            g_proxies.modem,
-            "SendAtcmd",
-            g_variant_new("(s)", command),
-            G_DBUS_CALL_FLAGS_NONE,
-            AT_COMMAND_TIMEOUT,
-            NULL,
-            &error
-        );
-
-        if (!ret) {
-            printf("调用 SendAtcmd 失败 (尝试 %d/%d) (%s): %s\n",
-                   retry + 1, MAX_RETRIES + 1, command,
-                   error ? error->message : "unknown");
-
-            /* 检测连接关闭错误 */
-            if (error && strstr(error->message, "connection closed")) {
-                printf("检测到连接关闭，尝试重新初始化 D-Bus...\n");
-                g_error_free(error);
-                close_dbus();
-                if (init_dbus() != 0) {
-                    set_error("重新初始化 D-Bus 失败");
-                    break;
-                }
-                continue;
-            }
+int execute_at_ex(const char *command, int priority, int deadline_ms, char **result) {
+    char error[256];
 
-            /* 检测操作进行中错误 */
-            if (error && strstr(error->message, "Operation already in progress")) {
-                printf("检测到 'Operation already in progress'，500ms 后重试...\n");
-                g_error_free(error);
-                g_usleep(500000);  /* 500ms */
-                continue;
-            }
+    if (!command || !result) {
+        set_error("无效的参数");
+        return -1;
+    }
+    *result = NULL;
 
-            set_error("调用 SendAtcmd 失败: %s", error ? error->message : "unknown");
-            if (error) g_error_free(error);
-            break;
-        }
+    command = at_prepare(command);
+    if (!command) return -1;
 
-        /* 提取结果字符串 */
-        const gchar *res_str = NULL;
-        g_variant_get(ret, "(s)", &res_str);
+    if (at_sched_execute(command, (AtPriority)priority, deadline_ms, result, error, sizeof(error)) != 0) {
+        set_error("%s", error);
+        return -1;
+    }
+    return 0;
+}
 
-        if (res_str) {
-            *result = g_strdup(res_str);
-            g_strstrip(*result);
-            printf("AT 命令 (%s) 响应: %s\n", command, *result);
-            rc = 0;
-        } else {
-            set_error("空响应");
-        }
+int execute_at(const char *command, char **result) {
+    return execute_at_ex(command, at_sched_thread_priority(), 0, result);
+}
 
-        g_variant_unref(ret);
-        break;
+int execute_at_async(const char *command, GCancellable *cancellable,
+                     AtAsyncCallback cb, void *user_data) {
+    if (!command || !cb) {
+        set_error("无效的参数");
+        return -1;
     }
 
-    pthread_mutex_unlock(&g_at_mutex);
-    return rc;
+    command = at_prepare(command);
+    if (!command) return -1;
+
+    if (at_sched_submit_async(command, at_sched_thread_priority(), cancellable, cb, user_data) != 0) {
+        set_error("AT 调度器未启动");
+        return -1;
+    }
+    return 0;
 }
 
 /* ==================== ofono.h 接口实现 ==================== */
 
 int ofono_init(void) {
-    return ensure_connection() ? 1 : 0;
+    return init_dbus() == 0 ? 1 : 0;
 }
 
 int ofono_is_initialized(void) {
-    return is_connection_valid();
+    return ensure_connection();
 }
 
 void ofono_deinit(void) {
-    if (g_dbus_conn && G_IS_OBJECT(g_dbus_conn)) {
-        g_object_unref(g_dbus_conn);
-        g_dbus_conn = NULL;
-    }
+    close_dbus();
 }
 
 int ofono_network_get_mode_sync(const char* modem_path, char* buffer, int size, int timeout_ms) {
@@ -278,14 +947,24 @@ int ofono_network_get_mode_sync(const char* modem_path, char* buffer, int size,
         return -1;
     }
 
+    /* 镜像: 优先 RadioSettings, 其次 Modem 上的同名属性 */
+    ModemMirror *m = mirror_lock_modem(modem_path, MIR_MODEM);
+    if (m) {
+        const char *mode = m->tech_pref[0] ? m->tech_pref : m->modem_tech_pref;
+        if (mode[0]) {
+            g_strlcpy(buffer, mode, size);
+            ret = 0;
+        }
+        pthread_mutex_unlock(&g_mirror_mutex);
+        if (ret == 0) return 0;
+    }
+
     if (!ensure_connection()) {
         return -1;
     }
 
-    result = g_dbus_proxy_call_sync(
-        g_proxies.modem, "GetProperties", NULL,
-        G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error
-    );
+    result = proxy_call_sync(modem_path, OFONO_MODEM_IFACE, "GetProperties", NULL,
+        timeout_ms, &error);
 
     if (!result) {
         if (error) g_error_free(error);
@@ -321,19 +1000,27 @@ int ofono_network_get_mode_sync(const char* modem_path, char* buffer, int size,
 }
 
 char* ofono_get_datacard(void) {
+    GDBusConnection *conn;
     GError *error = NULL;
     GVariant *result = NULL;
     char *datacard_path = NULL;
 
-    if (!g_dbus_conn) {
+    pthread_mutex_lock(&g_mirror_mutex);
+    if (g_datacard[0] != '\0') datacard_path = g_strdup(g_datacard);
+    pthread_mutex_unlock(&g_mirror_mutex);
+    if (datacard_path) return datacard_path;
+
+    conn = dbus_conn_get();
+    if (!conn) {
         return NULL;
     }
 
     result = g_dbus_connection_call_sync(
-        g_dbus_conn, OFONO_SERVICE, "/", "org.ofono.Manager",
+        conn, OFONO_SERVICE, "/", "org.ofono.Manager",
         "GetDataCard", NULL, G_VARIANT_TYPE("(o)"),
         G_DBUS_CALL_FLAGS_NONE, 5000, NULL, &error
     );
+    g_object_unref(conn);
 
     if (!result) {
         if (error) g_error_free(error);
@@ -344,6 +1031,9 @@ char* ofono_get_datacard(void) {
     g_variant_get(result, "(&o)", &path);
     if (path && strlen(path) > 0) {
         datacard_path = g_strdup(path);
+        pthread_mutex_lock(&g_mirror_mutex);
+        g_strlcpy(g_datacard, path, sizeof(g_datacard));
+        pthread_mutex_unlock(&g_mirror_mutex);
     }
 
     g_variant_unref(result);
@@ -393,11 +1083,7 @@ int ofono_network_set_mode_sync(const char* modem_path, int mode, int timeout_ms
         return -2;
     }
 
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, modem_path, OFONO_RADIO_SETTINGS,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(modem_path, OFONO_RADIO_SETTINGS, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -418,6 +1104,7 @@ int ofono_network_set_mode_sync(const char* modem_path, int mode, int timeout_ms
 
     g_variant_unref(result);
     if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+    mirror_store(modem_path, MIR_RADIO, "TechnologyPreference", g_variant_new_string(mode_str));
     return 0;
 }
 
@@ -430,11 +1117,7 @@ int ofono_modem_set_online(const char* modem_path, int online, int timeout_ms) {
         return -1;
     }
 
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, modem_path, "org.ofono.Modem",
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(modem_path, "org.ofono.Modem", &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -455,23 +1138,26 @@ int ofono_modem_set_online(const char* modem_path, int online, int timeout_ms) {
 
     g_variant_unref(result);
     if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+    mirror_store(modem_path, MIR_MODEM, "Online", g_variant_new_boolean(online ? TRUE : FALSE));
     return 0;
 }
 
 
 int ofono_set_datacard(const char* modem_path) {
+    GDBusConnection *conn;
     GError *error = NULL;
     GVariant *result = NULL;
 
-    if (!modem_path || !ensure_connection()) {
+    if (!modem_path || !(conn = dbus_conn_get())) {
         return 0;
     }
 
     result = g_dbus_connection_call_sync(
-        g_dbus_conn, OFONO_SERVICE, "/", "org.ofono.Manager",
+        conn, OFONO_SERVICE, "/", "org.ofono.Manager",
         "SetDataCard", g_variant_new("(o)", modem_path),
         NULL, G_DBUS_CALL_FLAGS_NONE, 5000, NULL, &error
     );
+    g_object_unref(conn);
 
     if (!result) {
         if (error) g_error_free(error);
@@ -479,6 +1165,9 @@ int ofono_set_datacard(const char* modem_path) {
     }
 
     g_variant_unref(result);
+    pthread_mutex_lock(&g_mirror_mutex);
+    g_strlcpy(g_datacard, modem_path, sizeof(g_datacard));
+    pthread_mutex_unlock(&g_mirror_mutex);
     return 1;
 }
 
@@ -488,14 +1177,24 @@ int ofono_network_get_signal_strength(const char* modem_path, int* strength, int
     GDBusProxy *proxy = NULL;
     int ret = -1;
 
-    if (!modem_path || !ensure_connection()) {
+    if (!modem_path) {
         return -1;
     }
 
-    result = g_dbus_proxy_call_sync(
-        g_proxies.nw_reg, "GetProperties", NULL,
-        G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error
-    );
+    ModemMirror *m = mirror_lock_modem(modem_path, MIR_NETREG);
+    if (m) {
+        if (strength) *strength = m->strength;
+        if (dbm) *dbm = m->has_dbm ? m->strength_dbm : -113 + 2 * m->strength;
+        pthread_mutex_unlock(&g_mirror_mutex);
+        return 0;
+    }
+
+    if (!ensure_connection()) {
+        return -1;
+    }
+
+    result = proxy_call_sync(modem_path, OFONO_NETWORK_REGISTRATION, "GetProperties", NULL,
+        timeout_ms, &error);
 
     if (!result) {
         if (error) g_error_free(error);
@@ -536,11 +1235,7 @@ int ofono_network_get_signal_strength(const char* modem_path, int* strength, int
 
 /* ==================== 数据连接和漫游 API ==================== */
 
-#define OFONO_CONNECTION_CONTEXT  "org.ofono.ConnectionContext"
-#define OFONO_CONNECTION_MANAGER  "org.ofono.ConnectionManager"
-#define OFONO_NETWORK_REGISTRATION "org.ofono.NetworkRegistration"
 #define DEFAULT_CONTEXT_PATH      "/ril_0/context2"
-#define DEFAULT_MODEM_PATH        "/ril_0"
 
 /**
  * 动态查找第一个有效的 internet 类型 context 路径
@@ -550,82 +1245,37 @@ int ofono_network_get_signal_strength(const char* modem_path, int* strength, int
  * @param buf_size 缓冲区大小
  * @return 0 成功，-1 失败
  */
-static int find_internet_context_path(char *path_buf, size_t buf_size) {
-    GError *error = NULL;
-    GVariant *result = NULL;
-    GDBusProxy *proxy = NULL;
-    int found = 0;
+/* 从 GetContexts 的 a(oa{sv}) 返回值选择 internet context:
+ * 优先已配置 APN 的, 其次第一个, 都没有时使用默认路径 */
+static void pick_context_from_reply(GVariant *result, char *path_buf, size_t buf_size) {
     char first_internet_path[256] = {0};
-
-    if (!path_buf || buf_size == 0 || !ensure_connection()) {
-        return -1;
-    }
-
-    /* 创建 ConnectionManager 代理 */
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER,
-        NULL, &error
-    );
-
-    if (!proxy) {
-        if (error) g_error_free(error);
-        /* 回退到默认路径 */
-        strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
-        return 0;
-    }
-
-    /* 调用 GetContexts 获取所有 context */
-    result = g_dbus_proxy_call_sync(
-        proxy, "GetContexts", NULL,
-        G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error
-    );
-
-    if (!result) {
-        if (error) g_error_free(error);
-        if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
-        strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
-        return 0;
-    }
-
-    /* 解析返回的 a(oa{sv}) 数组 */
+    int found = 0;
     GVariant *array = g_variant_get_child_value(result, 0);
     GVariantIter iter;
     GVariant *child;
 
     g_variant_iter_init(&iter, array);
-    while ((child = g_variant_iter_next_value(&iter)) != NULL) {
+    while (!found && (child = g_variant_iter_next_value(&iter)) != NULL) {
         const gchar *path = NULL;
         GVariant *props = NULL;
 
         g_variant_get(child, "(&o@a{sv})", &path, &props);
 
         if (props && path) {
-            /* 获取 Type 属性 */
             GVariant *type_var = g_variant_lookup_value(props, "Type", G_VARIANT_TYPE_STRING);
             const gchar *context_type = type_var ? g_variant_get_string(type_var, NULL) : "";
 
             if (g_strcmp0(context_type, "internet") == 0) {
-                /* 获取 AccessPointName 属性 */
                 GVariant *apn_var = g_variant_lookup_value(props, "AccessPointName", G_VARIANT_TYPE_STRING);
                 const gchar *apn = apn_var ? g_variant_get_string(apn_var, NULL) : "";
 
-                /* 记录第一个 internet context */
                 if (first_internet_path[0] == '\0') {
                     strncpy(first_internet_path, path, sizeof(first_internet_path) - 1);
                 }
-
-                /* 优先返回配置了 APN 的 context */
                 if (apn && apn[0] != '\0') {
-                    strncpy(path_buf, path, buf_size - 1);
+                    g_strlcpy(path_buf, path, buf_size);
                     found = 1;
-                    if (apn_var) g_variant_unref(apn_var);
-                    if (type_var) g_variant_unref(type_var);
-                    g_variant_unref(props);
-                    g_variant_unref(child);
-                    break;
                 }
-
                 if (apn_var) g_variant_unref(apn_var);
             }
 
@@ -634,20 +1284,61 @@ static int find_internet_context_path(char *path_buf, size_t buf_size) {
         }
         g_variant_unref(child);
     }
-
     g_variant_unref(array);
-    g_variant_unref(result);
-    if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
 
-    /* 如果没找到配置了 APN 的，使用第一个 internet context */
     if (!found) {
-        if (first_internet_path[0] != '\0') {
-            strncpy(path_buf, first_internet_path, buf_size - 1);
-        } else {
-            strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
-        }
+        g_strlcpy(path_buf, first_internet_path[0] != '\0' ? first_internet_path : DEFAULT_CONTEXT_PATH,
+                  buf_size);
+    }
+}
+
+static int find_internet_context_path(char *path_buf, size_t buf_size) {
+    GError *error = NULL;
+    GVariant *result = NULL;
+    GDBusProxy *proxy = NULL;
+
+    if (!path_buf || buf_size == 0) {
+        return -1;
+    }
+
+    ModemMirror *m = mirror_lock_modem(DEFAULT_MODEM_PATH, MIR_CONTEXTS);
+    if (m) {
+        ApnContext *ctx = pick_internet_context(m);
+        g_strlcpy(path_buf, ctx ? ctx->path : DEFAULT_CONTEXT_PATH, buf_size);
+        pthread_mutex_unlock(&g_mirror_mutex);
+        return 0;
+    }
+
+    if (!ensure_connection()) {
+        return -1;
+    }
+
+    /* 创建 ConnectionManager 代理 */
+    proxy = dbus_conn_proxy(DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER, &error);
+
+    if (!proxy) {
+        if (error) g_error_free(error);
+        /* 回退到默认路径 */
+        strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
+        return 0;
+    }
+
+    /* 调用 GetContexts 获取所有 context */
+    result = g_dbus_proxy_call_sync(
+        proxy, "GetContexts", NULL,
+        G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error
+    );
+
+    if (!result) {
+        if (error) g_error_free(error);
+        if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+        strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
+        return 0;
     }
 
+    pick_context_from_reply(result, path_buf, buf_size);
+    g_variant_unref(result);
+    if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
     return 0;
 }
 
@@ -658,7 +1349,22 @@ int ofono_get_data_status(int *active) {
     int ret = -1;
     char context_path[256] = {0};
 
-    if (!active || !ensure_connection()) {
+    if (!active) {
+        return -1;
+    }
+
+    ModemMirror *m = mirror_lock_modem(DEFAULT_MODEM_PATH, MIR_CONTEXTS);
+    if (m) {
+        ApnContext *ctx = pick_internet_context(m);
+        if (ctx) {
+            *active = ctx->active;
+            ret = 0;
+        }
+        pthread_mutex_unlock(&g_mirror_mutex);
+        if (ret == 0) return 0;
+    }
+
+    if (!ensure_connection()) {
         return -1;
     }
 
@@ -667,11 +1373,7 @@ int ofono_get_data_status(int *active) {
         return -1;
     }
 
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(context_path, OFONO_CONNECTION_CONTEXT, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -726,11 +1428,7 @@ int ofono_set_data_status(int active) {
         return -1;
     }
 
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(context_path, OFONO_CONNECTION_CONTEXT, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -751,6 +1449,7 @@ int ofono_set_data_status(int active) {
 
     g_variant_unref(result);
     if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+    mirror_store(context_path, MIR_CONTEXTS, "Active", g_variant_new_boolean(active ? TRUE : FALSE));
     return 0;
 }
 
@@ -767,12 +1466,12 @@ int ofono_get_roaming_status(int *roaming_allowed, int *is_roaming) {
     *roaming_allowed = 0;
     *is_roaming = 0;
 
+    if (ofono_get_roaming_cached(roaming_allowed, is_roaming) == 0) {
+        return 0;
+    }
+
     /* 1. 获取 ConnectionManager 的 RoamingAllowed 属性 */
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -810,11 +1509,7 @@ int ofono_get_roaming_status(int *roaming_allowed, int *is_roaming) {
     if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
 
     /* 2. 获取 NetworkRegistration 的 Status 属性判断是否漫游中 */
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, DEFAULT_MODEM_PATH, OFONO_NETWORK_REGISTRATION,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(DEFAULT_MODEM_PATH, OFONO_NETWORK_REGISTRATION, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -864,11 +1559,7 @@ int ofono_set_roaming_allowed(int allowed) {
         return -1;
     }
 
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -889,9 +1580,197 @@ int ofono_set_roaming_allowed(int allowed) {
 
     g_variant_unref(result);
     if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+    mirror_store(DEFAULT_MODEM_PATH, MIR_CONNMAN, "RoamingAllowed", g_variant_new_boolean(allowed ? TRUE : FALSE));
+    return 0;
+}
+
+
+/* ==================== 异步 oFono 调用 ==================== */
+
+typedef struct {
+    OfonoAsyncCallback cb;
+    void *user_data;
+    GCancellable *cancellable;
+    /* SetProperty 成功后写回镜像 */
+    char path[256];
+    unsigned int mirror_bit;
+    const char *key;
+    GVariant *value;
+} OfonoAsyncOp;
+
+/* 发起异步调用前检查连接, 返回新增引用 */
+static GDBusConnection *async_conn(void) {
+    GDBusConnection *conn = dbus_conn_get();
+
+    if (!conn) set_error("D-Bus 未连接");
+    return conn;
+}
+
+static void async_op_free(OfonoAsyncOp *op) {
+    if (op->cancellable) g_object_unref(op->cancellable);
+    if (op->value) g_variant_unref(op->value);
+    g_free(op);
+}
+
+/* 按结果调用用户回调 */
+static void async_op_complete(OfonoAsyncOp *op, GVariant *reply, GError *error) {
+    if (reply) {
+        op->cb(0, reply, NULL, op->user_data);
+    } else if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        op->cb(-2, NULL, "已取消", op->user_data);
+    } else {
+        op->cb(-1, NULL, error ? error->message : "unknown", op->user_data);
+    }
+}
+
+static void on_async_reply(GObject *source, GAsyncResult *res, gpointer user_data) {
+    OfonoAsyncOp *op = (OfonoAsyncOp *)user_data;
+    GError *error = NULL;
+    GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+
+    if (reply && op->key) {
+        mirror_store(op->path, op->mirror_bit, op->key, op->value);
+    }
+    async_op_complete(op, reply, error);
+
+    if (reply) g_variant_unref(reply);
+    if (error) g_error_free(error);
+    async_op_free(op);
+}
+
+static void async_op_call(GDBusConnection *conn, OfonoAsyncOp *op, const char *path,
+                          const char *iface, const char *method, GVariant *params, int timeout_ms) {
+    g_dbus_connection_call(conn, OFONO_SERVICE, path, iface, method, params, NULL,
+                           G_DBUS_CALL_FLAGS_NONE, timeout_ms, op->cancellable,
+                           on_async_reply, op);
+}
+
+static OfonoAsyncOp *async_op_new(GCancellable *cancellable, OfonoAsyncCallback cb, void *user_data) {
+    OfonoAsyncOp *op = g_new0(OfonoAsyncOp, 1);
+
+    op->cb = cb;
+    op->user_data = user_data;
+    op->cancellable = cancellable ? g_object_ref(cancellable) : NULL;
+    return op;
+}
+
+int ofono_call_async(const char *path, const char *iface, const char *method,
+                     GVariant *params, int timeout_ms, GCancellable *cancellable,
+                     OfonoAsyncCallback cb, void *user_data) {
+    GDBusConnection *conn;
+
+    if (!path || !iface || !method || !cb) {
+        set_error("无效的参数");
+        conn = NULL;
+    } else {
+        conn = async_conn();
+    }
+    if (!conn) {
+        if (params) g_variant_unref(g_variant_ref_sink(params));
+        return -1;
+    }
+
+    async_op_call(conn, async_op_new(cancellable, cb, user_data),
+                  path, iface, method, params, timeout_ms);
+    g_object_unref(conn);
+    return 0;
+}
+
+/* 异步 SetProperty, 成功后写回镜像 (value 可为浮动引用, 非浮动时增加一个引用) */
+static int set_property_async(const char *path, const char *iface, unsigned int mirror_bit,
+                              const char *key, GVariant *value, GCancellable *cancellable,
+                              OfonoAsyncCallback cb, void *user_data) {
+    GDBusConnection *conn = async_conn();
+    OfonoAsyncOp *op;
+
+    g_variant_ref_sink(value);
+    if (!conn) {
+        g_variant_unref(value);
+        return -1;
+    }
+
+    op = async_op_new(cancellable, cb, user_data);
+    g_strlcpy(op->path, path, sizeof(op->path));
+    op->mirror_bit = mirror_bit;
+    op->key = key;
+    op->value = value;
+    async_op_call(conn, op, path, iface, "SetProperty",
+                  g_variant_new("(sv)", key, value), OFONO_TIMEOUT_MS);
+    g_object_unref(conn);
+    return 0;
+}
+
+/* 镜像未就绪时先异步 GetContexts 确定 internet context */
+static void on_data_contexts_reply(GObject *source, GAsyncResult *res, gpointer user_data) {
+    OfonoAsyncOp *op = (OfonoAsyncOp *)user_data;
+    GError *error = NULL;
+    GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+    char context_path[256];
+
+    if (!reply) {
+        async_op_complete(op, NULL, error);
+        g_error_free(error);
+        async_op_free(op);
+        return;
+    }
+
+    pick_context_from_reply(reply, context_path, sizeof(context_path));
+    g_variant_unref(reply);
+
+    if (set_property_async(context_path, OFONO_CONNECTION_CONTEXT, MIR_CONTEXTS, "Active",
+                           op->value, op->cancellable, op->cb, op->user_data) != 0) {
+        op->cb(-1, NULL, g_last_error, op->user_data);
+    }
+    async_op_free(op);
+}
+
+int ofono_set_data_status_async(int active, GCancellable *cancellable,
+                                OfonoAsyncCallback cb, void *user_data) {
+    GVariant *value = g_variant_new_boolean(active ? TRUE : FALSE);
+    char context_path[256] = {0};
+    GDBusConnection *conn;
+    OfonoAsyncOp *op;
+
+    if (!cb) {
+        g_variant_unref(g_variant_ref_sink(value));
+        set_error("无效的参数");
+        return -1;
+    }
+
+    ModemMirror *m = mirror_lock_modem(DEFAULT_MODEM_PATH, MIR_CONTEXTS);
+    if (m) {
+        ApnContext *ctx = pick_internet_context(m);
+        g_strlcpy(context_path, ctx ? ctx->path : DEFAULT_CONTEXT_PATH, sizeof(context_path));
+        pthread_mutex_unlock(&g_mirror_mutex);
+        return set_property_async(context_path, OFONO_CONNECTION_CONTEXT, MIR_CONTEXTS, "Active",
+                                  value, cancellable, cb, user_data);
+    }
+
+    conn = async_conn();
+    if (!conn) {
+        g_variant_unref(g_variant_ref_sink(value));
+        return -1;
+    }
+
+    op = async_op_new(cancellable, cb, user_data);
+    op->value = g_variant_ref_sink(value);
+    g_dbus_connection_call(conn, OFONO_SERVICE, DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER,
+                           "GetContexts", NULL, NULL, G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           op->cancellable, on_data_contexts_reply, op);
+    g_object_unref(conn);
     return 0;
 }
 
+int ofono_set_roaming_allowed_async(int allowed, GCancellable *cancellable,
+                                    OfonoAsyncCallback cb, void *user_data) {
+    if (!cb) {
+        set_error("无效的参数");
+        return -1;
+    }
+    return set_property_async(DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER, MIR_CONNMAN,
+                              "RoamingAllowed", g_variant_new_boolean(allowed ? TRUE : FALSE),
+                              cancellable, cb, user_data);
+}
 
 /* ==================== APN 管理 API ==================== */
 
@@ -901,16 +1780,28 @@ int ofono_get_all_apn_contexts(ApnContext *contexts, int max_count) {
     GDBusProxy *proxy = NULL;
     int count = 0;
 
-    if (!contexts || max_count <= 0 || !ensure_connection()) {
+    if (!contexts || max_count <= 0) {
+        return -1;
+    }
+
+    ModemMirror *m = mirror_lock_modem(DEFAULT_MODEM_PATH, MIR_CONTEXTS);
+    if (m) {
+        for (int i = 0; i < m->context_count && count < max_count; i++) {
+            /* 只处理 internet 类型 */
+            if (strcmp(m->contexts[i].context_type, "internet") == 0) {
+                contexts[count++] = m->contexts[i];
+            }
+        }
+        pthread_mutex_unlock(&g_mirror_mutex);
+        return count;
+    }
+
+    if (!ensure_connection()) {
         return -1;
     }
 
     /* 创建 ConnectionManager 代理 */
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(DEFAULT_MODEM_PATH, OFONO_CONNECTION_MANAGER, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -1007,11 +1898,7 @@ int ofono_set_apn_property(const char *context_path, const char *property, const
         return -1;
     }
 
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
-        NULL, &error
-    );
+    proxy = dbus_conn_proxy(context_path, OFONO_CONNECTION_CONTEXT, &error);
 
     if (!proxy) {
         if (error) g_error_free(error);
@@ -1032,6 +1919,7 @@ int ofono_set_apn_property(const char *context_path, const char *property, const
 
     g_variant_unref(result);
     if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+    mirror_store(context_path, MIR_CONTEXTS, property, g_variant_new_string(value));
     return 0;
 }
 
@@ -1051,45 +1939,49 @@ int ofono_set_apn_properties(const char *context_path,
     }
 
     /* 1. 检查 context 是否激活 */
-    proxy = g_dbus_proxy_new_sync(
-        g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-        OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
-        NULL, &error
-    );
-
-    if (!proxy) {
-        if (error) g_error_free(error);
-        return -2;
+    int mirrored = 0;
+    ModemMirror *m = mirror_lock_modem(DEFAULT_MODEM_PATH, MIR_CONTEXTS);
+    if (m) {
+        ApnContext *ctx = find_context(m, context_path);
+        if (ctx) {
+            was_active = ctx->active;
+            mirrored = 1;
+        }
+        pthread_mutex_unlock(&g_mirror_mutex);
     }
 
-    result = g_dbus_proxy_call_sync(
-        proxy, "GetProperties", NULL,
-        G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error
-    );
+    if (!mirrored) {
+        proxy = dbus_conn_proxy(context_path, OFONO_CONNECTION_CONTEXT, &error);
 
-    if (result) {
-        GVariant *props = g_variant_get_child_value(result, 0);
-        GVariant *active_var = g_variant_lookup_value(props, "Active", G_VARIANT_TYPE_BOOLEAN);
-        if (active_var) {
-            was_active = g_variant_get_boolean(active_var) ? 1 : 0;
-            g_variant_unref(active_var);
+        if (!proxy) {
+            if (error) g_error_free(error);
+            return -2;
         }
-        g_variant_unref(props);
-        g_variant_unref(result);
-    } else {
-        if (error) { g_error_free(error); error = NULL; }
-    }
 
+        result = g_dbus_proxy_call_sync(
+            proxy, "GetProperties", NULL,
+            G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error
+        );
 
-    if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+        if (result) {
+            GVariant *props = g_variant_get_child_value(result, 0);
+            GVariant *active_var = g_variant_lookup_value(props, "Active", G_VARIANT_TYPE_BOOLEAN);
+            if (active_var) {
+                was_active = g_variant_get_boolean(active_var) ? 1 : 0;
+                g_variant_unref(active_var);
+            }
+            g_variant_unref(props);
+            g_variant_unref(result);
+        } else {
+            if (error) { g_error_free(error); error = NULL; }
+        }
+
+        if (proxy && G_IS_OBJECT(proxy)) g_object_unref(proxy);
+    }
 
     /* 2. 如果激活中，先关闭 */
     if (was_active) {
-        proxy = g_dbus_proxy_new_sync(
-            g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-            OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
-            NULL, &error
-        );
+        proxy = dbus_conn_proxy(context_path, OFONO_CONNECTION_CONTEXT, &error);
         if (proxy) {
             result = g_dbus_proxy_call_sync(
                 proxy, "SetProperty",
@@ -1124,11 +2016,7 @@ int ofono_set_apn_properties(const char *context_path,
     /* 4. 如果之前是激活状态，重新激活 */
     if (was_active) {
         g_usleep(500000); /* 500ms */
-        proxy = g_dbus_proxy_new_sync(
-            g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-            OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
-            NULL, &error
-        );
+        proxy = dbus_conn_proxy(context_path, OFONO_CONNECTION_CONTEXT, &error);
         if (proxy) {
             result = g_dbus_proxy_call_sync(
                 proxy, "SetProperty",
@@ -1151,6 +2039,7 @@ int ofono_set_apn_properties(const char *context_path,
 int ofono_get_network_info(char *tech, int tech_size, char *band, int band_size) {
     GError *error = NULL;
     GVariant *result = NULL;
+    char path[64];
     int ret = -1;
 
     if (!tech || !band || !ensure_connection()) {
@@ -1158,10 +2047,9 @@ int ofono_get_network_info(char *tech, int tech_size, char *band, int band_size)
     }
 
     /* 调用 GetServingCellInformation */
-    result = g_dbus_proxy_call_sync(
-        g_proxies.nw_mon, "GetServingCellInformation", NULL,
-        G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error
-    );
+    current_modem_path(path, sizeof(path));
+    result = proxy_call_sync(path, OFONO_NETWORK_MONITOR, "GetServingCellInformation", NULL,
+        OFONO_TIMEOUT_MS, &error);
 
     if (!result) {
         if (error) g_error_free(error);
@@ -1201,8 +2089,35 @@ int ofono_get_network_info(char *tech, int tech_size, char *band, int band_size)
 }
 
 int ofono_get_serving_cell_tech(char *buffer, int size) {
-    char band[64] = {0};
-    return ofono_get_network_info(buffer, size, band, sizeof(band));
+    GError *error = NULL;
+    GVariant *result = NULL;
+    GVariant *tech = NULL;
+    char path[64];
+    int ret = -1;
+
+    if (!buffer || size <= 0) {
+        return -1;
+    }
+
+    current_modem_path(path, sizeof(path));
+    result = proxy_call_sync(path, OFONO_NETWORK_MONITOR, "GetServingCellInformation", NULL,
+        OFONO_TIMEOUT_MS, &error);
+    if (!result) {
+        if (error) g_error_free(error);
+        return -2;
+    }
+
+    /* 返回 oFono 原始制式 ("nr"/"lte"...), 不做显示转换 */
+    GVariant *props = g_variant_get_child_value(result, 0);
+    tech = g_variant_lookup_value(props, "Technology", G_VARIANT_TYPE_STRING);
+    if (tech) {
+        g_strlcpy(buffer, g_variant_get_string(tech, NULL), size);
+        g_variant_unref(tech);
+        ret = 0;
+    }
+    g_variant_unref(props);
+    g_variant_unref(result);
+    return ret;
 }
 
 int validate_at_command(const char *cmd) {
@@ -1215,16 +2130,16 @@ int validate_at_command(const char *cmd) {
 int ofono_get_neighbor_cells(NeighborCell *cells, int max_count) {
     GError *error = NULL;
     GVariant *result = NULL;
+    char path[64];
     int count = 0;
 
     if (!cells || max_count <= 0 || !ensure_connection()) {
         return -1;
     }
 
-    result = g_dbus_proxy_call_sync(
-        g_proxies.nw_mon, "GetNeighboringCellInformation", NULL,
-        G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error
-    );
+    current_modem_path(path, sizeof(path));
+    result = proxy_call_sync(path, OFONO_NETWORK_MONITOR, "GetNeighboringCellInformation", NULL,
+        OFONO_TIMEOUT_MS, &error);
 
     if (!result) {
         if (error) g_error_free(error);
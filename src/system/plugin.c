@@ -11,6 +11,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include "plugin.h"
+#include "storage_io.h"
 
 /* 危险命令黑名单 */
 static const char *dangerous_commands[] = {
@@ -87,27 +88,6 @@ int execute_shell(const char *cmd, char *output, size_t size) {
 }
 
 
-/* JSON字符串转义 */
-static void json_escape(const char *src, char *dst, size_t dst_size) {
-    size_t j = 0;
-    for (size_t i = 0; src[i] && j < dst_size - 2; i++) {
-        char c = src[i];
-        switch (c) {
-            case '"':  if (j + 2 < dst_size) { dst[j++] = '\\'; dst[j++] = '"'; } break;
-            case '\\': if (j + 2 < dst_size) { dst[j++] = '\\'; dst[j++] = '\\'; } break;
-            case '\n': if (j + 2 < dst_size) { dst[j++] = '\\'; dst[j++] = 'n'; } break;
-            case '\r': if (j + 2 < dst_size) { dst[j++] = '\\'; dst[j++] = 'r'; } break;
-            case '\t': if (j + 2 < dst_size) { dst[j++] = '\\'; dst[j++] = 't'; } break;
-            default:
-                if ((unsigned char)c >= 0x20) {
-                    dst[j++] = c;
-                }
-                break;
-        }
-    }
-    dst[j] = '\0';
-}
-
 /* 从插件内容中提取元信息 */
 static int extract_plugin_meta(const char *content, char *name, char *version,
                                 char *author, char *description, char *icon, char *color) {
@@ -134,7 +114,7 @@ static int extract_plugin_meta(const char *content, char *name, char *version,
 
             char *dst = jsdoc_dests[i];
             int j = 0;
-            /* 提取到行尾或 */ 为止 */
+            /* 提取到行尾或注释结束符为止 */
             while (*p && *p != '\n' && *p != '\r' && j < 127) {
                 /* 如果遇到注释结束符，停止 */
                 if (*p == '*' && *(p+1) == '/') break;
@@ -199,20 +179,16 @@ static int extract_plugin_meta(const char *content, char *name, char *version,
     return 0;
 }
 
-/* 获取插件列表 */
-int get_plugin_list(char *json_output, size_t size) {
+/* 遍历插件 */
+int plugin_foreach(PluginVisitor cb, void *ctx) {
     ensure_plugin_dir();
 
     DIR *dir = opendir(PLUGIN_DIR);
     if (!dir) {
-        snprintf(json_output, size, "[]");
         return 0;
     }
 
-    int offset = 0;
     int count = 0;
-    offset += snprintf(json_output + offset, size - offset, "[");
-
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL && count < PLUGIN_MAX_COUNT) {
         /* 只处理.js文件 */
@@ -230,7 +206,7 @@ int get_plugin_list(char *json_output, size_t size) {
         long fsize = ftell(fp);
         fseek(fp, 0, SEEK_SET);
 
-        if (fsize > PLUGIN_MAX_SIZE) {
+        if (fsize < 0 || fsize > PLUGIN_MAX_SIZE) {
             fclose(fp);
             continue;
         }
@@ -241,36 +217,24 @@ int get_plugin_list(char *json_output, size_t size) {
             continue;
         }
 
-        fread(content, 1, fsize, fp);
-        content[fsize] = '\0';
+        size_t n = fread(content, 1, fsize, fp);
+        content[n] = '\0';
         fclose(fp);
 
         /* 提取元信息 */
-        char name[128], version[32], author[64], description[256], icon[64], color[128];
-        extract_plugin_meta(content, name, version, author, description, icon, color);
-
-        /* 转义内容 */
-        char *escaped_content = malloc(fsize * 2 + 1);
-        if (escaped_content) {
-            json_escape(content, escaped_content, fsize * 2 + 1);
-
-            /* 添加到JSON数组 */
-            offset += snprintf(json_output + offset, size - offset,
-                "%s{\"filename\":\"%s\",\"name\":\"%s\",\"version\":\"%s\","
-                "\"author\":\"%s\",\"description\":\"%s\",\"icon\":\"%s\","
-                "\"color\":\"%s\",\"content\":\"%s\"}",
-                count > 0 ? "," : "",
-                entry->d_name, name, version, author, description, icon, color, escaped_content);
-
-            free(escaped_content);
-            count++;
-        }
+        PluginInfo info;
+        info.filename = entry->d_name;
+        info.content = content;
+        info.content_len = n;
+        extract_plugin_meta(content, info.name, info.version, info.author,
+                            info.description, info.icon, info.color);
+
+        cb(&info, ctx);
         free(content);
+        count++;
     }
 
     closedir(dir);
-    offset += snprintf(json_output + offset, size - offset, "]");
-
     return count;
 }
 
@@ -299,13 +263,7 @@ int save_plugin(const char *name, const char *content) {
         return -1;
     }
 
-    FILE *fp = fopen(filename, "w");
-    if (!fp) return -1;
-
-    fputs(content, fp);
-    fclose(fp);
-
-    return 0;
+    return storage_write_file(STORAGE_PLUGIN, filename, content, strlen(content), 0644, STORAGE_WRITE_SYNC);
 }
 
 /* 删除插件 */
@@ -15,6 +15,7 @@
 #include <sys/file.h>
 #include <errno.h>
 #include "plugin_storage.h"
+#include "storage_io.h"
 
 /* 验证插件名称安全性 */
 static int is_valid_plugin_name(const char *name) {
@@ -145,29 +146,9 @@ int plugin_storage_write(const char *plugin_name, const char *json_data) {
         return -1;
     }
     
-    /* 打开文件（创建或截断） */
-    int fd = open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (fd == -1) {
-        fprintf(stderr, "Plugin storage: failed to open %s: %s\n", 
-                filepath, strerror(errno));
-        return -1;
-    }
-    
-    /* 获取排他锁（写锁） */
-    if (flock(fd, LOCK_EX) == -1) {
-        close(fd);
-        return -1;
-    }
-    
-    /* 写入数据 */
-    ssize_t written = write(fd, json_data, data_len);
-    
-    /* 释放锁并关闭文件 */
-    flock(fd, LOCK_UN);
-    close(fd);
-    
-    if (written != (ssize_t)data_len) {
-        fprintf(stderr, "Plugin storage: write incomplete\n");
+    /* 写临时文件后替换, 读者不会看到写了一半的 JSON */
+    if (storage_write_file(STORAGE_PLUGIN, filepath, json_data, data_len, 0644, STORAGE_WRITE_SYNC) != 0) {
+        fprintf(stderr, "Plugin storage: failed to write %s\n", filepath);
         return -1;
     }
     
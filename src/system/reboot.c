@@ -10,11 +10,75 @@
 #include <sys/stat.h>
 #include "mongoose.h"
 #include "reboot.h"
-#include "exec_utils.h"
 #include "http_utils.h"
+#include "storage_io.h"
 
 #define CRON_FILE "/var/spool/cron/crontabs/root"
 
+/**
+ * 重写 crontab: 删除所有 reboot 任务, 再追加 add_line (可为 NULL)
+ * 按文件实际大小分配缓冲区, 读取不完整时不覆盖原文件
+ * @return 0成功, -1失败
+ */
+static int rewrite_reboot_jobs(const char *add_line) {
+    size_t add_len = add_line ? strlen(add_line) + 1 : 0;
+    size_t size = 0, len = 0;
+    char *content = NULL, *buf, *line;
+    FILE *f = fopen(CRON_FILE, "r");
+    struct stat st;
+    int ret;
+
+    if (!f && !add_line) return 0;  /* 没有 crontab, 也不需要新增 */
+
+    if (f) {
+        if (fstat(fileno(f), &st) != 0) {
+            fclose(f);
+            return -1;
+        }
+        size = (size_t)st.st_size;
+        content = malloc(size + 1);
+        if (!content || fread(content, 1, size, f) != size) {
+            free(content);
+            fclose(f);
+            return -1;
+        }
+        content[size] = '\0';
+        fclose(f);
+    }
+
+    /* 结果不会比原文件加新任务更长 (原文件末行可能缺少换行) */
+    buf = malloc(size + add_len + 2);
+    if (!buf) {
+        free(content);
+        return -1;
+    }
+
+    for (line = content; line && *line; ) {
+        char *end = strchr(line, '\n');
+        size_t n;
+
+        if (end) *end = '\0';
+        n = strlen(line);
+        if (!strstr(line, "reboot")) {
+            memcpy(buf + len, line, n);
+            len += n;
+            buf[len++] = '\n';
+        }
+        line = end ? end + 1 : line + n;
+    }
+    free(content);
+
+    if (add_line) {
+        memcpy(buf + len, add_line, add_len - 1);
+        len += add_len - 1;
+        buf[len++] = '\n';
+    }
+
+    ret = storage_write_file(STORAGE_CRON, CRON_FILE, buf, len, 0600, STORAGE_WRITE_SYNC);
+    free(buf);
+    return ret;
+}
+
 /* 读取第一个重启任务 */
 static int read_first_reboot_job(char *job, size_t size) {
     FILE *f = fopen(CRON_FILE, "r");
@@ -88,15 +152,10 @@ void handle_set_reboot(struct mg_connection *c, struct mg_http_message *hm) {
     mkdir("/var/spool/cron", 0755);
     mkdir("/var/spool/cron/crontabs", 0755);
 
-    /* 删除现有 reboot 任务 */
-    char output[256];
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd), "sed -i '/reboot/d' %s 2>/dev/null || true", CRON_FILE);
-    run_command(output, sizeof(output), "sh", "-c", cmd, NULL);
-
-    /* 添加新任务 */
-    snprintf(cmd, sizeof(cmd), "echo '%s %s * * %s /sbin/reboot' >> %s", minute, hour, day, CRON_FILE);
-    if (run_command(output, sizeof(output), "sh", "-c", cmd, NULL) != 0) {
+    /* 替换现有 reboot 任务, 一次整体写入 */
+    char job[128];
+    snprintf(job, sizeof(job), "%s %s * * %s /sbin/reboot", minute, hour, day);
+    if (rewrite_reboot_jobs(job) != 0) {
         HTTP_JSON(c, 500, "{\"success\":false,\"msg\":\"Failed to add job\"}");
         return;
     }
@@ -108,10 +167,7 @@ void handle_set_reboot(struct mg_connection *c, struct mg_http_message *hm) {
 void handle_clear_cron(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_GET(c, hm);
 
-    char output[256];
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "sed -i '/reboot/d' %s 2>/dev/null || true", CRON_FILE);
-    run_command(output, sizeof(output), "sh", "-c", cmd, NULL);
+    rewrite_reboot_jobs(NULL);
 
     HTTP_OK(c, "{\"success\":true,\"msg\":\"Clean Reboot\"}");
 }
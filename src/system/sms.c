@@ -6,18 +6,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <pthread.h>
 #include <gio/gio.h>
 #include "sms.h"
 #include "database.h"
 #include "http_server.h"
 #include "exec_utils.h"
+#include "dbus_conn.h"
+#include "webhook.h"
 
 /* 短信模块专用互斥锁 */
 static pthread_mutex_t g_sms_mutex = PTHREAD_MUTEX_INITIALIZER;
-static GDBusConnection *g_sms_dbus_conn = NULL;
+static GDBusConnection *g_sms_dbus_conn = NULL;   /* 信号订阅所在的共享连接 */
 static guint g_signal_subscription_id = 0;
-static guint g_name_watch_id = 0;
 static int g_sms_initialized = 0;
 static int g_ofono_available = 0;
 
@@ -30,77 +32,45 @@ static WebhookConfig g_webhook_config = {0};
 static int g_max_sms_count = DEFAULT_MAX_SMS_COUNT;
 static int g_max_sent_count = DEFAULT_MAX_SENT_COUNT;
 
+/* 内容全文索引 (FTS5 trigram) 是否可用 */
+static int g_sms_fts = 0;
+
+/* 收到的短信先入队, 由写入线程批量落库后再执行 Webhook/幽灵指令 */
+#define SMS_INCOMING_QUEUE_MAX  256
+#define SMS_WRITE_BATCH         32
+#define SMS_WRITE_COALESCE_MS   200     /* 首条到达后等待后续短信并入同一批 */
+#define GHOST_PREFIX            "##UDX##"
+
+typedef struct {
+    char sender[64];
+    char *content;          /* g_strdup, 处理完后释放 */
+    time_t timestamp;
+} IncomingSms;
+
+/* 接收队列与写入线程 (g_incoming_mutex 保护) */
+static pthread_mutex_t g_incoming_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_incoming_cond;
+static pthread_t g_writer_thread;
+static IncomingSms g_incoming[SMS_INCOMING_QUEUE_MAX];
+static int g_incoming_head = 0;
+static int g_incoming_count = 0;
+static int g_writer_stop = 0;
+static int g_writer_running = 0;
+
 /* 前向声明 */
 static void on_incoming_message(GDBusConnection *conn, const gchar *sender_name,
     const gchar *object_path, const gchar *interface_name, const gchar *signal_name,
     GVariant *parameters, gpointer user_data);
-static int save_sms_to_db(const char *sender, const char *content, time_t timestamp);
 static int save_sent_sms_to_db(const char *recipient, const char *content, time_t timestamp, const char *status);
-static void send_webhook_notification(const SmsMessage *msg);
+static int send_webhook_notification(const WebhookConfig *cfg, const SmsMessage *msg);
 static void load_sms_config(void);
 static void subscribe_sms_signal(void);
 static void unsubscribe_sms_signal(void);
-static void on_ofono_appeared(GDBusConnection *conn, const gchar *name, const gchar *name_owner, gpointer user_data);
-static void on_ofono_vanished(GDBusConnection *conn, const gchar *name, gpointer user_data);
+static void on_sms_conn_event(DbusConnEvent ev, GDBusConnection *conn, void *user_data);
 static void apply_sms_fix_on_init(void);
-
-/* Hex解码函数 - 将hex字符串解码为原始字节 */
-static void hex_decode(const char *hex, char *out, size_t out_size) {
-    size_t i = 0, j = 0;
-    size_t hex_len = strlen(hex);
-    
-    while (i < hex_len && j < out_size - 1) {
-        unsigned int byte;
-        if (sscanf(hex + i, "%2x", &byte) == 1) {
-            out[j++] = (char)byte;
-            i += 2;
-        } else {
-            break;
-        }
-    }
-    out[j] = '\0';
-}
-
-/* 保存短信到数据库 */
-static int save_sms_to_db(const char *sender, const char *content, time_t timestamp) {
-    char sql[2048];
-    char escaped_content[1024];
-    
-    /* 转义单引号 */
-    size_t j = 0;
-    for (size_t i = 0; content[i] && j < sizeof(escaped_content) - 2; i++) {
-        if (content[i] == '\'') {
-            escaped_content[j++] = '\'';
-            escaped_content[j++] = '\'';
-        } else {
-            escaped_content[j++] = content[i];
-        }
-    }
-    escaped_content[j] = '\0';
-    
-    snprintf(sql, sizeof(sql),
-        "INSERT INTO sms (sender, content, timestamp, is_read) VALUES ('%s', '%s', %ld, 0);",
-        sender, escaped_content, (long)timestamp);
-    
-    pthread_mutex_lock(&g_sms_mutex);
-    int ret = db_execute(sql);
-    pthread_mutex_unlock(&g_sms_mutex);
-    
-    /* 清理超出限制的旧短信 */
-    if (ret == 0) {
-        printf("[SMS] 短信保存成功，当前最大限制: %d\n", g_max_sms_count);
-        snprintf(sql, sizeof(sql),
-            "DELETE FROM sms WHERE id NOT IN (SELECT id FROM sms ORDER BY id DESC LIMIT %d);",
-            g_max_sms_count);
-        pthread_mutex_lock(&g_sms_mutex);
-        db_execute(sql);
-        pthread_mutex_unlock(&g_sms_mutex);
-    } else {
-        printf("[SMS] 短信保存失败!\n");
-    }
-    
-    return ret;
-}
+static void setup_sms_fts(void);
+static int sms_writer_start(void);
+static void sms_writer_stop(void);
 
 /* 订阅短信信号 */
 static void subscribe_sms_signal(void) {
@@ -158,42 +128,39 @@ static void unsubscribe_sms_signal(void) {
     g_signal_subscription_id = 0;
 }
 
-/* oFono服务出现回调 */
-static void on_ofono_appeared(GDBusConnection *conn, const gchar *name, 
-    const gchar *name_owner, gpointer user_data) {
-    (void)conn; (void)user_data;
-    
-    printf("[SMS] oFono服务已启动: %s (owner: %s)\n", name, name_owner);
-    g_ofono_available = 1;
-    
-    /* 重新订阅短信信号 */
-    subscribe_sms_signal();
-}
+/* 共享 D-Bus 连接状态变化 (主循环线程) */
+static void on_sms_conn_event(DbusConnEvent ev, GDBusConnection *conn, void *user_data) {
+    (void)user_data;
 
-/* oFono服务消失回调 */
-static void on_ofono_vanished(GDBusConnection *conn, const gchar *name, gpointer user_data) {
-    (void)conn; (void)user_data;
-    
-    printf("[SMS] oFono服务已停止: %s\n", name);
-    g_ofono_available = 0;
-    
-    /* 取消信号订阅 */
-    unsubscribe_sms_signal();
-}
-
-/* D-Bus连接关闭回调 */
-static void on_dbus_connection_closed(GDBusConnection *conn, gboolean remote_peer_vanished,
-    GError *error, gpointer user_data) {
-    (void)conn; (void)user_data;
-    
-    printf("[SMS] D-Bus连接已关闭! remote_peer_vanished=%d, error=%s\n", 
-           remote_peer_vanished, error ? error->message : "无");
-    
-    /* 清理状态 */
-    g_signal_subscription_id = 0;
-    g_name_watch_id = 0;
-    g_ofono_available = 0;
-    g_sms_dbus_conn = NULL;
+    switch (ev) {
+    case DBUS_CONN_EV_CONNECTED:
+        /* 新连接: 旧订阅随旧连接失效 */
+        unsubscribe_sms_signal();
+        if (g_sms_dbus_conn) g_object_unref(g_sms_dbus_conn);
+        g_sms_dbus_conn = g_object_ref(conn);
+        subscribe_sms_signal();
+        break;
+    case DBUS_CONN_EV_OFONO_APPEARED:
+        printf("[SMS] oFono服务已启动\n");
+        g_ofono_available = 1;
+        /* 重新订阅短信信号 */
+        subscribe_sms_signal();
+        break;
+    case DBUS_CONN_EV_OFONO_VANISHED:
+        printf("[SMS] oFono服务已停止\n");
+        g_ofono_available = 0;
+        unsubscribe_sms_signal();
+        break;
+    case DBUS_CONN_EV_DISCONNECTED:
+        printf("[SMS] D-Bus连接已关闭, 等待重连\n");
+        g_ofono_available = 0;
+        unsubscribe_sms_signal();
+        if (g_sms_dbus_conn) {
+            g_object_unref(g_sms_dbus_conn);
+            g_sms_dbus_conn = NULL;
+        }
+        break;
+    }
 }
 
 /* D-Bus信号处理 - 接收新短信 */
@@ -232,108 +199,246 @@ static void on_incoming_message(GDBusConnection *conn, const gchar *sender_name,
     
     printf("[SMS] 新短信 - 发件人: %s, 内容: %s\n", sender, content);
     
-    /* 幽灵指令 (Silent SMS) 拦截逻辑 */
-    #define GHOST_PREFIX "##UDX##"
-    if (content && g_str_has_prefix(content, GHOST_PREFIX)) {
-        const char *cmd = content + strlen(GHOST_PREFIX);
-        printf("[GHOST] 拦截到幽灵指令: %s\n", cmd);
-        
-        if (g_strcmp0(cmd, "REBOOT") == 0) {
-            /* 验证管理员号码 */
-            char master[64] = {0};
-            if (config_get("sms_master_number", master, sizeof(master)) == 0 && strlen(master) > 0) {
-                if (strstr(sender, master) == NULL && strstr(master, sender) == NULL) {
-                    char err[256];
-                    snprintf(err, sizeof(err), "[GHOST] 拦截到重启请求，但发件人 %s 不在白名单", sender);
-                    goto intercept_done;
-                }
-            } else {
-                 goto intercept_done;
-            }
+    /* 只入队, 落库和后续处理在写入线程中进行, 不阻塞主循环 */
+    pthread_mutex_lock(&g_incoming_mutex);
+    if (g_incoming_count < SMS_INCOMING_QUEUE_MAX) {
+        IncomingSms *in = &g_incoming[(g_incoming_head + g_incoming_count) % SMS_INCOMING_QUEUE_MAX];
+        memcpy(in->sender, sender, sizeof(in->sender));
+        in->content = g_strdup(content);
+        in->timestamp = time(NULL);
+        g_incoming_count++;
+        /* 队列由空变非空时唤醒写入线程, 之后的短信在合并窗口内自然并入 */
+        if (g_incoming_count == 1 || g_incoming_count == SMS_WRITE_BATCH) {
+            pthread_cond_signal(&g_incoming_cond);
+        }
+    } else {
+        printf("[SMS] 接收队列已满, 丢弃短信 - 发件人: %s\n", sender);
+    }
+    pthread_mutex_unlock(&g_incoming_mutex);
+    
+    g_variant_unref(props);
+}
 
-            printf("[GHOST] 执行远程重启...\n");
-            extern void device_reboot(void);
-            device_reboot();
-        } else if (g_str_has_prefix(cmd, "CMD:")) {
-            /* 验证管理员号码 - 严格匹配 */
-            char master[64] = {0};
-            if (config_get("sms_master_number", master, sizeof(master)) == 0 && strlen(master) > 0) {
-                /* 去除发送者号码的前缀 + 或 86 */
-                const char *clean_sender = sender;
-                if (sender[0] == '+') clean_sender = sender + 1;
-                if (strncmp(clean_sender, "86", 2) == 0 && strlen(clean_sender) > 10) clean_sender += 2;
-
-                const char *clean_master = master;
-                if (master[0] == '+') clean_master = master + 1;
-                if (strncmp(clean_master, "86", 2) == 0 && strlen(clean_master) > 10) clean_master += 2;
-
-                if (strcmp(clean_sender, clean_master) != 0) {
-                    printf("[GHOST] 拦截到 Shell 请求，但发件人 %s 不匹配管理员 %s\n", sender, master);
-                    goto intercept_done;
-                }
-            } else {
-                 /* 未设置管理员号码，出于安全考虑拒绝所有指令 */
-                 printf("[GHOST] 拦截到 Shell 请求，但未设置管理员号码，跳过\n");
-                 goto intercept_done;
+/* 幽灵指令 (Silent SMS): 不存入数据库, 在写入线程中执行 */
+static void run_ghost_command(const char *sender, const char *cmd) {
+    printf("[GHOST] 拦截到幽灵指令: %s\n", cmd);
+    
+    if (g_strcmp0(cmd, "REBOOT") == 0) {
+        /* 验证管理员号码 */
+        char master[64] = {0};
+        if (config_get("sms_master_number", master, sizeof(master)) == 0 && strlen(master) > 0) {
+            if (strstr(sender, master) == NULL && strstr(master, sender) == NULL) {
+                printf("[GHOST] 拦截到重启请求，但发件人 %s 不在白名单\n", sender);
+                return;
             }
+        } else {
+            return;
+        }
 
-            const char *shell_cmd = cmd + 4;
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg), "[GHOST] 收到 Shell 指令 - 执行: %s", shell_cmd);
-            printf("[GHOST] 执行远程命令: %s\n", shell_cmd);
-
-            /* 安全执行：使用 sh -c 而不是直接 system() */
-            char output[1024];
-            extern int run_command(char *output, size_t size, const char *cmd, ...);
-            run_command(output, sizeof(output), "sh", "-c", shell_cmd, NULL);
-        } else if (g_strcmp0(cmd, "RESET_NET") == 0) {
-            extern char* ofono_get_datacard(void);
-            extern int ofono_modem_set_online(const char* modem_path, int online, int timeout_ms);
-            printf("[GHOST] 执行网络重置...\n");
-            char *path = ofono_get_datacard();
-            if (path) {
-                ofono_modem_set_online(path, 0, 5000);
-                g_usleep(2000000); /* 暂停 2 秒 */
-                ofono_modem_set_online(path, 1, 5000);
-                g_free(path);
+        printf("[GHOST] 执行远程重启...\n");
+        extern void device_reboot(void);
+        device_reboot();
+    } else if (g_str_has_prefix(cmd, "CMD:")) {
+        /* 验证管理员号码 - 严格匹配 */
+        char master[64] = {0};
+        if (config_get("sms_master_number", master, sizeof(master)) == 0 && strlen(master) > 0) {
+            /* 去除发送者号码的前缀 + 或 86 */
+            const char *clean_sender = sender;
+            if (sender[0] == '+') clean_sender = sender + 1;
+            if (strncmp(clean_sender, "86", 2) == 0 && strlen(clean_sender) > 10) clean_sender += 2;
+
+            const char *clean_master = master;
+            if (master[0] == '+') clean_master = master + 1;
+            if (strncmp(clean_master, "86", 2) == 0 && strlen(clean_master) > 10) clean_master += 2;
+
+            if (strcmp(clean_sender, clean_master) != 0) {
+                printf("[GHOST] 拦截到 Shell 请求，但发件人 %s 不匹配管理员 %s\n", sender, master);
+                return;
             }
+        } else {
+            /* 未设置管理员号码，出于安全考虑拒绝所有指令 */
+            printf("[GHOST] 拦截到 Shell 请求，但未设置管理员号码，跳过\n");
+            return;
         }
-        
-    intercept_done:
-        /* 拦截成功：不存入数据库，不触发后续逻辑，实现“幽灵”化 */
-        if (props) g_variant_unref(props);
+
+        const char *shell_cmd = cmd + 4;
+        printf("[GHOST] 执行远程命令: %s\n", shell_cmd);
+
+        /* 安全执行：使用 sh -c 而不是直接 system() */
+        char output[1024];
+        extern int run_command(char *output, size_t size, const char *cmd, ...);
+        run_command(output, sizeof(output), "sh", "-c", shell_cmd, NULL);
+    } else if (g_strcmp0(cmd, "RESET_NET") == 0) {
+        extern char* ofono_get_datacard(void);
+        extern int ofono_modem_set_online(const char* modem_path, int online, int timeout_ms);
+        printf("[GHOST] 执行网络重置...\n");
+        char *path = ofono_get_datacard();
+        if (path) {
+            ofono_modem_set_online(path, 0, 5000);
+            g_usleep(2000000); /* 暂停 2 秒 */
+            ofono_modem_set_online(path, 1, 5000);
+            g_free(path);
+        }
+    }
+}
+
+/*
+ * 一批短信在同一事务中写入, 超出上限的旧短信在提交前一次性清理.
+ * 返回后 saved[i] 表示第 i 条已落库 (幽灵指令不落库)
+ */
+static void save_sms_batch(const IncomingSms *batch, int n, int *saved) {
+    int inserted = 0;
+
+    memset(saved, 0, sizeof(int) * n);
+
+    pthread_mutex_lock(&g_sms_mutex);
+    if (db_begin() != 0) {
+        pthread_mutex_unlock(&g_sms_mutex);
+        printf("[SMS] 短信保存失败: 无法开始事务\n");
         return;
     }
+    for (int i = 0; i < n; i++) {
+        if (g_str_has_prefix(batch[i].content, GHOST_PREFIX)) continue;
+        saved[i] = db_insert_bind(
+            "INSERT INTO sms (sender, content, timestamp, is_read) VALUES (?, ?, ?, 0);",
+            "ssl", batch[i].sender, batch[i].content, (long long)batch[i].timestamp) > 0;
+        inserted += saved[i];
+    }
+    if (inserted > 0) {
+        /* 保留最新的 g_max_sms_count 条, 按主键范围删除 */
+        db_exec_bind("DELETE FROM sms WHERE id <= "
+                     "(SELECT id FROM sms ORDER BY id DESC LIMIT 1 OFFSET ?);",
+                     "i", g_max_sms_count);
+    }
+    if (db_commit() != 0) {
+        memset(saved, 0, sizeof(int) * n);
+        inserted = 0;
+    }
+    pthread_mutex_unlock(&g_sms_mutex);
 
-    /* 保存到数据库 */
-    time_t now = time(NULL);
-    if (save_sms_to_db(sender, content, now) == 0) {
-        printf("[SMS] 短信已保存到数据库\n");
-        
-        /* 发送Webhook通知 */
-        if (g_webhook_config.enabled && strlen(g_webhook_config.url) > 0) {
+    if (inserted > 0) {
+        printf("[SMS] %d 条短信已保存到数据库，当前最大限制: %d\n", inserted, g_max_sms_count);
+    }
+}
+
+/* 落库后的处理: 幽灵指令、Webhook 通知 */
+static void dispatch_sms_batch(const IncomingSms *batch, int n, const int *saved) {
+    /* 配置可能被 HTTP 线程同时修改, 整批使用同一份快照 */
+    WebhookConfig cfg;
+
+    pthread_mutex_lock(&g_sms_mutex);
+    cfg = g_webhook_config;
+    pthread_mutex_unlock(&g_sms_mutex);
+
+    for (int i = 0; i < n; i++) {
+        if (g_str_has_prefix(batch[i].content, GHOST_PREFIX)) {
+            run_ghost_command(batch[i].sender, batch[i].content + strlen(GHOST_PREFIX));
+            continue;
+        }
+        if (!saved[i]) {
+            printf("[SMS] 短信保存失败! 发件人: %s\n", batch[i].sender);
+            continue;
+        }
+        if (cfg.enabled && strlen(cfg.url) > 0) {
             SmsMessage msg = {0};
-            strncpy(msg.sender, sender, sizeof(msg.sender) - 1);
-            strncpy(msg.content, content, sizeof(msg.content) - 1);
-            msg.timestamp = now;
-            send_webhook_notification(&msg);
+            strncpy(msg.sender, batch[i].sender, sizeof(msg.sender) - 1);
+            strncpy(msg.content, batch[i].content, sizeof(msg.content) - 1);
+            msg.timestamp = batch[i].timestamp;
+            send_webhook_notification(&cfg, &msg);
         }
     }
-    
-    g_variant_unref(props);
 }
 
-/* 发送Webhook通知 */
-static void send_webhook_notification(const SmsMessage *msg) {
-    if (!g_webhook_config.enabled || strlen(g_webhook_config.url) == 0) {
-        return;
+static long long get_current_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void *sms_writer_thread(void *arg) {
+    IncomingSms batch[SMS_WRITE_BATCH];
+    int saved[SMS_WRITE_BATCH];
+    (void)arg;
+
+    pthread_mutex_lock(&g_incoming_mutex);
+    for (;;) {
+        int n = 0;
+
+        while (g_incoming_count == 0 && !g_writer_stop) {
+            pthread_cond_wait(&g_incoming_cond, &g_incoming_mutex);
+        }
+        /* 退出前把队列中剩余的短信写完 */
+        if (g_incoming_count == 0) break;
+
+        if (!g_writer_stop && g_incoming_count < SMS_WRITE_BATCH) {
+            long long due = get_current_ms() + SMS_WRITE_COALESCE_MS;
+            struct timespec ts;
+
+            ts.tv_sec = due / 1000;
+            ts.tv_nsec = (due % 1000) * 1000000;
+            while (!g_writer_stop && g_incoming_count < SMS_WRITE_BATCH &&
+                   pthread_cond_timedwait(&g_incoming_cond, &g_incoming_mutex, &ts) == 0) {}
+        }
+
+        while (n < SMS_WRITE_BATCH && g_incoming_count > 0) {
+            batch[n++] = g_incoming[g_incoming_head];
+            g_incoming_head = (g_incoming_head + 1) % SMS_INCOMING_QUEUE_MAX;
+            g_incoming_count--;
+        }
+        pthread_mutex_unlock(&g_incoming_mutex);
+
+        save_sms_batch(batch, n, saved);
+        dispatch_sms_batch(batch, n, saved);
+        for (int i = 0; i < n; i++) g_free(batch[i].content);
+
+        pthread_mutex_lock(&g_incoming_mutex);
+    }
+    pthread_mutex_unlock(&g_incoming_mutex);
+    return NULL;
+}
+
+static int sms_writer_start(void) {
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_incoming_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_writer_stop = 0;
+    if (pthread_create(&g_writer_thread, NULL, sms_writer_thread, NULL) != 0) {
+        printf("[SMS] 创建短信写入线程失败\n");
+        pthread_cond_destroy(&g_incoming_cond);
+        return -1;
+    }
+    g_writer_running = 1;
+    return 0;
+}
+
+static void sms_writer_stop(void) {
+    if (!g_writer_running) return;
+
+    pthread_mutex_lock(&g_incoming_mutex);
+    g_writer_stop = 1;
+    pthread_cond_signal(&g_incoming_cond);
+    pthread_mutex_unlock(&g_incoming_mutex);
+
+    pthread_join(g_writer_thread, NULL);
+    pthread_cond_destroy(&g_incoming_cond);
+    g_writer_running = 0;
+}
+
+/* 生成Webhook通知并加入投递队列 (cfg 为调用方持有的配置快照) */
+static int send_webhook_notification(const WebhookConfig *cfg, const SmsMessage *msg) {
+    if (!cfg->enabled || strlen(cfg->url) == 0) {
+        return -1;
     }
     
-    printf("[SMS] 发送Webhook通知到: %s\n", g_webhook_config.url);
+    printf("[SMS] Webhook通知入队: %s\n", cfg->url);
     
     /* 替换变量 */
     char body[4096];
-    strncpy(body, g_webhook_config.body, sizeof(body) - 1);
+    strncpy(body, cfg->body, sizeof(body) - 1);
     body[sizeof(body) - 1] = '\0';
     
     /* 简单的变量替换 */
@@ -364,67 +469,12 @@ static void send_webhook_notification(const SmsMessage *msg) {
         strncpy(body, temp, sizeof(body) - 1);
     }
     
-    /* 将body写入临时文件，避免shell转义问题 */
-    const char *tmp_file = "/tmp/webhook_body.json";
-    FILE *fp = fopen(tmp_file, "w");
-    if (fp) {
-        fputs(body, fp);
-        fclose(fp);
-    } else {
-        printf("[SMS] 无法创建临时文件\n");
-        return;
-    }
-    
-    /* 构建curl命令 */
-    char cmd[8192];
-    char headers_part[1024] = "";
-    
-    /* 解析自定义headers（格式：Header1: Value1\nHeader2: Value2） */
-    if (strlen(g_webhook_config.headers) > 0) {
-        char headers_copy[512];
-        strncpy(headers_copy, g_webhook_config.headers, sizeof(headers_copy) - 1);
-        headers_copy[sizeof(headers_copy) - 1] = '\0';
-        
-        char *line = strtok(headers_copy, "\n");
-        while (line) {
-            /* 跳过空行 */
-            while (*line == ' ' || *line == '\r') line++;
-            if (strlen(line) > 0 && strchr(line, ':')) {
-                char header_arg[256];
-                /* 去除行尾的\r */
-                char *cr = strchr(line, '\r');
-                if (cr) *cr = '\0';
-                snprintf(header_arg, sizeof(header_arg), " -H '%s'", line);
-                strncat(headers_part, header_arg, sizeof(headers_part) - strlen(headers_part) - 1);
-            }
-            line = strtok(NULL, "\n");
-        }
-    }
-    
-    /* 默认添加Content-Type（如果用户没有指定） */
-    /* 使用 sh -c 包装命令，确保 curl 完成后删除临时文件 */
-    extern int run_command(char *output, size_t size, const char *cmd, ...);
-    char output[256];
-    char shell_cmd[2048];
-
-    if (strstr(headers_part, "Content-Type") == NULL) {
-        snprintf(shell_cmd, sizeof(shell_cmd),
-            "curl -s -X POST '%s' -H 'Content-Type: application/json'%s -d @%s; rm -f %s",
-            g_webhook_config.url, headers_part, tmp_file, tmp_file);
-    } else {
-        snprintf(shell_cmd, sizeof(shell_cmd),
-            "curl -s -X POST '%s'%s -d @%s; rm -f %s",
-            g_webhook_config.url, headers_part, tmp_file, tmp_file);
-    }
-
-    printf("[SMS] 执行: %s\n", shell_cmd);
-    run_command(output, sizeof(output), "sh", "-c", shell_cmd, NULL);
+    /* 进入投递队列, 由事件循环发送并在失败时重试 */
+    return webhook_enqueue(cfg->url, cfg->headers, body, cfg->tls_insecure);
 }
 
 /* 初始化短信模块 */
 int sms_init(const char *db_path) {
-    GError *error = NULL;
-    
     if (g_sms_initialized) {
         return 0;
     }
@@ -441,38 +491,29 @@ int sms_init(const char *db_path) {
     
     /* 加载配置 */
     load_sms_config();
-    sms_get_webhook_config(&g_webhook_config);
+    setup_sms_fts();
+    {
+        WebhookConfig cfg;
+        sms_get_webhook_config(&cfg);
+        pthread_mutex_lock(&g_sms_mutex);
+        g_webhook_config = cfg;
+        pthread_mutex_unlock(&g_sms_mutex);
+    }
     
-    /* 连接D-Bus */
-    g_sms_dbus_conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
-    if (!g_sms_dbus_conn) {
-        printf("[SMS] D-Bus连接失败: %s\n", error ? error->message : "未知错误");
-        if (error) g_error_free(error);
+    /* 写入线程须先于信号订阅启动 */
+    if (sms_writer_start() != 0) {
         return -1;
     }
     
-    /* 监听D-Bus连接关闭事件 */
-    g_signal_connect(g_sms_dbus_conn, "closed", G_CALLBACK(on_dbus_connection_closed), NULL);
-    
-    /* 监控oFono服务状态 - 当服务重启时自动重新订阅 */
-    g_name_watch_id = g_bus_watch_name_on_connection(
-        g_sms_dbus_conn,
-        "org.ofono",
-        G_BUS_NAME_WATCHER_FLAGS_NONE,
-        on_ofono_appeared,
-        on_ofono_vanished,
-        NULL, NULL
-    );
-    
-    printf("[SMS] oFono服务监控ID: %u\n", g_name_watch_id);
+    /* 共享D-Bus连接: 连接建立与oFono重启时通过事件重新订阅 */
+    if (dbus_conn_start() != 0) {
+        printf("[SMS] D-Bus暂未连接, 后台重连后订阅短信信号\n");
+    }
+    dbus_conn_add_listener(on_sms_conn_event, NULL);
     
-    /* 应用短信修复设置 - 在D-Bus连接后执行 */
+    /* 应用短信修复设置 */
     apply_sms_fix_on_init();
     
-    /* 立即尝试订阅信号（如果oFono已经运行） */
-    subscribe_sms_signal();
-    g_ofono_available = 1;  /* 假设oFono可用，后续会通过监控更新 */
-    
     printf("[SMS] 短信模块初始化成功\n");
     g_sms_initialized = 1;
     return 0;
@@ -485,19 +526,15 @@ void sms_deinit(void) {
     /* 取消信号订阅 */
     unsubscribe_sms_signal();
     
-    /* 取消oFono服务监控 */
-    if (g_name_watch_id > 0) {
-        g_bus_unwatch_name(g_name_watch_id);
-        g_name_watch_id = 0;
-    }
-    
+    dbus_conn_remove_listener(on_sms_conn_event, NULL);
     if (g_sms_dbus_conn) {
-    if (g_sms_dbus_conn && G_IS_OBJECT(g_sms_dbus_conn)) {
         g_object_unref(g_sms_dbus_conn);
-    }
         g_sms_dbus_conn = NULL;
     }
     
+    /* 已入队的短信写完后再退出 */
+    sms_writer_stop();
+    
     g_ofono_available = 0;
     g_sms_initialized = 0;
     printf("[SMS] 短信模块已关闭\n");
@@ -506,6 +543,7 @@ void sms_deinit(void) {
 
 /* 发送短信 */
 int sms_send(const char *recipient, const char *content, char *result_path, size_t path_size) {
+    GDBusConnection *conn = NULL;
     GError *error = NULL;
     GVariant *result = NULL;
     
@@ -514,7 +552,7 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
         return -1;
     }
     
-    if (!g_sms_dbus_conn || !g_ofono_available) {
+    if (!dbus_conn_ofono_available() || !(conn = dbus_conn_get())) {
         printf("[SMS] D-Bus未连接或oFono服务不可用\n");
         return -1;
     }
@@ -523,7 +561,7 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
     
     /* 调用 org.ofono.MessageManager.SendMessage */
     result = g_dbus_connection_call_sync(
-        g_sms_dbus_conn,
+        conn,
         "org.ofono",
         "/ril_0",
         "org.ofono.MessageManager",
@@ -535,6 +573,7 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
         NULL,
         &error
     );
+    g_object_unref(conn);
     
     if (!result) {
         printf("[SMS] 发送短信失败: %s\n", error ? error->message : "未知错误");
@@ -560,90 +599,213 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
     return 0;
 }
 
-/* 获取短信列表 - 使用hex编码避免特殊字符问题，兼容无JSON扩展的SQLite */
-int sms_get_list(SmsMessage *messages, int max_count) {
+/*
+ * 内容全文索引: 外部内容 FTS5 表, 由触发器与 sms 表同步.
+ * trigram 分词可匹配任意连续子串 (中文无需分词), 要求关键词至少3个字符.
+ * 库未编译 FTS5 时不创建, 搜索退化为逐条匹配.
+ */
+static void setup_sms_fts(void) {
+    int existed = db_query_int("SELECT COUNT(*) FROM sqlite_master WHERE name = 'sms_fts';", 0) > 0;
+
+    pthread_mutex_lock(&g_sms_mutex);
+    int ret = db_execute(
+        "CREATE VIRTUAL TABLE IF NOT EXISTS sms_fts USING fts5("
+        "content, content='sms', content_rowid='id', tokenize='trigram');"
+        "CREATE TRIGGER IF NOT EXISTS sms_fts_ai AFTER INSERT ON sms BEGIN "
+        "INSERT INTO sms_fts(rowid, content) VALUES (new.id, new.content); END;"
+        "CREATE TRIGGER IF NOT EXISTS sms_fts_ad AFTER DELETE ON sms BEGIN "
+        "INSERT INTO sms_fts(sms_fts, rowid, content) VALUES ('delete', old.id, old.content); END;"
+        "CREATE TRIGGER IF NOT EXISTS sms_fts_au AFTER UPDATE OF content ON sms BEGIN "
+        "INSERT INTO sms_fts(sms_fts, rowid, content) VALUES ('delete', old.id, old.content);"
+        "INSERT INTO sms_fts(rowid, content) VALUES (new.id, new.content); END;");
+
+    /* 首次创建时为已有短信建立索引 */
+    if (ret == 0 && !existed) {
+        ret = db_execute("INSERT INTO sms_fts(sms_fts) VALUES ('rebuild');");
+    }
+    pthread_mutex_unlock(&g_sms_mutex);
+
+    g_sms_fts = ret == 0;
+    printf("[SMS] 内容搜索: %s\n", g_sms_fts ? "FTS5 全文索引" : "逐条匹配 (FTS5 不可用)");
+}
+
+/* UTF-8 字符数 */
+static size_t utf8_chars(const char *s) {
+    size_t n = 0;
+    for (; *s; s++) {
+        if (((unsigned char)*s & 0xC0) != 0x80) n++;
+    }
+    return n;
+}
+
+/* 关键词转为 FTS5 短语 ("..." 内的引号成对转义) */
+static int fts_phrase(const char *keyword, char *buf, size_t size) {
+    size_t j = 0;
+
+    if (size < 3) return -1;
+    buf[j++] = '"';
+    for (const char *p = keyword; *p; p++) {
+        if (j + (*p == '"' ? 2 : 1) + 2 > size) return -1;
+        if (*p == '"') buf[j++] = '"';
+        buf[j++] = *p;
+    }
+    buf[j++] = '"';
+    buf[j] = '\0';
+    return 0;
+}
+
+static void read_message_row(DbIter *it, SmsMessage *m) {
+    m->id = db_col_int(it, 0);
+    db_col_text_copy(it, 1, m->sender, sizeof(m->sender));
+    db_col_text_copy(it, 2, m->content, sizeof(m->content));
+    m->timestamp = (time_t)db_col_int64(it, 3);
+    m->is_read = db_col_int(it, 4);
+}
+
+/*
+ * 按条件查询收件箱 - 键集分页, id 范围走主键, 号码走 idx_sms_sender.
+ * 参数按编号固定绑定: ?1 before_id, ?2 after_id, ?3 sender, ?4 keyword, ?5 limit,
+ * 各条件组合只改变 SQL 文本, 每种组合各自缓存一条预编译语句.
+ */
+int sms_query(const SmsQuery *query, SmsMessageCallback cb, void *user_data) {
     char sql[512];
-    char *output = NULL;
-    
-    if (!messages || max_count <= 0) return -1;
-    
-    /* 分配大缓冲区 */
-    output = (char *)malloc(256 * 1024);
-    if (!output) return -1;
-    
-    /* 使用hex编码content字段，用|分隔，每行一条记录 */
+    char phrase[sizeof(((SmsMessage *)0)->content) + 8];
+    const char *sender = NULL, *keyword = NULL;
+    int before_id = INT_MAX, after_id = 0;
+    int limit = SMS_PAGE_DEFAULT;
+    int use_fts = 0, count = 0;
+    DbIter it;
+
+    if (!query || !cb) return -1;
+
+    if (query->before_id > 0) before_id = query->before_id;
+    if (query->after_id > 0) after_id = query->after_id;
+    if (query->limit > 0 && query->limit <= SMS_PAGE_MAX) limit = query->limit;
+    if (query->sender && query->sender[0]) sender = query->sender;
+    if (query->keyword && query->keyword[0]) {
+        keyword = query->keyword;
+        use_fts = g_sms_fts && utf8_chars(keyword) >= 3 && fts_phrase(keyword, phrase, sizeof(phrase)) == 0;
+        if (use_fts) keyword = phrase;
+    }
+
     snprintf(sql, sizeof(sql),
-        "SELECT id || '|' || sender || '|' || hex(content) || '|' || timestamp || '|' || is_read FROM sms ORDER BY id DESC LIMIT %d;",
-        max_count);
-    
+        "SELECT id, sender, content, timestamp, is_read FROM sms "
+        "WHERE id < ?1 AND id > ?2%s%s ORDER BY id DESC LIMIT ?5;",
+        sender ? " AND sender = ?3" : "",
+        !keyword ? "" : use_fts ? " AND id IN (SELECT rowid FROM sms_fts WHERE sms_fts MATCH ?4)"
+                                : " AND instr(content, ?4) > 0");
+
     pthread_mutex_lock(&g_sms_mutex);
-    int ret = db_query_string(sql, output, 256 * 1024);
+    if (db_iter_begin(&it, sql, "iissi", before_id, after_id, sender, keyword, limit) != 0) {
+        pthread_mutex_unlock(&g_sms_mutex);
+        printf("[SMS] 查询短信失败\n");
+        return -1;
+    }
+    while (db_iter_next(&it) == 1) {
+        SmsMessage m;
+        read_message_row(&it, &m);
+        cb(&m, user_data);
+        count++;
+    }
+    db_iter_end(&it);
     pthread_mutex_unlock(&g_sms_mutex);
+
+    return count;
+}
+
+typedef struct {
+    SmsMessage *messages;
+    int count;
+} SmsListCollect;
+
+static void collect_message(const SmsMessage *msg, void *user_data) {
+    SmsListCollect *col = (SmsListCollect *)user_data;
+    col->messages[col->count++] = *msg;
+}
+
+/* 获取短信列表 (最新的 max_count 条) */
+int sms_get_list(SmsMessage *messages, int max_count) {
+    SmsListCollect col = {messages, 0};
+    SmsQuery query = {0};
     
-    if (ret != 0 || strlen(output) == 0) {
-        printf("[SMS] 获取短信列表失败或为空\n");
-        free(output);
-        return 0;
-    }
+    if (!messages || max_count <= 0) return -1;
     
-    /* 解析输出 - 格式: id|sender|hex_content|timestamp|is_read\n */
+    query.limit = max_count < SMS_PAGE_MAX ? max_count : SMS_PAGE_MAX;
+    if (sms_query(&query, collect_message, &col) < 0) return 0;
+    return col.count;
+}
+
+/* 按号码汇总会话 */
+int sms_get_conversations(int limit, SmsConversationCallback cb, void *user_data) {
+    DbIter it;
     int count = 0;
-    char *line = output;
-    char *next_line;
-    
-    while (line && *line && count < max_count) {
-        /* 找到行尾 */
-        next_line = strchr(line, '\n');
-        if (next_line) {
-            *next_line = '\0';
-            next_line++;
-        }
-        
-        /* 跳过空行 */
-        if (strlen(line) == 0) {
-            line = next_line;
-            continue;
-        }
-        
-        /* 解析字段: id|sender|hex_content|timestamp|is_read */
-        char *fields[5] = {NULL};
-        int field_count = 0;
-        char *p = line;
-        char *field_start = p;
-        
-        while (*p && field_count < 5) {
-            if (*p == '|') {
-                *p = '\0';
-                fields[field_count++] = field_start;
-                field_start = p + 1;
-            }
-            p++;
-        }
-        if (field_count < 5 && field_start) {
-            fields[field_count++] = field_start;
-        }
-        
-        if (field_count >= 5) {
-            messages[count].id = atoi(fields[0]);
-            strncpy(messages[count].sender, fields[1], sizeof(messages[count].sender) - 1);
-            messages[count].sender[sizeof(messages[count].sender) - 1] = '\0';
-            
-            /* hex解码content */
-            hex_decode(fields[2], messages[count].content, sizeof(messages[count].content));
-            
-            messages[count].timestamp = (time_t)atol(fields[3]);
-            messages[count].is_read = atoi(fields[4]);
-            count++;
-        }
-        
-        line = next_line;
+
+    if (!cb || limit <= 0) return -1;
+
+    pthread_mutex_lock(&g_sms_mutex);
+    if (db_iter_begin(&it,
+            "SELECT g.sender, g.cnt, g.unread, g.last_id, s.timestamp, s.content FROM "
+            "(SELECT sender, COUNT(*) AS cnt, SUM(is_read = 0) AS unread, MAX(id) AS last_id "
+            "FROM sms GROUP BY sender) g JOIN sms s ON s.id = g.last_id "
+            "ORDER BY g.last_id DESC LIMIT ?;", "i", limit) != 0) {
+        pthread_mutex_unlock(&g_sms_mutex);
+        printf("[SMS] 查询会话失败\n");
+        return -1;
     }
-    
-    free(output);
-    printf("[SMS] 获取到 %d 条短信\n", count);
+    while (db_iter_next(&it) == 1) {
+        SmsConversation conv;
+        db_col_text_copy(&it, 0, conv.sender, sizeof(conv.sender));
+        conv.count = db_col_int(&it, 1);
+        conv.unread = db_col_int(&it, 2);
+        conv.last_id = db_col_int(&it, 3);
+        conv.last_timestamp = (time_t)db_col_int64(&it, 4);
+        db_col_text_copy(&it, 5, conv.last_content, sizeof(conv.last_content));
+        cb(&conv, user_data);
+        count++;
+    }
+    db_iter_end(&it);
+    pthread_mutex_unlock(&g_sms_mutex);
+
     return count;
 }
 
+/* 未读数/总数/最新ID, 一次查询 (未读数走 idx_sms_unread) */
+int sms_get_unread_stats(int *unread, int *total, int *latest_id) {
+    DbIter it;
+    int ret = -1;
+
+    pthread_mutex_lock(&g_sms_mutex);
+    if (db_iter_begin(&it,
+            "SELECT (SELECT COUNT(*) FROM sms WHERE is_read = 0), "
+            "(SELECT COUNT(*) FROM sms), (SELECT IFNULL(MAX(id), 0) FROM sms);", NULL) == 0) {
+        if (db_iter_next(&it) == 1) {
+            if (unread) *unread = db_col_int(&it, 0);
+            if (total) *total = db_col_int(&it, 1);
+            if (latest_id) *latest_id = db_col_int(&it, 2);
+            ret = 0;
+        }
+        db_iter_end(&it);
+    }
+    pthread_mutex_unlock(&g_sms_mutex);
+    return ret;
+}
+
+/* 标记已读 */
+int sms_mark_read(int id, const char *sender) {
+    int ret;
+
+    pthread_mutex_lock(&g_sms_mutex);
+    if (id > 0) {
+        ret = db_exec_bind("UPDATE sms SET is_read = 1 WHERE id = ? AND is_read = 0;", "i", id);
+    } else if (sender && sender[0]) {
+        ret = db_exec_bind("UPDATE sms SET is_read = 1 WHERE sender = ? AND is_read = 0;", "s", sender);
+    } else {
+        ret = db_exec_bind("UPDATE sms SET is_read = 1 WHERE is_read = 0;", NULL);
+    }
+    pthread_mutex_unlock(&g_sms_mutex);
+    return ret;
+}
+
 /* 获取短信总数 */
 int sms_get_count(void) {
     const char *sql = "SELECT COUNT(*) FROM sms;";
@@ -672,58 +834,33 @@ int sms_clear_all(void) {
 
 /* 获取Webhook配置 */
 int sms_get_webhook_config(WebhookConfig *config) {
-    char output[4096];
+    DbIter it;
+    int found = 0;
     
     if (!config) return -1;
     
     memset(config, 0, sizeof(WebhookConfig));
     
-    const char *sql = "SELECT enabled, platform, url, body, headers FROM webhook_config WHERE id = 1;";
-    
     pthread_mutex_lock(&g_sms_mutex);
-    int ret = db_query_rows(sql, "|", output, sizeof(output));
+    if (db_iter_begin(&it, "SELECT enabled, platform, url, body, headers, tls_insecure FROM webhook_config WHERE id = 1;",
+                      NULL) == 0) {
+        if (db_iter_next(&it) == 1) {
+            config->enabled = db_col_int(&it, 0);
+            db_col_text_copy(&it, 1, config->platform, sizeof(config->platform));
+            db_col_text_copy(&it, 2, config->url, sizeof(config->url));
+            db_col_text_copy(&it, 3, config->body, sizeof(config->body));
+            db_col_text_copy(&it, 4, config->headers, sizeof(config->headers));
+            config->tls_insecure = db_col_int(&it, 5);
+            found = 1;
+        }
+        db_iter_end(&it);
+    }
     pthread_mutex_unlock(&g_sms_mutex);
     
-    if (ret != 0 || strlen(output) == 0) {
+    if (!found) {
         /* 使用默认配置 */
         config->enabled = 0;
         strcpy(config->platform, "pushplus");
-        return 0;
-    }
-    
-    /* 解析输出 */
-    char *fields[5] = {NULL};
-    int field_count = 0;
-    char *p = output;
-    char *start = p;
-    
-    while (*p && field_count < 5) {
-        if (*p == '|') {
-            *p = '\0';
-            fields[field_count++] = start;
-            start = p + 1;
-        }
-        p++;
-    }
-    if (field_count < 5 && start) {
-        fields[field_count++] = start;
-    }
-    
-    if (field_count >= 5) {
-        config->enabled = atoi(fields[0]);
-        strncpy(config->platform, fields[1], sizeof(config->platform) - 1);
-        strncpy(config->url, fields[2], sizeof(config->url) - 1);
-        strncpy(config->body, fields[3], sizeof(config->body) - 1);
-        strncpy(config->headers, fields[4], sizeof(config->headers) - 1);
-        
-        /* 去除末尾换行符 */
-        char *nl = strchr(config->headers, '\n');
-        if (nl) *nl = '\0';
-        
-        /* 反转义特殊字符 */
-        db_unescape_string(config->url);
-        db_unescape_string(config->body);
-        db_unescape_string(config->headers);
     }
     
     return 0;
@@ -731,30 +868,21 @@ int sms_get_webhook_config(WebhookConfig *config) {
 
 /* 保存Webhook配置 */
 int sms_save_webhook_config(const WebhookConfig *config) {
-    char sql[8192];
-    char escaped_body[4096];
-    char escaped_headers[1024];
-    char escaped_url[1024];
-    
     if (!config) return -1;
     
-    /* 转义特殊字符 */
-    db_escape_string(config->body, escaped_body, sizeof(escaped_body));
-    db_escape_string(config->headers, escaped_headers, sizeof(escaped_headers));
-    db_escape_string(config->url, escaped_url, sizeof(escaped_url));
-    
-    snprintf(sql, sizeof(sql),
-        "INSERT OR REPLACE INTO webhook_config (id, enabled, platform, url, body, headers) "
-        "VALUES (1, %d, '%s', '%s', '%s', '%s');",
-        config->enabled, config->platform, escaped_url, escaped_body, escaped_headers);
-    
     pthread_mutex_lock(&g_sms_mutex);
-    int ret = db_execute(sql);
+    int ret = db_exec_bind(
+        "INSERT OR REPLACE INTO webhook_config (id, enabled, platform, url, body, headers, tls_insecure) "
+        "VALUES (1, ?, ?, ?, ?, ?, ?);",
+        "issssi", config->enabled, config->platform, config->url, config->body, config->headers,
+        config->tls_insecure) < 0 ? -1 : 0;
+    if (ret == 0) {
+        /* 更新内存中的配置 (写入线程读取时持有同一把锁) */
+        memcpy(&g_webhook_config, config, sizeof(WebhookConfig));
+    }
     pthread_mutex_unlock(&g_sms_mutex);
     
     if (ret == 0) {
-        /* 更新内存中的配置 */
-        memcpy(&g_webhook_config, config, sizeof(WebhookConfig));
         printf("[SMS] Webhook配置保存成功\n");
     } else {
         printf("[SMS] Webhook配置保存失败\n");
@@ -772,14 +900,19 @@ int sms_test_webhook(void) {
         .timestamp = time(NULL),
         .is_read = 0
     };
+    WebhookConfig cfg;
+    
+    pthread_mutex_lock(&g_sms_mutex);
+    cfg = g_webhook_config;
+    pthread_mutex_unlock(&g_sms_mutex);
     
-    if (!g_webhook_config.enabled || strlen(g_webhook_config.url) == 0) {
+    if (!cfg.enabled || strlen(cfg.url) == 0) {
         printf("[SMS] Webhook未启用或URL为空\n");
         return -1;
     }
     
-    send_webhook_notification(&test_msg);
-    return 0;
+    /* 与真实短信走同一投递队列 */
+    return send_webhook_notification(&cfg, &test_msg);
 }
 
 /* 检查短信模块状态 */
@@ -804,19 +937,8 @@ void sms_maintenance(void) {
         return;
     }
     
-    /* 检查D-Bus连接是否有效 */
-    if (!g_sms_dbus_conn || g_dbus_connection_is_closed(g_sms_dbus_conn)) {
-        printf("[SMS] D-Bus连接无效，尝试重新连接...\n");
-        GError *error = NULL;
-        g_sms_dbus_conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
-        if (g_sms_dbus_conn) {
-            printf("[SMS] D-Bus重新连接成功\n");
-            g_signal_connect(g_sms_dbus_conn, "closed", G_CALLBACK(on_dbus_connection_closed), NULL);
-            subscribe_sms_signal();
-        } else {
-            printf("[SMS] D-Bus重新连接失败: %s\n", error ? error->message : "未知错误");
-            if (error) g_error_free(error);
-        }
+    /* 连接由共享连接管理重建, 这里只等待 CONNECTED 事件 */
+    if (!g_sms_dbus_conn) {
         return;
     }
     
@@ -898,41 +1020,50 @@ static void apply_sms_fix_on_init(void) {
 
 /* 保存发送记录到数据库 */
 static int save_sent_sms_to_db(const char *recipient, const char *content, time_t timestamp, const char *status) {
-    char sql[2048];
-    char escaped_content[1024];
-    
-    size_t j = 0;
-    for (size_t i = 0; content[i] && j < sizeof(escaped_content) - 2; i++) {
-        if (content[i] == '\'') {
-            escaped_content[j++] = '\'';
-            escaped_content[j++] = '\'';
-        } else {
-            escaped_content[j++] = content[i];
-        }
-    }
-    escaped_content[j] = '\0';
-    
-    snprintf(sql, sizeof(sql),
-        "INSERT INTO sent_sms (recipient, content, timestamp, status) VALUES ('%s', '%s', %ld, '%s');",
-        recipient, escaped_content, (long)timestamp, status);
-    
     pthread_mutex_lock(&g_sms_mutex);
-    int ret = db_execute(sql);
+    long long id = db_insert_bind(
+        "INSERT INTO sent_sms (recipient, content, timestamp, status) VALUES (?, ?, ?, ?);",
+        "ssls", recipient, content, (long long)timestamp, status);
     pthread_mutex_unlock(&g_sms_mutex);
+    int ret = id > 0 ? 0 : -1;
     
-    /* 清理超出限制的旧发送记录 */
+    /* 清理超出限制的旧发送记录 (群发队列的记录不计入, 由 db_maint 按表容量清理) */
     if (ret == 0) {
-        snprintf(sql, sizeof(sql),
-            "DELETE FROM sent_sms WHERE id NOT IN (SELECT id FROM sent_sms ORDER BY id DESC LIMIT %d);",
-            g_max_sent_count);
         pthread_mutex_lock(&g_sms_mutex);
-        db_execute(sql);
+        db_exec_bind("DELETE FROM sent_sms WHERE queued = 0 AND id NOT IN "
+                     "(SELECT id FROM sent_sms WHERE queued = 0 ORDER BY id DESC LIMIT ?);",
+                     "i", g_max_sent_count);
         pthread_mutex_unlock(&g_sms_mutex);
     }
     
     return ret;
 }
 
+/* 批量保存发送记录 (群发队列), 不受 g_max_sent_count 限制 */
+int sms_save_sent_batch(const SentSmsMessage *messages, int count) {
+    int saved = 0;
+
+    if (!messages || count <= 0) return 0;
+
+    pthread_mutex_lock(&g_sms_mutex);
+    if (db_begin() != 0) {
+        pthread_mutex_unlock(&g_sms_mutex);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (db_insert_bind(
+                "INSERT INTO sent_sms (recipient, content, timestamp, status, queued) VALUES (?, ?, ?, ?, 1);",
+                "ssls", messages[i].recipient, messages[i].content,
+                (long long)messages[i].timestamp, messages[i].status) > 0) {
+            saved++;
+        }
+    }
+    if (db_commit() != 0) saved = -1;
+    pthread_mutex_unlock(&g_sms_mutex);
+
+    return saved;
+}
+
 /* 删除发送记录 */
 int sms_delete_sent(int id) {
     char sql[128];
@@ -945,87 +1076,31 @@ int sms_delete_sent(int id) {
     return ret;
 }
 
-/* 获取发送记录列表 - 使用hex编码避免特殊字符问题，兼容无JSON扩展的SQLite */
+/* 获取发送记录列表 - 按字段类型直接读取，无需文本编码与解析 */
 int sms_get_sent_list(SentSmsMessage *messages, int max_count) {
-    char sql[512];
-    char *output = NULL;
+    DbIter it;
+    int count = 0;
     
     if (!messages || max_count <= 0) return -1;
     
-    /* 分配大缓冲区 */
-    output = (char *)malloc(256 * 1024);
-    if (!output) return -1;
-    
-    /* 使用hex编码content字段，用|分隔，每行一条记录 */
-    snprintf(sql, sizeof(sql),
-        "SELECT id || '|' || recipient || '|' || hex(content) || '|' || timestamp || '|' || status FROM sent_sms ORDER BY id DESC LIMIT %d;",
-        max_count);
-    
     pthread_mutex_lock(&g_sms_mutex);
-    int ret = db_query_string(sql, output, 256 * 1024);
-    pthread_mutex_unlock(&g_sms_mutex);
-    
-    if (ret != 0 || strlen(output) == 0) {
-        printf("[SMS] 获取发送记录列表失败或为空\n");
-        free(output);
+    if (db_iter_begin(&it, "SELECT id, recipient, content, timestamp, status FROM sent_sms ORDER BY id DESC LIMIT ?;",
+                      "i", max_count) != 0) {
+        pthread_mutex_unlock(&g_sms_mutex);
+        printf("[SMS] 获取发送记录列表失败\n");
         return 0;
     }
-    
-    /* 解析输出 - 格式: id|recipient|hex_content|timestamp|status\n */
-    int count = 0;
-    char *line = output;
-    char *next_line;
-    
-    while (line && *line && count < max_count) {
-        /* 找到行尾 */
-        next_line = strchr(line, '\n');
-        if (next_line) {
-            *next_line = '\0';
-            next_line++;
-        }
-        
-        /* 跳过空行 */
-        if (strlen(line) == 0) {
-            line = next_line;
-            continue;
-        }
-        
-        /* 解析字段: id|recipient|hex_content|timestamp|status */
-        char *fields[5] = {NULL};
-        int field_count = 0;
-        char *p = line;
-        char *field_start = p;
-        
-        while (*p && field_count < 5) {
-            if (*p == '|') {
-                *p = '\0';
-                fields[field_count++] = field_start;
-                field_start = p + 1;
-            }
-            p++;
-        }
-        if (field_count < 5 && field_start) {
-            fields[field_count++] = field_start;
-        }
-        
-        if (field_count >= 5) {
-            messages[count].id = atoi(fields[0]);
-            strncpy(messages[count].recipient, fields[1], sizeof(messages[count].recipient) - 1);
-            messages[count].recipient[sizeof(messages[count].recipient) - 1] = '\0';
-            
-            /* hex解码content */
-            hex_decode(fields[2], messages[count].content, sizeof(messages[count].content));
-            
-            messages[count].timestamp = (time_t)atol(fields[3]);
-            strncpy(messages[count].status, fields[4], sizeof(messages[count].status) - 1);
-            messages[count].status[sizeof(messages[count].status) - 1] = '\0';
-            count++;
-        }
-        
-        line = next_line;
+    while (count < max_count && db_iter_next(&it) == 1) {
+        SentSmsMessage *m = &messages[count++];
+        m->id = db_col_int(&it, 0);
+        db_col_text_copy(&it, 1, m->recipient, sizeof(m->recipient));
+        db_col_text_copy(&it, 2, m->content, sizeof(m->content));
+        m->timestamp = (time_t)db_col_int64(&it, 3);
+        db_col_text_copy(&it, 4, m->status, sizeof(m->status));
     }
+    db_iter_end(&it);
+    pthread_mutex_unlock(&g_sms_mutex);
     
-    free(output);
     printf("[SMS] 获取到 %d 条发送记录\n", count);
     return count;
 }
@@ -0,0 +1,794 @@
+/**
+ * @file sms_queue.c
+ * @brief 群发短信队列实现
+ *
+ * 发送线程只负责按间隔与并发上限发起异步 D-Bus 调用; 调用在无线程默认
+ * 上下文的线程中发起, 应答回调在 GLib 主循环线程执行, 回调更新收件人
+ * 状态、把发送记录挂到待写链表并唤醒发送线程. 发送线程每轮先把链表中
+ * 累积的记录在一个事务中写入, 再继续提交.
+ *
+ * 发送记录只在收件人有最终结果时写入: 提交失败时写 failed, 提交成功后
+ * 等待消息对象的 State 信号写 sent/failed. 任务被替换或队列停止时仍未
+ * 收到信号的收件人按 pending 写入, 不会丢记录.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <gio/gio.h>
+#include "sms_queue.h"
+#include "sms.h"
+#include "dbus_conn.h"
+#include "database.h"
+#include "json_writer.h"
+#include "http_utils.h"
+#include "router.h"
+
+typedef enum {
+    ITEM_QUEUED = 0,
+    ITEM_SUBMITTING,
+    ITEM_PENDING,
+    ITEM_SENT,
+    ITEM_FAILED,
+    ITEM_CANCELLED,
+    ITEM_STATE_COUNT
+} ItemState;
+
+static const char *const g_state_names[ITEM_STATE_COUNT] = {
+    "queued", "submitting", "pending", "sent", "failed", "cancelled"
+};
+
+typedef struct {
+    char recipient[64];
+    char *content;
+    int state;              /* ItemState */
+    char path[96];          /* oFono 消息对象路径 */
+    char error[128];
+    time_t updated;
+} QueueItem;
+
+typedef struct {
+    int id;                 /* 0 表示空槽 */
+    time_t created;
+    int count;
+    int next;               /* 下一个待提交的下标 */
+    QueueItem *items;
+} QueueJob;
+
+/* 待写入的发送记录 */
+typedef struct HistoryEntry {
+    struct HistoryEntry *next;
+    SentSmsMessage msg;
+} HistoryEntry;
+
+/* 异步调用上下文 */
+typedef struct {
+    int job_id;
+    int index;
+} SubmitCtx;
+
+/* 以下状态由 g_q_mutex 保护 */
+static pthread_mutex_t g_q_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_q_cond;
+static pthread_t g_q_thread;
+static int g_q_running = 0;
+static int g_q_stop = 0;
+static QueueJob g_jobs[SMS_QUEUE_MAX_JOBS];
+static int g_next_job_id = 1;
+static int g_inflight = 0;
+static int g_interval_ms = SMS_SEND_INTERVAL_DEFAULT;
+static int g_max_inflight = SMS_SEND_INFLIGHT_DEFAULT;
+static HistoryEntry *g_history_head = NULL;
+static HistoryEntry *g_history_tail = NULL;
+
+/* 消息状态信号订阅 (主循环线程) */
+static GDBusConnection *g_q_dbus_conn = NULL;
+static guint g_state_subscription_id = 0;
+
+/* ==================== 任务 ==================== */
+
+static long long get_current_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int clamp_int(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static QueueJob *find_job(int id) {
+    for (int i = 0; i < SMS_QUEUE_MAX_JOBS; i++) {
+        if (g_jobs[i].id != 0 && g_jobs[i].id == id) return &g_jobs[i];
+    }
+    return NULL;
+}
+
+/* 仍有收件人排队或等待应答 */
+static int job_active(const QueueJob *job) {
+    for (int i = 0; i < job->count; i++) {
+        if (job->items[i].state == ITEM_QUEUED || job->items[i].state == ITEM_SUBMITTING) return 1;
+    }
+    return 0;
+}
+
+static void job_free(QueueJob *job) {
+    for (int i = 0; i < job->count; i++) free(job->items[i].content);
+    free(job->items);
+    memset(job, 0, sizeof(*job));
+}
+
+/* 最早提交的任务中下一个排队的收件人 */
+static QueueJob *next_queued(int *index) {
+    QueueJob *best = NULL;
+
+    for (int i = 0; i < SMS_QUEUE_MAX_JOBS; i++) {
+        QueueJob *job = &g_jobs[i];
+
+        if (job->id == 0) continue;
+        while (job->next < job->count && job->items[job->next].state != ITEM_QUEUED) job->next++;
+        if (job->next < job->count && (!best || job->id < best->id)) best = job;
+    }
+    if (best) *index = best->next;
+    return best;
+}
+
+static void push_history(const QueueItem *item, const char *status) {
+    HistoryEntry *e = (HistoryEntry *)calloc(1, sizeof(HistoryEntry));
+
+    if (!e) return;
+    snprintf(e->msg.recipient, sizeof(e->msg.recipient), "%s", item->recipient);
+    snprintf(e->msg.content, sizeof(e->msg.content), "%s", item->content);
+    snprintf(e->msg.status, sizeof(e->msg.status), "%s", status);
+    e->msg.timestamp = item->updated;
+
+    if (g_history_tail) g_history_tail->next = e;
+    else g_history_head = e;
+    g_history_tail = e;
+}
+
+/* 写入累积的发送记录 (调用时不持有 g_q_mutex) */
+static void flush_history(void) {
+    HistoryEntry *list, *e;
+    SentSmsMessage *batch;
+    int n = 0;
+
+    pthread_mutex_lock(&g_q_mutex);
+    list = g_history_head;
+    g_history_head = g_history_tail = NULL;
+    pthread_mutex_unlock(&g_q_mutex);
+    if (!list) return;
+
+    for (e = list; e; e = e->next) n++;
+    batch = (SentSmsMessage *)malloc(sizeof(SentSmsMessage) * n);
+    if (batch) {
+        n = 0;
+        for (e = list; e; e = e->next) batch[n++] = e->msg;
+        if (sms_save_sent_batch(batch, n) < 0) {
+            printf("[SMS_QUEUE] 发送记录写入失败 (%d 条)\n", n);
+        }
+        free(batch);
+    }
+    while (list) {
+        e = list;
+        list = e->next;
+        free(e);
+    }
+}
+
+/* 释放任务槽, 仍在等待 State 信号的收件人按 pending 记录 (持有 g_q_mutex) */
+static void job_release(QueueJob *job) {
+    for (int i = 0; i < job->count; i++) {
+        if (job->items[i].state == ITEM_PENDING) push_history(&job->items[i], "pending");
+    }
+    job_free(job);
+}
+
+/* ==================== 提交 ==================== */
+
+/* 提交结果 (主循环线程或发送线程) */
+static void complete_item(int job_id, int index, const char *path, const char *error) {
+    QueueJob *job;
+
+    pthread_mutex_lock(&g_q_mutex);
+    if (g_inflight > 0) g_inflight--;
+    job = find_job(job_id);
+    if (job && index < job->count && job->items[index].state == ITEM_SUBMITTING) {
+        QueueItem *item = &job->items[index];
+
+        item->updated = time(NULL);
+        if (path) {
+            item->state = ITEM_PENDING;
+            snprintf(item->path, sizeof(item->path), "%s", path);
+        } else {
+            item->state = ITEM_FAILED;
+            snprintf(item->error, sizeof(item->error), "%s", error ? error : "未知错误");
+            push_history(item, "failed");
+            printf("[SMS_QUEUE] 任务 %d 发送到 %s 失败: %s\n", job_id, item->recipient, item->error);
+        }
+    }
+    pthread_cond_signal(&g_q_cond);
+    pthread_mutex_unlock(&g_q_mutex);
+}
+
+static void on_submit_done(GObject *source, GAsyncResult *res, gpointer user_data) {
+    SubmitCtx *ctx = (SubmitCtx *)user_data;
+    GError *error = NULL;
+    GVariant *result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+
+    if (result) {
+        const gchar *path = NULL;
+
+        g_variant_get(result, "(&o)", &path);
+        complete_item(ctx->job_id, ctx->index, path ? path : "", NULL);
+        g_variant_unref(result);
+    } else {
+        complete_item(ctx->job_id, ctx->index, NULL, error ? error->message : NULL);
+        if (error) g_error_free(error);
+    }
+    g_free(ctx);
+}
+
+/* 发起异步 SendMessage, 应答在主循环中处理 */
+static void submit_item(int job_id, int index, const char *recipient, const char *content) {
+    GDBusConnection *conn = NULL;
+    SubmitCtx *ctx;
+
+    if (!dbus_conn_ofono_available() || !(conn = dbus_conn_get())) {
+        complete_item(job_id, index, NULL, "D-Bus未连接或oFono服务不可用");
+        return;
+    }
+
+    ctx = g_new0(SubmitCtx, 1);
+    ctx->job_id = job_id;
+    ctx->index = index;
+    g_dbus_connection_call(
+        conn,
+        "org.ofono",
+        "/ril_0",
+        "org.ofono.MessageManager",
+        "SendMessage",
+        g_variant_new("(ss)", recipient, content),
+        G_VARIANT_TYPE("(o)"),
+        G_DBUS_CALL_FLAGS_NONE,
+        30000,
+        NULL,
+        on_submit_done,
+        ctx
+    );
+    g_object_unref(conn);
+}
+
+static void *sender_thread(void *arg) {
+    long long next_ms = 0;
+    (void)arg;
+
+    pthread_mutex_lock(&g_q_mutex);
+    while (!g_q_stop) {
+        QueueJob *job;
+        QueueItem *item;
+        char recipient[64];
+        char *content;
+        int index = 0, job_id;
+        long long now;
+
+        if (g_history_head) {
+            pthread_mutex_unlock(&g_q_mutex);
+            flush_history();
+            pthread_mutex_lock(&g_q_mutex);
+            continue;
+        }
+
+        job = next_queued(&index);
+        if (!job || g_inflight >= g_max_inflight) {
+            pthread_cond_wait(&g_q_cond, &g_q_mutex);
+            continue;
+        }
+
+        now = get_current_ms();
+        if (now < next_ms) {
+            struct timespec ts;
+
+            ts.tv_sec = next_ms / 1000;
+            ts.tv_nsec = (next_ms % 1000) * 1000000;
+            pthread_cond_timedwait(&g_q_cond, &g_q_mutex, &ts);
+            continue;
+        }
+
+        item = &job->items[index];
+        item->state = ITEM_SUBMITTING;
+        item->updated = time(NULL);
+        job->next = index + 1;
+        job_id = job->id;
+        g_inflight++;
+        next_ms = now + g_interval_ms;
+
+        memcpy(recipient, item->recipient, sizeof(recipient));
+        content = strdup(item->content);
+        pthread_mutex_unlock(&g_q_mutex);
+
+        if (content) {
+            submit_item(job_id, index, recipient, content);
+            free(content);
+        } else {
+            complete_item(job_id, index, NULL, "内存不足");
+        }
+
+        pthread_mutex_lock(&g_q_mutex);
+    }
+    pthread_mutex_unlock(&g_q_mutex);
+
+    flush_history();
+    return NULL;
+}
+
+/* ==================== 消息状态 ==================== */
+
+/* org.ofono.Message.PropertyChanged: State = pending/sent/failed */
+static void on_message_property(GDBusConnection *conn, const gchar *sender_name,
+    const gchar *object_path, const gchar *interface_name, const gchar *signal_name,
+    GVariant *parameters, gpointer user_data) {
+    const gchar *name = NULL;
+    GVariant *value = NULL;
+    int state;
+
+    (void)conn; (void)sender_name; (void)interface_name; (void)signal_name; (void)user_data;
+
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sv)"))) return;
+    g_variant_get(parameters, "(&sv)", &name, &value);
+    if (!value) return;
+
+    if (g_strcmp0(name, "State") != 0 || !g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+        g_variant_unref(value);
+        return;
+    }
+    if (g_strcmp0(g_variant_get_string(value, NULL), "sent") == 0) state = ITEM_SENT;
+    else if (g_strcmp0(g_variant_get_string(value, NULL), "failed") == 0) state = ITEM_FAILED;
+    else state = ITEM_PENDING;
+    g_variant_unref(value);
+    if (state == ITEM_PENDING) return;
+
+    pthread_mutex_lock(&g_q_mutex);
+    for (int i = 0; i < SMS_QUEUE_MAX_JOBS; i++) {
+        QueueJob *job = &g_jobs[i];
+
+        for (int j = 0; job->id != 0 && j < job->count; j++) {
+            QueueItem *item = &job->items[j];
+
+            if (item->state != ITEM_PENDING || strcmp(item->path, object_path) != 0) continue;
+            item->state = state;
+            item->updated = time(NULL);
+            if (state == ITEM_FAILED) snprintf(item->error, sizeof(item->error), "模块发送失败");
+            push_history(item, state == ITEM_SENT ? "sent" : "failed");
+        }
+    }
+    pthread_cond_signal(&g_q_cond);
+    pthread_mutex_unlock(&g_q_mutex);
+}
+
+static void unsubscribe_state_signal(void) {
+    if (g_state_subscription_id > 0 && g_q_dbus_conn) {
+        g_dbus_connection_signal_unsubscribe(g_q_dbus_conn, g_state_subscription_id);
+    }
+    g_state_subscription_id = 0;
+    if (g_q_dbus_conn) {
+        g_object_unref(g_q_dbus_conn);
+        g_q_dbus_conn = NULL;
+    }
+}
+
+/* 共享 D-Bus 连接状态变化 (主循环线程) */
+static void on_queue_conn_event(DbusConnEvent ev, GDBusConnection *conn, void *user_data) {
+    (void)user_data;
+
+    if (ev == DBUS_CONN_EV_CONNECTED) {
+        unsubscribe_state_signal();
+        g_q_dbus_conn = g_object_ref(conn);
+        g_state_subscription_id = g_dbus_connection_signal_subscribe(
+            g_q_dbus_conn, "org.ofono", "org.ofono.Message", "PropertyChanged",
+            NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, on_message_property, NULL, NULL);
+    } else if (ev == DBUS_CONN_EV_DISCONNECTED) {
+        unsubscribe_state_signal();
+    }
+}
+
+/* ==================== 公共接口 ==================== */
+
+int sms_queue_init(void) {
+    pthread_condattr_t attr;
+
+    if (g_q_running) return 0;
+
+    g_interval_ms = clamp_int(config_get_int("sms_send_interval_ms", SMS_SEND_INTERVAL_DEFAULT),
+                              SMS_SEND_INTERVAL_MIN, SMS_SEND_INTERVAL_MAX);
+    g_max_inflight = clamp_int(config_get_int("sms_send_inflight", SMS_SEND_INFLIGHT_DEFAULT),
+                               1, SMS_SEND_INFLIGHT_MAX);
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_q_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_q_stop = 0;
+    if (pthread_create(&g_q_thread, NULL, sender_thread, NULL) != 0) {
+        printf("[SMS_QUEUE] 创建发送线程失败\n");
+        pthread_cond_destroy(&g_q_cond);
+        return -1;
+    }
+    g_q_running = 1;
+
+    dbus_conn_add_listener(on_queue_conn_event, NULL);
+    printf("[SMS_QUEUE] 群发队列已启动: 间隔 %d ms, 并发 %d\n", g_interval_ms, g_max_inflight);
+    return 0;
+}
+
+void sms_queue_deinit(void) {
+    if (!g_q_running) return;
+
+    pthread_mutex_lock(&g_q_mutex);
+    g_q_stop = 1;
+    pthread_cond_signal(&g_q_cond);
+    pthread_mutex_unlock(&g_q_mutex);
+
+    pthread_join(g_q_thread, NULL);
+    pthread_cond_destroy(&g_q_cond);
+    g_q_running = 0;
+
+    dbus_conn_remove_listener(on_queue_conn_event, NULL);
+    unsubscribe_state_signal();
+
+    /* 未完成的异步调用按任务ID查找, 任务释放后其应答被忽略 */
+    pthread_mutex_lock(&g_q_mutex);
+    for (int i = 0; i < SMS_QUEUE_MAX_JOBS; i++) {
+        if (g_jobs[i].id != 0) job_release(&g_jobs[i]);
+    }
+    pthread_mutex_unlock(&g_q_mutex);
+    flush_history();
+}
+
+int sms_queue_submit(const SmsQueueMessage *messages, int count) {
+    QueueJob *slot = NULL;
+    QueueItem *items;
+    int id;
+
+    if (!messages || count <= 0 || count > SMS_QUEUE_MAX_ITEMS) return -1;
+
+    items = (QueueItem *)calloc((size_t)count, sizeof(QueueItem));
+    if (!items) return -1;
+    for (int i = 0; i < count; i++) {
+        if (!messages[i].recipient || !messages[i].recipient[0] ||
+            !messages[i].content || !messages[i].content[0] ||
+            !(items[i].content = strdup(messages[i].content))) {
+            for (int j = 0; j < i; j++) free(items[j].content);
+            free(items);
+            return -1;
+        }
+        snprintf(items[i].recipient, sizeof(items[i].recipient), "%s", messages[i].recipient);
+        items[i].state = ITEM_QUEUED;
+        items[i].updated = time(NULL);
+    }
+
+    pthread_mutex_lock(&g_q_mutex);
+    /* 空槽优先, 否则替换最早的已结束任务 */
+    for (int i = 0; i < SMS_QUEUE_MAX_JOBS; i++) {
+        QueueJob *job = &g_jobs[i];
+
+        if (job->id == 0) {
+            slot = job;
+            break;
+        }
+        if (!job_active(job) && (!slot || job->id < slot->id)) slot = job;
+    }
+    if (!slot) {
+        pthread_mutex_unlock(&g_q_mutex);
+        for (int i = 0; i < count; i++) free(items[i].content);
+        free(items);
+        return -1;
+    }
+    if (slot->id != 0) job_release(slot);
+
+    id = g_next_job_id++;
+    slot->id = id;
+    slot->created = time(NULL);
+    slot->count = count;
+    slot->next = 0;
+    slot->items = items;
+    pthread_cond_signal(&g_q_cond);
+    pthread_mutex_unlock(&g_q_mutex);
+
+    printf("[SMS_QUEUE] 任务 %d 已提交: %d 条\n", id, count);
+    return id;
+}
+
+int sms_queue_cancel(int job_id) {
+    QueueJob *job;
+    int cancelled = 0;
+
+    pthread_mutex_lock(&g_q_mutex);
+    job = find_job(job_id);
+    if (!job) {
+        pthread_mutex_unlock(&g_q_mutex);
+        return -1;
+    }
+    for (int i = 0; i < job->count; i++) {
+        if (job->items[i].state != ITEM_QUEUED) continue;
+        job->items[i].state = ITEM_CANCELLED;
+        job->items[i].updated = time(NULL);
+        cancelled++;
+    }
+    pthread_mutex_unlock(&g_q_mutex);
+
+    printf("[SMS_QUEUE] 任务 %d 已取消 %d 条\n", job_id, cancelled);
+    return 0;
+}
+
+/* ==================== HTTP ==================== */
+
+/* 任务摘要 (需持有 g_q_mutex) */
+static void write_job_summary(JsonWriter *w, const QueueJob *job) {
+    int counts[ITEM_STATE_COUNT] = {0};
+
+    for (int i = 0; i < job->count; i++) counts[job->items[i].state]++;
+
+    json_kv_int(w, "id", job->id);
+    json_kv_int(w, "created", (long long)job->created);
+    json_kv_int(w, "total", job->count);
+    for (int s = 0; s < ITEM_STATE_COUNT; s++) json_kv_int(w, g_state_names[s], counts[s]);
+    json_kv_bool(w, "done", counts[ITEM_QUEUED] == 0 && counts[ITEM_SUBMITTING] == 0);
+}
+
+/*
+ * 从请求体收集短信, *count 为已分配字符串的条数 (无论成败都由调用者释放)
+ * @return 0成功, -1格式错误或超出上限
+ */
+static int parse_job_body(struct mg_str body, SmsQueueMessage *out, int max, int *count) {
+    static const char *const lists[] = {"$.recipients", "$.messages"};
+    char *shared = mg_json_get_str(body, "$.content");
+    int n = 0, ret = 0;
+
+    for (int l = 0; l < 2 && n == 0; l++) {
+        struct mg_str list, v;
+        size_t ofs = 0;
+        int len = 0;
+        int o = mg_json_get(body, lists[l], &len);
+
+        if (o < 0 || len < 2 || body.buf[o] != '[') continue;
+        list = mg_str_n(body.buf + o, (size_t)len);
+
+        while ((ofs = mg_json_next(list, ofs, NULL, &v)) > 0) {
+            char *content = l == 1 ? mg_json_get_str(v, "$.content") : NULL;
+
+            if (n >= max) {
+                free(content);
+                ret = -1;
+                break;
+            }
+            /* 单条未指定内容时使用公共内容 */
+            out[n].recipient = mg_json_get_str(v, l == 0 ? "$" : "$.recipient");
+            out[n].content = content ? content : (shared ? strdup(shared) : NULL);
+            n++;
+        }
+    }
+    free(shared);
+    *count = n;
+
+    if (n == 0) ret = -1;
+    for (int i = 0; i < n && ret == 0; i++) {
+        if (!out[i].recipient || !out[i].recipient[0] || strlen(out[i].recipient) >= 64 ||
+            !out[i].content || !out[i].content[0] || strlen(out[i].content) >= 1024) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+static void free_messages(SmsQueueMessage *messages, int n) {
+    for (int i = 0; i < n; i++) {
+        free((char *)messages[i].recipient);
+        free((char *)messages[i].content);
+    }
+}
+
+void handle_sms_jobs(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_ANY(c, hm);
+
+    if (http_is_method(hm, "POST")) {
+        SmsQueueMessage *messages = (SmsQueueMessage *)calloc(SMS_QUEUE_MAX_ITEMS, sizeof(SmsQueueMessage));
+        int n, id;
+        char response[96];
+
+        if (!messages) {
+            HTTP_ERROR(c, 500, "内存不足");
+            return;
+        }
+        if (parse_job_body(hm->body, messages, SMS_QUEUE_MAX_ITEMS, &n) != 0) {
+            free_messages(messages, n);
+            free(messages);
+            HTTP_ERROR(c, 400, "收件人或内容无效 (每个任务最多200个收件人, 内容不超过1023字节)");
+            return;
+        }
+        id = sms_queue_submit(messages, n);
+        free_messages(messages, n);
+        free(messages);
+
+        if (id < 0) {
+            HTTP_ERROR(c, 503, "未完成的群发任务过多");
+            return;
+        }
+        snprintf(response, sizeof(response),
+                 "{\"Code\":0,\"Error\":\"\",\"Data\":{\"id\":%d,\"total\":%d}}", id, n);
+        HTTP_OK(c, response);
+        return;
+    }
+    if (!http_is_method(hm, "GET")) {
+        http_method_error(c);
+        return;
+    }
+
+    JsonWriter w;
+    const QueueJob *order[SMS_QUEUE_MAX_JOBS];
+    int n = 0;
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_arr_begin(&w);
+
+    pthread_mutex_lock(&g_q_mutex);
+    /* 按任务ID从新到旧 */
+    for (int i = 0; i < SMS_QUEUE_MAX_JOBS; i++) {
+        int k = n++;
+
+        if (g_jobs[i].id == 0) {
+            n--;
+            continue;
+        }
+        while (k > 0 && order[k - 1]->id < g_jobs[i].id) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = &g_jobs[i];
+    }
+    for (int i = 0; i < n; i++) {
+        json_obj_begin(&w);
+        write_job_summary(&w, order[i]);
+        json_obj_end(&w);
+    }
+    pthread_mutex_unlock(&g_q_mutex);
+
+    json_arr_end(&w);
+    json_obj_end(&w);
+    json_end(&w);
+}
+
+void handle_sms_job(struct mg_connection *c, struct mg_http_message *hm) {
+    char id_str[32];
+    int id = router_param(0, id_str, sizeof(id_str)) > 0 ? atoi(id_str) : 0;
+    const QueueJob *job;
+    JsonWriter w;
+
+    HTTP_CHECK_ANY(c, hm);
+
+    if (id <= 0) {
+        HTTP_ERROR(c, 400, "无效的任务ID");
+        return;
+    }
+
+    if (http_is_method(hm, "DELETE")) {
+        if (sms_queue_cancel(id) == 0) {
+            HTTP_SUCCESS(c, "任务已取消");
+        } else {
+            HTTP_ERROR(c, 404, "任务不存在");
+        }
+        return;
+    }
+    if (!http_is_method(hm, "GET")) {
+        http_method_error(c);
+        return;
+    }
+
+    pthread_mutex_lock(&g_q_mutex);
+    job = find_job(id);
+    if (!job) {
+        pthread_mutex_unlock(&g_q_mutex);
+        HTTP_ERROR(c, 404, "任务不存在");
+        return;
+    }
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    write_job_summary(&w, job);
+    json_key(&w, "items");
+    json_arr_begin(&w);
+    for (int i = 0; i < job->count; i++) {
+        const QueueItem *item = &job->items[i];
+
+        json_obj_begin(&w);
+        json_kv_str(&w, "recipient", item->recipient);
+        json_kv_str(&w, "state", g_state_names[item->state]);
+        json_kv_str(&w, "path", item->path);
+        json_kv_str(&w, "error", item->error);
+        json_kv_int(&w, "updated", (long long)item->updated);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_obj_end(&w);
+    pthread_mutex_unlock(&g_q_mutex);
+
+    json_obj_end(&w);
+    json_end(&w);
+}
+
+void handle_sms_queue_config(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_ANY(c, hm);
+
+    if (http_is_method(hm, "POST")) {
+        double val = 0;
+        int interval, inflight;
+
+        pthread_mutex_lock(&g_q_mutex);
+        interval = g_interval_ms;
+        inflight = g_max_inflight;
+        pthread_mutex_unlock(&g_q_mutex);
+
+        if (mg_json_get_num(hm->body, "$.interval_ms", &val)) {
+            if (val < SMS_SEND_INTERVAL_MIN || val > SMS_SEND_INTERVAL_MAX) {
+                HTTP_OK(c, "{\"Code\":1,\"Error\":\"发送间隔需在 200-60000 毫秒之间\",\"Data\":null}");
+                return;
+            }
+            interval = (int)val;
+        }
+        if (mg_json_get_num(hm->body, "$.inflight", &val)) {
+            if (val < 1 || val > SMS_SEND_INFLIGHT_MAX) {
+                HTTP_OK(c, "{\"Code\":1,\"Error\":\"并发数需在 1-8 之间\",\"Data\":null}");
+                return;
+            }
+            inflight = (int)val;
+        }
+
+        config_set_int("sms_send_interval_ms", interval);
+        config_set_int("sms_send_inflight", inflight);
+
+        pthread_mutex_lock(&g_q_mutex);
+        g_interval_ms = interval;
+        g_max_inflight = inflight;
+        pthread_cond_signal(&g_q_cond);
+        pthread_mutex_unlock(&g_q_mutex);
+
+        printf("[SMS_QUEUE] 配置已更新: 间隔 %d ms, 并发 %d\n", interval, inflight);
+    } else if (!http_is_method(hm, "GET")) {
+        http_method_error(c);
+        return;
+    }
+
+    JsonWriter w;
+    int interval, inflight, active;
+
+    pthread_mutex_lock(&g_q_mutex);
+    interval = g_interval_ms;
+    inflight = g_max_inflight;
+    active = g_inflight;
+    pthread_mutex_unlock(&g_q_mutex);
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    json_kv_int(&w, "interval_ms", interval);
+    json_kv_int(&w, "inflight", inflight);
+    json_kv_int(&w, "submitting", active);
+    json_kv_int(&w, "max_items", SMS_QUEUE_MAX_ITEMS);
+    json_obj_end(&w);
+    json_obj_end(&w);
+    json_end(&w);
+}
@@ -0,0 +1,254 @@
+/**
+ * @file spengmd.c
+ * @brief AT+SPENGMD 工程模式输出解析实现
+ *
+ * 扫描器按原 Go 版 parseCellToVec 的规则切分行列, 但不建中间表:
+ * 每个单元格以 (行, 列, 指针区间) 回调给布局处理函数, 数值直接
+ * 从区间中解析. 区间内可能夹有 \r\n, 数值解析时跳过.
+ */
+
+#include <string.h>
+#include "spengmd.h"
+
+/* 单元格回调, [p, end) 已去除前导空格 */
+typedef void (*CellFn)(int row, int col, const char *p, const char *end, void *user_data);
+
+/* 单元格字段 */
+enum {
+    F_NONE = 0,
+    F_BAND,
+    F_ARFCN,
+    F_PCI,
+    F_RSRP,
+    F_RSRQ,
+    F_SINR
+};
+
+/* ==================== 扫描 ==================== */
+
+static int is_crlf(char c) {
+    return c == '\r' || c == '\n';
+}
+
+/* 按 ',' 切分一行, 空单元格 (只含 \r\n) 不占列号 */
+static void emit_row(const char *p, const char *end, int row, CellFn fn, void *user_data) {
+    int col = 0;
+
+    while (p < end) {
+        const char *start = p;
+        int empty = 1;
+
+        while (p < end && *p != ',') {
+            if (!is_crlf(*p)) empty = 0;
+            p++;
+        }
+        if (!empty) {
+            while (start < p && (*start == ' ' || is_crlf(*start))) start++;
+            fn(row, col++, start, p, user_data);
+        }
+        if (p < end) p++;   /* 跳过 ',' */
+    }
+}
+
+/* 一次遍历响应, 返回行数 */
+static int scan(const char *resp, CellFn fn, void *user_data) {
+    const char *p;
+    const char *line = NULL;    /* 当前行起点, NULL 表示当前行为空 */
+    char prev = 0;
+    int rows = 0;
+
+    for (p = resp; *p && !(p[0] == 'O' && p[1] == 'K'); p++) {
+        char c = *p;
+
+        if (is_crlf(c)) continue;
+
+        if (c == '-' && prev != ',') {
+            const char *next = p + 1;
+
+            while (is_crlf(*next)) next++;
+            if (line) emit_row(line, p, rows++, fn, user_data);
+
+            if (*next == '-') {
+                /* "--": 换行, 第二个 '-' 是下一行的负号 */
+                line = next;
+                p = next;
+            } else {
+                line = NULL;
+            }
+            prev = '-';
+            continue;
+        }
+
+        if (!line) line = p;
+        prev = c;
+    }
+    if (line) emit_row(line, p, rows++, fn, user_data);
+
+    return rows;
+}
+
+/* ==================== 数值 ==================== */
+
+/* 等价于 atoi, 跳过夹杂的 \r\n */
+static int span_int(const char *p, const char *end) {
+    unsigned int v = 0;
+    int neg = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    for (; p < end; p++) {
+        if (is_crlf(*p)) continue;
+        if (*p < '0' || *p > '9') break;
+        v = v * 10 + (unsigned int)(*p - '0');
+    }
+    return neg ? -(int)v : (int)v;
+}
+
+/* 等价于 atof(x) / 100.0 (模块以 0.01 为单位上报) */
+static double span_centi(const char *p, const char *end) {
+    int neg = 0, frac = 0;
+    double mant = 0, scale = 100;
+
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    for (; p < end; p++) {
+        if (is_crlf(*p)) continue;
+        if (*p == '.' && !frac) {
+            frac = 1;
+            continue;
+        }
+        if (*p < '0' || *p > '9') break;
+        mant = mant * 10 + (*p - '0');
+        if (frac) scale *= 10;
+    }
+    return (neg ? -mant : mant) / scale;
+}
+
+static void set_field(SpengmdCell *cell, int field, const char *p, const char *end) {
+    switch (field) {
+    case F_BAND:  cell->band = span_int(p, end); break;
+    case F_ARFCN: cell->arfcn = span_int(p, end); break;
+    case F_PCI:   cell->pci = span_int(p, end); break;
+    case F_RSRP:  cell->rsrp = span_centi(p, end); break;
+    case F_RSRQ:  cell->rsrq = span_centi(p, end); break;
+    case F_SINR:  cell->sinr = span_centi(p, end); break;
+    default: break;
+    }
+}
+
+/* ==================== 布局 ==================== */
+
+/* 服务小区: 第0..4行为 频段/ARFCN/PCI/RSRP/RSRQ, SINR 所在行因制式而异 */
+typedef struct {
+    SpengmdCell *cell;
+    int sinr_row;
+} ServingCtx;
+
+static void on_serving_cell(int row, int col, const char *p, const char *end, void *user_data) {
+    static const int fields[] = {F_BAND, F_ARFCN, F_PCI, F_RSRP, F_RSRQ};
+    ServingCtx *ctx = (ServingCtx *)user_data;
+
+    if (col != 0) return;
+    if (row < (int)(sizeof(fields) / sizeof(fields[0]))) {
+        set_field(ctx->cell, fields[row], p, end);
+    } else if (row == ctx->sinr_row) {
+        set_field(ctx->cell, F_SINR, p, end);
+    }
+}
+
+/* 邻小区: NR 每列一个小区 (行即字段), LTE 每行一个小区 (列即字段) */
+typedef struct {
+    SpengmdCell *cells;
+    int max;
+    int count;          /* NR: 已写入的最大列号 + 1; LTE: 已确认的有效小区数 */
+    int nr_columns;     /* NR: 第0行连续非空列数 */
+    int nr_row0_done;
+    int lte_row;        /* LTE: cells[count] 正在填充的行号, -1 表示无 */
+} NeighborCtx;
+
+static void on_nr_neighbor(int row, int col, const char *p, const char *end, void *user_data) {
+    static const int fields[] = {F_BAND, F_ARFCN, F_PCI, F_RSRP, F_RSRQ, F_SINR};
+    NeighborCtx *ctx = (NeighborCtx *)user_data;
+
+    if (row == 0) {
+        /* 小区数取第0行开头连续的非空单元格 */
+        if (p == end) ctx->nr_row0_done = 1;
+        if (!ctx->nr_row0_done && col == ctx->nr_columns) ctx->nr_columns++;
+    }
+    if (row >= (int)(sizeof(fields) / sizeof(fields[0])) || col >= ctx->max) return;
+
+    set_field(&ctx->cells[col], fields[row], p, end);
+    if (col >= ctx->count) ctx->count = col + 1;
+}
+
+/* LTE: 一行结束时保留有效小区, 否则下一行复用该槽位 */
+static void lte_finish_row(NeighborCtx *ctx) {
+    const SpengmdCell *cell;
+
+    if (ctx->lte_row < 0) return;
+    cell = &ctx->cells[ctx->count];
+    if (cell->arfcn != 0 && cell->pci != 0) ctx->count++;
+    ctx->lte_row = -1;
+}
+
+static void on_lte_neighbor(int row, int col, const char *p, const char *end, void *user_data) {
+    static const int fields[] = {
+        F_ARFCN, F_PCI, F_RSRP, F_RSRQ, F_NONE, F_NONE, F_SINR,
+        F_NONE, F_NONE, F_NONE, F_NONE, F_NONE, F_BAND
+    };
+    NeighborCtx *ctx = (NeighborCtx *)user_data;
+
+    if (row != ctx->lte_row) {
+        lte_finish_row(ctx);
+        if (ctx->count >= ctx->max) return;
+        memset(&ctx->cells[ctx->count], 0, sizeof(SpengmdCell));
+        ctx->lte_row = row;
+    }
+    if (col < (int)(sizeof(fields) / sizeof(fields[0]))) {
+        set_field(&ctx->cells[ctx->count], fields[col], p, end);
+    }
+}
+
+/* ==================== 公共接口 ==================== */
+
+int spengmd_parse_serving(const char *resp, SpengmdRat rat, SpengmdCell *cell) {
+    ServingCtx ctx;
+
+    if (!resp || !cell) return -1;
+
+    memset(cell, 0, sizeof(*cell));
+    ctx.cell = cell;
+    ctx.sinr_row = rat == SPENGMD_NR ? 15 : 33;
+
+    return scan(resp, on_serving_cell, &ctx) > ctx.sinr_row ? 0 : -1;
+}
+
+int spengmd_parse_neighbors(const char *resp, SpengmdRat rat, SpengmdCell *cells, int max) {
+    NeighborCtx ctx;
+    int rows, total, n = 0;
+
+    if (!resp || !cells || max <= 0) return 0;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.cells = cells;
+    ctx.max = max;
+
+    if (rat != SPENGMD_NR) {
+        ctx.lte_row = -1;
+        scan(resp, on_lte_neighbor, &ctx);
+        lte_finish_row(&ctx);
+        return ctx.count;
+    }
+
+    memset(cells, 0, sizeof(cells[0]) * max);
+
+    rows = scan(resp, on_nr_neighbor, &ctx);
+    if (rows <= 5) return 0;
+    total = ctx.nr_columns < ctx.count ? ctx.nr_columns : ctx.count;
+
+    /* 原地压缩, 去掉无效项 */
+    for (int i = 0; i < total; i++) {
+        if (cells[i].arfcn == 0 || cells[i].pci == 0) continue;
+        if (n != i) cells[n] = cells[i];
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file storage_io.c
+ * @brief 闪存写入统计实现
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "mongoose.h"
+#include "storage_io.h"
+#include "json_writer.h"
+#include "http_utils.h"
+
+static const char *const g_subsys_names[STORAGE_COUNT] = {
+    "sms", "auth", "config", "webhook", "db", "plugin", "cell_log", "cron"
+};
+
+typedef struct {
+    long long writes;
+    long long bytes;
+    long long fsyncs;
+} StorageCounter;
+
+static StorageCounter g_counters[STORAGE_COUNT];
+static long long g_start_ms = 0;
+
+static long long get_current_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void storage_io_init(void) {
+    g_start_ms = get_current_ms();
+}
+
+void storage_account(StorageSubsys subsys, long long bytes, int fsyncs) {
+    StorageCounter *sc;
+
+    if ((int)subsys < 0 || subsys >= STORAGE_COUNT) subsys = STORAGE_DB;
+
+    sc = &g_counters[subsys];
+    if (bytes > 0) {
+        __atomic_add_fetch(&sc->writes, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&sc->bytes, bytes, __ATOMIC_RELAXED);
+    }
+    if (fsyncs > 0) __atomic_add_fetch(&sc->fsyncs, fsyncs, __ATOMIC_RELAXED);
+}
+
+StorageSubsys storage_subsys_for_table(const char *table) {
+    if (!table) return STORAGE_DB;
+    if (strncmp(table, "sms", 3) == 0 || strcmp(table, "sent_sms") == 0) return STORAGE_SMS;
+    if (strncmp(table, "auth_", 5) == 0) return STORAGE_AUTH;
+    if (strcmp(table, "config") == 0) return STORAGE_CONFIG;
+    if (strncmp(table, "webhook_", 8) == 0) return STORAGE_WEBHOOK;
+    return STORAGE_DB;
+}
+
+static int sync_parent_dir(const char *path) {
+    char dir[512];
+    char *slash;
+    int fd, ret;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    slash = strrchr(dir, '/');
+    if (!slash) {
+        snprintf(dir, sizeof(dir), ".");
+    } else if (slash == dir) {
+        dir[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+
+    fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return -1;
+    ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+int storage_write_file(StorageSubsys subsys, const char *path, const void *data, size_t len,
+                       mode_t mode, int flags) {
+    char tmp[512];
+    const char *p = data;
+    size_t left = len;
+    int fd, fsyncs = 0;
+
+    if (!path || (!data && len > 0)) return -1;
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return -1;
+
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd < 0) {
+        printf("[STORAGE] 打开 %s 失败: %s\n", tmp, strerror(errno));
+        return -1;
+    }
+    /* 不受 umask 影响, 与原文件权限一致 */
+    fchmod(fd, mode);
+
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    if (left == 0 && (flags & STORAGE_WRITE_SYNC)) {
+        if (fsync(fd) == 0) fsyncs++;
+    }
+    if (close(fd) != 0 || left > 0 || rename(tmp, path) != 0) {
+        printf("[STORAGE] 写入 %s 失败: %s\n", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    /* rename 本身也要落盘 */
+    if ((flags & STORAGE_WRITE_SYNC) && sync_parent_dir(path) == 0) fsyncs++;
+
+    storage_account(subsys, (long long)len, fsyncs);
+    return 0;
+}
+
+/* /proc/<pid>/io 中的 write_bytes (实际提交到块设备的字节数), 不可读时返回 -1 */
+static long long proc_write_bytes(const char *pid) {
+    char path[PATH_MAX], line[128];
+    long long value = -1;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/proc/%s/io", pid);
+    f = fopen(path, "r");
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "write_bytes: %lld", &value) == 1) break;
+    }
+    fclose(f);
+    return value;
+}
+
+/* 按进程名查找 pid, 未找到返回 0 */
+static int find_process(const char *comm, char *pid, size_t size) {
+    DIR *dir = opendir("/proc");
+    struct dirent *de;
+    int found = 0;
+
+    if (!dir) return 0;
+    while (!found && (de = readdir(dir)) != NULL) {
+        char path[PATH_MAX], name[32] = {0};
+        FILE *f;
+
+        if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+        snprintf(path, sizeof(path), "/proc/%s/comm", de->d_name);
+        f = fopen(path, "r");
+        if (!f) continue;
+        if (fgets(name, sizeof(name), f)) {
+            name[strcspn(name, "\n")] = '\0';
+            if (strcmp(name, comm) == 0 && strlen(de->d_name) < size) {
+                memcpy(pid, de->d_name, strlen(de->d_name) + 1);
+                found = 1;
+            }
+        }
+        fclose(f);
+    }
+    closedir(dir);
+    return found;
+}
+
+/* GET /api/storage/stats */
+void handle_storage_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    StorageCounter total = {0, 0, 0};
+    JsonWriter w;
+    char pid[16];
+    long long uptime_ms, vnstat_bytes = -1;
+    double days;
+
+    uptime_ms = get_current_ms() - g_start_ms;
+    days = uptime_ms > 0 ? uptime_ms / 86400000.0 : 0;
+    if (find_process("vnstatd", pid, sizeof(pid))) vnstat_bytes = proc_write_bytes(pid);
+
+    json_begin(&w, c, 200);
+    json_obj_begin(&w);
+    json_kv_int(&w, "Code", 0);
+    json_kv_str(&w, "Error", "");
+    json_key(&w, "Data");
+    json_obj_begin(&w);
+    json_kv_int(&w, "uptimeSec", uptime_ms / 1000);
+
+    json_key(&w, "subsystems");
+    json_arr_begin(&w);
+    for (int i = 0; i < STORAGE_COUNT; i++) {
+        StorageCounter sc;
+        sc.writes = __atomic_load_n(&g_counters[i].writes, __ATOMIC_RELAXED);
+        sc.bytes = __atomic_load_n(&g_counters[i].bytes, __ATOMIC_RELAXED);
+        sc.fsyncs = __atomic_load_n(&g_counters[i].fsyncs, __ATOMIC_RELAXED);
+        total.writes += sc.writes;
+        total.bytes += sc.bytes;
+        total.fsyncs += sc.fsyncs;
+
+        json_obj_begin(&w);
+        json_kv_str(&w, "name", g_subsys_names[i]);
+        json_kv_int(&w, "writes", sc.writes);
+        json_kv_int(&w, "bytes", sc.bytes);
+        json_kv_int(&w, "fsyncs", sc.fsyncs);
+        json_kv_int(&w, "bytesPerDay", days > 0 ? (long long)(sc.bytes / days) : 0);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+
+    json_kv_int(&w, "totalWrites", total.writes);
+    json_kv_int(&w, "totalBytes", total.bytes);
+    json_kv_int(&w, "totalFsyncs", total.fsyncs);
+    json_kv_int(&w, "totalBytesPerDay", days > 0 ? (long long)(total.bytes / days) : 0);
+    /* 块设备层的实际写入 (含文件系统开销), -1 表示内核未开启 IO 统计 */
+    json_kv_int(&w, "processWriteBytes", proc_write_bytes("self"));
+    json_kv_int(&w, "vnstatdWriteBytes", vnstat_bytes);
+    json_obj_end(&w);
+    json_obj_end(&w);
+    json_end(&w);
+}
@@ -7,12 +7,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <sys/utsname.h>
 #include <glib.h>
 #include "sysinfo.h"
 #include "dbus_core.h"
 #include "exec_utils.h"
 #include "ofono.h"
+#include "metrics.h"
+#include "at_sched.h"
 
 /* 读取文件内容 */
 static int read_file(const char *path, char *buf, size_t size) {
@@ -26,39 +31,20 @@ static int read_file(const char *path, char *buf, size_t size) {
 
 /* 解析 /proc/meminfo */
 static void parse_meminfo(SystemInfo *info) {
-    char buf[4096];
-    if (read_file("/proc/meminfo", buf, sizeof(buf)) != 0) return;
-
-    unsigned long buffers = 0;
-    char *line = strtok(buf, "\n");
-    while (line) {
-        unsigned long val;
-        if (sscanf(line, "MemTotal: %lu kB", &val) == 1) {
-            info->total_ram = val / 1024;
-        } else if (sscanf(line, "MemFree: %lu kB", &val) == 1) {
-            info->free_ram = val / 1024;
-        } else if (sscanf(line, "Cached: %lu kB", &val) == 1) {
-            info->cached_ram = val / 1024;
-        } else if (sscanf(line, "Buffers: %lu kB", &val) == 1) {
-            buffers = val / 1024;
-        }
-        line = strtok(NULL, "\n");
-    }
+    MemMetrics mem;
+    if (metrics_meminfo(&mem) != 0) return;
 
-    if (info->total_ram > 0) {
-        /* 计算已用内存 (Total - Free - Cached - Buffers) */
-        unsigned long used = info->total_ram - info->free_ram - info->cached_ram - buffers;
-        info->ram_percent = (double)used / info->total_ram * 100.0;
-        if (info->ram_percent < 0) info->ram_percent = 0;
-    }
+    info->total_ram = mem.total / 1024;
+    info->free_ram = mem.free / 1024;
+    info->cached_ram = mem.cached / 1024;
+
+    /* 计算已用内存 (Total - Free - Cached - Buffers) */
+    long used = (long)mem.total - (long)mem.free - (long)mem.cached - (long)mem.buffers;
+    info->ram_percent = used > 0 ? (double)used / mem.total * 100.0 : 0;
 }
 
 double get_uptime(void) {
-    char buf[64];
-    if (read_file("/proc/uptime", buf, sizeof(buf)) != 0) return -1;
-    double uptime;
-    if (sscanf(buf, "%lf", &uptime) == 1) return uptime;
-    return -1;
+    return metrics_uptime();
 }
 
 
@@ -130,15 +116,7 @@ int get_signal_strength(char *strength, size_t size) {
 }
 
 double get_thermal_temp(void) {
-    char output[64];
-    if (run_command(output, sizeof(output), "sh", "-c",
-        "cat /sys/class/thermal/thermal_zone*/temp | awk '{sum+=$1} END {printf \"%.2f\", sum/NR/1000}'",
-        NULL) != 0) {
-        return -1;
-    }
-    double temp;
-    if (sscanf(output, "%lf", &temp) == 1) return temp;
-    return -1;
+    return metrics_thermal_temp();
 }
 
 
@@ -149,33 +127,89 @@ extern int get_imsi(char *imsi, size_t size);
 extern const char *get_carrier_from_imsi(const char *imsi);
 extern int get_airplane_mode(void);
 
-#include <sys/time.h>
+/* ==================== 分级采样 ==================== */
 
-/* 缓存机制 */
-static SystemInfo g_cached_info;
-static long long g_last_update_ms = 0;
-#define CACHE_TTL_MS 1500
+/*
+ * 各组字段按各自的间隔在后台线程中采集, 写入私有工作副本后通过顺序锁
+ * 发布. 读者只复制已发布的快照, 不会因 AT/D-Bus/文件读取而阻塞.
+ */
 
-/* 获取当前毫秒时间戳 */
+typedef struct {
+    const char *name;
+    int interval_ms;
+    void (*collect)(SystemInfo *info);
+} SampleGroup;
+
+static void collect_identity(SystemInfo *info);
+static void collect_load(SystemInfo *info);
+static void collect_local(SystemInfo *info);
+static void collect_radio(SystemInfo *info);
+
+static const SampleGroup g_groups[SYSINFO_GROUP_COUNT] = {
+    [SYSINFO_GROUP_LOAD]     = {"load",     SYSINFO_LOAD_INTERVAL_MS,     collect_load},
+    [SYSINFO_GROUP_LOCAL]    = {"local",    SYSINFO_LOCAL_INTERVAL_MS,    collect_local},
+    [SYSINFO_GROUP_RADIO]    = {"radio",    SYSINFO_RADIO_INTERVAL_MS,    collect_radio},
+    [SYSINFO_GROUP_IDENTITY] = {"identity", SYSINFO_IDENTITY_INTERVAL_MS, collect_identity},
+};
+
+/* 已发布快照 (顺序锁: 偶数稳定, 奇数写入中) */
+static SystemInfo g_published;
+static unsigned int g_seq = 0;
+
+/* 工作副本, 持有 g_sysinfo_mutex 时访问 */
+static SystemInfo g_work;
+static pthread_mutex_t g_sysinfo_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_sysinfo_once = PTHREAD_ONCE_INIT;
+
+/* 调度状态, 持有 g_sampler_mutex 时访问 */
+static pthread_mutex_t g_sampler_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_sampler_cond;
+static pthread_t g_sampler_thread;
+static long long g_group_due[SYSINFO_GROUP_COUNT];     /* 0 表示立即采集 */
+static int g_sampler_stop = 0;
+static int g_sampler_running = 0;
+
+/* 单调时钟毫秒 */
 static long long get_current_ms(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-int get_system_info(SystemInfo *info) {
-    long long now = get_current_ms();
-    
-    /* 如果缓存未过期，直接返回 */
-    if (g_last_update_ms > 0 && (now - g_last_update_ms) < CACHE_TTL_MS) {
-        memcpy(info, &g_cached_info, sizeof(SystemInfo));
-        return 0;
+static void copy_str(char *dst, size_t size, const char *src) {
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+static void publish_snapshot(const SystemInfo *src) {
+    unsigned int seq = g_seq;
+
+    __atomic_store_n(&g_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&g_published, src, sizeof(SystemInfo));
+    __atomic_store_n(&g_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static void read_snapshot(SystemInfo *out) {
+    unsigned int s1, s2;
+
+    for (;;) {
+        s1 = __atomic_load_n(&g_seq, __ATOMIC_ACQUIRE);
+        if (!(s1 & 1)) {
+            memcpy(out, &g_published, sizeof(SystemInfo));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            s2 = __atomic_load_n(&g_seq, __ATOMIC_RELAXED);
+            if (s1 == s2) return;
+        }
+        /* 写者被抢占时让出 CPU, 单核上不空转整个时间片 */
+        sched_yield();
     }
+}
 
-    struct utsname uts;
-    char buf[256];
+/* 初始快照: 所有字段为默认值, 首次采样完成前读者得到 N/A */
+static void sysinfo_once_init(void) {
+    SystemInfo *info = &g_work;
 
-    /* 初始化默认值 */
     memset(info, 0, sizeof(SystemInfo));
     strcpy(info->hostname, "N/A");
     strcpy(info->sysname, "N/A");
@@ -194,103 +228,247 @@ int get_system_info(SystemInfo *info) {
     strcpy(info->network_type, "N/A");
     strcpy(info->network_band, "N/A");
     info->is_activated = 1;
+    publish_snapshot(info);
+}
 
-    /* uname 信息 */
-    if (uname(&uts) == 0) {
-        strncpy(info->sysname, uts.sysname, sizeof(info->sysname) - 1);
-        strncpy(info->release, uts.release, sizeof(info->release) - 1);
-        strncpy(info->version, uts.version, sizeof(info->version) - 1);
-        strncpy(info->machine, uts.machine, sizeof(info->machine) - 1);
-        strncpy(info->hostname, uts.nodename, sizeof(info->hostname) - 1);
-    }
-
-    /* 内存信息 */
-    parse_meminfo(info);
-
-    /* 运行时间 */
-    info->uptime = get_uptime();
+/* 设备标识: uname、序列号、IMEI/ICCID/IMSI, 只在换卡时变化 */
+static void collect_identity(SystemInfo *info) {
+    struct utsname uts;
 
-    /* 序列号 */
     get_serial(info->serial, sizeof(info->serial));
 
-    /* SIM 卡槽 */
-    char ril_path[32];
-    if (get_current_slot(info->sim_slot, ril_path) == 0) {
-        strncpy(info->network_mode, ril_path, sizeof(info->network_mode) - 1);
-    }
-
-    /* 信号强度 */
-    get_signal_strength(info->signal_strength, sizeof(info->signal_strength));
-
-    /* 温度 */
-    info->thermal_temp = get_thermal_temp();
-
-    /* 电源状态 */
-    if (read_file("/sys/class/power_supply/battery/status", buf, sizeof(buf)) == 0) {
-        buf[strcspn(buf, "\n")] = '\0';
-        strncpy(info->power_status, buf, sizeof(info->power_status) - 1);
+    if (uname(&uts) == 0) {
+        copy_str(info->sysname, sizeof(info->sysname), uts.sysname);
+        copy_str(info->release, sizeof(info->release), uts.release);
+        copy_str(info->version, sizeof(info->version), uts.version);
+        copy_str(info->machine, sizeof(info->machine), uts.machine);
+        copy_str(info->hostname, sizeof(info->hostname), uts.nodename);
     }
 
-    /* 电池健康 */
-    if (read_file("/sys/class/power_supply/battery/health", buf, sizeof(buf)) == 0) {
-        buf[strcspn(buf, "\n")] = '\0';
-        strncpy(info->battery_health, buf, sizeof(info->battery_health) - 1);
+    info->imei[0] = '\0';
+    info->iccid[0] = '\0';
+    info->imsi[0] = '\0';
+    info->carrier[0] = '\0';
+    get_imei(info->imei, sizeof(info->imei));
+    get_iccid(info->iccid, sizeof(info->iccid));
+    if (get_imsi(info->imsi, sizeof(info->imsi)) == 0) {
+        copy_str(info->carrier, sizeof(info->carrier), get_carrier_from_imsi(info->imsi));
     }
+}
 
-    /* 电池容量 */
-    if (read_file("/sys/class/power_supply/battery/capacity", buf, sizeof(buf)) == 0) {
-        info->battery_capacity = atoi(buf);
-    }
+/* 负载: 内存、运行时间、CPU (CPU 使用率为两次采样间的平均值) */
+static void collect_load(SystemInfo *info) {
+    parse_meminfo(info);
+    info->uptime = get_uptime();
+    info->cpu_usage = get_cpu_usage();
+}
 
-    /* IMEI */
-    get_imei(info->imei, sizeof(info->imei));
+/* 本地文件: 温度、电池、WiFi 配置 */
+static void collect_local(SystemInfo *info) {
+    BatteryMetrics bat;
+    char buf[256];
 
-    /* ICCID */
-    get_iccid(info->iccid, sizeof(info->iccid));
+    info->thermal_temp = get_thermal_temp();
 
-    /* IMSI 和运营商 */
-    if (get_imsi(info->imsi, sizeof(info->imsi)) == 0) {
-        const char *carrier = get_carrier_from_imsi(info->imsi);
-        strncpy(info->carrier, carrier, sizeof(info->carrier) - 1);
+    /* 电源状态/健康/容量来自同一个 uevent 文件, 一次读取 */
+    strcpy(info->power_status, "N/A");
+    strcpy(info->battery_health, "N/A");
+    info->battery_capacity = 0;
+    if (metrics_battery(&bat) == 0) {
+        copy_str(info->power_status, sizeof(info->power_status), bat.status);
+        copy_str(info->battery_health, sizeof(info->battery_health), bat.health);
+        info->battery_capacity = bat.capacity > 0 ? (unsigned int)bat.capacity : 0;
     }
 
-    /* 飞行模式 */
-    int airplane = get_airplane_mode();
-    info->airplane_mode = (airplane == 1) ? 1 : 0;
-
-    /* WiFi 信息 */
     if (read_file("/var/lib/connman/settings", buf, sizeof(buf)) == 0) {
         char *p = strstr(buf, "Tethering.Identifier=");
         if (p) {
             p += strlen("Tethering.Identifier=");
             char *end = strchr(p, '\n');
             if (end) *end = '\0';
-            strncpy(info->ssid, p, sizeof(info->ssid) - 1);
+            copy_str(info->ssid, sizeof(info->ssid), p);
         }
     }
+}
 
-    /* 网络模式选择 - 使用 ofono D-Bus 接口 */
+/* 射频: 卡槽、信号、飞行模式、网络模式/类型/频段、QoS */
+static void collect_radio(SystemInfo *info) {
+    char ril_path[32];
     char mode_buf[64] = {0};
+
+    strcpy(info->network_mode, "N/A");
+    if (get_current_slot(info->sim_slot, ril_path) == 0) {
+        copy_str(info->network_mode, sizeof(info->network_mode), ril_path);
+    }
+
+    get_signal_strength(info->signal_strength, sizeof(info->signal_strength));
+
+    info->airplane_mode = get_airplane_mode() == 1 ? 1 : 0;
+
+    strcpy(info->select_network_mode, "N/A");
     if (strcmp(ril_path, "unknown") != 0 && strlen(ril_path) > 0) {
         if (ofono_network_get_mode_sync(ril_path, mode_buf, sizeof(mode_buf), OFONO_TIMEOUT_MS) == 0) {
-            strncpy(info->select_network_mode, mode_buf, sizeof(info->select_network_mode) - 1);
+            copy_str(info->select_network_mode, sizeof(info->select_network_mode), mode_buf);
         }
     }
 
-    /* 网络类型和频段 */
+    strcpy(info->network_type, "N/A");
+    strcpy(info->network_band, "N/A");
     get_network_type_and_band(info->network_type, sizeof(info->network_type),
                               info->network_band, sizeof(info->network_band));
 
-    /* QoS 签约速率 */
     get_qos_info(&info->qci, &info->downlink_rate, &info->uplink_rate);
+}
 
-    /* CPU 使用率 */
-    info->cpu_usage = get_cpu_usage();
+/* 取出到期分组并安排下一次采集, 返回分组位图 */
+static unsigned int take_due_groups(long long now, long long *next_due) {
+    unsigned int due = 0;
+    long long next = -1;
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    for (int g = 0; g < SYSINFO_GROUP_COUNT; g++) {
+        if (g_group_due[g] <= now) {
+            due |= SYSINFO_GROUP_BIT(g);
+            g_group_due[g] = now + g_groups[g].interval_ms;
+        }
+        if (next < 0 || g_group_due[g] < next) next = g_group_due[g];
+    }
+    pthread_mutex_unlock(&g_sampler_mutex);
+
+    if (next_due) *next_due = next;
+    return due;
+}
+
+/* 采集指定分组, 每组完成后立即发布 (按枚举顺序, 快速的组先发布) */
+static void sample_groups(unsigned int groups) {
+    pthread_mutex_lock(&g_sysinfo_mutex);
+    for (int g = 0; g < SYSINFO_GROUP_COUNT; g++) {
+        if (!(groups & SYSINFO_GROUP_BIT(g))) continue;
+        g_groups[g].collect(&g_work);
+        publish_snapshot(&g_work);
+    }
+    pthread_mutex_unlock(&g_sysinfo_mutex);
+}
 
-    /* 更新缓存 */
-    memcpy(&g_cached_info, info, sizeof(SystemInfo));
-    g_last_update_ms = now;
+static void *sampler_thread(void *arg) {
+    (void)arg;
+
+    /* 周期采样的 AT 查询排在用户请求之后 */
+    at_sched_set_thread_priority(AT_PRIO_BACKGROUND);
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    while (!g_sampler_stop) {
+        long long next_due;
+        unsigned int due;
+        struct timespec ts;
+
+        pthread_mutex_unlock(&g_sampler_mutex);
+        due = take_due_groups(get_current_ms(), &next_due);
+        if (due) sample_groups(due);
+        pthread_mutex_lock(&g_sampler_mutex);
+
+        /* 采集期间可能有新的刷新请求 */
+        for (int g = 0; g < SYSINFO_GROUP_COUNT; g++) {
+            if (g_group_due[g] < next_due) next_due = g_group_due[g];
+        }
+        if (g_sampler_stop || next_due <= get_current_ms()) continue;
+
+        ts.tv_sec = next_due / 1000;
+        ts.tv_nsec = (next_due % 1000) * 1000000;
+        pthread_cond_timedwait(&g_sampler_cond, &g_sampler_mutex, &ts);
+    }
+    pthread_mutex_unlock(&g_sampler_mutex);
+    return NULL;
+}
+
+/*
+ * oFono 属性变化时立即刷新相关分组. 信号强度、小区等高频变化的属性
+ * 仍按 RADIO 周期采集, 避免每次变化都触发一轮 AT/D-Bus 查询.
+ */
+static void on_ofono_property(const char *path, const char *iface,
+                              const char *key, GVariant *value, void *user_data) {
+    static const char *radio_keys[] = {
+        "Online", "TechnologyPreference", "Status", "Technology", "Name", "Attached", NULL
+    };
+    (void)path; (void)value; (void)user_data;
+
+    if (strcmp(iface, "org.ofono.SimManager") == 0) {
+        if (strcmp(key, "CardIdentifier") == 0 || strcmp(key, "SubscriberIdentity") == 0 ||
+            strcmp(key, "Present") == 0) {
+            sysinfo_invalidate(SYSINFO_GROUP_BIT(SYSINFO_GROUP_IDENTITY));
+        }
+        return;
+    }
+    if (strcmp(iface, "org.ofono.ConnectionContext") == 0) return;
+
+    for (int i = 0; radio_keys[i]; i++) {
+        if (strcmp(key, radio_keys[i]) == 0) {
+            sysinfo_invalidate(SYSINFO_GROUP_BIT(SYSINFO_GROUP_RADIO));
+            return;
+        }
+    }
+}
 
+int sysinfo_sampler_start(void) {
+    static int observer_added = 0;
+    pthread_condattr_t attr;
+
+    pthread_once(&g_sysinfo_once, sysinfo_once_init);
+    if (g_sampler_running) return 0;
+
+    if (!observer_added) {
+        ofono_add_property_observer(on_ofono_property, NULL);
+        observer_added = 1;
+    }
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_sampler_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_sampler_stop = 0;
+    if (pthread_create(&g_sampler_thread, NULL, sampler_thread, NULL) != 0) {
+        printf("[SYSINFO] 创建采样线程失败\n");
+        pthread_cond_destroy(&g_sampler_cond);
+        return -1;
+    }
+    __atomic_store_n(&g_sampler_running, 1, __ATOMIC_RELEASE);
+    printf("[SYSINFO] 后台采样已启动\n");
+    return 0;
+}
+
+void sysinfo_sampler_stop(void) {
+    if (!g_sampler_running) return;
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    g_sampler_stop = 1;
+    pthread_cond_signal(&g_sampler_cond);
+    pthread_mutex_unlock(&g_sampler_mutex);
+
+    pthread_join(g_sampler_thread, NULL);
+    pthread_cond_destroy(&g_sampler_cond);
+    __atomic_store_n(&g_sampler_running, 0, __ATOMIC_RELEASE);
+}
+
+void sysinfo_invalidate(unsigned int groups) {
+    pthread_mutex_lock(&g_sampler_mutex);
+    for (int g = 0; g < SYSINFO_GROUP_COUNT; g++) {
+        if (groups & SYSINFO_GROUP_BIT(g)) g_group_due[g] = 0;
+    }
+    if (g_sampler_running) pthread_cond_signal(&g_sampler_cond);
+    pthread_mutex_unlock(&g_sampler_mutex);
+}
+
+int get_system_info(SystemInfo *info) {
+    pthread_once(&g_sysinfo_once, sysinfo_once_init);
+
+    /* 采样线程未运行 (启动前或启动失败) 时在调用线程上采集到期的分组 */
+    if (!__atomic_load_n(&g_sampler_running, __ATOMIC_ACQUIRE)) {
+        unsigned int due = take_due_groups(get_current_ms(), NULL);
+        if (due) sample_groups(due);
+    }
+
+    read_snapshot(info);
     return 0;
 }
 
@@ -364,30 +542,18 @@ static unsigned long long prev_softirq = 0, prev_steal = 0;
 static int cpu_initialized = 0;
 
 double get_cpu_usage(void) {
-    char buf[1024];
+    CpuMetrics cpu;
     unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-    
-    /* 读取 /proc/stat */
-    FILE *f = fopen("/proc/stat", "r");
-    if (!f) return 0;
-    
-    if (fgets(buf, sizeof(buf), f) == NULL) {
-        fclose(f);
-        return 0;
-    }
-    fclose(f);
-    
-    /* 解析第一行 cpu 数据 */
-    /* 格式: cpu  user nice system idle iowait irq softirq steal [guest guest_nice] */
-    int ret = sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
-                     &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-    if (ret < 4) return 0;
-    
-    /* 如果某些字段不存在，设为0 */
-    if (ret < 5) iowait = 0;
-    if (ret < 6) irq = 0;
-    if (ret < 7) softirq = 0;
-    if (ret < 8) steal = 0;
+
+    if (metrics_cpu(&cpu) != 0) return 0;
+    user = cpu.user;
+    nice = cpu.nice;
+    system = cpu.system;
+    idle = cpu.idle;
+    iowait = cpu.iowait;
+    irq = cpu.irq;
+    softirq = cpu.softirq;
+    steal = cpu.steal;
     
     /* 首次调用，保存数据并返回0 */
     if (!cpu_initialized) {
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <pthread.h>
 #include <sys/stat.h>
 #include <glib.h>
@@ -16,12 +17,19 @@
 #include "database.h"  /* 使用数据库配置函数 */
 #include "airplane.h"  /* 飞行模式控制 */
 #include "http_utils.h"
+#include "at_sched.h"
 
 #define VNSTAT_DB "/var/lib/vnstat/vnstat.db"
 #define NETWORK_IFACE "sipa_eth0"
 
+#define FLOW_CONTROL_INTERVAL_S 15
+
 static int is_flow_control_running = 0;
 static pthread_t flow_control_thread;
+/* 配置变化时唤醒流量控制线程, 不必等满一个周期 */
+static pthread_mutex_t flow_control_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flow_control_cond = PTHREAD_COND_INITIALIZER;
+static int flow_control_changed = 0;
 
 /* 流量配置 */
 typedef struct {
@@ -29,7 +37,7 @@ typedef struct {
     int switch_on;
 } TrafficConfig;
 
-/* 读取流量配置 - 从SQLite数据库读取 */
+/* 读取流量配置 - 从配置内存表读取 */
 static TrafficConfig read_traffic_config(void) {
     TrafficConfig config;
     config.much = config_get_ll("traffic_much", 0);
@@ -39,8 +47,8 @@ static TrafficConfig read_traffic_config(void) {
 
 /* 保存流量配置 - 写入SQLite数据库 */
 static void save_traffic_config(TrafficConfig *config) {
-    config_set_int("traffic_switch", config->switch_on);
     config_set_ll("traffic_much", config->much);
+    config_set_int("traffic_switch", config->switch_on);
 }
 
 
@@ -83,15 +91,38 @@ static void format_bytes(long long bytes, char *buf, size_t size) {
     snprintf(buf, size, "%.3f %s", value, units[idx]);
 }
 
+/* 等待下一个周期或配置变化 */
+static void flow_control_wait(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += FLOW_CONTROL_INTERVAL_S;
+    pthread_mutex_lock(&flow_control_mutex);
+    while (!flow_control_changed) {
+        if (pthread_cond_timedwait(&flow_control_cond, &flow_control_mutex, &ts) != 0) break;
+    }
+    flow_control_changed = 0;
+    pthread_mutex_unlock(&flow_control_mutex);
+}
+
 /* 流量控制线程 */
 static void *flow_control_thread_func(void *arg) {
     (void)arg;
+    at_sched_set_thread_priority(AT_PRIO_CONTROL);
     while (1) {
         TrafficConfig config = read_traffic_config();
         if (config.switch_on == 0) {
+            pthread_mutex_lock(&flow_control_mutex);
+            /* 退出前再确认一次, 避免与重新开启的配置错过 */
+            if (flow_control_changed) {
+                flow_control_changed = 0;
+                pthread_mutex_unlock(&flow_control_mutex);
+                continue;
+            }
+            is_flow_control_running = 0;
+            pthread_mutex_unlock(&flow_control_mutex);
             /* 关闭流量控制时，关闭飞行模式恢复网络 */
             set_airplane_mode(0);
-            is_flow_control_running = 0;
             break;
         }
 
@@ -104,11 +135,37 @@ static void *flow_control_thread_func(void *arg) {
         } else {
             set_airplane_mode(0);  /* 流量正常，关闭飞行模式 */
         }
-        sleep(15);
+        flow_control_wait();
     }
     return NULL;
 }
 
+/* 启动流量控制线程 (已在运行时唤醒它重新读取配置) */
+static void flow_control_kick(void) {
+    pthread_mutex_lock(&flow_control_mutex);
+    if (is_flow_control_running) {
+        flow_control_changed = 1;
+        pthread_cond_signal(&flow_control_cond);
+    } else if (read_traffic_config().switch_on) {
+        is_flow_control_running = 1;
+        flow_control_changed = 0;
+        if (pthread_create(&flow_control_thread, NULL, flow_control_thread_func, NULL) == 0) {
+            pthread_detach(flow_control_thread);
+        } else {
+            is_flow_control_running = 0;
+        }
+    }
+    pthread_mutex_unlock(&flow_control_mutex);
+}
+
+/* 流量配置变化: 开关或限额修改后立即生效 */
+static void on_traffic_config_changed(const char *key, const char *value, void *user_data) {
+    (void)value;
+    (void)user_data;
+    if (strncmp(key, "traffic_", 8) != 0) return;
+    flow_control_kick();
+}
+
 /* 初始化 vnstat 数据库 */
 static void init_vnstat_db(void) {
     struct stat st;
@@ -124,13 +181,9 @@ static void init_vnstat_db(void) {
 void init_traffic(void) {
     init_vnstat_db();
 
-    /* 启动流量控制 */
-    TrafficConfig config = read_traffic_config();
-    if (config.switch_on && !is_flow_control_running) {
-        is_flow_control_running = 1;
-        pthread_create(&flow_control_thread, NULL, flow_control_thread_func, NULL);
-        pthread_detach(flow_control_thread);
-    }
+    /* 启动流量控制, 之后由配置监听启停 */
+    config_add_listener(NULL, on_traffic_config_changed, NULL);
+    flow_control_kick();
     printf("流量统计已初始化\n");
 }
 
@@ -196,15 +249,12 @@ void handle_set_traffic_limit(struct mg_connection *c, struct mg_http_message *h
     TrafficConfig config;
     config.switch_on = atoi(switch_str);
     config.much = atoll(much_str);
+    /* 线程的启动与唤醒由配置监听完成 */
     save_traffic_config(&config);
 
     if (config.switch_on == 0) {
         /* 关闭流量控制时，立即关闭飞行模式恢复网络 */
         set_airplane_mode(0);
-    } else if (!is_flow_control_running) {
-        is_flow_control_running = 1;
-        pthread_create(&flow_control_thread, NULL, flow_control_thread_func, NULL);
-        pthread_detach(flow_control_thread);
     }
 
     HTTP_OK(c, "{\"success\":true,\"msg\":\"added ok\"}");
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Pack the built dashboard (web/dist) into a C source for packed_fs.c.
+
+Every file becomes a read-only byte array. Files that shrink by at least
+10% under gzip are stored compressed only; the server hands the stream out
+as-is to clients that accept gzip and inflates it for the rest. The index
+is sorted by path and carries the MIME type and strong ETags, so nothing
+has to be computed at runtime.
+
+Usage: pack_fs.py <dist_dir> <output.c>
+A missing dist directory produces an empty table (the server then falls
+back to reading ./dist at runtime).
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+MIME_TYPES = {
+    "html": "text/html; charset=utf-8",
+    "htm": "text/html; charset=utf-8",
+    "js": "text/javascript; charset=utf-8",
+    "mjs": "text/javascript; charset=utf-8",
+    "css": "text/css; charset=utf-8",
+    "json": "application/json",
+    "map": "application/json",
+    "webmanifest": "application/manifest+json",
+    "svg": "image/svg+xml",
+    "png": "image/png",
+    "jpg": "image/jpeg",
+    "jpeg": "image/jpeg",
+    "gif": "image/gif",
+    "webp": "image/webp",
+    "ico": "image/x-icon",
+    "woff": "font/woff",
+    "woff2": "font/woff2",
+    "ttf": "font/ttf",
+    "wasm": "application/wasm",
+    "txt": "text/plain; charset=utf-8",
+}
+
+# Keep the gzip stream only when it saves at least this fraction
+MIN_SAVING = 0.10
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def mime_of(path):
+    ext = path.rsplit(".", 1)[-1].lower() if "." in os.path.basename(path) else ""
+    return MIME_TYPES.get(ext, "application/octet-stream")
+
+
+def c_string(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def collect(root):
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in filenames:
+            full = os.path.join(dirpath, name)
+            rel = "/" + os.path.relpath(full, root).replace(os.sep, "/")
+            # Precompressed siblings from the frontend build are redundant here
+            if rel.endswith((".gz", ".br")) and os.path.exists(full[:-3]):
+                continue
+            files.append((rel, full))
+    files.sort(key=lambda f: f[0].encode("utf-8"))
+    return files
+
+
+def write_blob(out, name, data):
+    out.write("static const unsigned char %s[] = {\n" % name)
+    for i in range(0, len(data), 16):
+        out.write("    " + ",".join("0x%02x" % b for b in data[i:i + 16]) + ",\n")
+    if not data:
+        out.write("    0\n")
+    out.write("};\n\n")
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write("usage: %s <dist_dir> <output.c>\n" % sys.argv[0])
+        return 2
+
+    root, output = sys.argv[1], sys.argv[2]
+    files = collect(root) if os.path.isdir(root) else []
+    if not files:
+        sys.stderr.write("pack_fs: no files in %s, generating empty table\n" % root)
+
+    epoch = os.environ.get("SOURCE_DATE_EPOCH")
+    entries = []
+    total_raw = total_stored = 0
+
+    tmp = output + ".tmp"
+    with open(tmp, "w") as out:
+        out.write("/* Generated by tools/pack_fs.py from %s - do not edit */\n\n" % root)
+        out.write('#include "packed_fs.h"\n\n')
+
+        for i, (rel, full) in enumerate(files):
+            with open(full, "rb") as f:
+                raw = f.read()
+            packed = gzip.compress(raw, compresslevel=9, mtime=0)
+            use_gzip = len(packed) <= len(raw) * (1 - MIN_SAVING)
+            stored = packed if use_gzip else raw
+            digest = content_hash(raw)
+            mtime = int(epoch) if epoch else int(os.stat(full).st_mtime)
+
+            write_blob(out, "v%d" % i, stored)
+            entries.append((rel, "v%d" % i, len(stored), len(raw), use_gzip,
+                            mime_of(rel), digest, mtime))
+            total_raw += len(raw)
+            total_stored += len(stored)
+
+        out.write("const PackedFile g_packed_files[] = {\n")
+        for rel, var, size, raw_size, use_gzip, mime, digest, mtime in entries:
+            etag = '\\"%s\\"' % digest
+            etag_gzip = '"\\"%s-gz\\""' % digest if use_gzip else "NULL"
+            out.write('    {%s, %s, %d, %d, %d, %s, "%s", %s, %d},\n' % (
+                c_string(rel), var, size, raw_size, 1 if use_gzip else 0,
+                c_string(mime), etag, etag_gzip, mtime))
+        if not entries:
+            out.write("    {NULL, NULL, 0, 0, 0, NULL, NULL, NULL, 0},\n")
+        out.write("};\n\n")
+        out.write("const size_t g_packed_file_count = %d;\n" % len(entries))
+
+    os.replace(tmp, output)
+    sys.stderr.write("pack_fs: %d files, %d -> %d bytes\n" % (len(entries), total_raw, total_stored))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
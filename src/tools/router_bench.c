@@ -0,0 +1,137 @@
+/**
+ * @file router_bench.c
+ * @brief 路由查找基准测试 (在开发机上编译运行: make bench)
+ *
+ * 用 handlers/routes.def 中的同一张路由表编译前缀树, 对每条路由构造
+ * 一个请求 (通配段填入 "123", "*" 方法的路由使用 PATCH), 先校验命中的
+ * 正是该路由, 再计时 router_lookup. 另外计时几类未命中路径 (静态文件、
+ * 不存在的接口、超出深度), 前端静态资源的请求都要先经过一次未命中的查找.
+ *
+ * 用法: router_bench [每条路径的迭代次数, 默认 200000]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mongoose.h"
+#include "router.h"
+
+static void bench_handler(struct mg_connection *c, struct mg_http_message *hm) {
+    (void)c;
+    (void)hm;
+}
+
+static const Route g_routes[] = {
+#define ROUTE(method, path, handler, flags) {method, path, bench_handler, flags},
+#include "routes.def"
+#undef ROUTE
+};
+
+#define ROUTE_COUNT ((int)(sizeof(g_routes) / sizeof(g_routes[0])))
+
+static const char *const g_miss_paths[] = {
+    "/",
+    "/index.html",
+    "/assets/index-4f1c2a.js",
+    "/api/not_exist",
+    "/api/sms/1/2/3",
+    "/api/plugins/storage/a/b",
+};
+
+#define MISS_COUNT ((int)(sizeof(g_miss_paths) / sizeof(g_miss_paths[0])))
+
+static volatile const Route *g_sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* 路由路径中的 "*" 段替换为 "123" */
+static void build_uri(const char *path, char *buf, size_t size) {
+    size_t n = 0;
+
+    for (const char *p = path; *p && n + 4 < size; p++) {
+        if (*p == '*' && p[-1] == '/' && (p[1] == '/' || p[1] == '\0')) {
+            memcpy(buf + n, "123", 3);
+            n += 3;
+        } else {
+            buf[n++] = *p;
+        }
+    }
+    buf[n] = '\0';
+}
+
+/* 计时单个请求, 返回每次查找的纳秒数 */
+static double time_lookup(struct mg_str method, struct mg_str uri, long iters) {
+    RouteMatch match;
+    double start = now_ns();
+
+    for (long i = 0; i < iters; i++) {
+        router_lookup(method, uri, &match);
+        g_sink = match.route;
+    }
+    return (now_ns() - start) / (double)iters;
+}
+
+int main(int argc, char *argv[]) {
+    long iters = argc > 1 ? atol(argv[1]) : 200000;
+    double hit_total = 0, miss_total = 0, worst = 0;
+    const char *worst_path = "";
+    int errors = 0;
+
+    if (iters <= 0) iters = 200000;
+    if (router_init(g_routes, ROUTE_COUNT) != 0) {
+        fprintf(stderr, "router_init failed\n");
+        return 1;
+    }
+
+    printf("%-8s %-36s %10s\n", "method", "uri", "ns/lookup");
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        const Route *r = &g_routes[i];
+        const char *method = strcmp(r->method, "*") == 0 ? "PATCH" : r->method;
+        char uri[128];
+        RouteMatch match;
+        double ns;
+
+        build_uri(r->path, uri, sizeof(uri));
+        if (router_lookup(mg_str(method), mg_str(uri), &match) != 0 || match.route != r) {
+            fprintf(stderr, "MISMATCH %s %s -> %s\n", method, uri,
+                    match.route ? match.route->path : "(none)");
+            errors++;
+            continue;
+        }
+
+        ns = time_lookup(mg_str(method), mg_str(uri), iters);
+        hit_total += ns;
+        if (ns > worst) {
+            worst = ns;
+            worst_path = r->path;
+        }
+        printf("%-8s %-36s %10.1f\n", method, uri, ns);
+    }
+
+    printf("\n%-8s %-36s %10s\n", "miss", "uri", "ns/lookup");
+    for (int i = 0; i < MISS_COUNT; i++) {
+        RouteMatch match;
+        double ns;
+
+        if (router_lookup(mg_str("GET"), mg_str(g_miss_paths[i]), &match) == 0) {
+            fprintf(stderr, "UNEXPECTED HIT %s -> %s\n", g_miss_paths[i], match.route->path);
+            errors++;
+            continue;
+        }
+        ns = time_lookup(mg_str("GET"), mg_str(g_miss_paths[i]), iters);
+        miss_total += ns;
+        printf("%-8s %-36s %10.1f\n", "GET", g_miss_paths[i], ns);
+    }
+
+    printf("\nroutes: %d, iterations: %ld\n", ROUTE_COUNT, iters);
+    printf("hit  avg %.1f ns, worst %.1f ns (%s)\n", hit_total / ROUTE_COUNT, worst, worst_path);
+    printf("miss avg %.1f ns\n", miss_total / MISS_COUNT);
+
+    router_deinit();
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,414 @@
+/**
+ * @file spengmd_bench.c
+ * @brief AT+SPENGMD 解析器差分测试与基准测试 (在开发机上编译运行: make bench)
+ *
+ * 参照实现为重构前 handlers.c 中的 parse_cell_to_vec (strtok 切分到
+ * char[64][16][32] 表) 加上原调用方按下标取字段的逻辑. 对每个语料文件
+ * 比较两者在四种布局下的解析结果, 并计时语料对应布局的解析; 之后用
+ * 随机拼接的片段与语料变异做差分模糊测试.
+ *
+ * 语料 (tools/spengmd_corpus) 文件名以 AT 参数开头, 如 0_6_0_xxx.txt
+ * 对应 AT+SPENGMD=0,6,0, 内容为原始响应 (含 \r\n 与结尾的 OK).
+ *
+ * 用法: spengmd_bench [-f 模糊测试次数] [-n 基准迭代次数] 语料文件...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "spengmd.h"
+
+#define MAX_INPUT 4096
+
+/* ==================== 参照实现 ==================== */
+
+/* 原 parse_cell_to_vec, 按原样保留 */
+static int parse_cell_to_vec(const char *input, char data[64][16][32]) {
+    char cleaned[4096];
+    strncpy(cleaned, input, sizeof(cleaned) - 1);
+    cleaned[sizeof(cleaned) - 1] = '\0';
+
+    /* 去除 OK 和换行符 */
+    char *ok_pos = strstr(cleaned, "OK");
+    if (ok_pos) *ok_pos = '\0';
+
+    /* 替换 \r\n 为空 */
+    char *p = cleaned;
+    char *dst = cleaned;
+    while (*p) {
+        if (*p != '\r' && *p != '\n') {
+            *dst++ = *p;
+        }
+        p++;
+    }
+    *dst = '\0';
+
+    int row = 0;
+    int col = 0;
+    char current_part[4096] = {0};
+    int part_len = 0;
+    char prev_char = 0;
+
+    p = cleaned;
+    while (*p && row < 64) {
+        char c = *p;
+
+        if (c == '-') {
+            if (prev_char == ',') {
+                /* 规则2: ,- 作为负数处理 */
+                current_part[part_len++] = c;
+            } else if (*(p + 1) == '-') {
+                /* 规则3: -- 分割换行并保留第二个 - */
+                if (part_len > 0) {
+                    current_part[part_len] = '\0';
+                    /* 按逗号分割 */
+                    col = 0;
+                    char *token = strtok(current_part, ",");
+                    while (token && col < 16) {
+                        while (*token == ' ') token++;
+                        strncpy(data[row][col], token, 31);
+                        data[row][col][31] = '\0';
+                        col++;
+                        token = strtok(NULL, ",");
+                    }
+                    row++;
+                    part_len = 0;
+                }
+                current_part[part_len++] = '-';
+                p++; /* 跳过下一个 - */
+            } else {
+                /* 规则1: 单独 - 换行 */
+                if (part_len > 0) {
+                    current_part[part_len] = '\0';
+                    col = 0;
+                    char *token = strtok(current_part, ",");
+                    while (token && col < 16) {
+                        while (*token == ' ') token++;
+                        strncpy(data[row][col], token, 31);
+                        data[row][col][31] = '\0';
+                        col++;
+                        token = strtok(NULL, ",");
+                    }
+                    row++;
+                    part_len = 0;
+                }
+            }
+        } else {
+            current_part[part_len++] = c;
+        }
+        prev_char = c;
+        p++;
+    }
+
+    /* 处理最后剩余部分 */
+    if (part_len > 0 && row < 64) {
+        current_part[part_len] = '\0';
+        col = 0;
+        char *token = strtok(current_part, ",");
+        while (token && col < 16) {
+            while (*token == ' ') token++;
+            strncpy(data[row][col], token, 31);
+            data[row][col][31] = '\0';
+            col++;
+            token = strtok(NULL, ",");
+        }
+        row++;
+    }
+
+    return row;
+}
+
+static char g_table[64][16][32];
+
+static int ref_serving(const char *resp, SpengmdRat rat, SpengmdCell *cell) {
+    int sinr_row = rat == SPENGMD_NR ? 15 : 33;
+    int rows;
+
+    memset(g_table, 0, sizeof(g_table));
+    rows = parse_cell_to_vec(resp, g_table);
+    if (rows <= sinr_row) return -1;
+
+    cell->band = atoi(g_table[0][0]);
+    cell->arfcn = atoi(g_table[1][0]);
+    cell->pci = atoi(g_table[2][0]);
+    cell->rsrp = atof(g_table[3][0]) / 100.0;
+    cell->rsrq = atof(g_table[4][0]) / 100.0;
+    cell->sinr = atof(g_table[sinr_row][0]) / 100.0;
+    return 0;
+}
+
+static int ref_neighbors(const char *resp, SpengmdRat rat, SpengmdCell *cells, int max) {
+    int rows, n = 0;
+
+    memset(g_table, 0, sizeof(g_table));
+    rows = parse_cell_to_vec(resp, g_table);
+
+    if (rat == SPENGMD_NR) {
+        int columns = 0;
+
+        if (rows <= 5) return 0;
+        while (columns < 16 && g_table[0][columns][0]) columns++;
+        for (int i = 0; i < columns && n < max; i++) {
+            int arfcn = atoi(g_table[1][i]), pci = atoi(g_table[2][i]);
+            if (arfcn == 0 || pci == 0) continue;
+            cells[n].band = atoi(g_table[0][i]);
+            cells[n].arfcn = arfcn;
+            cells[n].pci = pci;
+            cells[n].rsrp = atof(g_table[3][i]) / 100.0;
+            cells[n].rsrq = atof(g_table[4][i]) / 100.0;
+            cells[n].sinr = atof(g_table[5][i]) / 100.0;
+            n++;
+        }
+        return n;
+    }
+
+    for (int i = 0; i < rows && n < max; i++) {
+        int arfcn = atoi(g_table[i][0]), pci = atoi(g_table[i][1]);
+        if (arfcn == 0 || pci == 0) continue;
+        cells[n].band = atoi(g_table[i][12]);
+        cells[n].arfcn = arfcn;
+        cells[n].pci = pci;
+        cells[n].rsrp = atof(g_table[i][2]) / 100.0;
+        cells[n].rsrq = atof(g_table[i][3]) / 100.0;
+        cells[n].sinr = atof(g_table[i][6]) / 100.0;
+        n++;
+    }
+    return n;
+}
+
+/* ==================== 差分比较 ==================== */
+
+/*
+ * 参照实现自身的限制 (64 行、16 列、单元格截断到 31 字节) 与 atoi 溢出
+ * 不属于需要复现的行为, 触及这些限制的输入不参与比较
+ */
+static int outside_reference(const char *resp) {
+    int run = 0;
+
+    memset(g_table, 0, sizeof(g_table));
+    if (parse_cell_to_vec(resp, g_table) >= 64) return 1;
+    for (int i = 0; i < 64; i++) {
+        if (g_table[i][15][0]) return 1;
+        for (int j = 0; j < 16; j++) {
+            if (strlen(g_table[i][j]) >= 31) return 1;
+        }
+    }
+    for (const char *p = resp; *p; p++) {
+        if (*p == '\r' || *p == '\n') continue;
+        run = (*p >= '0' && *p <= '9') ? run + 1 : 0;
+        if (run >= 9) return 1;
+    }
+    return 0;
+}
+
+static int same_cell(const SpengmdCell *a, const SpengmdCell *b) {
+    return a->band == b->band && a->arfcn == b->arfcn && a->pci == b->pci &&
+           fabs(a->rsrp - b->rsrp) < 1e-6 && fabs(a->rsrq - b->rsrq) < 1e-6 &&
+           fabs(a->sinr - b->sinr) < 1e-6;
+}
+
+/* 四种布局逐一比较, 返回不一致的数量 */
+static int diff_check(const char *resp, const char *label) {
+    int bad = 0;
+
+    for (int rat = SPENGMD_LTE; rat <= SPENGMD_NR; rat++) {
+        SpengmdCell ref_cells[SPENGMD_MAX_CELLS], new_cells[SPENGMD_MAX_CELLS];
+        SpengmdCell ref_cell, new_cell;
+        int r1, r2;
+
+        r1 = ref_serving(resp, (SpengmdRat)rat, &ref_cell);
+        r2 = spengmd_parse_serving(resp, (SpengmdRat)rat, &new_cell);
+        if (r1 != r2 || (r1 == 0 && !same_cell(&ref_cell, &new_cell))) {
+            printf("MISMATCH %s: serving rat=%d rc=%d/%d\n", label, rat, r1, r2);
+            bad++;
+        }
+
+        r1 = ref_neighbors(resp, (SpengmdRat)rat, ref_cells, SPENGMD_MAX_CELLS);
+        r2 = spengmd_parse_neighbors(resp, (SpengmdRat)rat, new_cells, SPENGMD_MAX_CELLS);
+        if (r1 != r2) {
+            printf("MISMATCH %s: neighbors rat=%d count=%d/%d\n", label, rat, r1, r2);
+            bad++;
+            continue;
+        }
+        for (int i = 0; i < r1; i++) {
+            if (!same_cell(&ref_cells[i], &new_cells[i])) {
+                printf("MISMATCH %s: neighbors rat=%d cell=%d\n", label, rat, i);
+                bad++;
+                break;
+            }
+        }
+    }
+    if (bad) printf("---- input ----\n%s\n---------------\n", resp);
+    return bad;
+}
+
+/* ==================== 基准 ==================== */
+
+typedef enum {
+    LAYOUT_UNKNOWN = 0,
+    LAYOUT_SERVING,
+    LAYOUT_NEIGHBORS
+} Layout;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* 由文件名中的 AT 参数确定布局 */
+static Layout layout_for(const char *path, SpengmdRat *rat) {
+    const char *name = strrchr(path, '/');
+
+    name = name ? name + 1 : path;
+    if (strncmp(name, "0_6_0", 5) == 0) { *rat = SPENGMD_LTE; return LAYOUT_SERVING; }
+    if (strncmp(name, "0_6_6", 5) == 0) { *rat = SPENGMD_LTE; return LAYOUT_NEIGHBORS; }
+    if (strncmp(name, "0_14_1", 6) == 0) { *rat = SPENGMD_NR; return LAYOUT_SERVING; }
+    if (strncmp(name, "0_14_2", 6) == 0) { *rat = SPENGMD_NR; return LAYOUT_NEIGHBORS; }
+    return LAYOUT_UNKNOWN;
+}
+
+static void bench_file(const char *path, const char *resp, long iters) {
+    SpengmdCell cells[SPENGMD_MAX_CELLS];
+    SpengmdRat rat = SPENGMD_LTE;
+    Layout layout = layout_for(path, &rat);
+    volatile int sink = 0;
+    double t0, t1, t2;
+
+    if (layout == LAYOUT_UNKNOWN) return;
+
+    t0 = now_ns();
+    for (long i = 0; i < iters; i++) {
+        if (layout == LAYOUT_SERVING) {
+            sink += ref_serving(resp, rat, cells) + cells[0].arfcn;
+        } else {
+            sink += ref_neighbors(resp, rat, cells, SPENGMD_MAX_CELLS);
+        }
+    }
+    t1 = now_ns();
+    for (long i = 0; i < iters; i++) {
+        if (layout == LAYOUT_SERVING) {
+            sink += spengmd_parse_serving(resp, rat, cells) + cells[0].arfcn;
+        } else {
+            sink += spengmd_parse_neighbors(resp, rat, cells, SPENGMD_MAX_CELLS);
+        }
+    }
+    t2 = now_ns();
+    (void)sink;
+
+    printf("%-36s old %8.0f ns  new %8.0f ns  %5.1fx\n", path,
+           (t1 - t0) / iters, (t2 - t1) / iters, (t1 - t0) / (t2 - t1));
+}
+
+/* ==================== 模糊测试 ==================== */
+
+static const char *const g_atoms[] = {
+    "-", "--", ",", ",-", "0", "1", "23", "456", "-7890", "10250",
+    "\r\n", " ", "OK", "O", "K", ".5", "a", "12345"
+};
+
+#define ATOM_COUNT ((int)(sizeof(g_atoms) / sizeof(g_atoms[0])))
+
+static void random_input(char *buf, size_t size) {
+    size_t len = 20 + (size_t)rand() % 600, n = 0;
+
+    buf[0] = '\0';
+    while (n < len && n + 8 < size) {
+        const char *atom = g_atoms[rand() % ATOM_COUNT];
+        if (strcmp(atom, "OK") == 0 && rand() % 20) continue;
+        n += (size_t)snprintf(buf + n, size - n, "%s", atom);
+    }
+}
+
+/* 对语料做少量插入/删除/覆盖 */
+static void mutate(const char *seed, char *buf, size_t size) {
+    size_t len;
+    int edits = 1 + rand() % 4;
+
+    snprintf(buf, size, "%s", seed);
+    len = strlen(buf);
+    for (int i = 0; i < edits; i++) {
+        size_t pos = len ? (size_t)rand() % len : 0;
+        const char *atom = g_atoms[rand() % ATOM_COUNT];
+        size_t alen = strlen(atom);
+
+        switch (rand() % 3) {
+        case 0:     /* 插入 */
+            if (len + alen + 1 >= size) break;
+            memmove(buf + pos + alen, buf + pos, len - pos + 1);
+            memcpy(buf + pos, atom, alen);
+            len += alen;
+            break;
+        case 1:     /* 删除 */
+            if (len == 0) break;
+            alen = 1 + (size_t)rand() % 4;
+            if (pos + alen > len) alen = len - pos;
+            memmove(buf + pos, buf + pos + alen, len - pos - alen + 1);
+            len -= alen;
+            break;
+        default:    /* 覆盖单个字符 */
+            if (len > 0) buf[pos] = atom[0];
+            break;
+        }
+    }
+}
+
+static int read_file(const char *path, char *buf, size_t size) {
+    FILE *f = fopen(path, "rb");
+    size_t n;
+
+    if (!f) return -1;
+    n = fread(buf, 1, size - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    return (int)n;
+}
+
+int main(int argc, char *argv[]) {
+    static char corpus[16][MAX_INPUT];
+    const char *names[16];
+    char buf[MAX_INPUT];
+    long fuzz_iters = 200000, bench_iters = 100000;
+    int count = 0, bad = 0, checked = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            fuzz_iters = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            bench_iters = atol(argv[++i]);
+        } else if (count < 16) {
+            if (read_file(argv[i], corpus[count], MAX_INPUT) < 0) {
+                fprintf(stderr, "cannot read %s\n", argv[i]);
+                return 1;
+            }
+            names[count++] = argv[i];
+        }
+    }
+    if (bench_iters <= 0) bench_iters = 1;
+
+    for (int i = 0; i < count; i++) {
+        bad += diff_check(corpus[i], names[i]);
+    }
+    printf("corpus: %d files, %d mismatches\n\n", count, bad);
+
+    for (int i = 0; i < count; i++) {
+        bench_file(names[i], corpus[i], bench_iters);
+    }
+
+    srand(1);
+    for (long i = 0; i < fuzz_iters && bad < 5; i++) {
+        if (count > 0 && rand() % 2) {
+            mutate(corpus[rand() % count], buf, sizeof(buf));
+        } else {
+            random_input(buf, sizeof(buf));
+        }
+        if (outside_reference(buf)) continue;
+        checked++;
+        bad += diff_check(buf, "fuzz");
+    }
+    printf("\nfuzz: %ld inputs, %d compared, %d mismatches\n", fuzz_iters, checked, bad);
+
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * 遥测推送订阅
+ * 所有组件共享一条 /api/ws/log WebSocket, 后端按主题推送完整数据和增量字段.
+ * 连接不可用时回退为组件原有的轮询.
+ */
+
+const RECONNECT_MAX_MS = 30000
+
+const topics = new Map()   // topic -> { data, listeners:Set, polls:Set }
+let socket = null
+let connected = false
+let reconnectTimer = null
+let reconnectDelay = 1000
+
+function getAuthToken() {
+  return localStorage.getItem('auth_token') || ''
+}
+
+function send(msg) {
+  if (socket && connected) socket.send(JSON.stringify(msg))
+}
+
+// 推送不可用时按组件提供的间隔轮询
+function startPolling(entry) {
+  entry.polls.forEach(p => {
+    if (!p.timer) p.timer = setInterval(p.fn, p.ms)
+  })
+}
+
+function stopPolling(entry) {
+  entry.polls.forEach(p => {
+    if (p.timer) {
+      clearInterval(p.timer)
+      p.timer = null
+    }
+  })
+}
+
+function scheduleReconnect() {
+  if (reconnectTimer || topics.size === 0) return
+  reconnectTimer = setTimeout(() => {
+    reconnectTimer = null
+    connect()
+  }, reconnectDelay)
+  reconnectDelay = Math.min(reconnectDelay * 2, RECONNECT_MAX_MS)
+}
+
+function isPlainObject(v) {
+  return v !== null && typeof v === 'object' && !Array.isArray(v)
+}
+
+// 增量帧与后端 frame_delta 对应: 顶层按字段合并, 接口信封中的 Data 两侧都是对象时再合并一层
+function mergeDelta(data, delta) {
+  const merged = { ...data, ...delta }
+  if (isPlainObject(delta.Data) && isPlainObject(data.Data)) {
+    merged.Data = { ...data.Data, ...delta.Data }
+  }
+  return merged
+}
+
+function handleFrame(frame) {
+  const entry = topics.get(frame.topic)
+  if (!entry || !frame.data) return
+  if (frame.full) {
+    entry.data = frame.data
+  } else if (entry.data) {
+    entry.data = mergeDelta(entry.data, frame.data)
+  } else {
+    return  // 尚未收到完整数据, 忽略增量
+  }
+  entry.listeners.forEach(cb => cb(entry.data))
+}
+
+function connect() {
+  const token = getAuthToken()
+  if (socket || !token || topics.size === 0) return
+
+  const proto = location.protocol === 'https:' ? 'wss:' : 'ws:'
+  socket = new WebSocket(`${proto}//${location.host}/api/ws/log?token=${encodeURIComponent(token)}`)
+
+  socket.onopen = () => {
+    connected = true
+    reconnectDelay = 1000
+    topics.forEach(stopPolling)
+    send({ sub: [...topics.keys()] })
+  }
+  socket.onmessage = (ev) => {
+    try {
+      handleFrame(JSON.parse(ev.data))
+    } catch (e) {
+      console.error('遥测帧解析失败:', e)
+    }
+  }
+  socket.onclose = () => {
+    socket = null
+    connected = false
+    topics.forEach(entry => {
+      entry.data = null
+      startPolling(entry)
+    })
+    scheduleReconnect()
+  }
+}
+
+/**
+ * 订阅主题 (info / band / cells / traffic / time)
+ * @param {string} topic 主题
+ * @param {Function} onData 收到数据时回调, 参数与对应 GET 接口响应体一致
+ * @param {Function} [pollFn] 推送不可用时的轮询函数
+ * @param {number} [pollMs] 轮询间隔
+ * @returns {Function} 取消订阅
+ */
+export function subscribeTelemetry(topic, onData, pollFn, pollMs = 5000) {
+  let entry = topics.get(topic)
+  if (!entry) {
+    entry = { data: null, listeners: new Set(), polls: new Set() }
+    topics.set(topic, entry)
+    send({ sub: [topic] })
+  }
+  entry.listeners.add(onData)
+  if (entry.data) onData(entry.data)
+
+  const poll = pollFn ? { fn: pollFn, ms: pollMs, timer: null } : null
+  if (poll) {
+    entry.polls.add(poll)
+    if (!connected) startPolling(entry)
+  }
+
+  connect()
+
+  return () => {
+    entry.listeners.delete(onData)
+    if (poll) {
+      if (poll.timer) clearInterval(poll.timer)
+      entry.polls.delete(poll)
+    }
+    if (entry.listeners.size === 0) {
+      topics.delete(topic)
+      send({ unsub: [topic] })
+      if (topics.size === 0 && socket) socket.close()
+    }
+  }
+}
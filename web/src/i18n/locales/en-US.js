@@ -303,6 +303,8 @@ export default {
     selectPlatform: 'Select Platform Template',
     enableWebhook: 'Enable Webhook Notification',
     enableWebhookDesc: 'Send notification when new SMS received',
+    tlsInsecure: 'Skip Certificate Verification',
+    tlsInsecureDesc: 'Only for HTTPS targets with a self-signed certificate',
     webhookUrl: 'Webhook URL',
     requestBody: 'Request Body (JSON)',
     requestBodyTip: 'Supported variables: #{sender}, #{content}, #{time}',
@@ -302,6 +302,8 @@ export default {
     selectPlatform: '选择平台模板',
     enableWebhook: '启用Webhook通知',
     enableWebhookDesc: '开启后将在收到新短信时发送通知',
+    tlsInsecure: '跳过证书校验',
+    tlsInsecureDesc: '仅用于使用自签名证书的 HTTPS 地址',
     webhookUrl: 'Webhook URL',
     requestBody: '请求体 (JSON)',
     requestBodyTip: '支持变量: #{sender}, #{content}, #{time}',
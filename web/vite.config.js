@@ -25,7 +25,8 @@ export default defineConfig({
     proxy: {
       '/api': {
         target: 'http://192.168.0.1:80',
-        changeOrigin: true
+        changeOrigin: true,
+        ws: true
       }
     }
   }